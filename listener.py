@@ -3,22 +3,29 @@ import socket
 Enhanced UDP Listener for GPS Logger Packets with IMU Data
 
 This script listens for UDP packets from an enhanced GPS logger device that includes
-both GPS data and IMU (accelerometer/gyroscope) data in a 40-byte packet format.
+both GPS data and IMU (accelerometer/gyroscope) data in a 44-byte packet format.
 
-Updated Packet Structure (40 bytes total):
-- 38 bytes payload:
+Updated Packet Structure (44 bytes total):
+- 42 bytes payload:
   * GPS data: timestamp(4), latitude(4), longitude(4), altitude(4), speed(2), heading(4), fix_type(1), satellites(1)
   * Battery data: voltage_mv(2), percentage(1)
   * IMU data: accel_x(2), accel_y(2), accel_z(2), gyro_x(2), gyro_y(2)
-  * Reserved byte(1)
-- 2 bytes CRC16 (little-endian, calculated over the 38-byte payload)
+  * PMU status byte(1)
+  * Sub-second GNSS-disciplined timestamp in microseconds(4)
+- 2 bytes CRC16 (little-endian, calculated over the 42-byte payload)
 
 Key Functions:
 - crc16_xmodem(data: bytes) -> int: Computes CRC16-XMODEM checksum for given data.
 
+Current firmware batches several records per datagram in a telemetry frame
+(src/telemetry_frame.h) with a device ID, frame sequence and timestamps; frames
+are split with record_codec.py, raw or delta-encoded (SET_ENCODING:NET:DELTA),
+back into 44-byte records. Per device the listener reports frame loss,
+reordering and latency (sample age and time in flight) every few seconds.
+
 Main Loop:
 - Receives UDP packets.
-- Validates packet length (40 bytes).
+- Validates packet length (44 bytes).
 - Extracts and verifies CRC.
 - Unpacks payload using struct format for GPS + IMU data.
 - Converts and prints all fields including motion data.
@@ -32,24 +39,34 @@ Dependencies:
 
 Note:
 - Updated for GPS logger v2.2 with MPU6000/MPU9250 IMU support
-- Now handles 40-byte packets with proper heading precision (uint32_t)
+- Now handles 44-byte packets with proper heading precision (uint32_t)
+  and microsecond timestamps
 - Handles both stationary and motion data
 - Calculates total acceleration magnitude for motion detection
 """
 import struct
 import binascii
 import math
+import time
+from record_codec import crc16, parse_schema, is_telemetry_frame, parse_telemetry_frame, FRAME_FLAG_DELTA
 from datetime import datetime
 
 UDP_IP = "0.0.0.0"
 UDP_PORT = 9000
 
-# Updated structure for 40-byte packets with uint32_t heading
-# Format: timestamp(4), lat(4), lon(4), alt(4), speed(2), heading(4), fix_type(1), sats(1),
-#         batt_mv(2), batt_pct(1), accel_x(2), accel_y(2), accel_z(2), gyro_x(2), gyro_y(2), reserved(1)
-STRUCT_FORMAT = "<IiiiHIBBHBhhhhhB"
-PAYLOAD_SIZE = 38  # Actual payload size
-TOTAL_PACKET_SIZE = 40  # Total packet size including CRC
+# Record layout, copied from the #SCHEMA line the firmware writes into log headers
+# (UDP packets carry no header). name:structcode:scale:unit, in wire order, CRC16 last.
+SCHEMA = ('gps v2 size=44 crc=42 fields='
+          'timestamp:I:1:s,latitude:i:1e-07:deg,longitude:i:1e-07:deg,altitude:i:0.001:m,'
+          'speed:H:0.001:m/s,heading:I:1e-05:deg,fixType:B:1:,satellites:B:1:,'
+          'battery_mv:H:1:mV,battery_pct:B:1:%,accel_x:h:0.001:g,accel_y:h:0.001:g,'
+          'accel_z:h:0.001:g,gyro_x:h:0.01:deg/s,gyro_y:h:0.01:deg/s,pmu_status:B:1:,'
+          'timestamp_us:I:1:us')
+RECORD_SCHEMA = parse_schema(SCHEMA)
+SCHEMA_FIELDS = [name for name, _, _, _ in RECORD_SCHEMA['fields']]
+STRUCT_FORMAT = RECORD_SCHEMA['format'][:-1]
+PAYLOAD_SIZE = RECORD_SCHEMA['crc']            # CRC covers the whole payload
+TOTAL_PACKET_SIZE = RECORD_SCHEMA['size']      # Total packet size including CRC
 
 print(f"🚀 Enhanced GPS Logger UDP Listener v2.3")
 print(f"📡 Listening on UDP {UDP_IP}:{UDP_PORT}...")
@@ -64,17 +81,8 @@ sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
 sock.bind((UDP_IP, UDP_PORT))
 
 def crc16_xmodem(data: bytes) -> int:
-    """Calculate CRC16-XMODEM checksum"""
-    crc = 0x0000
-    for byte in data:
-        crc ^= (byte << 8)
-        for _ in range(8):
-            if (crc & 0x8000):
-                crc = ((crc << 1) ^ 0x1021)
-            else:
-                crc <<= 1
-            crc &= 0xFFFF
-    return crc
+    """Calculate CRC16-XMODEM checksum (table-driven, in C)"""
+    return crc16(data)
 
 def classify_motion(magnitude):
     """Classify motion based on acceleration magnitude"""
@@ -148,20 +156,79 @@ def format_heading(heading_raw):
 packet_count = 0
 last_heading = None
 
-while True:
-    data, addr = sock.recvfrom(1024)
-    packet_count += 1
-    
-    print(f"\n📦 Packet #{packet_count} from {addr[0]}:{addr[1]}")
-    print(f"📏 Received {len(data)} bytes")
-    
-    if len(data) != TOTAL_PACKET_SIZE:
-        print(f"❌ Invalid packet size: {len(data)} bytes (expected {TOTAL_PACKET_SIZE})")
-        print(f"🔹 Raw HEX: {binascii.hexlify(data)}")
-        continue
+
+class LinkStats:
+    """Loss, reordering and latency of one device's frame sequence."""
+    REPORT_EVERY_S = 5.0
+    RESTART_GAP = 1000  # a sequence this far back means the device rebooted
+
+    def __init__(self, device_id):
+        self.device_id = device_id
+        self.top = None
+        self.missing = set()
+        self.frames = self.records = self.reordered = self.duplicates = 0
+        self.sample_age_ms = []
+        self.in_flight_ms = []
+        self.last_report = time.time()
+
+    def update(self, header, now_us):
+        """Account one frame; False for a duplicate."""
+        seq = header['sequence']
+        if self.top is None or seq + self.RESTART_GAP < self.top:
+            if self.top is not None:
+                print(f"🔄 Device {self.device_id:08X} restarted (sequence {self.top} -> {seq})")
+            self.top = seq
+            self.missing.clear()
+        elif seq > self.top:
+            self.missing.update(range(self.top + 1, seq))
+            self.top = seq
+        elif seq in self.missing:
+            self.missing.discard(seq)
+            self.reordered += 1
+        else:
+            self.duplicates += 1
+            return False
+        self.frames += 1
+        self.records += header['record_count']
+        # Device time is GNSS UTC; these assume the host clock is NTP-synced
+        if header['first_sample_us']:
+            self.sample_age_ms.append((now_us - header['first_sample_us']) / 1000.0)
+        if header['sent_us']:
+            self.in_flight_ms.append((now_us - header['sent_us']) / 1000.0)
+        return True
+
+    def report(self):
+        if time.time() - self.last_report < self.REPORT_EVERY_S:
+            return
+        self.last_report = time.time()
+        expected = self.frames + len(self.missing)
+        loss = 100.0 * len(self.missing) / expected if expected else 0.0
+
+        def summary(values):
+            if not values:
+                return "n/a"
+            return f"min {min(values):.0f} / avg {sum(values) / len(values):.0f} / max {max(values):.0f} ms"
+
+        print("=" * 60)
+        print(f"📶 LINK {self.device_id:08X}: {self.frames} frames, {self.records} records")
+        print(f"   Lost        : {len(self.missing)} frames ({loss:.2f}%)")
+        print(f"   Reordered   : {self.reordered}, duplicates: {self.duplicates}")
+        print(f"   Sample age  : {summary(self.sample_age_ms)}")
+        print(f"   In flight   : {summary(self.in_flight_ms)}")
+        print("=" * 60)
+        self.sample_age_ms.clear()
+        self.in_flight_ms.clear()
+
+
+links = {}
+
+
+def show_record(data):
+    """Verify and print one 44-byte record."""
+    global last_heading
 
     # Split payload and CRC
-    payload = data[:PAYLOAD_SIZE]  # First 38 bytes
+    payload = data[:PAYLOAD_SIZE]  # First 42 bytes
     crc_data = data[PAYLOAD_SIZE:TOTAL_PACKET_SIZE]  # Last 2 bytes
 
     # Verify CRC
@@ -177,19 +244,23 @@ while True:
             
     except Exception as e:
         print(f"❌ CRC processing error: {e}")
-        continue
+        return
 
     # Unpack the enhanced payload
     try:
         expected_size = struct.calcsize(STRUCT_FORMAT)
         if len(payload) != expected_size:
             print(f"⚠️ Size mismatch: payload={len(payload)}, format expects={expected_size}")
-            continue
+            return
         
-        fields = struct.unpack(STRUCT_FORMAT, payload)
+        fields = dict(zip(SCHEMA_FIELDS, struct.unpack(STRUCT_FORMAT, payload)))
         
-        (timestamp, lat, lon, alt, speed, heading_raw, fix_type, sats, 
-         batt_mv, batt_pct, accel_x, accel_y, accel_z, gyro_x, gyro_y, reserved) = fields
+        timestamp, lat, lon, alt = fields['timestamp'], fields['latitude'], fields['longitude'], fields['altitude']
+        speed, heading_raw, fix_type, sats = fields['speed'], fields['heading'], fields['fixType'], fields['satellites']
+        batt_mv, batt_pct = fields['battery_mv'], fields['battery_pct']
+        accel_x, accel_y, accel_z = fields['accel_x'], fields['accel_y'], fields['accel_z']
+        gyro_x, gyro_y = fields['gyro_x'], fields['gyro_y']
+        reserved, timestamp_us = fields['pmu_status'], fields['timestamp_us']
 
         # Convert GPS data to human-readable units
         lat_deg = lat / 1e7
@@ -211,6 +282,7 @@ while True:
         
         # Format timestamp
         time_str = datetime.utcfromtimestamp(timestamp).strftime('%Y-%m-%d %H:%M:%S')
+        time_str += f".{timestamp_us:06d}"
         
         # Check heading stability
         heading_status = ""
@@ -287,7 +359,40 @@ while True:
             byte_offset = i // 2
             print(f"   Bytes {byte_offset:2d}-{byte_offset+3:2d}: {chunk}")
             
-        continue
+        return
     except Exception as e:
         print(f"❌ Unexpected error: {e}")
-        continue
\ No newline at end of file
+        return
+
+
+while True:
+    data, addr = sock.recvfrom(2048)
+    now_us = int(time.time() * 1e6)
+    packet_count += 1
+    
+    print(f"\n📦 Packet #{packet_count} from {addr[0]}:{addr[1]}")
+    print(f"📏 Received {len(data)} bytes")
+    
+    if is_telemetry_frame(data):
+        try:
+            header, records = parse_telemetry_frame(data, RECORD_SCHEMA)
+        except (ValueError, struct.error) as e:
+            print(f"❌ Bad telemetry frame: {e}")
+            continue
+        link = links.setdefault(header['device_id'], LinkStats(header['device_id']))
+        fresh = link.update(header, now_us)
+        encoding = "delta" if header['flags'] & FRAME_FLAG_DELTA else "raw"
+        print(f"🧾 Frame #{header['sequence']} from {header['device_id']:08X}: "
+              f"{header['record_count']} {encoding} records in {len(data)} bytes")
+        if fresh:
+            for record in records:
+                show_record(record)
+        link.report()
+        continue
+
+    # Unbatched packets from older firmware
+    if len(data) != TOTAL_PACKET_SIZE:
+        print(f"❌ Invalid packet size: {len(data)} bytes (expected {TOTAL_PACKET_SIZE})")
+        print(f"🔹 Raw HEX: {binascii.hexlify(data)}")
+        continue
+    show_record(data)
@@ -3,112 +3,329 @@
 GPS BIN Parser
 
 This script reads a binary GPS log file produced by the ESP32 GPS logger.
-It skips the text header, parses each 38-byte record according to the packed
+It skips the text header, parses each record according to the packed
 `GPSPacket` structure, verifies the CRC16, and can output parsed data and
-statistics or save to CSV.
+statistics or save to CSV. V1.2 logs describe the record layout in a
+`#SCHEMA` header line; V1.0 (40-byte) and V1.1 (44-byte) logs use the
+built-in layouts below. Logs with an `#ENCODING delta` line hold
+keyframe/delta frames (record_codec.py) instead of fixed-size records.
+V2 logs are fixed-size blocks with their own CRC32 (src/log_block.h); a
+damaged block is skipped and reading resumes at the next intact one. A
+finished V2 log ends in a #SUMMARY block, flagged when the logger wrote it
+at boot while recovering a file cut off by a power loss.
+
+--range reads only the records between two UTC times (Unix seconds) of a
+V2 log, seeking to them through its .idx time index sidecar.
+
+--bench re-encodes a log's records as a delta stream and reports
+bytes/record against zlib and xz over the raw records, and encode time.
 """
 import struct
 import datetime
 import sys
+import time
+import zlib
+import lzma
+
+from record_codec import (crc16, parse_schema, StreamDecoder, StreamEncoder,
+                          LOG_BLOCK_SIZE, LOG_BLOCK_SYNC, LOG_BLOCK_DELTA, LOG_BLOCK_METADATA,
+                          LOG_BLOCK_RECORDS, LOG_BLOCK_SUMMARY, LOG_BLOCK_RECOVERED,
+                          LOG_RECORD_GPS, parse_log_block, find_log_block,
+                          log_block_records, log_index_range)
+
+# Constants matching the C struct layout, keyed by log header
+HEADER_V10 = b'GPS_LOG_V1.0\n'
+HEADER_V11 = b'GPS_LOG_V1.1\n'
+HEADER_V12 = b'GPS_LOG_V1.2\n'
+
+# Layouts of logs written before the #SCHEMA line, in the same syntax:
+# name version size=<bytes> crc=<crc offset> fields=name:structcode:scale:unit,...
+SCHEMA_V10 = ('gps v1 size=40 crc=38 fields='
+              'timestamp:I:1:s,latitude:i:1e-07:deg,longitude:i:1e-07:deg,altitude:i:0.001:m,'
+              'speed:H:0.001:m/s,heading:I:1e-05:deg,fixType:B:1:,satellites:B:1:,'
+              'battery_mv:H:1:mV,battery_pct:B:1:%,accel_x:h:0.001:g,accel_y:h:0.001:g,'
+              'accel_z:h:0.001:g,gyro_x:h:0.01:deg/s,gyro_y:h:0.01:deg/s,pmu_status:B:1:')
+SCHEMA_V11 = SCHEMA_V10.replace('v1 size=40 crc=38', 'v2 size=44 crc=42') + ',timestamp_us:I:1:us'
+SCHEMAS = {HEADER_V10: SCHEMA_V10, HEADER_V11: SCHEMA_V11}
+
+# Header lines that may precede the first record - a bare '#' could be record data
+METADATA_PREFIXES = (b'#BOOT ', b'#SCHEMA ', b'#ENCODING ')
+
 
-# Constants matching the C struct layout
-RECORD_SIZE = 38           # bytes per record (including CRC)
-HEADER_LINE = b'GPS_LOG_V1.0\n'
-
-# CRC16 parameters match the embedded implementation (poly 0x1021, init 0x0000)
-def crc16(data: bytes) -> int:
-    """Compute CRC-16 (poly=0x1021) over the given data."""
-    crc = 0x0000
-    for b in data:
-        crc ^= (b << 8)
-        for _ in range(8):
-            if crc & 0x8000:
-                crc = ((crc << 1) & 0xFFFF) ^ 0x1021
-            else:
-                crc = (crc << 1) & 0xFFFF
-    return crc
-
-# Struct format: little-endian
-# Fields: timestamp, lat, lon, alt, speed, heading,
-#         fixType, satellites, battery_mv, battery_pct,
-#         accel_x, accel_y, accel_z, gyro_x, gyro_y,
-#         reserved1, crc
-FMT = '<IiiiHHBBHBhhhhhBH'
-
-def parse_record(chunk: bytes) -> dict:
+# Fields with a dedicated output column; anything else is added scaled, by name
+KNOWN_FIELDS = {'timestamp', 'timestamp_us', 'latitude', 'longitude', 'altitude', 'speed',
+                'heading', 'fixType', 'satellites', 'battery_mv', 'battery_pct',
+                'accel_x', 'accel_y', 'accel_z', 'gyro_x', 'gyro_y', 'pmu_status'}
+
+
+def parse_record(chunk: bytes, schema: dict = None) -> dict:
     """Unpack a single record and verify its CRC."""
-    if len(chunk) != RECORD_SIZE:
-        raise ValueError(f"Invalid record size: expected {RECORD_SIZE}, got {len(chunk)}")
-    # Unpack all fields including CRC
-    fields = struct.unpack(FMT, chunk)
-    (timestamp, lat, lon, alt,
-     speed, heading,
-     fixType, sats,
-     batt_mv, batt_pct,
-     accel_x, accel_y, accel_z, gyro_x, gyro_y,
-     reserved1, crc_stored) = fields
-
-    # Verify CRC over payload (all but last 2 bytes)
-    payload = chunk[:-2]
-    crc_calc = crc16(payload)
-
-    return {
+    if schema is None:
+        schema = parse_schema(SCHEMA_V11)
+    if len(chunk) != schema['size']:
+        raise ValueError(f"Invalid record size: expected {schema['size']}, got {len(chunk)}")
+    values = struct.unpack(schema['format'], chunk)
+    raw = {name: value for (name, _, _, _), value in zip(schema['fields'], values)}
+    crc_stored = values[-1]
+
+    # Verify CRC over payload (everything before the CRC)
+    crc_calc = crc16(chunk[:schema['crc']])
+
+    timestamp = raw.get('timestamp', 0) + raw.get('timestamp_us', 0) / 1e6
+    speed = raw.get('speed', 0)
+    batt_mv = raw.get('battery_mv', 0)
+    record = {
         'timestamp': timestamp,
         'datetime_utc': datetime.datetime.utcfromtimestamp(timestamp),
-        'latitude': lat * 1e-7,
-        'longitude': lon * 1e-7,
-        'altitude_m': alt / 1000.0,
+        'latitude': raw.get('latitude', 0) * 1e-7,
+        'longitude': raw.get('longitude', 0) * 1e-7,
+        'altitude_m': raw.get('altitude', 0) / 1000.0,
         'speed_m_s': speed / 1000.0,
         'speed_kmh': speed * 3.6 / 1000.0,
-        'heading_deg': heading / 100.0,
-        'fix_type': fixType,
-        'satellites': sats,
+        'heading_deg': raw.get('heading', 0) / 100000.0,
+        'fix_type': raw.get('fixType', 0),
+        'satellites': raw.get('satellites', 0),
         'battery_mv': batt_mv,
         'battery_v': batt_mv / 1000.0,
-        'battery_pct': batt_pct,
-        'accel_x_g': accel_x / 1000.0,
-        'accel_y_g': accel_y / 1000.0,
-        'accel_z_g': accel_z / 1000.0,
-        'gyro_x_dps': gyro_x / 100.0,
-        'gyro_y_dps': gyro_y / 100.0,
-        'crc_stored': crc_stored,
-        'crc_calc': crc_calc,
-        'crc_ok': crc_stored == crc_calc,
+        'battery_pct': raw.get('battery_pct', 0),
+        'accel_x_g': raw.get('accel_x', 0) / 1000.0,
+        'accel_y_g': raw.get('accel_y', 0) / 1000.0,
+        'accel_z_g': raw.get('accel_z', 0) / 1000.0,
+        'gyro_x_dps': raw.get('gyro_x', 0) / 100.0,
+        'gyro_y_dps': raw.get('gyro_y', 0) / 100.0,
+        'pmu_status': raw.get('pmu_status', 0),
     }
+    for name, _, scale, _ in schema['fields']:
+        if name not in KNOWN_FIELDS:
+            record[name] = raw[name] * scale
+    record['crc_stored'] = crc_stored
+    record['crc_calc'] = crc_calc
+    record['crc_ok'] = crc_stored == crc_calc
+    return record
+
+
+def read_block_log(data: bytes, ranged: bool = False):
+    """Read a V2 block log; returns its schema and the raw bytes of every record."""
+    schema = None
+    chunks = []
+    damaged = skipped = gaps = bad_entries = unwritten = 0
+    previous = previous_kind = None
+    pos = 0
+    while pos + LOG_BLOCK_SIZE <= len(data):
+        block = parse_log_block(data, pos)
+        if block is None:
+            if not any(data[pos:pos + LOG_BLOCK_SIZE]):
+                # Unwritten space of a preallocated file that was not trimmed
+                unwritten += LOG_BLOCK_SIZE
+                pos += LOG_BLOCK_SIZE
+                continue
+            damaged += 1
+            following = find_log_block(data, pos + 1)
+            skipped += following - pos
+            pos = following
+            continue
+        header, payload = block
+        pos += LOG_BLOCK_SIZE
+        # A range skips from the metadata block to its first block
+        if previous is not None and header['sequence'] != (previous + 1) & 0xFFFFFFFF and \
+                not (ranged and previous_kind == LOG_BLOCK_METADATA):
+            gaps += 1
+        previous = header['sequence']
+        previous_kind = header['kind']
 
+        if header['kind'] == LOG_BLOCK_METADATA:
+            for line in payload.decode('ascii', errors='replace').splitlines():
+                if line.startswith('#BOOT '):
+                    print(f"Boot timeline: {line[6:]}")
+                elif line.startswith('#SCHEMA ') and schema is None:
+                    schema = parse_schema(line[8:])
+                    print(f"Record schema: {schema['name']} v{schema['version']}, {schema['size']} bytes, blocks")
+            continue
+        if header['kind'] == LOG_BLOCK_SUMMARY:
+            line = payload.decode('ascii', errors='replace').strip()
+            recovered = " (recovered after a power loss)" if header['flags'] & LOG_BLOCK_RECOVERED else ""
+            print(f"File summary{recovered}: {line[9:] if line.startswith('#SUMMARY ') else line}")
+            continue
+        if header['kind'] != LOG_BLOCK_RECORDS or schema is None:
+            continue
+        # Each block stands alone - delta blocks start with a keyframe
+        decoder = StreamDecoder(schema) if header['flags'] & LOG_BLOCK_DELTA else None
+        try:
+            for record_type, record in log_block_records(payload):
+                if record_type != LOG_RECORD_GPS:
+                    continue
+                if decoder is None:
+                    chunks.append(record)
+                    continue
+                status, _, chunk = decoder.decode(record)
+                if status == StreamDecoder.RECORD:
+                    chunks.append(chunk)
+                else:
+                    bad_entries += 1
+        except ValueError:
+            bad_entries += 1
 
-def parse_file(path: str) -> list:
-    """Read and parse all records from a GPS log file."""
-    records = []
+    if schema is None:
+        raise ValueError("V2 log without a metadata block holding #SCHEMA")
+    if damaged or gaps or bad_entries:
+        print(f"Warning: {damaged} damaged blocks ({skipped} bytes skipped), {gaps} sequence gaps, "
+              f"{bad_entries} undecodable records", file=sys.stderr)
+    if unwritten:
+        print(f"Unwritten space at the end: {unwritten} bytes")
+    return schema, chunks
+
+
+def read_block_range(f, path: str, from_us: int, to_us: int):
+    """Read the metadata block and the blocks of a V2 log holding from_us..to_us, via its .idx sidecar."""
+    metadata = f.read(LOG_BLOCK_SIZE)
+    block = parse_log_block(metadata)
+    if block is None or block[0]['kind'] != LOG_BLOCK_METADATA:
+        raise ValueError("V2 log without an intact metadata block")
+    f.seek(0, 2)
+    block_count = f.tell() // LOG_BLOCK_SIZE
+    index_path = path.rsplit('.', 1)[0] + '.idx'
+    try:
+        with open(index_path, 'rb') as index_file:
+            found = log_index_range(index_file, block[0]['sequence'], block_count, from_us, to_us)
+    except FileNotFoundError:
+        found = None
+    if found is None:
+        raise ValueError(f"No index of {path} at {index_path}")
+    first, end = found
+    print(f"Range: blocks {first}-{end} of {block_count}")
+    f.seek(first * LOG_BLOCK_SIZE)
+    return read_block_log(metadata + f.read((end - first) * LOG_BLOCK_SIZE), ranged=True)
+
+
+def read_records(path: str, time_range=None):
+    """Read a GPS log file; returns its schema and the raw bytes of every record.
+
+    time_range (from_us, to_us) reads only the blocks of a V2 log covering it.
+    """
+    chunks = []
     with open(path, 'rb') as f:
+        if f.peek(4)[:4] == LOG_BLOCK_SYNC:
+            if time_range:
+                return read_block_range(f, path, *time_range)
+            return read_block_log(f.read())
+        if time_range:
+            raise ValueError("--range needs a V2 log")
         # Skip the text header line
         header = f.readline()
-        if header != HEADER_LINE:
+        descriptor = SCHEMAS.get(header)
+        if descriptor is None and header != HEADER_V12:
             print(f"Warning: unexpected header: {header!r}", file=sys.stderr)
+            descriptor = SCHEMA_V11
+        encoding = 'raw'
+        # Metadata lines (boot timeline, record schema, encoding) before the first record
+        while f.peek(10)[:10].startswith(METADATA_PREFIXES):
+            line = f.readline().decode('ascii').strip()
+            if line.startswith('#BOOT '):
+                print(f"Boot timeline: {line[6:]}")
+            elif line.startswith('#SCHEMA '):
+                descriptor = line[8:]
+            elif line.startswith('#ENCODING '):
+                encoding = line.split()[1]
+        if descriptor is None:
+            raise ValueError("V1.2 log without a #SCHEMA line")
+        schema = parse_schema(descriptor)
+        print(f"Record schema: {schema['name']} v{schema['version']}, {schema['size']} bytes, {encoding}")
+        record_size = schema['size']
+        if encoding == 'delta':
+            data = f.read()
+            decoder = StreamDecoder(schema)
+            pos = 0
+            while pos < len(data):
+                status, pos, chunk = decoder.decode(data, pos)
+                if status == StreamDecoder.RECORD:
+                    chunks.append(chunk)
+                elif status == StreamDecoder.INCOMPLETE:
+                    print(f"Warning: incomplete frame at byte {pos}", file=sys.stderr)
+                    break
+                elif status == StreamDecoder.ERROR:
+                    print(f"Warning: bad frame at byte {pos - 1}", file=sys.stderr)
+            if decoder.skipped:
+                print(f"Warning: {decoder.skipped} frames skipped waiting for a keyframe", file=sys.stderr)
+            return schema, chunks
         # Read records
         idx = 0
         while True:
-            chunk = f.read(RECORD_SIZE)
+            chunk = f.read(record_size)
             if not chunk:
                 break
-            if len(chunk) != RECORD_SIZE:
+            if len(chunk) != record_size:
                 print(f"Warning: incomplete record at index {idx}", file=sys.stderr)
                 break
-            rec = parse_record(chunk)
-            records.append(rec)
+            chunks.append(chunk)
             idx += 1
+    return schema, chunks
+
+
+def parse_file(path: str, time_range=None) -> list:
+    """Read and parse all records from a GPS log file, or those in time_range (from_us, to_us)."""
+    schema, chunks = read_records(path, time_range)
+    records = [parse_record(chunk, schema) for chunk in chunks]
+    if time_range:
+        # The blocks read may hold a little either side of the range
+        records = [r for r in records if time_range[0] <= r['timestamp'] * 1e6 <= time_range[1]]
     return records
 
 
+def bench_stream(path: str):
+    """Re-encode a log as a delta stream: size per record, encode time, round trip."""
+    schema, chunks = read_records(path)
+    if not chunks:
+        print("No records")
+        return
+    encoder = StreamEncoder(schema)
+    start = time.perf_counter_ns()
+    frames = [encoder.encode(chunk) for chunk in chunks]
+    elapsed = time.perf_counter_ns() - start
+    stream = b''.join(frames)
+
+    decoder = StreamDecoder(schema)
+    pos, decoded = 0, []
+    while pos < len(stream):
+        status, pos, chunk = decoder.decode(stream, pos)
+        if status != StreamDecoder.RECORD:
+            break
+        decoded.append(chunk)
+
+    raw = schema['size']
+    per_record = len(stream) / len(chunks)
+    print(f"Records       : {len(chunks)}")
+    print(f"Raw           : {raw} bytes/record, {raw * len(chunks)} bytes")
+    print(f"Delta stream  : {per_record:.2f} bytes/record, {len(stream)} bytes ({raw / per_record:.2f}x smaller)")
+    # General-purpose compressors over the whole raw file, for comparison - the
+    # device cannot run them per record, but they bound what is in the data
+    raw_stream = b''.join(chunks)
+    for name, packed in (('zlib -9', zlib.compress(raw_stream, 9)), ('xz -9', lzma.compress(raw_stream, preset=9))):
+        size = len(packed) / len(chunks)
+        print(f"{name:<14}: {size:.2f} bytes/record ({raw / size:.2f}x smaller)")
+    print(f"Encode (py)   : {elapsed / len(chunks):.0f} ns/record")
+    print(f"Round trip    : {'ok' if decoded == chunks else 'MISMATCH'}")
+
+
 def main():
     if len(sys.argv) < 2:
         print(f"Usage: {sys.argv[0]} <input.bin> [output.csv]")
+        print(f"       {sys.argv[0]} --range <from_utc_s> <to_utc_s> <input.bin> [output.csv]")
+        print(f"       {sys.argv[0]} --bench <input.bin>")
         sys.exit(1)
 
-    in_path = sys.argv[1]
-    out_csv = sys.argv[2] if len(sys.argv) > 2 else None
+    if sys.argv[1] == '--bench':
+        bench_stream(sys.argv[2])
+        return
+
+    args = sys.argv[1:]
+    time_range = None
+    if args[0] == '--range':
+        time_range = (int(float(args[1]) * 1e6), int(float(args[2]) * 1e6))
+        args = args[3:]
+    in_path = args[0]
+    out_csv = args[1] if len(args) > 1 else None
 
-    recs = parse_file(in_path)
+    recs = parse_file(in_path, time_range)
     print(f"Total records parsed: {len(recs)}")
     if recs:
         t0 = recs[0]['datetime_utc']
@@ -0,0 +1,330 @@
+#!/usr/bin/env python3
+"""
+GPS record codec shared by parser.py and listener.py
+
+Mirrors src/packet_schema.h and src/record_stream.h on the device:
+- parse_schema() reads the #SCHEMA descriptor written into log headers
+- StreamDecoder turns keyframe/delta frames back into GPSPacket bytes
+- StreamEncoder produces the same frames, for benchmarks on existing logs
+- parse_telemetry_frame() splits a batched UDP frame into its records
+- parse_log_block() checks one block of a V2 log file
+"""
+import binascii
+import struct
+
+STREAM_VERSION = 1
+FRAME_KEY = 0
+FRAME_DELTA = 1
+
+# Fields extrapolated from their previous two values (device: GPS_STREAM_LINEAR_FIELDS)
+LINEAR_FIELDS = ('timestamp', 'timestamp_us', 'latitude', 'longitude', 'altitude')
+KEYFRAME_INTERVAL = 25
+
+
+def crc16(data: bytes) -> int:
+    """CRC-16/XMODEM (poly 0x1021, init 0x0000), table-driven in C."""
+    return binascii.crc_hqx(data, 0x0000)
+
+
+def parse_schema(descriptor: str) -> dict:
+    """Turn a #SCHEMA descriptor into a struct format and field list."""
+    parts = descriptor.split()
+    schema = {'name': parts[0], 'version': int(parts[1].lstrip('v')), 'fields': []}
+    for part in parts[2:]:
+        key, value = part.split('=', 1)
+        if key == 'fields':
+            for field in value.split(','):
+                name, code, scale, unit = field.split(':')
+                schema['fields'].append((name, code, float(scale), unit))
+        else:
+            schema[key] = int(value)
+    # Records without crc= (USB stream IMU samples) have no CRC16 trailer
+    schema['format'] = '<' + ''.join(code for _, code, _, _ in schema['fields']) + ('H' if 'crc' in schema else '')
+    if struct.calcsize(schema['format']) != schema['size']:
+        raise ValueError(f"Schema fields do not add up to {schema['size']} bytes")
+    return schema
+
+
+def linear_mask(schema: dict) -> int:
+    return sum(1 << i for i, (name, _, _, _) in enumerate(schema['fields']) if name in LINEAR_FIELDS)
+
+
+def _zigzag(v: int) -> int:
+    return (v << 1) ^ (v >> 63)
+
+
+def _unzigzag(v: int) -> int:
+    return (v >> 1) ^ -(v & 1)
+
+
+def _put_varint(out: bytearray, v: int):
+    v &= (1 << 64) - 1
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+
+
+def _get_varint(data, pos: int):
+    """Returns (value, new position), or None if the data ends first."""
+    v = 0
+    for n in range(10):
+        if pos + n >= len(data):
+            return None
+        b = data[pos + n]
+        v |= (b & 0x7F) << (7 * n)
+        if not b & 0x80:
+            return v, pos + n + 1
+    return None
+
+
+def _fields_of(schema: dict, record: bytes) -> list:
+    return list(struct.unpack(schema['format'], record)[:-1])
+
+
+def _seal(schema: dict, values: list) -> bytes:
+    payload = struct.pack(schema['format'][:-1], *values)
+    return payload + struct.pack('<H', crc16(payload[:schema['crc']]))
+
+
+class StreamEncoder:
+    def __init__(self, schema: dict, linear: int = None, keyframe_interval: int = KEYFRAME_INTERVAL):
+        self.schema = schema
+        self.linear = linear_mask(schema) if linear is None else linear
+        self.keyframe_interval = keyframe_interval
+        self.since_keyframe = 0
+        self.sequence = 0
+        self.need_keyframe = True
+        self.previous = []
+        self.slope = []
+
+    def encode(self, record: bytes) -> bytes:
+        values = _fields_of(self.schema, record)
+        key = self.need_keyframe or self.since_keyframe >= self.keyframe_interval
+        out = bytearray([((FRAME_KEY if key else FRAME_DELTA) << 6) | (self.sequence & 0x3F)])
+        self.sequence += 1
+        if key:
+            _put_varint(out, self.linear)
+            out.append(len(values))
+            for v in values:
+                _put_varint(out, _zigzag(v))
+            self.previous = values
+            self.slope = [0] * len(values)
+            self.need_keyframe = False
+            self.since_keyframe = 0
+        else:
+            changed = 0
+            residuals = bytearray()
+            for i, v in enumerate(values):
+                predicted = self.previous[i] + (self.slope[i] if (self.linear >> i) & 1 else 0)
+                if v != predicted:
+                    changed |= 1 << i
+                    _put_varint(residuals, _zigzag(v - predicted))
+                self.slope[i] = v - self.previous[i]
+                self.previous[i] = v
+            _put_varint(out, changed)
+            out += residuals
+        self.since_keyframe += 1
+        return bytes(out)
+
+
+class StreamDecoder:
+    RECORD, SKIPPED, INCOMPLETE, ERROR = range(4)
+
+    def __init__(self, schema: dict):
+        self.schema = schema
+        self.count = len(schema['fields'])
+        self.linear = 0
+        self.synced = False
+        self.sequence = 0
+        self.previous = [0] * self.count
+        self.slope = [0] * self.count
+        self.skipped = 0
+
+    def decode(self, data, pos: int = 0):
+        """Decode one frame at data[pos:]. Returns (status, new position, record bytes or None);
+        the position is unchanged for INCOMPLETE."""
+        if pos >= len(data):
+            return self.INCOMPLETE, pos, None
+        kind, seq = data[pos] >> 6, data[pos] & 0x3F
+        p = pos + 1
+        if kind == FRAME_KEY:
+            r = _get_varint(data, p)
+            if r is None or r[1] >= len(data):
+                return self.INCOMPLETE, pos, None
+            mask, p = r
+            if data[p] != self.count:
+                return self.ERROR, pos + 1, None
+            p += 1
+            values = []
+            for _ in range(self.count):
+                r = _get_varint(data, p)
+                if r is None:
+                    return self.INCOMPLETE, pos, None
+                values.append(_unzigzag(r[0]))
+                p = r[1]
+            self.linear = mask
+            self.previous = values
+            self.slope = [0] * self.count
+            self.synced = True
+        elif kind == FRAME_DELTA:
+            r = _get_varint(data, p)
+            if r is None:
+                return self.INCOMPLETE, pos, None
+            changed, p = r
+            residuals = [0] * self.count
+            for i in range(self.count):
+                if (changed >> i) & 1:
+                    r = _get_varint(data, p)
+                    if r is None:
+                        return self.INCOMPLETE, pos, None
+                    residuals[i] = _unzigzag(r[0])
+                    p = r[1]
+            # A lost frame breaks the prediction chain until the next keyframe
+            if not self.synced or seq != ((self.sequence + 1) & 0x3F):
+                self.synced = False
+                self.sequence = seq
+                self.skipped += 1
+                return self.SKIPPED, p, None
+            for i in range(self.count):
+                value = self.previous[i] + (self.slope[i] if (self.linear >> i) & 1 else 0) + residuals[i]
+                self.slope[i] = value - self.previous[i]
+                self.previous[i] = value
+        else:
+            return self.ERROR, pos + 1, None
+        self.sequence = seq
+        return self.RECORD, p, _seal(self.schema, self.previous)
+
+
+# Batched UDP telemetry frames (src/telemetry_frame.h)
+FRAME_MAGIC = 0x4C47
+FRAME_FLAG_DELTA = 0x01
+FRAME_HEADER = struct.Struct('<HBBIIqqBBH')
+FRAME_HEADER_FIELDS = ('magic', 'version', 'flags', 'device_id', 'sequence',
+                       'first_sample_us', 'sent_us', 'record_count', 'record_size', 'payload_length')
+
+
+def is_telemetry_frame(data: bytes) -> bool:
+    return len(data) >= FRAME_HEADER.size and struct.unpack_from('<H', data)[0] == FRAME_MAGIC
+
+
+def parse_telemetry_frame(data: bytes, schema: dict):
+    """Split a telemetry frame into its header and raw record bytes.
+    Delta frames start with a keyframe, so each decodes on its own."""
+    header = dict(zip(FRAME_HEADER_FIELDS, FRAME_HEADER.unpack_from(data)))
+    payload = data[FRAME_HEADER.size:FRAME_HEADER.size + header['payload_length']]
+    if len(payload) != header['payload_length']:
+        raise ValueError(f"Frame truncated: {len(payload)} of {header['payload_length']} payload bytes")
+    records = []
+    if header['flags'] & FRAME_FLAG_DELTA:
+        decoder = StreamDecoder(schema)
+        pos = 0
+        while pos < len(payload):
+            status, pos, record = decoder.decode(payload, pos)
+            if status != StreamDecoder.RECORD:
+                raise ValueError(f"Bad delta record at payload byte {pos}")
+            records.append(record)
+    else:
+        size = header['record_size']
+        records = [payload[i:i + size] for i in range(0, len(payload) - size + 1, size)]
+    if len(records) != header['record_count']:
+        raise ValueError(f"Frame holds {len(records)} records, header says {header['record_count']}")
+    return header, records
+
+
+# V2 block logs (src/log_block.h): fixed-size blocks, each checked on its own
+LOG_BLOCK_SIZE = 2048
+LOG_BLOCK_SYNC = b'GBLK'
+LOG_BLOCK_VERSION = 2
+LOG_BLOCK_DELTA = 0x01
+LOG_BLOCK_RECOVERED = 0x02
+LOG_BLOCK_METADATA = 0
+LOG_BLOCK_RECORDS = 1
+LOG_BLOCK_SUMMARY = 2
+LOG_RECORD_GPS = 0
+LOG_BLOCK_HEADER = struct.Struct('<4sBBBBIHHqqI')
+LOG_BLOCK_HEADER_FIELDS = ('sync', 'version', 'kind', 'flags', 'type_mask', 'sequence',
+                           'record_count', 'payload_length', 'first_us', 'last_us', 'crc')
+
+
+def parse_log_block(data, pos: int = 0):
+    """Check the block at data[pos:]; returns (header, payload), or None if it is not intact."""
+    if pos + LOG_BLOCK_SIZE > len(data) or data[pos:pos + 4] != LOG_BLOCK_SYNC:
+        return None
+    header = dict(zip(LOG_BLOCK_HEADER_FIELDS, LOG_BLOCK_HEADER.unpack_from(data, pos)))
+    if header['version'] != LOG_BLOCK_VERSION or header['payload_length'] > LOG_BLOCK_SIZE - LOG_BLOCK_HEADER.size:
+        return None
+    start = pos + LOG_BLOCK_HEADER.size
+    payload = bytes(data[start:start + header['payload_length']])
+    crc = binascii.crc32(bytes(data[pos:start - 4]))
+    if binascii.crc32(payload, crc) != header['crc']:
+        return None
+    return header, payload
+
+
+def find_log_block(data, pos: int) -> int:
+    """Offset of the first intact block at or after pos, or len(data)."""
+    while True:
+        pos = data.find(LOG_BLOCK_SYNC, pos)
+        if pos < 0 or pos + LOG_BLOCK_SIZE > len(data):
+            return len(data)
+        if parse_log_block(data, pos):
+            return pos
+        pos += 1
+
+
+def log_block_records(payload: bytes):
+    """Yield (type, record bytes) for each entry of a records block."""
+    pos = 0
+    while pos + 2 <= len(payload):
+        record_type, length = payload[pos], payload[pos + 1]
+        if pos + 2 + length > len(payload):
+            raise ValueError(f"Record entry at payload byte {pos} runs past the block")
+        yield record_type, payload[pos + 2:pos + 2 + length]
+        pos += 2 + length
+    if pos != len(payload):
+        raise ValueError("Truncated record entry at the end of the block")
+
+
+# Time index sidecar of a V2 log, <name>.idx (src/log_index.h)
+LOG_INDEX_MAGIC = b'GIDX'
+LOG_INDEX_VERSION = 1
+LOG_INDEX_HEADER = struct.Struct('<4sBBHII')
+LOG_INDEX_ENTRY = struct.Struct('<qI')
+
+
+def log_index_range(index_file, metadata_sequence: int, block_count: int, from_us: int, to_us: int):
+    """Block range [first, end) of a log holding from_us..to_us, or None if the index does not fit the log.
+
+    Bisects the entries in the open index file, reading O(log n) of them.
+    """
+    index_file.seek(0)
+    raw = index_file.read(LOG_INDEX_HEADER.size)
+    if len(raw) != LOG_INDEX_HEADER.size:
+        return None
+    magic, version, _, every, sequence, block_size = LOG_INDEX_HEADER.unpack(raw)
+    if (magic, version, block_size, sequence) != (LOG_INDEX_MAGIC, LOG_INDEX_VERSION, LOG_BLOCK_SIZE,
+                                                  metadata_sequence):
+        return None
+    index_file.seek(0, 2)
+    count = (index_file.tell() - LOG_INDEX_HEADER.size) // LOG_INDEX_ENTRY.size
+
+    def entry(i):
+        index_file.seek(LOG_INDEX_HEADER.size + i * LOG_INDEX_ENTRY.size)
+        return LOG_INDEX_ENTRY.unpack(index_file.read(LOG_INDEX_ENTRY.size))
+
+    def at_or_before(us):
+        low, high = 0, count
+        while low < high:
+            mid = (low + high) // 2
+            if entry(mid)[0] <= us:
+                low = mid + 1
+            else:
+                high = mid
+        return low
+
+    n = at_or_before(from_us)
+    first = entry(n - 1)[1] if n > 0 else 1
+    n = at_or_before(to_us)
+    end = min(entry(n)[1] if n < count else block_count, block_count)
+    return min(first, end), end
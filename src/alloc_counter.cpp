@@ -0,0 +1,62 @@
+#include "alloc_counter.h"
+#include <esp_heap_caps.h>
+
+static volatile uint32_t totalAllocations = 0;
+static volatile uint32_t watchedAllocations = 0;
+static TaskHandle_t watchedTask = nullptr;
+
+static inline void IRAM_ATTR countAllocation() {
+    totalAllocations++;
+    if (watchedTask && xTaskGetCurrentTaskHandle() == watchedTask) {
+        watchedAllocations++;
+    }
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* IRAM_ATTR __wrap_malloc(size_t size) {
+    countAllocation();
+    return __real_malloc(size);
+}
+
+void* IRAM_ATTR __wrap_calloc(size_t count, size_t size) {
+    countAllocation();
+    return __real_calloc(count, size);
+}
+
+// realloc(ptr, 0) only frees
+void* IRAM_ATTR __wrap_realloc(void* ptr, size_t size) {
+    if (size > 0) countAllocation();
+    return __real_realloc(ptr, size);
+}
+}
+
+void allocCounterWatch(TaskHandle_t task) {
+    watchedTask = task;
+}
+
+uint32_t allocCounterTotal() {
+    return totalAllocations;
+}
+
+uint32_t allocCounterWatched() {
+    return watchedAllocations;
+}
+
+// Boot allocates long before anyone asks
+bool allocCounterActive() {
+    return totalAllocations > 0;
+}
+
+HeapSnapshot heapSnapshot() {
+    const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    HeapSnapshot s;
+    s.freeBytes = heap_caps_get_free_size(caps);
+    s.largestBlock = heap_caps_get_largest_free_block(caps);
+    s.minimumFree = heap_caps_get_minimum_free_size(caps);
+    s.fragmentationPct = s.freeBytes ? (uint8_t)(100 - (uint64_t)s.largestBlock * 100 / s.freeBytes) : 0;
+    return s;
+}
@@ -0,0 +1,31 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Heap allocation accounting. malloc, calloc and realloc are wrapped at link
+// time (-Wl,--wrap=... in platformio.ini) and every call is counted, and
+// separately for one watched task - the main loop - so steady-state logging
+// can be checked to allocate nothing. heap_caps_malloc() callers, such as
+// LVGL's PSRAM allocator, are not counted. Without the linker flags nothing
+// is counted and allocCounterActive() is false.
+void allocCounterWatch(TaskHandle_t task);
+
+uint32_t allocCounterTotal();       // every task, approximate across cores
+uint32_t allocCounterWatched();     // the watched task only, exact
+bool allocCounterActive();
+
+// Internal RAM heap; fragmentation is the share of free memory outside the
+// largest free block
+struct HeapSnapshot {
+    uint32_t freeBytes;
+    uint32_t largestBlock;
+    uint32_t minimumFree;           // low-water mark since boot
+    uint8_t fragmentationPct;
+};
+
+HeapSnapshot heapSnapshot();
+
+#endif // ALLOC_COUNTER_H
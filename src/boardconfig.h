@@ -6,9 +6,12 @@ bool debugMode = false;
 // T-Display-S3-Pro Hardware Pin Definitions
 #define BOARD_I2C_SDA       5
 #define BOARD_I2C_SCL       6
+#define I2C_BUS_CLOCK_HZ    400000 // IMU, CST226 and SY6970 all support fast mode
 #define BOARD_SPI_MISO      8
 #define BOARD_SPI_MOSI      17
 #define BOARD_SPI_SCK       18
+#define SPI_TFT_DEADLINE_US 16000 // one display band per UI frame
+#define SPI_SD_DEADLINE_US  50000
 #define BOARD_TFT_CS        39
 #define BOARD_TFT_RST       47
 #define BOARD_TFT_DC        9
@@ -23,6 +26,7 @@ bool debugMode = false;
 #define BOARD_TFT_HEIGHT    222
 #define GNSS_RX             43
 #define GNSS_TX             44
+// #define GNSS_PPS         -1  // Optional receiver TIMEPULSE input for TimeBase
 
 // BLE Configuration
 const char* telemetryServiceUUID = "6e400001-b5a3-f393-e0a9-e50e24dcca9e";
@@ -39,6 +43,47 @@ bool wifiUDPEnabled = false;
 const float MOTION_THRESHOLD = 1.2;
 const float IMPACT_THRESHOLD = 2.5;
 
+// GNSS navigation rate governor
+#define NAV_IDLE_AFTER_MS       10000   // still this long -> reduced rate
+#define NAV_PARKED_AFTER_MS     300000  // still this long -> minimum rate, GPS only
+#define NAV_MOVING_SPEED_KMH    5.0     // above GNSS speed noise when parked
+
+// Stall monitor
+#define STALL_MIN_BUDGET_US     50000   // scheduler jobs get max(job budget, this)
+#define STALL_CHECK_PERIOD_US   100000  // stuck-section check, from the esp_timer task
+#define STALL_WDT_TIMEOUT_S     8       // task watchdog - resets on a hard hang
+
+// Steady-state allocation check (alloc_counter.h)
+#define ALLOC_SETTLE_MS         10000   // logging this long before loop allocations count
+#define ALLOC_ABORT_ON_STEADY   0       // 1: abort at the first one - not with BLE connected,
+                                        // the BLE library copies every notify into a std::string
+
+// Batched UDP telemetry (SET_UDP_BATCH changes the batch at runtime)
+#define UDP_BATCH_RECORDS       5       // records per frame - 5 Hz frames at 25 Hz
+#define UDP_BATCH_LATENCY_US    200000  // oldest record waits at most this long
+#define UDP_QUEUE_FRAMES        4       // frames waiting for the sender task
+#define UDP_SENDER_STACK        4096
+#define UDP_SENDER_PRIORITY     2
+
+// Binary streaming over USB CDC (SET_USB_STREAM, or "STREAM ON" typed on the port)
+#define USB_STREAM_STACK        4096
+#define USB_STREAM_PRIORITY     1
+#define USB_STREAM_PERIOD_MS    10
+#define USB_STREAM_SCHEMA_MS    1000    // schema frame for readers that attach late
+
+// SD writer task (sd_writer.h) - query with SD
+#define SD_RING_BYTES           (2 * 1024 * 1024)   // PSRAM; 1/16 of it in internal RAM without
+#define SD_WRITE_BLOCK          (16 * 1024)         // whole sectors per card write
+#define SD_SYNC_INTERVAL_MS     2000    // flush of the FAT and directory entry
+#define SD_STALL_US             100000  // a card write this slow counts as a stall
+#define SD_WRITER_PRIORITY      1
+#define SD_FATFS_DRIVE          "0:"    // SD.begin() mounts the card as the first FatFs drive
+
+// Log files are preallocated and rolled over (SET_LOG_FILE, query SD_HIST)
+#define LOG_FILE_SECONDS        3600    // at the full navigation rate
+#define LOG_FILE_MAX_SECONDS    (4 * 3600)
+#define LOG_BLOCK_MAX_AGE_MS    5000    // a part-filled block goes to the card after this
+
 // MPU6xxx Direct I2C Functions
 #define MPU6xxx_ADDRESS 0x68
 #define MPU6xxx_WHO_AM_I 0x75
@@ -48,6 +93,20 @@ const float IMPACT_THRESHOLD = 2.5;
 #define MPU6xxx_TEMP_OUT_H 0x41
 #define MPU6xxx_ACCEL_CONFIG 0x1C
 #define MPU6xxx_GYRO_CONFIG 0x1B
+#define MPU6xxx_SMPLRT_DIV 0x19
+#define MPU6xxx_CONFIG 0x1A
+#define MPU6xxx_FIFO_EN 0x23
+#define MPU6xxx_INT_ENABLE 0x38
+#define MPU6xxx_INT_STATUS 0x3A
+#define MPU6xxx_USER_CTRL 0x6A
+#define MPU6xxx_FIFO_COUNTH 0x72
+#define MPU6xxx_FIFO_R_W 0x74
+
+// MPU6xxx FIFO capture
+#define IMU_FIFO_RATE_HZ 500        // 1 kHz gyro clock / (1 + SMPLRT_DIV)
+#define IMU_FIFO_FRAME_SIZE 14      // accel(6) + temp(2) + gyro(6)
+#define IMU_FIFO_SIZE 512           // smallest FIFO across MPU6050/6500/9250
+#define IMU_FIFO_BURST_FRAMES 9     // 126 bytes, fits the 128 byte Wire buffer
 
 static unsigned long lastPacketTime = 0;
 static unsigned long lastDebugTime = 0;
@@ -58,4 +117,6 @@ volatile bool pendingListFiles = false;
 volatile bool pendingStartTransfer = false;
 volatile bool pendingDeleteFile = false;
 volatile bool pendingCancelTransfer = false;
+volatile bool pendingCrcBenchmark = false;
+volatile bool pendingConvertBenchmark = false;
 
@@ -0,0 +1,86 @@
+#include "boot_sequence.h"
+
+#define BOOT_STAGE_TASK_PRIORITY 1
+
+BootSequence::BootSequence(BootTimeline& timeline) :
+    timeline(timeline),
+    complete(false)
+{
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+        stages[i].owner = this;
+        stages[i].id = (BootStage)i;
+        stages[i].name = "";
+        stages[i].function = nullptr;
+        stages[i].dependsOn = 0;
+        stages[i].stackSize = 0;
+    }
+}
+
+void BootSequence::addStage(BootStage stage, const char* name, StageFunction function,
+                            uint32_t dependsOn, uint32_t stackSize) {
+    Stage& s = stages[stage];
+    s.name = name;
+    s.function = function;
+    s.dependsOn = dependsOn;
+    s.stackSize = stackSize;
+    timeline.stageState[stage] = BOOT_PENDING;
+}
+
+void BootSequence::skipStage(BootStage stage) {
+    uint32_t now = millis();
+    timeline.stageStartMs[stage] = now;
+    timeline.stageEndMs[stage] = now;
+    timeline.stageState[stage] = BOOT_SKIPPED;
+}
+
+bool BootSequence::isFinished(BootStage stage) const {
+    uint8_t state = timeline.stageState[stage];
+    return state == BOOT_DONE || state == BOOT_FAILED || state == BOOT_SKIPPED;
+}
+
+void BootSequence::update() {
+    if (complete) return;
+
+    bool allFinished = true;
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+        Stage& s = stages[i];
+        BootStage id = (BootStage)i;
+
+        // Stages never added count as skipped
+        if (!s.function && timeline.stageState[id] == BOOT_PENDING) {
+            skipStage(id);
+        }
+        if (!isFinished(id)) allFinished = false;
+        if (timeline.stageState[id] != BOOT_PENDING) continue;
+
+        bool ready = true;
+        for (uint8_t d = 0; d < BOOT_STAGE_COUNT && ready; d++) {
+            if ((s.dependsOn & bit((BootStage)d)) && !isFinished((BootStage)d)) {
+                ready = false;
+            }
+        }
+        if (!ready) continue;
+
+        timeline.stageStartMs[id] = millis();
+        timeline.stageState[id] = BOOT_RUNNING;
+        if (xTaskCreate(stageTask, s.name, s.stackSize, &s, BOOT_STAGE_TASK_PRIORITY, nullptr) != pdPASS) {
+            // No memory for a task - run it inline rather than not at all
+            bool ok = s.function();
+            timeline.stageEndMs[id] = millis();
+            timeline.stageState[id] = ok ? BOOT_DONE : BOOT_FAILED;
+        }
+    }
+
+    if (allFinished) {
+        complete = true;
+        timeline.bootCompleteMs = millis();
+    }
+}
+
+void BootSequence::stageTask(void* parameter) {
+    Stage* s = (Stage*)parameter;
+    bool ok = s->function();
+    s->owner->timeline.stageEndMs[s->id] = millis();
+    s->owner->timeline.stageState[s->id] = ok ? BOOT_DONE : BOOT_FAILED;
+    vTaskDelete(nullptr);
+}
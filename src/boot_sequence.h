@@ -0,0 +1,49 @@
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <Arduino.h>
+#include "data_structures.h"
+
+// Dependency-driven boot. Each stage runs in its own short-lived task as soon
+// as every stage it depends on has finished (done, failed or skipped), so
+// slow stages - IMU calibration, GNSS detection, SD mount, WiFi association -
+// overlap instead of queueing up in setup(). update() is polled from the main
+// loop and records the start and end of every stage in the BootTimeline.
+class BootSequence {
+public:
+    typedef bool (*StageFunction)();
+
+    explicit BootSequence(BootTimeline& timeline);
+
+    void addStage(BootStage stage, const char* name, StageFunction function,
+                  uint32_t dependsOn, uint32_t stackSize);
+    void skipStage(BootStage stage);
+
+    // Launch every stage whose dependencies are met; cheap once complete
+    void update();
+
+    bool isFinished(BootStage stage) const;
+    bool isComplete() const { return complete; }
+
+    const char* stageName(BootStage stage) const { return stages[stage].name; }
+
+    static uint32_t bit(BootStage stage) { return 1UL << stage; }
+
+private:
+    struct Stage {
+        BootSequence* owner;
+        BootStage id;
+        const char* name;
+        StageFunction function;
+        uint32_t dependsOn;
+        uint32_t stackSize;
+    };
+
+    BootTimeline& timeline;
+    Stage stages[BOOT_STAGE_COUNT];
+    bool complete;
+
+    static void stageTask(void* parameter);
+};
+
+#endif // BOOT_SEQUENCE_H
@@ -0,0 +1,179 @@
+#include "crc.h"
+
+#ifdef ESP_PLATFORM
+#include <esp_rom_crc.h>
+#define CRC16_DEFAULT_BACKEND CRC16_ROM
+#else
+#define CRC16_DEFAULT_BACKEND CRC16_SLICE8
+#endif
+
+#define CRC16_POLY 0x1021
+
+// table[k][b] = b * x^(16 + 8k) mod P; table[0] is the classic byte table
+static uint16_t table[8][256];
+static Crc16Backend selected = CRC16_DEFAULT_BACKEND;
+
+// Built during static initialization, before any task can compute a CRC
+static struct Crc16Tables {
+    Crc16Tables() {
+        for (uint16_t b = 0; b < 256; b++) {
+            uint16_t crc = b << 8;
+            for (uint8_t i = 0; i < 8; i++) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ CRC16_POLY : crc << 1;
+            }
+            table[0][b] = crc;
+        }
+        for (uint8_t k = 1; k < 8; k++) {
+            for (uint16_t b = 0; b < 256; b++) {
+                uint16_t prev = table[k - 1][b];
+                table[k][b] = (prev << 8) ^ table[0][prev >> 8];
+            }
+        }
+    }
+} tables;
+
+static uint16_t crc16Bitwise(uint16_t crc, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t j = 0; j < 8; j++) {
+            if (crc & 0x8000)
+                crc = (crc << 1) ^ CRC16_POLY;
+            else
+                crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+static inline uint16_t crc16Bytes(uint16_t crc, const uint8_t* data, size_t length) {
+    while (length--) {
+        crc = (crc << 8) ^ table[0][(crc >> 8) ^ *data++];
+    }
+    return crc;
+}
+
+// The first two bytes of each step fold into the 16-bit state, the rest
+// look up their own table
+static uint16_t crc16Slice4(uint16_t crc, const uint8_t* data, size_t length) {
+    while (length >= 4) {
+        crc ^= (data[0] << 8) | data[1];
+        crc = table[3][crc >> 8] ^ table[2][crc & 0xFF] ^
+              table[1][data[2]] ^ table[0][data[3]];
+        data += 4;
+        length -= 4;
+    }
+    return crc16Bytes(crc, data, length);
+}
+
+static uint16_t crc16Slice8(uint16_t crc, const uint8_t* data, size_t length) {
+    while (length >= 8) {
+        crc ^= (data[0] << 8) | data[1];
+        crc = table[7][crc >> 8] ^ table[6][crc & 0xFF] ^
+              table[5][data[2]] ^ table[4][data[3]] ^
+              table[3][data[4]] ^ table[2][data[5]] ^
+              table[1][data[6]] ^ table[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+    return crc16Bytes(crc, data, length);
+}
+
+uint16_t crc16With(Crc16Backend backend, const uint8_t* data, size_t length, uint16_t crc) {
+    switch (backend) {
+        case CRC16_BITWISE: return crc16Bitwise(crc, data, length);
+        case CRC16_SLICE4:  return crc16Slice4(crc, data, length);
+        case CRC16_SLICE8:  return crc16Slice8(crc, data, length);
+#ifdef ESP_PLATFORM
+        // The ROM routine inverts the CRC on entry and exit
+        case CRC16_ROM:     return ~esp_rom_crc16_be((uint16_t)~crc, data, length);
+#endif
+        default:            return crc16Bytes(crc, data, length);
+    }
+}
+
+uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc) {
+    return crc16With(selected, data, length, crc);
+}
+
+bool crc16BackendAvailable(Crc16Backend backend) {
+#ifndef ESP_PLATFORM
+    if (backend == CRC16_ROM) return false;
+#endif
+    return backend < CRC16_BACKEND_COUNT;
+}
+
+const char* crc16BackendName(Crc16Backend backend) {
+    switch (backend) {
+        case CRC16_BITWISE: return "bitwise";
+        case CRC16_TABLE:   return "table";
+        case CRC16_SLICE4:  return "slice4";
+        case CRC16_SLICE8:  return "slice8";
+        case CRC16_ROM:     return "rom";
+        default:            return "?";
+    }
+}
+
+void crc16SetBackend(Crc16Backend backend) {
+    if (crc16BackendAvailable(backend)) selected = backend;
+}
+
+Crc16Backend crc16Backend() {
+    return selected;
+}
+
+#ifndef ESP_PLATFORM
+static uint32_t crc32Table[256];
+
+static struct Crc32Table {
+    Crc32Table() {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (uint8_t i = 0; i < 8; i++) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+            crc32Table[b] = crc;
+        }
+    }
+} crc32Tables;
+#endif
+
+uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc) {
+#ifdef ESP_PLATFORM
+    return esp_rom_crc32_le(crc, data, length);
+#else
+    crc = ~crc;
+    while (length--) {
+        crc = (crc >> 8) ^ crc32Table[(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+#endif
+}
+
+Crc16BenchResult crc16Benchmark(Crc16Backend backend, const uint8_t* data, size_t length,
+                                uint16_t iterations, CrcClockFunction clock) {
+    Crc16BenchResult result = {0.0f, false};
+    if (!crc16BackendAvailable(backend) || length == 0 || iterations == 0) return result;
+
+    // Every length from 0 up to 17 exercises the slicing tails, then the whole buffer
+    result.matchesReference = true;
+    for (size_t n = 0; n <= 17 && n <= length; n++) {
+        if (crc16With(backend, data, n, 0x1D0F) != crc16Bitwise(0x1D0F, data, n)) {
+            result.matchesReference = false;
+        }
+    }
+    uint16_t reference = crc16Bitwise(CRC16_INIT, data, length);
+    if (crc16With(backend, data, length) != reference) result.matchesReference = false;
+
+    volatile uint16_t sink = 0;
+    uint32_t start = clock();
+    for (uint16_t i = 0; i < iterations; i++) {
+        sink ^= crc16With(backend, data, length);
+    }
+    uint32_t elapsed = clock() - start;
+    (void)sink;
+
+    if (elapsed > 0) {
+        result.megabytesPerSecond = (float)length * iterations / elapsed;  // bytes/us == MB/s
+    }
+    return result;
+}
@@ -0,0 +1,59 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-16/XMODEM: poly 0x1021, init 0x0000, MSB first, no final XOR.
+// Shared with the host tools (parser.py, listener.py).
+#define CRC16_INIT 0x0000
+
+enum Crc16Backend {
+    CRC16_BITWISE = 0,  // reference, 8 shifts per byte
+    CRC16_TABLE,        // 256-entry table, one lookup per byte
+    CRC16_SLICE4,       // 4 tables, 4 bytes per step
+    CRC16_SLICE8,       // 8 tables, 8 bytes per step
+    CRC16_ROM,          // ESP32 ROM esp_rom_crc16_be
+    CRC16_BACKEND_COUNT
+};
+
+// One-shot, or continue a stream by passing the previous result as crc.
+// crc16() uses the selected backend; every backend gives the same result.
+uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = CRC16_INIT);
+uint16_t crc16With(Crc16Backend backend, const uint8_t* data, size_t length,
+                   uint16_t crc = CRC16_INIT);
+
+bool crc16BackendAvailable(Crc16Backend backend);
+const char* crc16BackendName(Crc16Backend backend);
+void crc16SetBackend(Crc16Backend backend);
+Crc16Backend crc16Backend();
+
+// Streaming CRC over data that arrives in pieces (blocks, files)
+class Crc16 {
+public:
+    explicit Crc16(uint16_t init = CRC16_INIT) : value(init) {}
+
+    void update(const uint8_t* data, size_t length) { value = crc16(data, length, value); }
+    void reset(uint16_t init = CRC16_INIT) { value = init; }
+    uint16_t result() const { return value; }
+
+private:
+    uint16_t value;
+};
+
+// CRC-32 as zlib's crc32() and Python's binascii.crc32(): reflected poly
+// 0xEDB88320, init and final XOR 0xFFFFFFFF. Continue a stream by passing
+// the previous result. The ROM routine on the ESP32, a table elsewhere.
+uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+
+// Throughput of one backend over data, and whether it agrees with the
+// bitwise reference. The clock returns microseconds.
+struct Crc16BenchResult {
+    float megabytesPerSecond;
+    bool matchesReference;
+};
+typedef uint32_t (*CrcClockFunction)();
+Crc16BenchResult crc16Benchmark(Crc16Backend backend, const uint8_t* data, size_t length,
+                                uint16_t iterations, CrcClockFunction clock);
+
+#endif // CRC_H
@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <FS.h>
 #include <SD.h>
+#include "fixed_point.h"
+#include "packet_schema.h"
 
 // System state data
 struct SystemData {
@@ -23,8 +25,8 @@ struct SystemData {
 // GPS data structure
 struct GPSData {
     uint32_t timestamp = 0;
-    float latitude = 0.0;
-    float longitude = 0.0;
+    DegreesE7 latitude;
+    DegreesE7 longitude;
     int32_t altitude = 0; // meters
     float speed = 0.0; // km/h
     float heading = 0.0; // degrees
@@ -54,14 +56,25 @@ struct IMUData {
     float gyroOffsetX = 0.0;
     float gyroOffsetY = 0.0;
     float gyroOffsetZ = 0.0;
+    // Same offsets in sensor counts, for the acquisition task (applyIMUOffsets)
+    AccelG accelOffsetCounts[3];
+    GyroDps gyroOffsetCounts[3];
     bool isCalibrated = false;
     unsigned long calibrationStartTime = 0;
     int calibrationSamples = 0;
     bool calibrationInProgress = false;
+    float calibrationConfidence = 0.0; // 0..1, from the online bias tracker
+    
+    // FIFO capture (written by the acquisition task only)
+    bool fifoEnabled = false;
+    uint16_t sampleRateHz = 0;
+    uint32_t fifoSamples = 0;
+    uint32_t fifoOverflows = 0;
 };
 
 // Enhanced battery monitoring with SY6970 PMU data
 struct BatteryData {
+    uint16_t millivolts = 0;    // as read, for GPSPacket battery_mv
     float voltage = 0.0;
     float current = 0.0;
     uint8_t percentage = 0;
@@ -70,10 +83,19 @@ struct BatteryData {
     bool usbConnected = false;
     float vbusVoltage = 0.0;
     float systemVoltage = 0.0;
-    String chargeStatus = "Unknown";
+    const char* chargeStatus = "Unknown";   // string literal
     unsigned long lastUpdate = 0;
 };
 
+// Raw SY6970 readings taken on the I2C bus task
+struct PMUReading {
+    uint16_t battMillivolts = 0;
+    uint16_t vbusMillivolts = 0;
+    uint16_t systemMillivolts = 0;
+    bool usbConnected = false;
+    uint8_t chargeStatus = 0;
+};
+
 // Performance monitoring
 struct PerformanceStats {
     unsigned long totalPackets = 0;
@@ -82,6 +104,7 @@ struct PerformanceStats {
     unsigned long maxDelta = 0;
     unsigned long avgDelta = 0;
     unsigned long lastResetTime = 0;
+    float expectedRateHz = 25.0;   // current GNSS navigation rate
 };
 
 // Enhanced File transfer state
@@ -89,7 +112,7 @@ struct FileTransferState {
     bool active = false;
     bool listingFiles = false;
     File transferFile;
-    String filename = "";
+    char filename[64] = "";
     size_t fileSize = 0;
     size_t bytesSent = 0;
     unsigned long lastChunkTime = 0;
@@ -98,28 +121,79 @@ struct FileTransferState {
     float progressPercent = 0.0f;
     unsigned long transferStartTime = 0;
     unsigned long estimatedTimeRemaining = 0;
+    // Time range of a block log: its first rangeHead bytes, then
+    // [rangeStart, rangeEnd). rangeEnd 0 sends the whole file.
+    size_t rangeHead = 0;
+    size_t rangeStart = 0;
+    size_t rangeEnd = 0;
 };
 
-// GPS Packet Structure (42 bytes) for transmission
-struct __attribute__((packed)) GPSPacket {
-    uint32_t timestamp;      // Unix epoch (4 bytes)
-    int32_t latitude;        // deg * 1e7 (4 bytes)
-    int32_t longitude;       // deg * 1e7 (4 bytes)
-    int32_t altitude;        // mm (4 bytes)
-    uint16_t speed;          // mm/s (2 bytes)
-    uint32_t heading;        // deg * 1e5 (4 bytes)
-    uint8_t fixType;         // 0-5 (1 byte)
-    uint8_t satellites;      // count (1 byte)
-    uint16_t battery_mv;     // mV (2 bytes)
-    uint8_t battery_pct;     // % (1 byte)
-    
-    int16_t accel_x;         // mg (2 bytes)
-    int16_t accel_y;         // mg (2 bytes) 
-    int16_t accel_z;         // mg (2 bytes)
-    int16_t gyro_x;          // deg/s * 100 (2 bytes)
-    int16_t gyro_y;          // deg/s * 100 (2 bytes)
-    uint8_t pmu_status;      // PMU status flags (1 byte)
-    uint16_t crc;            // CRC16 (2 bytes)
+// Timestamped IMU sample produced by the acquisition task - calibrated,
+// still in sensor counts (fixed_point.h)
+struct IMUSample {
+    int64_t timestampMicros = 0;        // local esp_timer µs
+    int64_t gnssTimeMicros = 0;         // UTC µs, 0 until time is known
+    AccelG accelX, accelY, accelZ;
+    GyroDps gyroX, gyroY, gyroZ;
+    TempCentiC temperature;
+};
+
+// Timestamped GNSS fix produced by the acquisition task
+struct GPSSample {
+    int64_t arrivalMicros = 0;  // local esp_timer µs of the first UBX sync byte
+    int64_t gnssTimeMicros = 0; // UTC µs of the navigation epoch
+    GPSData data;
+    GPSPacket packet;
+};
+
+// Boot stages, brought up concurrently once the UI is live
+enum BootStage {
+    BOOT_STAGE_TOUCH = 0,
+    BOOT_STAGE_IMU,
+    BOOT_STAGE_PMU,
+    BOOT_STAGE_SD,
+    BOOT_STAGE_GNSS,
+    BOOT_STAGE_GNSS_ASSIST,
+    BOOT_STAGE_BLE,
+    BOOT_STAGE_WIFI,
+    BOOT_STAGE_ACQUISITION,
+    BOOT_STAGE_COUNT
+};
+
+enum BootStageState {
+    BOOT_PENDING = 0,
+    BOOT_RUNNING,
+    BOOT_DONE,
+    BOOT_FAILED,
+    BOOT_SKIPPED
+};
+
+// How the GNSS receiver configuration was brought up at boot
+enum GNSSConfigState {
+    GNSS_CONFIG_PENDING = 0,
+    GNSS_CONFIG_VERIFIED,   // stored hash and read-back matched, nothing written
+    GNSS_CONFIG_APPLIED,    // one CFG-VALSET batch acknowledged
+    GNSS_CONFIG_LEGACY,     // receiver without CFG-VALSET, per-setting commands
+    GNSS_CONFIG_FAILED      // receiver not detected
+};
+
+// Hot-start aiding pushed to the receiver at boot
+#define GNSS_ASSIST_TIME      0x01
+#define GNSS_ASSIST_POSITION  0x02
+#define GNSS_ASSIST_DATABASE  0x04
+
+// Boot timeline - all times in ms since reset, 0 = not reached yet
+struct BootTimeline {
+    uint32_t stageStartMs[BOOT_STAGE_COUNT] = {0};
+    uint32_t stageEndMs[BOOT_STAGE_COUNT] = {0};
+    volatile uint8_t stageState[BOOT_STAGE_COUNT] = {0};
+    uint32_t uiReadyMs = 0;
+    uint32_t bootCompleteMs = 0;   // every stage finished
+    uint32_t firstPvtMs = 0;       // first NAV-PVT with a 2D/3D fix
+    uint32_t firstRecordMs = 0;    // first record written to SD
+    uint8_t gnssConfig = GNSS_CONFIG_PENDING;
+    uint32_t gnssBaud = 0;
+    uint8_t gnssAssist = 0;        // GNSS_ASSIST_* bits
 };
 
 // Screen types for the UI
@@ -133,7 +207,7 @@ enum ScreenType {
 // Touch zones for landscape mode (480x222)
 struct TouchZone {
     uint16_t x, y, w, h;
-    String label;
+    const char* label;
 };
 
 // Color definitions for LVGL 8.x (proper format) - DARK THEME
@@ -0,0 +1,78 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+
+// Sensor value kept as the integer count the hardware produced, with its
+// scale in the type: Fixed<int16_t, std::ratio<1, 16384>> is accelerometer
+// LSBs read as g. fixedCast() rescales with integer arithmetic on
+// compile-time constants. toFloat()/fromFloat() are single precision and
+// belong at the edges only - display, debug output and the calibration
+// filters. The S3 FPU has no double support, so nothing here uses double.
+template<typename Rep, typename Scale>
+struct Fixed {
+    typedef Rep rep;
+    typedef Scale scale;
+
+    Rep count;
+
+    constexpr Fixed() : count(0) {}
+    constexpr explicit Fixed(Rep count) : count(count) {}
+
+    static constexpr float unit() { return float(Scale::num) / float(Scale::den); }
+
+    float toFloat() const { return count * unit(); }
+
+    // Nearest count, saturated to Rep
+    static Fixed fromFloat(float value) {
+        float counts = value * (float(Scale::den) / float(Scale::num));
+        if (counts >= (float)std::numeric_limits<Rep>::max()) return Fixed(std::numeric_limits<Rep>::max());
+        if (counts <= (float)std::numeric_limits<Rep>::min()) return Fixed(std::numeric_limits<Rep>::min());
+        return Fixed(Rep(counts >= 0.0f ? counts + 0.5f : counts - 0.5f));
+    }
+
+    // Saturates rather than wrapping - a clipped sensor stays clipped
+    Fixed operator-(Fixed other) const {
+        int32_t v = (int32_t)count - (int32_t)other.count;
+        if (v > std::numeric_limits<Rep>::max()) v = std::numeric_limits<Rep>::max();
+        if (v < std::numeric_limits<Rep>::min()) v = std::numeric_limits<Rep>::min();
+        return Fixed(Rep(v));
+    }
+};
+
+namespace fixed_detail {
+    // n * num / den rounded half away from zero, den > 0
+    template<typename Wide>
+    inline Wide scaleRound(Wide n, Wide num, Wide den) {
+        return n >= 0 ? (n * num + den / 2) / den : -((-n * num + den / 2) / den);
+    }
+}
+
+// Rescale to another Fixed type. The product stays in 32 bits whenever it
+// fits - Xtensa has a 32-bit divider but 64-bit division is a libcall.
+template<typename To, typename Rep, typename Scale>
+inline To fixedCast(Fixed<Rep, Scale> value) {
+    typedef std::ratio_divide<Scale, typename To::scale> R;
+    typedef typename std::conditional<
+        sizeof(Rep) <= 2 && R::num <= 65535 && R::den <= 65535, int32_t, int64_t>::type Wide;
+    return To((typename To::rep)fixed_detail::scaleRound<Wide>(value.count, R::num, R::den));
+}
+
+// MPU6xxx registers at ±2 g / ±250 deg/s (initMPU6050)
+typedef Fixed<int16_t, std::ratio<1, 16384>> AccelG;
+typedef Fixed<int16_t, std::ratio<1, 131>>   GyroDps;
+typedef Fixed<int16_t, std::centi>           TempCentiC;
+
+// GPSPacket accel_* and gyro_*
+typedef Fixed<int16_t, std::milli>           AccelMilliG;
+typedef Fixed<int16_t, std::centi>           GyroCentiDps;
+
+// NAV-PVT fields as received
+typedef Fixed<int32_t, std::ratio<1, 10000000>> DegreesE7;   // lat, lon
+typedef Fixed<int32_t, std::ratio<1, 100000>>   DegreesE5;   // headMot
+typedef Fixed<int32_t, std::ratio<9, 2500>>     SpeedKmh;    // gSpeed in mm/s, read as km/h
+
+#endif // FIXED_POINT_H
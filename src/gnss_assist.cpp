@@ -0,0 +1,245 @@
+#include "gnss_assist.h"
+#include <string.h>
+
+#define UBX_FRAME_OVERHEAD  8   // sync, class, id, length, checksum
+#define MGA_INI_POS_LLH     0x01
+#define MGA_INI_TIME_UTC    0x10
+#define MGA_ACK_DATA0_LEN   8
+#define MGA_ACK_ACCEPTED    1
+
+static void putU2(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU4(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+GnssAssist::GnssAssist() :
+    buffer(nullptr),
+    capacity(0),
+    used(0),
+    dropped(0)
+{
+    memset(&header, 0, sizeof(header));
+}
+
+void GnssAssist::beginCapture(uint8_t* captureBuffer, uint32_t captureCapacity, uint32_t savedUnix) {
+    buffer = captureBuffer;
+    capacity = captureCapacity;
+    used = sizeof(GnssAssistHeader);
+    dropped = 0;
+    memset(&header, 0, sizeof(header));
+    header.magic = GNSS_ASSIST_MAGIC;
+    header.savedUnix = savedUnix;
+}
+
+bool GnssAssist::addFrame(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length) {
+    if (!buffer || msgClass != UBX_CLASS_MGA || msgId != UBX_MGA_DBD) return false;
+
+    uint32_t space = capacity > used ? capacity - used : 0;
+    if (space > 0xFFFF) space = 0xFFFF;
+    uint16_t n = buildFrame(msgClass, msgId, payload, length, buffer + used, (uint16_t)space);
+    if (n == 0) {
+        dropped++;
+        return false;
+    }
+    used += n;
+    header.frames++;
+    return true;
+}
+
+uint32_t GnssAssist::finishCapture() {
+    if (!buffer || header.frames == 0) return 0;
+    header.length = used - sizeof(GnssAssistHeader);
+    memcpy(buffer, &header, sizeof(header));
+    return used;
+}
+
+bool GnssAssist::validateBlob(const uint8_t* blob, uint32_t length, GnssAssistHeader& h) {
+    if (length < sizeof(GnssAssistHeader)) return false;
+    memcpy(&h, blob, sizeof(h));
+    if (h.magic != GNSS_ASSIST_MAGIC || h.frames == 0) return false;
+    if (h.length != length - sizeof(GnssAssistHeader)) return false;
+
+    // Every frame must be intact - a torn write leaves the receiver half-seeded
+    uint16_t frames = 0;
+    uint32_t offset = sizeof(GnssAssistHeader);
+    while (offset < length) {
+        uint16_t n = frameAt(blob, length, offset);
+        if (n == 0) return false;
+        offset += n;
+        frames++;
+    }
+    return frames == h.frames;
+}
+
+uint16_t GnssAssist::frameAt(const uint8_t* blob, uint32_t length, uint32_t offset) {
+    if (offset + UBX_FRAME_OVERHEAD > length) return 0;
+    const uint8_t* f = blob + offset;
+    if (f[0] != 0xB5 || f[1] != 0x62) return 0;
+
+    uint16_t payloadLength = f[4] | (f[5] << 8);
+    uint32_t frameLength = (uint32_t)payloadLength + UBX_FRAME_OVERHEAD;
+    if (offset + frameLength > length) return 0;
+
+    uint8_t ckA = 0, ckB = 0;
+    for (uint32_t i = 2; i < frameLength - 2; i++) {
+        ckA += f[i];
+        ckB += ckA;
+    }
+    if (ckA != f[frameLength - 2] || ckB != f[frameLength - 1]) return 0;
+    return (uint16_t)frameLength;
+}
+
+uint16_t GnssAssist::buildFrame(uint8_t msgClass, uint8_t msgId, const uint8_t* payload,
+                                uint16_t length, uint8_t* frame, uint16_t maxLength) {
+    if ((uint32_t)length + UBX_FRAME_OVERHEAD > maxLength) return 0;
+
+    frame[0] = 0xB5;
+    frame[1] = 0x62;
+    frame[2] = msgClass;
+    frame[3] = msgId;
+    putU2(frame + 4, length);
+    if (length) memcpy(frame + 6, payload, length);
+
+    uint8_t ckA = 0, ckB = 0;
+    for (uint16_t i = 2; i < length + 6; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[length + 6] = ckA;
+    frame[length + 7] = ckB;
+    return length + UBX_FRAME_OVERHEAD;
+}
+
+uint16_t GnssAssist::buildDbdPoll(uint8_t* frame, uint16_t maxLength) {
+    return buildFrame(UBX_CLASS_MGA, UBX_MGA_DBD, nullptr, 0, frame, maxLength);
+}
+
+uint16_t GnssAssist::buildPositionLLH(int32_t lat, int32_t lon, int32_t altCm, uint32_t accCm,
+                                      uint8_t* frame, uint16_t maxLength) {
+    uint8_t p[20] = {0};
+    p[0] = MGA_INI_POS_LLH;
+    putU4(p + 4, (uint32_t)lat);
+    putU4(p + 8, (uint32_t)lon);
+    putU4(p + 12, (uint32_t)altCm);
+    putU4(p + 16, accCm);
+    return buildFrame(UBX_CLASS_MGA, UBX_MGA_INI, p, sizeof(p), frame, maxLength);
+}
+
+uint16_t GnssAssist::buildTimeUTC(uint32_t unixSeconds, uint16_t accSeconds,
+                                  uint8_t* frame, uint16_t maxLength) {
+    // Civil date from days since 1970 (Howard Hinnant's algorithm)
+    int32_t days = unixSeconds / 86400;
+    uint32_t secondOfDay = unixSeconds % 86400;
+    days += 719468;
+    int32_t era = days / 146097;
+    uint32_t doe = days - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint8_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint8_t month = mp < 10 ? mp + 3 : mp - 9;
+    uint16_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+    uint8_t p[24] = {0};
+    p[0] = MGA_INI_TIME_UTC;
+    p[2] = 0;                   // ref: time valid on receipt
+    p[3] = 0x80;                // leap seconds unknown
+    putU2(p + 4, year);
+    p[6] = month;
+    p[7] = day;
+    p[8] = secondOfDay / 3600;
+    p[9] = (secondOfDay / 60) % 60;
+    p[10] = secondOfDay % 60;
+    putU2(p + 16, accSeconds);
+    return buildFrame(UBX_CLASS_MGA, UBX_MGA_INI, p, sizeof(p), frame, maxLength);
+}
+
+GnssAssistReplay::GnssAssistReplay() {
+    begin(nullptr, 0, 0, 0);
+}
+
+void GnssAssistReplay::begin(const uint8_t* replayBlob, uint32_t replayLength,
+                             uint32_t ackTimeoutMs, uint32_t replayPaceMs) {
+    blob = replayBlob;
+    length = replayLength;
+    offset = sizeof(GnssAssistHeader);
+    frameLength = 0;
+    sentAtMs = 0;
+    timeoutMs = ackTimeoutMs;
+    paceMs = replayPaceMs;
+    retried = false;
+    acking = true;
+    ackSeen = false;
+    finished = blob == nullptr;
+    sent = 0;
+    acked = 0;
+    rejected = 0;
+    timeouts = 0;
+    retries = 0;
+}
+
+void GnssAssistReplay::advance() {
+    offset += frameLength;
+    frameLength = 0;
+}
+
+uint16_t GnssAssistReplay::next(uint32_t nowMs, const uint8_t*& frame) {
+    if (finished) return 0;
+
+    if (frameLength > 0) {
+        uint32_t waited = nowMs - sentAtMs;
+        if (!acking) {
+            if (waited < paceMs) return 0;
+            advance();
+        } else {
+            if (waited < timeoutMs) return 0;
+            if (!retried) {
+                // Lost on the wire or its acknowledgement was - send it again
+                retried = true;
+                retries++;
+                sentAtMs = nowMs;
+                frame = blob + offset;
+                return frameLength;
+            }
+            timeouts++;
+            // Nothing acknowledged yet: the receiver does not do it at all
+            if (!ackSeen) acking = false;
+            advance();
+        }
+    }
+
+    uint16_t n = GnssAssist::frameAt(blob, length, offset);
+    if (n == 0) {
+        // End of the blob, or a corrupt frame nothing after can be trusted past
+        finished = true;
+        return 0;
+    }
+    frameLength = n;
+    sentAtMs = nowMs;
+    retried = false;
+    sent++;
+    frame = blob + offset;
+    return n;
+}
+
+void GnssAssistReplay::onAck(const uint8_t* payload, uint16_t ackLength) {
+    if (ackLength < MGA_ACK_DATA0_LEN || frameLength == 0) return;
+    ackSeen = true;
+    acking = true;
+
+    // The receiver echoes the message id and the first four payload bytes
+    const uint8_t* f = blob + offset;
+    uint16_t payloadLength = frameLength - UBX_FRAME_OVERHEAD;
+    uint16_t echoed = payloadLength < 4 ? payloadLength : 4;
+    if (payload[3] != f[3] || memcmp(payload + 4, f + 6, echoed) != 0) return;
+
+    if (payload[0] == MGA_ACK_ACCEPTED) acked++;
+    else rejected++;
+    advance();
+}
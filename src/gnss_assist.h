@@ -0,0 +1,114 @@
+#ifndef GNSS_ASSIST_H
+#define GNSS_ASSIST_H
+
+#include <stdint.h>
+
+#define UBX_CLASS_MGA       0x13
+#define UBX_MGA_INI         0x40
+#define UBX_MGA_ACK         0x60
+#define UBX_MGA_DBD         0x80
+
+#define GNSS_ASSIST_MAGIC   0x31534147  // "GAS1"
+
+// Saved navigation database: this header followed by complete UBX-MGA-DBD
+// frames exactly as the receiver sent them
+struct GnssAssistHeader {
+    uint32_t magic;
+    uint32_t savedUnix;     // UTC seconds when the database was dumped
+    uint16_t frames;
+    uint16_t reserved;
+    uint32_t length;        // bytes of frames after the header
+};
+
+// Hot-start aiding for u-blox receivers.
+// Captures the receiver's navigation database (the UBX-MGA-DBD dump that
+// follows an empty MGA-DBD poll) into a caller-supplied buffer, and builds
+// the MGA-INI position and time frames that seed the receiver at power-up.
+// A saved blob is replayed by walking frameAt() and writing each frame back
+// to the receiver unchanged. No Arduino dependencies so a saved blob can be
+// replayed into a stand-in UART on the host.
+class GnssAssist {
+public:
+    GnssAssist();
+
+    void beginCapture(uint8_t* buffer, uint32_t capacity, uint32_t savedUnix);
+    // Parser frame callback context; ignores everything but MGA-DBD
+    bool addFrame(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length);
+    // Write the header and return the blob length, 0 if nothing was captured
+    uint32_t finishCapture();
+    uint16_t capturedFrames() const { return header.frames; }
+    uint32_t droppedFrames() const { return dropped; }
+
+    // Check a saved blob; frames start at sizeof(GnssAssistHeader)
+    static bool validateBlob(const uint8_t* blob, uint32_t length, GnssAssistHeader& header);
+    // Length of the checksummed UBX frame at offset, 0 at the end or if corrupt
+    static uint16_t frameAt(const uint8_t* blob, uint32_t length, uint32_t offset);
+
+    static uint16_t buildFrame(uint8_t msgClass, uint8_t msgId, const uint8_t* payload,
+                               uint16_t length, uint8_t* frame, uint16_t maxLength);
+    static uint16_t buildDbdPoll(uint8_t* frame, uint16_t maxLength);
+    // MGA-INI-POS_LLH: lat/lon in deg * 1e7, altitude and accuracy in cm
+    static uint16_t buildPositionLLH(int32_t lat, int32_t lon, int32_t altCm, uint32_t accCm,
+                                     uint8_t* frame, uint16_t maxLength);
+    // MGA-INI-TIME_UTC, valid on receipt
+    static uint16_t buildTimeUTC(uint32_t unixSeconds, uint16_t accSeconds,
+                                 uint8_t* frame, uint16_t maxLength);
+
+private:
+    uint8_t* buffer;
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t dropped;
+    GnssAssistHeader header;
+};
+
+// Acknowledged replay of a saved blob.
+// With CFG-NAVSPG-ACKAIDING set the receiver answers every MGA frame with
+// MGA-ACK-DATA0, so each frame is sent only once the previous one has been
+// accepted or rejected - its input buffer cannot overrun however slowly it
+// digests the database. A frame that is never acknowledged is sent once
+// more and then skipped. A receiver that acknowledges nothing at all is
+// fed unacknowledged, one frame per pace interval. Not thread-safe: the
+// caller serialises next() against onAck() from the parser's task.
+class GnssAssistReplay {
+public:
+    GnssAssistReplay();
+
+    // The blob must stay valid until done()
+    void begin(const uint8_t* blob, uint32_t length, uint32_t timeoutMs, uint32_t paceMs);
+    // Length of the frame to write now, 0 while waiting or once done
+    uint16_t next(uint32_t nowMs, const uint8_t*& frame);
+    // MGA-ACK-DATA0 payload from the parser frame callback
+    void onAck(const uint8_t* payload, uint16_t length);
+    bool done() const { return finished; }
+
+    uint16_t sentFrames() const { return sent; }
+    uint16_t ackedFrames() const { return acked; }
+    uint16_t rejectedFrames() const { return rejected; }
+    uint16_t timedOutFrames() const { return timeouts; }
+    uint16_t retriedFrames() const { return retries; }
+    // False once the receiver was found not to acknowledge aiding
+    bool acknowledged() const { return acking; }
+
+private:
+    void advance();
+
+    const uint8_t* blob;
+    uint32_t length;
+    uint32_t offset;         // frame being sent or waited on
+    uint16_t frameLength;    // 0 when nothing is in flight
+    uint32_t sentAtMs;
+    uint32_t timeoutMs;
+    uint32_t paceMs;
+    bool retried;
+    bool acking;
+    bool ackSeen;
+    bool finished;
+    uint16_t sent;
+    uint16_t acked;
+    uint16_t rejected;
+    uint16_t timeouts;
+    uint16_t retries;
+};
+
+#endif // GNSS_ASSIST_H
@@ -0,0 +1,103 @@
+#include "gnss_config.h"
+
+static void putLE(uint8_t* p, uint32_t value, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint32_t getLE(const uint8_t* p, uint8_t size) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size && i < 4; i++) {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+GnssConfig::GnssConfig(const GnssConfigItem* items, uint8_t count) :
+    items(items),
+    itemCount(count > GNSS_CONFIG_MAX_ITEMS ? GNSS_CONFIG_MAX_ITEMS : count)
+{
+}
+
+uint8_t GnssConfig::valueSize(uint32_t key) {
+    switch ((key >> 28) & 0x07) {
+        case 1: return 1;  // single bit, stored in a byte
+        case 2: return 1;
+        case 3: return 2;
+        case 4: return 4;
+        case 5: return 8;
+        default: return 0;
+    }
+}
+
+uint32_t GnssConfig::hash() const {
+    // FNV-1a over every key and value
+    uint32_t h = 2166136261UL;
+    for (uint8_t i = 0; i < itemCount; i++) {
+        uint8_t bytes[8];
+        putLE(bytes, items[i].key, 4);
+        putLE(bytes + 4, items[i].value, 4);
+        for (uint8_t b = 0; b < sizeof(bytes); b++) {
+            h ^= bytes[b];
+            h *= 16777619UL;
+        }
+    }
+    return h;
+}
+
+uint16_t GnssConfig::buildValset(uint8_t layerMask, uint8_t* payload, uint16_t maxLength) const {
+    if (maxLength < 4) return 0;
+
+    payload[0] = 0;          // version
+    payload[1] = layerMask;
+    payload[2] = 0;          // reserved
+    payload[3] = 0;
+    uint16_t length = 4;
+
+    for (uint8_t i = 0; i < itemCount; i++) {
+        uint8_t size = valueSize(items[i].key);
+        if (size == 0 || length + 4 + size > maxLength) return 0;
+        putLE(payload + length, items[i].key, 4);
+        putLE(payload + length + 4, 0, size);
+        putLE(payload + length + 4, items[i].value, size > 4 ? 4 : size);
+        length += 4 + size;
+    }
+    return length;
+}
+
+uint16_t GnssConfig::buildValget(uint8_t layer, uint8_t* payload, uint16_t maxLength) const {
+    uint16_t length = 4 + 4 * itemCount;
+    if (length > maxLength) return 0;
+
+    payload[0] = 0;          // version
+    payload[1] = layer;
+    payload[2] = 0;          // position
+    payload[3] = 0;
+    for (uint8_t i = 0; i < itemCount; i++) {
+        putLE(payload + 4 + 4 * i, items[i].key, 4);
+    }
+    return length;
+}
+
+bool GnssConfig::matchesValget(const uint8_t* payload, uint16_t length) const {
+    if (length < 4 || payload[0] != 1) return false;
+
+    uint8_t found = 0;
+    uint16_t offset = 4;
+    while (offset + 4 <= length) {
+        uint32_t key = getLE(payload + offset, 4);
+        uint8_t size = valueSize(key);
+        if (size == 0 || offset + 4 + size > length) return false;
+        uint32_t value = getLE(payload + offset + 4, size);
+        offset += 4 + size;
+
+        for (uint8_t i = 0; i < itemCount; i++) {
+            if (items[i].key != key) continue;
+            if (items[i].value != value) return false;
+            found++;
+            break;
+        }
+    }
+    return found == itemCount;
+}
@@ -0,0 +1,60 @@
+#ifndef GNSS_CONFIG_H
+#define GNSS_CONFIG_H
+
+#include <stdint.h>
+
+// u-blox configuration keys (CFG-*), generation 9 and later receivers.
+// Bits 28..30 of a key encode the size of its value.
+#define GNSS_KEY_UART1OUTPROT_UBX       0x10740001
+#define GNSS_KEY_UART1OUTPROT_NMEA      0x10740002
+#define GNSS_KEY_RATE_MEAS              0x30210001  // ms between measurements
+#define GNSS_KEY_RATE_NAV               0x30210002  // measurements per solution
+#define GNSS_KEY_MSGOUT_NAV_PVT_UART1   0x20910007
+#define GNSS_KEY_NAVSPG_DYNMODEL        0x20110021
+#define GNSS_KEY_NAVSPG_ACKAIDING       0x10110025  // MGA-ACK for every aiding frame
+#define GNSS_KEY_SIGNAL_GPS_ENA         0x1031001f
+#define GNSS_KEY_SIGNAL_GAL_ENA         0x10310021
+
+// CFG-VALSET layer mask / CFG-VALGET layer
+#define GNSS_LAYER_RAM_MASK     0x01
+#define GNSS_LAYER_BBR_MASK     0x02
+#define GNSS_LAYER_RAM          0
+
+#define GNSS_CONFIG_MAX_ITEMS   64  // receiver limit per VALSET/VALGET
+
+struct GnssConfigItem {
+    uint32_t key;
+    uint32_t value;
+};
+
+// Whole receiver configuration as one table of key/value pairs.
+// Builds a single UBX-CFG-VALSET payload to apply it, a single CFG-VALGET
+// poll to read it back, and checks the poll response against the table. The
+// hash identifies a table so a stored copy can tell whether the receiver was
+// last programmed with this exact configuration.
+// Payloads only - framing is left to the transport. No Arduino dependencies
+// so payloads can be checked on the host.
+class GnssConfig {
+public:
+    GnssConfig(const GnssConfigItem* items, uint8_t count);
+
+    uint32_t hash() const;
+
+    // Return payload length, 0 if maxLength is too small
+    uint16_t buildValset(uint8_t layerMask, uint8_t* payload, uint16_t maxLength) const;
+    uint16_t buildValget(uint8_t layer, uint8_t* payload, uint16_t maxLength) const;
+
+    // True if a CFG-VALGET response holds every key with the expected value
+    bool matchesValget(const uint8_t* payload, uint16_t length) const;
+
+    uint8_t count() const { return itemCount; }
+
+    // Value size in bytes encoded in the key, 0 if unknown
+    static uint8_t valueSize(uint32_t key);
+
+private:
+    const GnssConfigItem* items;
+    uint8_t itemCount;
+};
+
+#endif // GNSS_CONFIG_H
@@ -0,0 +1,233 @@
+#include "i2c_bus.h"
+#include <esp_timer.h>
+
+I2CBus::I2CBus() :
+    wire(nullptr),
+    taskHandle(nullptr),
+    currentClock(0),
+    statsStart(0)
+{
+    for (uint8_t i = 0; i < I2C_DEVICE_COUNT; i++) {
+        queues[i] = nullptr;
+        deviceClock[i] = 0;
+    }
+    memset(deviceStats, 0, sizeof(deviceStats));
+}
+
+bool I2CBus::begin(TwoWire& bus, uint32_t clockHz, BaseType_t core, UBaseType_t priority) {
+    if (taskHandle) return true;
+
+    wire = &bus;
+    for (uint8_t i = 0; i < I2C_DEVICE_COUNT; i++) {
+        if (deviceClock[i] == 0) deviceClock[i] = clockHz;
+        queues[i] = xQueueCreate(QUEUE_DEPTH, sizeof(Transaction));
+        if (!queues[i]) return false;
+    }
+
+    wire->setClock(clockHz);
+    currentClock = clockHz;
+    resetStats();
+
+    BaseType_t result = xTaskCreatePinnedToCore(taskEntry, "i2c_bus", 4096, this,
+                                                priority, &taskHandle, core);
+    if (result != pdPASS) {
+        taskHandle = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void I2CBus::setDeviceClock(I2CDevice device, uint32_t clockHz) {
+    deviceClock[device] = clockHz;
+}
+
+bool I2CBus::submitRead(I2CDevice device, uint8_t address, uint8_t reg, uint8_t* buffer,
+                        size_t length, Callback callback, void* context) {
+    Transaction t = {};
+    t.type = TYPE_READ;
+    t.device = device;
+    t.address = address;
+    t.reg = reg;
+    t.buffer = buffer;
+    t.length = length;
+    t.callback = callback;
+    t.context = context;
+    return submit(t);
+}
+
+bool I2CBus::submitWrite(I2CDevice device, uint8_t address, uint8_t reg, uint8_t value,
+                         Callback callback, void* context) {
+    Transaction t = {};
+    t.type = TYPE_WRITE;
+    t.device = device;
+    t.address = address;
+    t.reg = reg;
+    t.value = value;
+    t.callback = callback;
+    t.context = context;
+    return submit(t);
+}
+
+bool I2CBus::submitJob(I2CDevice device, Job job, void* jobContext,
+                       Callback callback, void* context) {
+    Transaction t = {};
+    t.type = TYPE_JOB;
+    t.device = device;
+    t.job = job;
+    t.jobContext = jobContext;
+    t.callback = callback;
+    t.context = context;
+    return submit(t);
+}
+
+bool I2CBus::read(I2CDevice device, uint8_t address, uint8_t reg, uint8_t* buffer, size_t length) {
+    Transaction t = {};
+    t.type = TYPE_READ;
+    t.device = device;
+    t.address = address;
+    t.reg = reg;
+    t.buffer = buffer;
+    t.length = length;
+    return submitAndWait(t);
+}
+
+bool I2CBus::write(I2CDevice device, uint8_t address, uint8_t reg, uint8_t value) {
+    Transaction t = {};
+    t.type = TYPE_WRITE;
+    t.device = device;
+    t.address = address;
+    t.reg = reg;
+    t.value = value;
+    return submitAndWait(t);
+}
+
+bool I2CBus::runJob(I2CDevice device, Job job, void* jobContext) {
+    Transaction t = {};
+    t.type = TYPE_JOB;
+    t.device = device;
+    t.job = job;
+    t.jobContext = jobContext;
+    return submitAndWait(t);
+}
+
+void I2CBus::resetStats() {
+    memset(deviceStats, 0, sizeof(deviceStats));
+    statsStart = esp_timer_get_time();
+}
+
+const char* I2CBus::deviceName(I2CDevice device) {
+    switch (device) {
+        case I2C_DEVICE_IMU:   return "IMU";
+        case I2C_DEVICE_TOUCH: return "Touch";
+        case I2C_DEVICE_PMU:   return "PMU";
+        default:               return "?";
+    }
+}
+
+bool I2CBus::submit(Transaction& t) {
+    if (!taskHandle) return false;
+
+    t.queuedMicros = esp_timer_get_time();
+    if (xQueueSend(queues[t.device], &t, 0) != pdTRUE) {
+        deviceStats[t.device].queueFull++;
+        return false;
+    }
+    xTaskNotifyGive(taskHandle);
+    return true;
+}
+
+bool I2CBus::submitAndWait(Transaction& t) {
+    SyncWait wait;
+    wait.done = nullptr;
+    wait.ok = false;
+    t.callback = syncDone;
+    t.context = &wait;
+
+    // A job that calls back into the bus already owns it - run inline
+    if (xTaskGetCurrentTaskHandle() == taskHandle) {
+        t.queuedMicros = esp_timer_get_time();
+        execute(t);
+        return wait.ok;
+    }
+
+    StaticSemaphore_t semaphoreBuffer;
+    wait.done = xSemaphoreCreateBinaryStatic(&semaphoreBuffer);
+
+    if (!submit(t)) return false;
+    xSemaphoreTake(wait.done, portMAX_DELAY);
+    return wait.ok;
+}
+
+void I2CBus::syncDone(bool ok, void* context) {
+    SyncWait* wait = (SyncWait*)context;
+    wait->ok = ok;
+    if (wait->done) xSemaphoreGive(wait->done);
+}
+
+void I2CBus::execute(Transaction& t) {
+    int64_t start = esp_timer_get_time();
+
+    if (deviceClock[t.device] != currentClock) {
+        currentClock = deviceClock[t.device];
+        wire->setClock(currentClock);
+    }
+
+    bool ok = false;
+    switch (t.type) {
+        case TYPE_READ:
+            wire->beginTransmission(t.address);
+            wire->write(t.reg);
+            if (wire->endTransmission(false) == 0 &&
+                wire->requestFrom((uint16_t)t.address, t.length, true) == t.length) {
+                for (size_t i = 0; i < t.length; i++) {
+                    t.buffer[i] = wire->read();
+                }
+                ok = true;
+            }
+            break;
+        case TYPE_WRITE:
+            wire->beginTransmission(t.address);
+            wire->write(t.reg);
+            wire->write(t.value);
+            ok = (wire->endTransmission() == 0);
+            break;
+        case TYPE_JOB:
+            ok = t.job(*wire, t.jobContext);
+            // Driver libraries may re-begin the bus and change its clock
+            currentClock = wire->getClock();
+            break;
+    }
+
+    int64_t end = esp_timer_get_time();
+    uint32_t busy = (uint32_t)(end - start);
+    uint32_t waited = (uint32_t)(start - t.queuedMicros);
+
+    I2CDeviceStats& s = deviceStats[t.device];
+    s.transactions++;
+    if (!ok) s.errors++;
+    s.busMicros += busy;
+    if (busy > s.maxBusMicros) s.maxBusMicros = busy;
+    if (waited > s.maxWaitMicros) s.maxWaitMicros = waited;
+
+    if (t.callback) t.callback(ok, t.context);
+}
+
+void I2CBus::run() {
+    Transaction t;
+    for (;;) {
+        bool found = false;
+        for (uint8_t i = 0; i < I2C_DEVICE_COUNT && !found; i++) {
+            found = (xQueueReceive(queues[i], &t, 0) == pdTRUE);
+        }
+
+        if (found) {
+            execute(t);
+        } else {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+}
+
+void I2CBus::taskEntry(void* parameter) {
+    ((I2CBus*)parameter)->run();
+}
@@ -0,0 +1,112 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+// Devices on the shared bus, in priority order (lower value is served first)
+enum I2CDevice {
+    I2C_DEVICE_IMU = 0,
+    I2C_DEVICE_TOUCH,
+    I2C_DEVICE_PMU,
+    I2C_DEVICE_COUNT
+};
+
+// Per-device bus usage, written by the bus task only
+struct I2CDeviceStats {
+    uint32_t transactions;
+    uint32_t errors;
+    uint32_t queueFull;       // submits rejected because the queue was full
+    uint64_t busMicros;       // total time the device held the bus
+    uint32_t maxBusMicros;    // longest single transaction
+    uint32_t maxWaitMicros;   // longest time from submit to start
+};
+
+// Owns the Wire bus. Transactions are queued per device and executed by a
+// dedicated task, always taking the highest-priority device with work pending,
+// and complete through a callback on that task. The blocking helpers queue a
+// transaction and wait for it, so existing register code keeps its shape.
+// Driver libraries that talk to Wire directly (touch, PMU) run as jobs.
+class I2CBus {
+public:
+    typedef void (*Callback)(bool ok, void* context);
+    typedef bool (*Job)(TwoWire& wire, void* context);
+
+    I2CBus();
+
+    bool begin(TwoWire& wire, uint32_t clockHz, BaseType_t core, UBaseType_t priority);
+    bool isRunning() const { return taskHandle != nullptr; }
+
+    // Bus clock to use while this device holds the bus
+    void setDeviceClock(I2CDevice device, uint32_t clockHz);
+
+    // Asynchronous - false if the device queue is full
+    bool submitRead(I2CDevice device, uint8_t address, uint8_t reg, uint8_t* buffer,
+                    size_t length, Callback callback, void* context);
+    bool submitWrite(I2CDevice device, uint8_t address, uint8_t reg, uint8_t value,
+                     Callback callback, void* context);
+    bool submitJob(I2CDevice device, Job job, void* jobContext,
+                   Callback callback, void* context);
+
+    // Blocking - queue and wait for completion
+    bool read(I2CDevice device, uint8_t address, uint8_t reg, uint8_t* buffer, size_t length);
+    bool write(I2CDevice device, uint8_t address, uint8_t reg, uint8_t value);
+    bool runJob(I2CDevice device, Job job, void* jobContext);
+
+    const I2CDeviceStats& stats(I2CDevice device) const { return deviceStats[device]; }
+    uint32_t clockHz(I2CDevice device) const { return deviceClock[device]; }
+    int64_t statsStartMicros() const { return statsStart; }
+    void resetStats();
+
+    static const char* deviceName(I2CDevice device);
+
+private:
+    static const uint8_t QUEUE_DEPTH = 8;
+
+    enum Type {
+        TYPE_READ,
+        TYPE_WRITE,
+        TYPE_JOB
+    };
+
+    struct Transaction {
+        Type type;
+        I2CDevice device;
+        uint8_t address;
+        uint8_t reg;
+        uint8_t value;
+        uint8_t* buffer;
+        size_t length;
+        Job job;
+        void* jobContext;
+        Callback callback;
+        void* context;
+        int64_t queuedMicros;
+    };
+
+    struct SyncWait {
+        SemaphoreHandle_t done;
+        bool ok;
+    };
+
+    TwoWire* wire;
+    TaskHandle_t taskHandle;
+    QueueHandle_t queues[I2C_DEVICE_COUNT];
+    uint32_t deviceClock[I2C_DEVICE_COUNT];
+    uint32_t currentClock;
+    I2CDeviceStats deviceStats[I2C_DEVICE_COUNT];
+    int64_t statsStart;
+
+    bool submit(Transaction& t);
+    bool submitAndWait(Transaction& t);
+    void execute(Transaction& t);
+    void run();
+
+    static void taskEntry(void* parameter);
+    static void syncDone(bool ok, void* context);
+};
+
+#endif // I2C_BUS_H
@@ -0,0 +1,128 @@
+#include "imu_calibration.h"
+#include <math.h>
+
+// A window is quiet when the spread of the magnitudes stays below these
+#define QUIET_ACCEL_STDDEV_G    0.02
+#define QUIET_GYRO_STDDEV_DPS   0.5
+
+// Fraction of a tracking window's residual applied per window
+#define TRACK_GAIN              0.2f
+
+// Residual below which a window confirms the current offsets
+#define CONFIRM_GYRO_DPS        0.1f
+#define CONFIRM_ACCEL_G         0.01f
+
+#define FULL_CALIBRATION_CONFIDENCE 0.8f
+
+ImuBiasTracker::ImuBiasTracker() :
+    fullCalibration(false),
+    confidenceValue(0.0f),
+    accepted(0),
+    rejected(0)
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        lastCorrection.accel[i] = 0.0f;
+        lastCorrection.gyro[i] = 0.0f;
+    }
+    clearWindow();
+}
+
+void ImuBiasTracker::reset(float confidence) {
+    fullCalibration = false;
+    confidenceValue = confidence;
+    accepted = 0;
+    rejected = 0;
+    clearWindow();
+}
+
+void ImuBiasTracker::requestFullCalibration() {
+    fullCalibration = true;
+    clearWindow();
+}
+
+void ImuBiasTracker::clearWindow() {
+    count = 0;
+    windowStationary = true;
+    for (uint8_t i = 0; i < 3; i++) {
+        accelSum[i] = 0.0;
+        gyroSum[i] = 0.0;
+    }
+    accelMagSum = accelMagSumSq = 0.0;
+    gyroMagSum = gyroMagSumSq = 0.0;
+}
+
+ImuBiasTracker::Result ImuBiasTracker::addSample(const float accel[3], const float gyro[3],
+                                                 bool stationary) {
+    if (!stationary) {
+        windowStationary = false;
+    }
+
+    for (uint8_t i = 0; i < 3; i++) {
+        accelSum[i] += accel[i];
+        gyroSum[i] += gyro[i];
+    }
+    double accelMag = sqrt((double)accel[0] * accel[0] + (double)accel[1] * accel[1] +
+                           (double)accel[2] * accel[2]);
+    double gyroMag = sqrt((double)gyro[0] * gyro[0] + (double)gyro[1] * gyro[1] +
+                          (double)gyro[2] * gyro[2]);
+    accelMagSum += accelMag;
+    accelMagSumSq += accelMag * accelMag;
+    gyroMagSum += gyroMag;
+    gyroMagSumSq += gyroMag * gyroMag;
+    count++;
+
+    uint16_t windowSamples = fullCalibration ? FULL_WINDOW_SAMPLES : TRACK_WINDOW_SAMPLES;
+    if (count < windowSamples) return RESULT_NONE;
+
+    double n = count;
+    double accelMean = accelMagSum / n;
+    double gyroMean = gyroMagSum / n;
+    double accelVar = accelMagSumSq / n - accelMean * accelMean;
+    double gyroVar = gyroMagSumSq / n - gyroMean * gyroMean;
+    bool quiet = windowStationary &&
+                 accelVar < QUIET_ACCEL_STDDEV_G * QUIET_ACCEL_STDDEV_G &&
+                 gyroVar < QUIET_GYRO_STDDEV_DPS * QUIET_GYRO_STDDEV_DPS;
+
+    ImuBias residual;
+    for (uint8_t i = 0; i < 3; i++) {
+        residual.gyro[i] = (float)(gyroSum[i] / n);
+        residual.accel[i] = (float)(accelSum[i] / n);
+    }
+    residual.accel[2] -= 1.0f; // at rest the Z axis reads 1 g
+
+    bool wasFull = fullCalibration;
+    clearWindow();
+
+    if (!quiet) {
+        rejected++;
+        if (wasFull) {
+            fullCalibration = false;
+            return RESULT_CALIBRATION_FAILED;
+        }
+        return RESULT_NONE;
+    }
+    accepted++;
+
+    if (wasFull) {
+        fullCalibration = false;
+        lastCorrection = residual;
+        confidenceValue = FULL_CALIBRATION_CONFIDENCE;
+        return RESULT_CALIBRATED;
+    }
+
+    float gyroError = 0.0f, accelError = 0.0f;
+    for (uint8_t i = 0; i < 3; i++) {
+        lastCorrection.gyro[i] = residual.gyro[i] * TRACK_GAIN;
+        lastCorrection.accel[i] = residual.accel[i] * TRACK_GAIN;
+        gyroError = fmaxf(gyroError, fabsf(residual.gyro[i]));
+        accelError = fmaxf(accelError, fabsf(residual.accel[i]));
+    }
+
+    // Windows that agree with the offsets build confidence, others erode it
+    if (gyroError < CONFIRM_GYRO_DPS && accelError < CONFIRM_ACCEL_G) {
+        confidenceValue += (1.0f - confidenceValue) * 0.1f;
+    } else {
+        confidenceValue *= 0.9f;
+    }
+    return RESULT_REFINED;
+}
@@ -0,0 +1,62 @@
+#ifndef IMU_CALIBRATION_H
+#define IMU_CALIBRATION_H
+
+#include <stdint.h>
+
+// Accelerometer (g) and gyroscope (deg/s) bias
+struct ImuBias {
+    float accel[3];
+    float gyro[3];
+};
+
+// Online bias estimator fed with calibrated samples.
+// Samples are grouped into windows; a window only counts if the caller flagged
+// every sample as stationary and the window itself was quiet (low variance).
+// A quiet window's mean is the residual bias left after the current offsets -
+// zero rate on the gyro and (0, 0, 1 g) on the accelerometer - and a fraction
+// of it is returned as a correction to add to the offsets. A full calibration
+// captures one long window and returns the whole residual.
+// No Arduino dependencies so recorded samples can be replayed on the host.
+class ImuBiasTracker {
+public:
+    enum Result {
+        RESULT_NONE,
+        RESULT_REFINED,             // tracking window accepted, correction() is valid
+        RESULT_CALIBRATED,          // full calibration finished, correction() is valid
+        RESULT_CALIBRATION_FAILED   // unit moved during a full calibration
+    };
+
+    static const uint16_t TRACK_WINDOW_SAMPLES = 250;  // 0.5 s at 500 Hz
+    static const uint16_t FULL_WINDOW_SAMPLES = 1000;  // 2 s at 500 Hz
+
+    ImuBiasTracker();
+
+    void reset(float confidence);
+    void requestFullCalibration();
+    bool fullCalibrationActive() const { return fullCalibration; }
+
+    Result addSample(const float accel[3], const float gyro[3], bool stationary);
+
+    const ImuBias& correction() const { return lastCorrection; }
+    float confidence() const { return confidenceValue; }
+    uint32_t windowsAccepted() const { return accepted; }
+    uint32_t windowsRejected() const { return rejected; }
+
+private:
+    bool fullCalibration;
+    uint16_t count;
+    bool windowStationary;
+    double accelSum[3];
+    double gyroSum[3];
+    double accelMagSum, accelMagSumSq;
+    double gyroMagSum, gyroMagSumSq;
+
+    ImuBias lastCorrection;
+    float confidenceValue;
+    uint32_t accepted;
+    uint32_t rejected;
+
+    void clearWindow();
+};
+
+#endif // IMU_CALIBRATION_H
@@ -0,0 +1,59 @@
+#include "log_block.h"
+#include <string.h>
+#include "crc.h"
+
+static_assert(LOG_BLOCK_SIZE % 512 == 0, "Log blocks must be whole SD sectors");
+static_assert(sizeof(LogBlockHeader) == 36, "LogBlockHeader wire size changed");
+
+static uint32_t blockCrc(const uint8_t* block, uint16_t payloadLength) {
+    uint32_t crc = crc32(block, offsetof(LogBlockHeader, crc));
+    return crc32(block + sizeof(LogBlockHeader), payloadLength, crc);
+}
+
+void sealLogBlock(uint8_t* block, LogBlockHeader& header) {
+    header.sync = LOG_BLOCK_SYNC;
+    header.version = LOG_BLOCK_VERSION;
+    memcpy(block, &header, sizeof(header));
+    header.crc = blockCrc(block, header.payloadLength);
+    memcpy(block + offsetof(LogBlockHeader, crc), &header.crc, sizeof(header.crc));
+
+    size_t used = sizeof(header) + header.payloadLength;
+    memset(block + used, 0, LOG_BLOCK_SIZE - used);
+}
+
+bool checkLogBlock(const uint8_t* block, LogBlockHeader& header) {
+    memcpy(&header, block, sizeof(header));
+    if (header.sync != LOG_BLOCK_SYNC || header.version != LOG_BLOCK_VERSION) return false;
+    if (header.payloadLength > LOG_BLOCK_PAYLOAD) return false;
+    return blockCrc(block, header.payloadLength) == header.crc;
+}
+
+size_t findLogBlock(const uint8_t* data, size_t length, size_t from) {
+    const uint32_t sync = LOG_BLOCK_SYNC;
+    LogBlockHeader header;
+    for (size_t at = from; at + LOG_BLOCK_SIZE <= length; at++) {
+        if (memcmp(data + at, &sync, sizeof(sync)) == 0 && checkLogBlock(data + at, header)) return at;
+    }
+    return length;
+}
+
+LogBlockRecords::LogBlockRecords(const uint8_t* block, const LogBlockHeader& header) :
+    payload(block + sizeof(LogBlockHeader)),
+    length(header.kind == LOG_BLOCK_RECORDS ? header.payloadLength : 0),
+    position(0),
+    broken(false)
+{
+}
+
+bool LogBlockRecords::next(uint8_t& type, const uint8_t*& data, uint8_t& recordLength) {
+    if (position >= length) return false;
+    if (position + 2 > length || position + 2 + payload[position + 1] > length) {
+        broken = true;
+        return false;
+    }
+    type = payload[position];
+    recordLength = payload[position + 1];
+    data = payload + position + 2;
+    position += 2 + recordLength;
+    return true;
+}
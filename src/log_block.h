@@ -0,0 +1,83 @@
+#ifndef LOG_BLOCK_H
+#define LOG_BLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// V2 log files are a sequence of fixed-size blocks. Each starts with a
+// header carrying a sync word, the block's sequence in the file, the UTC
+// span and record count of what it holds, and a CRC32 over the header and
+// payload; the rest of the block is zero padding. A reader checks a block
+// without decoding it, skips a damaged one and finds the next by its sync
+// word, and can decode blocks independently - delta blocks start with a
+// keyframe. The first block of a file is a metadata block holding the
+// header text lines (#BOOT, #SCHEMA, #ENCODING); a finished file ends in a
+// summary block (#SUMMARY). Sequence numbers run on from a random start in
+// each file, so a block an earlier file left on the card never passes for
+// one of this file's.
+//
+// Record entries: type (1) | length (1) | record bytes
+//
+// No Arduino dependencies - shared with the host reader in tools/.
+#define LOG_BLOCK_SIZE      2048        // whole SD sectors
+#define LOG_BLOCK_SYNC      0x4B4C4247  // "GBLK" in the file
+#define LOG_BLOCK_VERSION   2
+#define LOG_BLOCK_DELTA     0x01        // flags: records are record_stream frames
+#define LOG_BLOCK_RECOVERED 0x02        // flags: summary written by boot-time recovery
+
+enum LogBlockKind {
+    LOG_BLOCK_METADATA = 0,     // header text lines
+    LOG_BLOCK_RECORDS,          // record entries
+    LOG_BLOCK_SUMMARY           // #SUMMARY text line; first/last span the file
+};
+
+enum LogRecordType {
+    LOG_RECORD_GPS = 0          // GPSPacket, raw or a record_stream frame
+};
+
+// Little-endian
+struct __attribute__((packed)) LogBlockHeader {
+    uint32_t sync;
+    uint8_t version;
+    uint8_t kind;
+    uint8_t flags;
+    uint8_t typeMask;           // 1 << LogRecordType for each type in the block
+    uint32_t sequence;          // consecutive in a file, from the metadata block's
+    uint16_t recordCount;
+    uint16_t payloadLength;
+    int64_t firstMicros;        // UTC µs of the first and last record, 0 if time unknown
+    int64_t lastMicros;
+    uint32_t crc;               // CRC32 of the header before it, then the payload
+};
+
+#define LOG_BLOCK_PAYLOAD   (LOG_BLOCK_SIZE - sizeof(LogBlockHeader))
+
+// Seals a block: fills in sync, version and CRC, zeroes the padding.
+// header.payloadLength bytes of payload follow the header in block.
+void sealLogBlock(uint8_t* block, LogBlockHeader& header);
+
+// True if block holds a whole, intact block; header receives its header
+bool checkLogBlock(const uint8_t* block, LogBlockHeader& header);
+
+// Offset of the first intact block at or after from, or length if none.
+// Blocks are looked for at every byte, so a reader recovers even if the
+// data it has lost is not a whole number of blocks.
+size_t findLogBlock(const uint8_t* data, size_t length, size_t from);
+
+// Walks the record entries of a checked records block
+class LogBlockRecords {
+public:
+    LogBlockRecords(const uint8_t* block, const LogBlockHeader& header);
+
+    // False at the end of the payload, or at an entry that runs past it
+    bool next(uint8_t& type, const uint8_t*& data, uint8_t& length);
+    bool malformed() const { return broken; }
+
+private:
+    const uint8_t* payload;
+    size_t length;
+    size_t position;
+    bool broken;
+};
+
+#endif // LOG_BLOCK_H
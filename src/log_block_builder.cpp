@@ -0,0 +1,124 @@
+#include "log_block_builder.h"
+#include <string.h>
+
+LogBlockBuilder::LogBlockBuilder(const RecordSchema& schema, RecordStreamEncoder& encoder) :
+    schema(schema),
+    encoder(encoder),
+    wantDelta(false),
+    delta(false),
+    count(0),
+    used(0),
+    firstLocalMicros(0),
+    firstUtcMicros(0),
+    lastUtcMicros(0),
+    sequence(0),
+    fileSequence(0),
+    fileRecordTotal(0),
+    takenCount(0),
+    fileFirstMicros(0),
+    fileLastMicros(0),
+    blockTotal(0),
+    recordTotal(0)
+{
+}
+
+void LogBlockBuilder::startFile(uint32_t firstSequence) {
+    count = 0;
+    used = 0;
+    sequence = fileSequence = firstSequence;
+    fileRecordTotal = 0;
+    fileFirstMicros = 0;
+    fileLastMicros = 0;
+}
+
+bool LogBlockBuilder::add(const uint8_t* record, int64_t localMicros, int64_t utcMicros) {
+    if (count == 0) {
+        delta = wantDelta;
+        firstLocalMicros = localMicros;
+        firstUtcMicros = utcMicros;
+        if (delta) encoder.reset();
+    }
+
+    uint8_t* entry = payload + used;
+    size_t length;
+    if (delta) {
+        length = encoder.encode(record, entry + 2);
+    } else {
+        memcpy(entry + 2, record, schema.size);
+        length = schema.size;
+    }
+    entry[0] = LOG_RECORD_GPS;
+    entry[1] = (uint8_t)length;
+    used += 2 + length;
+    lastUtcMicros = utcMicros;
+    if (fileRecordTotal == 0) fileFirstMicros = utcMicros;
+    fileLastMicros = utcMicros;
+    count++;
+    recordTotal++;
+    fileRecordTotal++;
+
+    // Full, or the next record might not fit
+    size_t worst = 2 + (delta ? encoder.maxFrameSize() : schema.size);
+    return used + worst > sizeof(payload);
+}
+
+bool LogBlockBuilder::due(int64_t nowLocalMicros, uint32_t maxAgeMicros) const {
+    return count > 0 && nowLocalMicros - firstLocalMicros >= (int64_t)maxAgeMicros;
+}
+
+bool LogBlockBuilder::take(uint8_t* out) {
+    if (count == 0) return false;
+
+    LogBlockHeader header;
+    header.kind = LOG_BLOCK_RECORDS;
+    header.flags = delta ? LOG_BLOCK_DELTA : 0;
+    header.typeMask = 1 << LOG_RECORD_GPS;
+    header.sequence = sequence++;
+    header.recordCount = count;
+    header.payloadLength = used;
+    header.firstMicros = firstUtcMicros;
+    header.lastMicros = lastUtcMicros;
+    memcpy(out + sizeof(header), payload, used);
+    sealLogBlock(out, header);
+    blockTotal++;
+
+    takenCount = count;
+    count = 0;
+    used = 0;
+    return true;
+}
+
+void LogBlockBuilder::untake() {
+    sequence--;
+    blockTotal--;
+    recordTotal -= takenCount;
+    fileRecordTotal -= takenCount;
+    takenCount = 0;
+}
+
+void LogBlockBuilder::takeMetadata(const char* text, size_t length, uint8_t* out) {
+    takeText(LOG_BLOCK_METADATA, text, length, 0, 0, out);
+}
+
+void LogBlockBuilder::takeSummary(const char* text, size_t length, uint8_t* out) {
+    takeText(LOG_BLOCK_SUMMARY, text, length, fileFirstMicros, fileLastMicros, out);
+}
+
+void LogBlockBuilder::takeText(uint8_t kind, const char* text, size_t length, int64_t firstMicros,
+                               int64_t lastMicros, uint8_t* out) {
+    if (length > LOG_BLOCK_PAYLOAD) length = LOG_BLOCK_PAYLOAD;
+
+    LogBlockHeader header;
+    header.kind = kind;
+    header.flags = 0;
+    header.typeMask = 0;
+    header.sequence = sequence++;
+    header.recordCount = 0;
+    header.payloadLength = length;
+    header.firstMicros = firstMicros;
+    header.lastMicros = lastMicros;
+    memcpy(out + sizeof(header), text, length);
+    sealLogBlock(out, header);
+    blockTotal++;
+    takenCount = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef LOG_BLOCK_BUILDER_H
+#define LOG_BLOCK_BUILDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "log_block.h"
+#include "record_stream.h"
+
+// Packs GPS records into LOG_BLOCK_SIZE blocks for the SD writer. A block
+// is taken when the next record might not fit, or when its first record is
+// older than the caller's age limit, so a slow nav rate still reaches the
+// card. Delta blocks restart the encoder with a keyframe. Records and
+// their delta frames must fit the one-byte entry length.
+class LogBlockBuilder {
+public:
+    LogBlockBuilder(const RecordSchema& schema, RecordStreamEncoder& encoder);
+
+    // A new file: the open block is dropped and blocks are numbered from
+    // firstSequence, a value an earlier file on the card is unlikely to share
+    void startFile(uint32_t firstSequence);
+    // Applies from the next block
+    void setDelta(bool delta) { wantDelta = delta; }
+
+    // Returns true once the block is full and should be taken
+    bool add(const uint8_t* record, int64_t localMicros, int64_t utcMicros);
+    // Open block held at least maxAgeMicros
+    bool due(int64_t nowLocalMicros, uint32_t maxAgeMicros) const;
+    bool pending() const { return count > 0; }
+    uint16_t pendingRecords() const { return count; }
+    // Seals the open block into out (LOG_BLOCK_SIZE bytes); false if there is none
+    bool take(uint8_t* out);
+    // The block just taken never reached the file: the next one takes its
+    // sequence number, so a block's number stays its place in the file
+    void untake();
+    // Seal a metadata or summary block holding text, truncated to
+    // LOG_BLOCK_PAYLOAD. The summary spans the file's records.
+    void takeMetadata(const char* text, size_t length, uint8_t* out);
+    void takeSummary(const char* text, size_t length, uint8_t* out);
+
+    uint32_t blocks() const { return blockTotal; }
+    uint32_t records() const { return recordTotal; }
+    uint32_t firstSequence() const { return fileSequence; }
+    // Blocks taken and records added in the current file
+    uint32_t fileBlocks() const { return sequence - fileSequence; }
+    uint32_t fileRecords() const { return fileRecordTotal; }
+
+private:
+    void takeText(uint8_t kind, const char* text, size_t length, int64_t firstMicros,
+                  int64_t lastMicros, uint8_t* out);
+
+    const RecordSchema& schema;
+    RecordStreamEncoder& encoder;
+    bool wantDelta;
+
+    bool delta;                 // encoding of the open block
+    uint16_t count;
+    size_t used;                // payload bytes
+    int64_t firstLocalMicros;
+    int64_t firstUtcMicros;
+    int64_t lastUtcMicros;
+    uint8_t payload[LOG_BLOCK_PAYLOAD];
+
+    uint32_t sequence;          // next block in the file
+    uint32_t fileSequence;      // of its first block
+    uint32_t fileRecordTotal;
+    uint16_t takenCount;        // records in the block last taken
+    int64_t fileFirstMicros;    // UTC span of its records
+    int64_t fileLastMicros;
+    uint32_t blockTotal;
+    uint32_t recordTotal;
+};
+
+#endif // LOG_BLOCK_BUILDER_H
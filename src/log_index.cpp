@@ -0,0 +1,71 @@
+#include "log_index.h"
+#include "log_block.h"
+
+static_assert(sizeof(LogIndexHeader) == 16, "LogIndexHeader wire size changed");
+static_assert(sizeof(LogIndexEntry) == 12, "LogIndexEntry wire size changed");
+
+void makeLogIndexHeader(uint32_t firstSequence, LogIndexHeader& header) {
+    header.magic = LOG_INDEX_MAGIC;
+    header.version = LOG_INDEX_VERSION;
+    header.reserved = 0;
+    header.blocksPerEntry = LOG_INDEX_EVERY;
+    header.firstSequence = firstSequence;
+    header.blockSize = LOG_BLOCK_SIZE;
+}
+
+bool checkLogIndexHeader(const LogIndexHeader& header, uint32_t firstSequence) {
+    return header.magic == LOG_INDEX_MAGIC && header.version == LOG_INDEX_VERSION &&
+           header.blocksPerEntry == LOG_INDEX_EVERY && header.blockSize == LOG_BLOCK_SIZE &&
+           header.firstSequence == firstSequence;
+}
+
+bool LogIndexer::add(uint32_t block, int64_t firstMicros, LogIndexEntry& entry) {
+    // Record blocks start at 1, after the metadata block
+    if (block == 0 || firstMicros == 0) return false;
+    uint32_t g = groupOf(block);
+    if (g == group) return false;
+    group = g;
+    entry.micros = firstMicros;
+    entry.block = block;
+    return true;
+}
+
+// Entries at or before micros, by bisection
+static bool countAtOrBefore(LogIndexRead read, void* context, uint32_t count, int64_t micros,
+                            uint32_t& n) {
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        LogIndexEntry entry;
+        if (!read(context, mid, entry)) return false;
+        if (entry.micros <= micros) low = mid + 1;
+        else high = mid;
+    }
+    n = low;
+    return true;
+}
+
+bool findLogIndexRange(LogIndexRead read, void* context, uint32_t count, uint32_t blockCount,
+                       int64_t fromMicros, int64_t toMicros, uint32_t& first, uint32_t& end) {
+    first = 1;
+    end = blockCount;
+    LogIndexEntry entry;
+
+    // From the last entry at or before fromMicros - blocks ahead of it end before it
+    uint32_t n;
+    if (!countAtOrBefore(read, context, count, fromMicros, n)) return false;
+    if (n > 0) {
+        if (!read(context, n - 1, entry)) return false;
+        first = entry.block;
+    }
+    // To the first entry after toMicros
+    if (!countAtOrBefore(read, context, count, toMicros, n)) return false;
+    if (n < count) {
+        if (!read(context, n, entry)) return false;
+        end = entry.block;
+    }
+    if (end > blockCount) end = blockCount;
+    if (first > end) first = end;
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Sparse time index of a V2 log, kept next to it as <name>.idx: a header,
+// then an entry for each group of LOG_INDEX_EVERY record blocks giving the
+// UTC time of the first record of its first block with a known time, and
+// that block's number - the log is fixed-size blocks, so the number is the
+// offset. Times only grow along a log, so a time range maps to a block
+// range with a binary search over the entries. The logger appends entries
+// as it writes and recovery rebuilds the tail after a power loss.
+//
+// No Arduino dependencies - shared with the host reader in tools/.
+#define LOG_INDEX_MAGIC     0x58444947  // "GIDX" in the file
+#define LOG_INDEX_VERSION   1
+#define LOG_INDEX_EVERY     8           // record blocks per entry - one SD writer block
+
+// Little-endian
+struct __attribute__((packed)) LogIndexHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t blocksPerEntry;
+    uint32_t firstSequence;     // of the log's metadata block - ties the index to its log
+    uint32_t blockSize;
+};
+
+struct __attribute__((packed)) LogIndexEntry {
+    int64_t micros;             // UTC µs of the block's first record
+    uint32_t block;             // in the log, from its metadata block at 0
+};
+
+void makeLogIndexHeader(uint32_t firstSequence, LogIndexHeader& header);
+// True if header is an index of the log whose metadata block has firstSequence
+bool checkLogIndexHeader(const LogIndexHeader& header, uint32_t firstSequence);
+
+// Picks the blocks that get an entry, as they are written
+class LogIndexer {
+public:
+    LogIndexer() : group(NO_GROUP) {}
+
+    void startFile() { group = NO_GROUP; }
+    // Resume after the group of block, which already has an entry
+    void resumeAfter(uint32_t block) { group = groupOf(block); }
+    // For each record block in order; true with entry filled in if it gets one
+    bool add(uint32_t block, int64_t firstMicros, LogIndexEntry& entry);
+
+    static uint32_t groupOf(uint32_t block) { return (block - 1) / LOG_INDEX_EVERY; }
+
+private:
+    static const uint32_t NO_GROUP = 0xFFFFFFFF;
+    uint32_t group;             // of the last entry
+};
+
+// Fetches entry i of the index; false on a read error
+typedef bool (*LogIndexRead)(void* context, uint32_t i, LogIndexEntry& entry);
+
+// Block range [first, end) of a log of blockCount blocks holding every record
+// from fromMicros to toMicros, looked up in an index of count entries with
+// O(log count) reads. With no entries it is every record block. False on a
+// read error.
+bool findLogIndexRange(LogIndexRead read, void* context, uint32_t count, uint32_t blockCount,
+                       int64_t fromMicros, int64_t toMicros, uint32_t& first, uint32_t& end);
+
+#endif // LOG_INDEX_H
@@ -0,0 +1,230 @@
+#include "log_recovery.h"
+#include <stdio.h>
+#include <string.h>
+#include <esp_timer.h>
+#include "ff.h"
+
+// FIL carries a sector buffer; all are too big for a boot task's stack
+static FIL fil;
+static FIL indexFil;
+static uint8_t block[LOG_BLOCK_SIZE];
+
+struct LogScan {
+    uint32_t firstSequence;     // of the metadata block
+    uint32_t blockCount;        // whole blocks in the file
+    bool error;
+    LogRecoveryResult& result;
+
+    explicit LogScan(LogRecoveryResult& r) : firstSequence(0), blockCount(0), error(false), result(r) {}
+
+    // Reads block index into block; false on a FatFs error
+    bool read(uint32_t index) {
+        UINT n = 0;
+        result.blockReads++;
+        if (f_lseek(&fil, (FSIZE_t)index * LOG_BLOCK_SIZE) != FR_OK ||
+            f_read(&fil, block, LOG_BLOCK_SIZE, &n) != FR_OK || n != LOG_BLOCK_SIZE) {
+            error = true;
+            return false;
+        }
+        return true;
+    }
+
+    // An intact block of this file, in its place
+    bool own(uint32_t index, LogBlockHeader& header) {
+        return read(index) && checkLogBlock(block, header) && header.sequence == firstSequence + index;
+    }
+
+    // First block of this file at or after index, looking at most
+    // LOG_RECOVERY_PROBE of them and none at or past end; end if none
+    uint32_t probe(uint32_t index, uint32_t end, LogBlockHeader& header) {
+        for (uint32_t i = index; i < end && i < index + LOG_RECOVERY_PROBE && !error; i++) {
+            if (own(i, header)) return i;
+        }
+        return end;
+    }
+};
+
+// Bytes of this file's blocks from index on that did not make it whole:
+// its sync word and sequence in the header, but not an intact block
+static uint32_t tornBytes(LogScan& scan, uint32_t index, uint32_t fileSize) {
+    uint32_t lost = 0;
+    for (uint32_t i = index; i < index + LOG_RECOVERY_PROBE; i++) {
+        uint32_t at = i * LOG_BLOCK_SIZE;
+        if (at + sizeof(LogBlockHeader) > fileSize) break;
+        UINT n = 0;
+        LogBlockHeader header;
+        scan.result.blockReads++;
+        if (f_lseek(&fil, at) != FR_OK || f_read(&fil, &header, sizeof(header), &n) != FR_OK ||
+            n != sizeof(header)) break;
+        if (header.sync != LOG_BLOCK_SYNC || header.sequence != scan.firstSequence + i) break;
+        lost += fileSize - at < LOG_BLOCK_SIZE ? fileSize - at : LOG_BLOCK_SIZE;
+    }
+    return lost;
+}
+
+static bool readIndexEntry(void* context, uint32_t i, LogIndexEntry& entry) {
+    UINT n = 0;
+    (void)context;
+    return f_lseek(&indexFil, sizeof(LogIndexHeader) + (FSIZE_t)i * sizeof(entry)) == FR_OK &&
+           f_read(&indexFil, &entry, sizeof(entry), &n) == FR_OK && n == sizeof(entry);
+}
+
+// Entries up to block last are kept; the groups after the last of them
+// get theirs from the first timed record block in each
+static bool rebuildIndex(LogScan& scan, const char* indexPath, uint32_t last) {
+    if (f_open(&indexFil, indexPath, FA_READ | FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) return false;
+
+    LogIndexHeader header;
+    UINT n = 0;
+    uint32_t size = (uint32_t)f_size(&indexFil);
+    uint32_t count = 0;
+    bool ok = size >= sizeof(header) && f_read(&indexFil, &header, sizeof(header), &n) == FR_OK &&
+              n == sizeof(header) && checkLogIndexHeader(header, scan.firstSequence);
+    if (ok) {
+        count = (size - sizeof(header)) / sizeof(LogIndexEntry);
+    } else {
+        makeLogIndexHeader(scan.firstSequence, header);
+        ok = f_lseek(&indexFil, 0) == FR_OK && f_write(&indexFil, &header, sizeof(header), &n) == FR_OK &&
+             n == sizeof(header);
+    }
+
+    // Entries are in block order: keep those at or before last
+    uint32_t low = 0;
+    uint32_t high = count;
+    LogIndexEntry entry;
+    while (ok && low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        ok = readIndexEntry(nullptr, mid, entry);
+        if (!ok) break;
+        if (entry.block <= last) low = mid + 1;
+        else high = mid;
+    }
+    uint32_t kept = low;
+
+    LogIndexer indexer;
+    uint32_t group = 1;
+    if (ok && kept > 0) {
+        ok = readIndexEntry(nullptr, kept - 1, entry);
+        if (ok) {
+            indexer.resumeAfter(entry.block);
+            group = (LogIndexer::groupOf(entry.block) + 1) * LOG_INDEX_EVERY + 1;
+        }
+    }
+    ok = ok && f_lseek(&indexFil, sizeof(header) + (FSIZE_t)kept * sizeof(entry)) == FR_OK;
+
+    uint32_t added = 0;
+    LogBlockHeader blockHeader;
+    for (; ok && group <= last; group += LOG_INDEX_EVERY) {
+        for (uint32_t i = group; i < group + LOG_INDEX_EVERY && i <= last; i++) {
+            if (!scan.own(i, blockHeader) || blockHeader.kind != LOG_BLOCK_RECORDS) continue;
+            if (!indexer.add(i, blockHeader.firstMicros, entry)) continue;
+            // The scan moved the file position; entries go after the last one
+            ok = f_lseek(&indexFil, sizeof(header) + (FSIZE_t)(kept + added) * sizeof(entry)) == FR_OK &&
+                 f_write(&indexFil, &entry, sizeof(entry), &n) == FR_OK && n == sizeof(entry);
+            added++;
+            break;
+        }
+    }
+
+    if (ok && f_size(&indexFil) > f_tell(&indexFil)) ok = f_truncate(&indexFil) == FR_OK;
+    if (f_close(&indexFil) != FR_OK) ok = false;
+    scan.result.indexEntries = kept + added;
+    scan.result.indexAdded = added;
+    return ok && !scan.error;
+}
+
+void recoverLogFile(const char* fatPath, const char* indexPath, LogRecoveryResult& result) {
+    int64_t start = esp_timer_get_time();
+    memset(&result, 0, sizeof(result));
+    result.status = LOG_RECOVERY_FAILED;
+
+    if (f_open(&fil, fatPath, FA_READ | FA_WRITE | FA_OPEN_EXISTING) != FR_OK) {
+        result.micros = (uint32_t)(esp_timer_get_time() - start);
+        return;
+    }
+    uint32_t size = (uint32_t)f_size(&fil);
+    result.originalBytes = result.finalBytes = size;
+
+    LogScan scan(result);
+    scan.blockCount = size / LOG_BLOCK_SIZE;
+    LogBlockHeader header;
+    if (scan.blockCount == 0 || !scan.read(0) || !checkLogBlock(block, header) ||
+        header.kind != LOG_BLOCK_METADATA) {
+        if (!scan.error) result.status = LOG_RECOVERY_UNREADABLE;
+        f_close(&fil);
+        result.micros = (uint32_t)(esp_timer_get_time() - start);
+        return;
+    }
+    scan.firstSequence = header.sequence;
+
+    // Block last is this file's, block end is not: halve the gap until
+    // they meet, treating a bad block followed closely by a good one as
+    // damage inside the written data rather than its end
+    uint32_t last = 0;
+    uint32_t end = scan.blockCount;
+    LogBlockHeader lastHeader = header;
+    while (end - last > 1 && !scan.error) {
+        uint32_t mid = last + (end - last) / 2;
+        uint32_t found = scan.probe(mid, end, header);
+        if (found < end) {
+            last = found;
+            lastHeader = header;
+        } else {
+            end = mid;
+        }
+    }
+    if (scan.error) {
+        f_close(&fil);
+        result.micros = (uint32_t)(esp_timer_get_time() - start);
+        return;
+    }
+    result.blocks = last + 1;
+    if (indexPath && !rebuildIndex(scan, indexPath, last)) {
+        f_close(&fil);
+        result.micros = (uint32_t)(esp_timer_get_time() - start);
+        return;
+    }
+
+    uint32_t cut = (last + 1) * LOG_BLOCK_SIZE;
+    FRESULT written = FR_OK;
+    if (lastHeader.kind == LOG_BLOCK_SUMMARY) {
+        // Finished, but reset before the preallocated tail was trimmed
+        result.blocks = last;
+        result.status = LOG_RECOVERY_CLEAN;
+    } else {
+        result.lostBytes = tornBytes(scan, last + 1, size);
+
+        // The file's span: its first intact record block to the last one kept
+        LogBlockHeader summary;
+        memset(&summary, 0, sizeof(summary));
+        if (last > 0) {
+            summary.lastMicros = lastHeader.lastMicros;
+            if (scan.probe(1, last + 1, header) <= last) summary.firstMicros = header.firstMicros;
+        }
+        int length = snprintf((char*)block + sizeof(LogBlockHeader), LOG_BLOCK_PAYLOAD,
+                              "#SUMMARY blocks=%lu recovered=1 lost_bytes=%lu\n",
+                              (unsigned long)result.blocks, (unsigned long)result.lostBytes);
+        summary.kind = LOG_BLOCK_SUMMARY;
+        summary.flags = LOG_BLOCK_RECOVERED;
+        summary.sequence = scan.firstSequence + last + 1;
+        summary.payloadLength = length;
+        sealLogBlock(block, summary);
+
+        UINT n = 0;
+        written = f_lseek(&fil, cut);
+        if (written == FR_OK) written = f_write(&fil, block, LOG_BLOCK_SIZE, &n);
+        if (written == FR_OK && n != LOG_BLOCK_SIZE) written = FR_DISK_ERR;
+        cut += LOG_BLOCK_SIZE;
+        result.status = LOG_RECOVERY_RECOVERED;
+    }
+
+    if (written == FR_OK && f_lseek(&fil, cut) == FR_OK && (uint32_t)f_size(&fil) > cut) {
+        written = f_truncate(&fil);
+    }
+    if (f_close(&fil) != FR_OK || written != FR_OK) {
+        result.status = LOG_RECOVERY_FAILED;
+    } else {
+        result.finalBytes = cut;
+    }
+    result.micros = (uint32_t)(esp_timer_get_time() - start);
+}
@@ -0,0 +1,51 @@
+#ifndef LOG_RECOVERY_H
+#define LOG_RECOVERY_H
+
+#include <stdint.h>
+#include "log_block.h"
+#include "log_index.h"
+
+// Blocks looked at past a bad one before it is taken as the end of what was
+// written - one SD writer block's worth, so a torn write is stepped over
+#define LOG_RECOVERY_PROBE  8
+
+enum LogRecoveryStatus {
+    LOG_RECOVERY_NONE = 0,      // no file was left open
+    LOG_RECOVERY_CLEAN,         // it was finished after all; at most trimmed
+    LOG_RECOVERY_RECOVERED,     // trimmed after its last intact block and given a summary
+    LOG_RECOVERY_UNREADABLE,    // no intact metadata block - not a V2 log, left alone
+    LOG_RECOVERY_FAILED         // FatFs error
+};
+
+struct LogRecoveryResult {
+    uint8_t status;
+    uint32_t originalBytes;     // file size found
+    uint32_t finalBytes;
+    uint32_t blocks;            // intact blocks kept, metadata included, summary not
+    uint32_t lostBytes;         // torn data of the file found past the last intact block
+    uint32_t blockReads;
+    uint32_t indexEntries;      // in the index afterwards
+    uint32_t indexAdded;        // of those, rebuilt from the log
+    uint32_t micros;
+};
+
+// Finishes a log file left open by a reset or power loss. The file is
+// usually preallocated, so its size says nothing about how much was
+// written: what was written is a prefix of intact blocks numbered on from
+// the metadata block, and the end of it is found by a binary search over
+// block indices (stepping LOG_RECOVERY_PROBE blocks over a damaged one).
+// The time taken grows with log2 of the file size, never with the data.
+// The file is cut after the last intact block and a summary block flagged
+// LOG_BLOCK_RECOVERED is written there. Its record count is left out -
+// counting would mean reading every block.
+//
+// The index sidecar (log_index.h) keeps its entries for the blocks kept
+// and gets the ones its last sync missed, one block read per entry. An
+// index that is missing or belongs to another log is rebuilt whole.
+//
+// Paths are FatFs paths ("0:/gps_....bin"); indexPath may be null. Uses
+// FatFs directly; the caller holds the bus and nothing else has the files
+// open.
+void recoverLogFile(const char* fatPath, const char* indexPath, LogRecoveryResult& result);
+
+#endif // LOG_RECOVERY_H
@@ -12,6 +12,9 @@
 #include <SD.h>
 #include <SPI.h>
 #include <Preferences.h>
+#include <esp_timer.h>
+#include <esp_task_wdt.h>
+#include <sys/time.h>
 #include <lvgl.h>
 #include <TFT_eSPI.h>
 #include <XPowersLib.h>
@@ -20,6 +23,28 @@
 
 #include "ui_manager.h"
 #include "data_structures.h"
+#include "sample_ring.h"
+#include "ubx_parser.h"
+#include "time_base.h"
+#include "scheduler.h"
+#include "i2c_bus.h"
+#include "spi_arbiter.h"
+#include "boot_sequence.h"
+#include "imu_calibration.h"
+#include "gnss_config.h"
+#include "gnss_assist.h"
+#include "nav_rate_governor.h"
+#include "stall_monitor.h"
+#include "crc.h"
+#include "packet_schema.h"
+#include "record_stream.h"
+#include "telemetry_frame.h"
+#include "usb_stream.h"
+#include "alloc_counter.h"
+#include "sd_writer.h"
+#include "log_block_builder.h"
+#include "log_recovery.h"
+#include "log_index.h"
 
 #include "boardconfig.h"
 
@@ -33,12 +58,31 @@ PowersSY6970 PMU;
 TouchDrvCSTXXX touch;
 UIManager uiManager;
 
+// Shared I2C bus (IMU, touch, PMU) - owned by its own task
+#define I2C_BUS_TASK_CORE     0
+#define I2C_BUS_TASK_PRIORITY 6 // above the acquisition task it serves
+I2CBus i2cBus;
+
+// Shared SPI bus (display, SD card)
+SPIArbiter spiArbiter;
+
+// Concurrent boot stages and their timeline
+BootTimeline bootTimeline;
+BootSequence bootSequence(bootTimeline);
+
 // WiFi Configuration
 const char* ssid = WIFI_SSID;
 const char* password = WIFI_PASSWORD;
 const IPAddress remoteIP(172, 16, 2, 158);
 const uint16_t remotePort = 9000;
 
+// Link watchdog - a dropped link is disconnected, left to settle, then
+// re-associated, one scheduler step at a time
+#define WIFI_CHECK_INTERVAL_MS  30000
+#define WIFI_SETTLE_MS          1000
+bool wifiReconnecting = false;
+unsigned long wifiStepMs = 0;
+
 
 BLECharacteristic* telemetryChar = nullptr;
 BLECharacteristic* configChar = nullptr;
@@ -53,8 +97,193 @@ BatteryData batteryData;
 PerformanceStats perfStats;
 FileTransferState fileTransfer;
 
-// SD Card and Logging
-File logFile;
+// Record encoding per sink, switched with SET_ENCODING; the log's applies from the next file
+RecordEncoding logEncoding = RECORD_ENCODING_RAW;
+RecordEncoding logFileEncoding = RECORD_ENCODING_RAW;
+RecordEncoding netEncoding = RECORD_ENCODING_RAW;
+RecordStreamEncoder logStream(gpsPacketSchema, GPS_STREAM_LINEAR_FIELDS);
+RecordStreamEncoder netStream(gpsPacketSchema, GPS_STREAM_LINEAR_FIELDS);
+int64_t logStreamEncodeMicros = 0;
+int64_t netStreamEncodeMicros = 0;
+
+// V2 log files: records packed into checksummed blocks (log_block.h)
+static_assert(GPS_STREAM_MAX_FRAME <= 0xFF, "GPS frames must fit a log record entry");
+static_assert(SD_WRITE_BLOCK % LOG_BLOCK_SIZE == 0, "SD writes must be whole log blocks");
+LogBlockBuilder logBlocks(gpsPacketSchema, logStream);
+uint8_t logBlock[LOG_BLOCK_SIZE];
+
+// UDP telemetry: records batched into frames on the main loop, sent by their own
+// task so a slow WiFi stack never holds up the loop
+TelemetryBatcher telemetryBatcher(gpsPacketSchema, GPS_STREAM_LINEAR_FIELDS);
+SampleRing<TelemetryFrame, UDP_QUEUE_FRAMES> udpFrameRing;
+TaskHandle_t udpSenderTaskHandle = nullptr;
+uint32_t udpFramesSent = 0;
+uint32_t udpSendErrors = 0;
+uint32_t udpFramesOffline = 0;  // dropped while WiFi was down
+
+// USB CDC binary stream: every GNSS record and IMU FIFO sample, COBS-framed.
+// The acquisition task only feeds the rings while streaming is on.
+volatile bool usbStreamEnabled = false;
+SampleRing<IMUSample, 256> imuUsbRing;
+SampleRing<GPSSample, 16> gpsUsbRing;
+UsbStreamFramer usbFramer;
+uint32_t usbStreamBytes = 0;
+uint32_t usbStreamShortWrites = 0;  // frames cut short by a full USB buffer
+volatile int8_t usbStreamRequest = -1;  // applied by the stream task: 1 on, 0 off
+bool usbStreamDebugMode = false;        // debug text is paused while streaming
+
+// Sensor acquisition task and its per-consumer sample rings
+#define ACQUISITION_TASK_CORE     0
+#define ACQUISITION_TASK_PRIORITY 5
+#define ACQUISITION_TASK_STACK    8192
+#define IMU_SAMPLE_PERIOD_US      10000 // 100 Hz
+
+TaskHandle_t acquisitionTaskHandle = nullptr;
+SampleRing<GPSSample, 64> gpsLogRing;
+SampleRing<GPSSample, 16> gpsTelemetryRing;
+SampleRing<GPSSample, 16> gpsUIRing;
+SampleRing<IMUSample, 256> imuUIRing;
+uint8_t imuChipType = 0;
+
+// IMU offsets persisted in NVS and refined on the main loop while stationary
+#define IMU_CAL_NAMESPACE        "imu_cal"
+#define IMU_CAL_SAVE_INTERVAL_MS 600000 // limit NVS wear from tracking updates
+ImuBiasTracker imuBias;
+volatile bool pendingIMUCalibration = false;
+bool imuCalibrationDirty = false;
+unsigned long lastIMUCalibrationSave = 0;
+
+// Interrupt-driven UBX receive path (UART event task -> acquisition task)
+#define GNSS_RX_BUFFER_SIZE 4096
+UbxParser ubxParser;
+SampleRing<UbxNavPvt, 16> pvtRing;
+uint32_t gnssBaud = 0; // 0 = receiver not detected
+
+// Receiver configuration, applied as one CFG-VALSET batch. The hash of the
+// last table written is kept in NVS with the working baud rate.
+#define GNSS_PREFS_NAMESPACE "gnss"
+#define GNSS_DEFAULT_BAUD    921600
+#define GNSS_ACTIVE_MEAS_MS  40     // 25 Hz
+const GnssConfigItem gnssConfigItems[] = {
+    {GNSS_KEY_UART1OUTPROT_UBX,     1},
+    {GNSS_KEY_UART1OUTPROT_NMEA,    0},
+    {GNSS_KEY_RATE_MEAS,            GNSS_ACTIVE_MEAS_MS},
+    {GNSS_KEY_RATE_NAV,             1},
+    {GNSS_KEY_MSGOUT_NAV_PVT_UART1, 1},
+    {GNSS_KEY_NAVSPG_DYNMODEL,      4},   // automotive
+    {GNSS_KEY_SIGNAL_GPS_ENA,       1},
+    {GNSS_KEY_SIGNAL_GAL_ENA,       1},
+    {GNSS_KEY_NAVSPG_ACKAIDING,     1},   // MGA-ACK paces the database replay
+};
+GnssConfig gnssConfig(gnssConfigItems, sizeof(gnssConfigItems) / sizeof(gnssConfigItems[0]));
+uint32_t gnssBootCount = 0;
+
+// Hot-start assist - navigation database on SD, last position in NVS
+#define GNSS_ASSIST_FILE          "/gnss_assist.ubx"
+#define GNSS_ASSIST_TMP_FILE      "/gnss_assist.tmp"
+#define GNSS_TTFF_FILE            "/ttff.csv"
+#define GNSS_ASSIST_CAPACITY      16384
+#define GNSS_ASSIST_FIRST_SAVE_MS 120000   // let ephemerides download after the first fix
+#define GNSS_ASSIST_INTERVAL_MS   900000   // refresh while the fix holds
+#define GNSS_ASSIST_CAPTURE_MS    3000     // receiver dumps its database within ~1 s
+#define GNSS_ASSIST_POS_ACC_CM    5000000  // 50 km - the unit may have moved while off
+#define GNSS_ASSIST_TIME_ACC_S    2
+#define GNSS_ASSIST_MIN_UNIX      1700000000UL // system time below this was never set
+#define GNSS_ASSIST_ACK_TIMEOUT_MS 250     // per MGA frame before it is sent again
+#define GNSS_ASSIST_PACE_MS       2        // between frames if the receiver does not acknowledge
+GnssAssist gnssAssist;
+GnssAssistReplay gnssAssistReplay;
+uint8_t* gnssAssistBuffer = nullptr;
+portMUX_TYPE gnssAssistLock = portMUX_INITIALIZER_UNLOCKED;
+volatile bool gnssAssistCapturing = false;
+volatile bool gnssAssistReplaying = false;
+unsigned long gnssAssistCaptureStart = 0;
+unsigned long lastGNSSAssistSave = 0;
+bool ttffRecorded = false;
+
+// Navigation rate follows motion; changes go to RAM only so the next boot
+// verifies against the full-rate configuration again
+#define GNSS_EVENTS_FILE "/gnss_events.csv"
+const uint16_t navModeMeasMs[NAV_MODE_COUNT] = {GNSS_ACTIVE_MEAS_MS, 200, 1000}; // 25, 5, 1 Hz
+NavRateGovernor navGovernor(NAV_IDLE_AFTER_MS, NAV_PARKED_AFTER_MS, NAV_MOVING_SPEED_KMH);
+volatile uint32_t navConfigAcks = 0;
+volatile uint32_t navConfigNaks = 0;
+
+// Log files are preallocated for logFileSeconds of records at the full
+// navigation rate and rolled over when full; 0 grows them as written
+// (SET_LOG_FILE, applies from the next file)
+uint32_t logFileSeconds = LOG_FILE_SECONDS;
+uint32_t logFileCapacity = 0;   // of the current file
+uint32_t logFileBytes() {
+    if (logFileSeconds == 0) return 0;
+    // Raw records in whole blocks, between the metadata and summary blocks
+    const uint32_t perBlock = LOG_BLOCK_PAYLOAD / (2 + sizeof(GPSPacket));
+    uint32_t records = logFileSeconds * (1000 / GNSS_ACTIVE_MEAS_MS);
+    return ((records + perBlock - 1) / perBlock + 2) * LOG_BLOCK_SIZE;
+}
+
+// The SD writer's open log file is named in NVS until it is finished, so
+// one still named at boot was cut off by a reset or power loss and is
+// recovered before logging can start (query RECOVERY)
+#define LOG_PREFS_NAMESPACE "logfile"
+LogRecoveryResult logRecovery = {};
+char logRecoveryFile[SD_WRITER_PATH_MAX] = "";
+
+// Time index sidecar of each log, <name>.idx (log_index.h, GET_RANGE)
+LogIndexer logIndexer;
+bool logIndexPath(const char* logPath, char* out, size_t size) {
+    const char* ext = strrchr(logPath, '.');
+    if (!ext || strcmp(ext, ".bin") != 0) return false;
+    return snprintf(out, size, "%.*s.idx", (int)(ext - logPath), logPath) < (int)size;
+}
+
+// Local esp_timer clock disciplined to GNSS time (owned by the acquisition task)
+TimeBase timeBase;
+#ifdef GNSS_PPS
+volatile int64_t ppsLocalMicros = 0;
+volatile bool ppsPending = false;
+#endif
+
+// Main loop scheduler (core 1) - replaces the ad-hoc millis() checks in loop()
+uint32_t schedulerClock() { return micros(); }
+Scheduler scheduler(schedulerClock);
+void startScheduler(); // defined with the loop jobs in part6
+void startStallMonitor();
+
+// Stall attribution - one section per scheduler job, plus the acquisition
+// task and the BLE write callbacks
+StallMonitor stallMonitor;
+int8_t stallSectionOfTask[Scheduler::MAX_TASKS];
+int8_t stallAcquisition = -1;
+int8_t stallBleConfig = -1;
+int8_t stallBleTransfer = -1;
+int8_t stallUdp = -1;
+int8_t stallUsb = -1;
+int8_t stallSd = -1;
+esp_timer_handle_t stallCheckTimer = nullptr;
+
+// SD card logging - the writer task owns the open log file
+SdWriter sdWriter(spiArbiter, SPI_SD_DEADLINE_US, stallMonitor);
+
+// Heap allocations by the main loop, per scheduler job (alloc_counter.h)
+uint32_t jobAllocStart = 0;
+uint32_t jobAllocations[Scheduler::MAX_TASKS];
+uint32_t steadyAllocationsOfJob[Scheduler::MAX_TASKS];
+uint32_t steadyAllocations = 0;     // after ALLOC_SETTLE_MS of logging
+bool heapSessionLogging = false;
+unsigned long heapSessionStartMs = 0;
+HeapSnapshot heapSessionStart = {};
+HeapSnapshot heapSessionEnd = {};
+
+// Kept across the task watchdog reset so the hang is attributed after boot
+#define STALL_HANG_MAGIC 0x474E4148 // "HANG"
+struct StallHang {
+    uint32_t magic;
+    int8_t section;
+    uint32_t openMicros;
+    uint32_t atMs;
+};
+RTC_NOINIT_ATTR StallHang stallHang;
 
 
 // Constants
@@ -62,123 +291,163 @@ File logFile;
 void debugPrint(const char* message) {
     if(debugMode) Serial.print(message);
 }
-void debugPrintln(const String& message) {
+void debugPrintln(const char* message) {
     if(debugMode) Serial.println(message);
 }
+// Formatted on the stack - Print::printf falls back to malloc past 64 bytes
 void debugPrintf(const char* format, ...) {
     if(debugMode) {
+        char buffer[256];
         va_list args;
         va_start(args, format);
-        Serial.printf(format, args);
+        int len = vsnprintf(buffer, sizeof(buffer), format, args);
         va_end(args);
+        if (len > 0) Serial.write((const uint8_t*)buffer, min(len, (int)sizeof(buffer) - 1));
     }
 }
 
-String pendingFilename = "";
+char pendingFilename[64] = "";
+// GET_RANGE - UTC µs, with pendingStartTransfer
+bool pendingRanged = false;
+int64_t pendingRangeFromMicros = 0;
+int64_t pendingRangeToMicros = 0;
 
 void writeRegister(uint8_t reg, uint8_t value) {
-    Wire.beginTransmission(MPU6xxx_ADDRESS);
-    Wire.write(reg);
-    Wire.write(value);
-    Wire.endTransmission();
+    i2cBus.write(I2C_DEVICE_IMU, MPU6xxx_ADDRESS, reg, value);
 }
 
 uint8_t readRegister(uint8_t reg) {
-    Wire.beginTransmission(MPU6xxx_ADDRESS);
-    Wire.write(reg);
-    Wire.endTransmission(false);
-    Wire.requestFrom(MPU6xxx_ADDRESS, 1, 1);
-    return Wire.read();
+    uint8_t value = 0;
+    i2cBus.read(I2C_DEVICE_IMU, MPU6xxx_ADDRESS, reg, &value, 1);
+    return value;
 }
 
 int16_t readRegister16(uint8_t reg) {
-    Wire.beginTransmission(MPU6xxx_ADDRESS);
-    Wire.write(reg);
-    Wire.endTransmission(false);
-    Wire.requestFrom(MPU6xxx_ADDRESS, 2, 1);
-    int16_t value = Wire.read() << 8;
-    value |= Wire.read();
-    return value;
+    uint8_t buffer[2] = {0, 0};
+    i2cBus.read(I2C_DEVICE_IMU, MPU6xxx_ADDRESS, reg, buffer, 2);
+    return (int16_t)((buffer[0] << 8) | buffer[1]);
 }
 
-// CRC16 calculation
-uint16_t crc16(const uint8_t* data, size_t length) {
-    uint16_t crc = 0x0000;
-    for (size_t i = 0; i < length; i++) {
-        crc ^= (uint16_t)data[i] << 8;
-        for (uint8_t j = 0; j < 8; j++) {
-            if (crc & 0x8000)
-                crc = (crc << 1) ^ 0x1021;
-            else
-                crc <<= 1;
-        }
+// Burst read of consecutive registers in a single I2C transaction
+bool readRegisters(uint8_t reg, uint8_t* buffer, size_t length) {
+    return i2cBus.read(I2C_DEVICE_IMU, MPU6xxx_ADDRESS, reg, buffer, length);
+}
+
+
+// Offsets in sensor counts for the acquisition task - after every change
+// to the float offsets
+void applyIMUOffsets() {
+    imuData.accelOffsetCounts[0] = AccelG::fromFloat(imuData.accelOffsetX);
+    imuData.accelOffsetCounts[1] = AccelG::fromFloat(imuData.accelOffsetY);
+    imuData.accelOffsetCounts[2] = AccelG::fromFloat(imuData.accelOffsetZ);
+    imuData.gyroOffsetCounts[0] = GyroDps::fromFloat(imuData.gyroOffsetX);
+    imuData.gyroOffsetCounts[1] = GyroDps::fromFloat(imuData.gyroOffsetY);
+    imuData.gyroOffsetCounts[2] = GyroDps::fromFloat(imuData.gyroOffsetZ);
+}
+
+// Load offsets saved by a previous session - false if none match this IMU
+bool loadIMUCalibration() {
+    if (!preferences.begin(IMU_CAL_NAMESPACE, true)) return false;
+    
+    bool valid = preferences.getUChar("chip", 0) == imuChipType && preferences.isKey("gx");
+    if (valid) {
+        imuData.accelOffsetX = preferences.getFloat("ax", 0.0f);
+        imuData.accelOffsetY = preferences.getFloat("ay", 0.0f);
+        imuData.accelOffsetZ = preferences.getFloat("az", 0.0f);
+        imuData.gyroOffsetX = preferences.getFloat("gx", 0.0f);
+        imuData.gyroOffsetY = preferences.getFloat("gy", 0.0f);
+        imuData.gyroOffsetZ = preferences.getFloat("gz", 0.0f);
+        // Temperature and ageing may have moved the bias since it was saved
+        imuData.calibrationConfidence = preferences.getFloat("conf", 0.0f) * 0.5f;
+    }
+    preferences.end();
+    
+    if (valid) {
+        applyIMUOffsets();
+        imuData.isCalibrated = true;
+        imuBias.reset(imuData.calibrationConfidence);
+        debugPrintf("✅ IMU calibration loaded (confidence %.0f%%)\n", imuData.calibrationConfidence * 100);
+        debugPrintf("📊 Gyro offsets: X=%.3f, Y=%.3f, Z=%.3f\n",
+                    imuData.gyroOffsetX, imuData.gyroOffsetY, imuData.gyroOffsetZ);
     }
-    return crc;
+    return valid;
 }
 
+void saveIMUCalibration() {
+    if (!preferences.begin(IMU_CAL_NAMESPACE, false)) return;
+    preferences.putUChar("chip", imuChipType);
+    preferences.putFloat("ax", imuData.accelOffsetX);
+    preferences.putFloat("ay", imuData.accelOffsetY);
+    preferences.putFloat("az", imuData.accelOffsetZ);
+    preferences.putFloat("gx", imuData.gyroOffsetX);
+    preferences.putFloat("gy", imuData.gyroOffsetY);
+    preferences.putFloat("gz", imuData.gyroOffsetZ);
+    preferences.putFloat("conf", imuData.calibrationConfidence);
+    preferences.end();
+    
+    imuCalibrationDirty = false;
+    lastIMUCalibrationSave = millis();
+    debugPrintf("💾 IMU calibration saved (confidence %.0f%%)\n", imuData.calibrationConfidence * 100);
+}
 
-bool calibrateAccelerometer() {
-    debugPrintln("🔧 Calibrating accelerometer...");
-    
-    const int CALIBRATION_SAMPLES = 100;
-    const int CALIBRATION_DELAY = 20; // ms between samples
-    
-    float accelSumX = 0, accelSumY = 0, accelSumZ = 0;
-    float gyroSumX = 0, gyroSumY = 0, gyroSumZ = 0;
-    
-    // Collect calibration samples
-    for (int i = 0; i < CALIBRATION_SAMPLES; i++) {
-        // Read accelerometer
-        int16_t accelX = readRegister16(MPU6xxx_ACCEL_XOUT_H);
-        int16_t accelY = readRegister16(MPU6xxx_ACCEL_XOUT_H + 2);
-        int16_t accelZ = readRegister16(MPU6xxx_ACCEL_XOUT_H + 4);
-        
-        // Read gyroscope
-        int16_t gyroX = readRegister16(MPU6xxx_GYRO_XOUT_H);
-        int16_t gyroY = readRegister16(MPU6xxx_GYRO_XOUT_H + 2);
-        int16_t gyroZ = readRegister16(MPU6xxx_GYRO_XOUT_H + 4);
-        
-        // Convert to real units
-        float accelX_g = accelX / 16384.0;
-        float accelY_g = accelY / 16384.0;
-        float accelZ_g = accelZ / 16384.0;
-        
-        float gyroX_dps = gyroX / 131.0;
-        float gyroY_dps = gyroY / 131.0;
-        float gyroZ_dps = gyroZ / 131.0;
-        
-        // Accumulate readings
-        accelSumX += accelX_g;
-        accelSumY += accelY_g;
-        accelSumZ += accelZ_g;
-        
-        gyroSumX += gyroX_dps;
-        gyroSumY += gyroY_dps;
-        gyroSumZ += gyroZ_dps;
-        
-        delay(CALIBRATION_DELAY);
+// One notification answering a BLE command that needs no file access
+void sendQueryResponse(const char* response) {
+    if (fileTransferChar) {
+        fileTransferChar->setValue(response);
+        fileTransferChar->notify();
+    }
+}
+
+// Main loop - feed the bias tracker and fold its corrections into the offsets
+// used by the acquisition task
+void trackIMUBias(const IMUSample& sample) {
+    const float accel[3] = {sample.accelX.toFloat(), sample.accelY.toFloat(), sample.accelZ.toFloat()};
+    const float gyro[3] = {sample.gyroX.toFloat(), sample.gyroY.toFloat(), sample.gyroZ.toFloat()};
+    
+    ImuBiasTracker::Result result = imuBias.addSample(accel, gyro, !imuData.motionDetected);
+    if (result == ImuBiasTracker::RESULT_NONE) return;
+    
+    if (result == ImuBiasTracker::RESULT_CALIBRATION_FAILED) {
+        imuData.calibrationInProgress = false;
+        debugPrintln("❌ IMU calibration failed - keep the unit still");
+        sendQueryResponse("CAL:FAILED:MOTION");
+        uiManager.requestUpdate();
+        return;
     }
     
-    // Calculate offsets
-    imuData.accelOffsetX = accelSumX / CALIBRATION_SAMPLES;
-    imuData.accelOffsetY = accelSumY / CALIBRATION_SAMPLES;
-    imuData.accelOffsetZ = (accelSumZ / CALIBRATION_SAMPLES) - 1.0; // Subtract 1g for Z-axis
-    
-    imuData.gyroOffsetX = gyroSumX / CALIBRATION_SAMPLES;
-    imuData.gyroOffsetY = gyroSumY / CALIBRATION_SAMPLES;
-    imuData.gyroOffsetZ = gyroSumZ / CALIBRATION_SAMPLES;
-    
-    imuData.isCalibrated = true;
-    
-    debugPrintln("✅ IMU calibration complete!");
-    debugPrintf("📊 Accel offsets: X=%.4f, Y=%.4f, Z=%.4f\n", 
-                  imuData.accelOffsetX, imuData.accelOffsetY, imuData.accelOffsetZ);
-    
-    return true;
+    const ImuBias& c = imuBias.correction();
+    imuData.accelOffsetX += c.accel[0];
+    imuData.accelOffsetY += c.accel[1];
+    imuData.accelOffsetZ += c.accel[2];
+    imuData.gyroOffsetX += c.gyro[0];
+    imuData.gyroOffsetY += c.gyro[1];
+    imuData.gyroOffsetZ += c.gyro[2];
+    applyIMUOffsets();
+    imuData.calibrationConfidence = imuBias.confidence();
+    imuCalibrationDirty = true;
+    
+    if (result == ImuBiasTracker::RESULT_CALIBRATED) {
+        imuData.calibrationInProgress = false;
+        debugPrintln("✅ IMU calibration complete!");
+        debugPrintf("📊 Accel offsets: X=%.4f, Y=%.4f, Z=%.4f\n", 
+                      imuData.accelOffsetX, imuData.accelOffsetY, imuData.accelOffsetZ);
+        saveIMUCalibration();
+        sendQueryResponse("CAL:OK");
+        uiManager.requestUpdate();
+    }
+}
+
+// Scheduler job - persist tracking refinements at a bounded rate
+void imuCalibrationJob() {
+    if (imuCalibrationDirty && millis() - lastIMUCalibrationSave > IMU_CAL_SAVE_INTERVAL_MS) {
+        saveIMUCalibration();
+    }
 }
 
 // LVGL display flush callback
 void lvgl_display_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
+    // One band per lease so SD transfers can slot in between bands
+    SPIBusLease lease(spiArbiter, SPI_DEVICE_TFT, SPI_TFT_DEADLINE_US);
     tft.startWrite();
     tft.setAddrWindow(area->x1, area->y1, area->x2 - area->x1 + 1, area->y2 - area->y1 + 1);
     tft.pushColors((uint16_t *)&color_p->full, (area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1), true);
@@ -186,10 +455,44 @@ void lvgl_display_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *
     lv_disp_flush_ready(disp);
 }
 
-// LVGL touch input callback
-void lvgl_touch_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data) {
+// Last touch controller state, refreshed on the I2C bus task
+volatile uint8_t touchPoints = 0;
+volatile int16_t touchX = 0;
+volatile int16_t touchY = 0;
+volatile bool touchPollPending = false;
+
+bool pollTouchJob(TwoWire& wire, void* context) {
     int16_t x, y;
     uint8_t n = touch.getPoint(&x, &y, 1);
+    touchX = x;
+    touchY = y;
+    touchPoints = n;
+    return true;
+}
+
+void onTouchPolled(bool ok, void* context) {
+    touchPollPending = false;
+}
+
+// LVGL touch input callback - reports the last polled state and queues the
+// next poll, so LVGL never waits on the bus
+void lvgl_touch_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data) {
+    // The touch boot stage may still be running
+    if (!systemData.touchAvailable) {
+        data->state = LV_INDEV_STATE_REL;
+        return;
+    }
+    
+    uint8_t n = touchPoints;
+    int16_t x = touchX;
+    int16_t y = touchY;
+    
+    if (!touchPollPending) {
+        touchPollPending = true;
+        if (!i2cBus.submitJob(I2C_DEVICE_TOUCH, pollTouchJob, nullptr, onTouchPolled, nullptr)) {
+            touchPollPending = false;
+        }
+    }
     
     if (n) {
         x = map(x, 2, 477, 0, 480);
@@ -212,6 +515,7 @@ void initDisplay() {
 
     tft.begin();
     tft.setRotation(1);
+    spiArbiter.begin(SPI, BOARD_SPI_SCK, BOARD_SPI_MISO, BOARD_SPI_MOSI);
     
     lv_init();
     
@@ -240,11 +544,15 @@ void initDisplay() {
     debugPrintln("✅ LVGL display initialized");
 }
 
+bool beginTouchJob(TwoWire& wire, void* context) {
+    return touch.begin(wire, CST226SE_SLAVE_ADDRESS, BOARD_I2C_SDA, BOARD_I2C_SCL);
+}
+
 bool initTouch() {
     debugPrintln("🖱️ Initializing Touch Controller…");
 
     touch.setPins(BOARD_TOUCH_RST, BOARD_SENSOR_IRQ);
-    touch.begin(Wire, CST226SE_SLAVE_ADDRESS, BOARD_I2C_SDA, BOARD_I2C_SCL);
+    i2cBus.runJob(I2C_DEVICE_TOUCH, beginTouchJob, nullptr);
 
     touch.setMaxCoordinates(BOARD_TFT_HEIGHT, BOARD_TFT_WIDTH); 
     touch.setSwapXY(true);
@@ -265,10 +573,23 @@ bool initTouch() {
     return true;
 }
 ///=========================================part2
+bool configurePMUJob(TwoWire& wire, void* context) {
+    if (!PMU.init(wire, SY6970_SLAVE_ADDRESS)) return false;
+    
+    PMU.setChargeTargetVoltage(4208);
+    PMU.setPrechargeCurr(128);
+    PMU.setChargerConstantCurr(1024);
+    PMU.setInputCurrentLimit(2000);
+    PMU.enableADCMeasure();
+    PMU.disableStatLed();
+    PMU.enableCharge();
+    return true;
+}
+
 bool initPMU() {
     debugPrintln("🔋 Initializing SY6970 Power Management...");
     
-    bool result = PMU.init(Wire, SY6970_SLAVE_ADDRESS);
+    bool result = i2cBus.runJob(I2C_DEVICE_PMU, configurePMUJob, nullptr);
     
     if (!result) {
         debugPrintln("❌ SY6970 PMU not found");
@@ -278,28 +599,37 @@ bool initPMU() {
     
     debugPrintf("✅ SY6970 PMU initialized at address 0x%02X\n", SY6970_SLAVE_ADDRESS);
     
-    PMU.setChargeTargetVoltage(4208);
-    PMU.setPrechargeCurr(128);
-    PMU.setChargerConstantCurr(1024);
-    PMU.setInputCurrentLimit(2000);
-    PMU.enableADCMeasure();
-    PMU.disableStatLed();
-    PMU.enableCharge();
-    
     systemData.pmuAvailable = true;
     debugPrintln("🔋 PMU configured for optimal battery monitoring");
     
     return true;
 }
 
+// I2C bus task - raw readings, applied on the main loop by updateBatteryData()
+PMUReading pmuReading;
+volatile bool pmuReadingReady = false;
+
+bool readPMUJob(TwoWire& wire, void* context) {
+    pmuReading.battMillivolts = PMU.getBattVoltage();
+    pmuReading.vbusMillivolts = PMU.getVbusVoltage();
+    pmuReading.systemMillivolts = PMU.getSystemVoltage();
+    pmuReading.usbConnected = PMU.isVbusIn();
+    pmuReading.chargeStatus = PMU.chargeStatus();
+    pmuReadingReady = true;
+    return true;
+}
+
 void updateBatteryData() {
-    if (!systemData.pmuAvailable || millis() - batteryData.lastUpdate < 5000) return;
+    if (!pmuReadingReady) return;
     
+    PMUReading reading = pmuReading;
+    pmuReadingReady = false;
     batteryData.lastUpdate = millis();
     
-    batteryData.voltage = PMU.getBattVoltage() / 1000.0f;
-    batteryData.vbusVoltage = PMU.getVbusVoltage() / 1000.0f;
-    batteryData.systemVoltage = PMU.getSystemVoltage() / 1000.0f;
+    batteryData.millivolts = reading.battMillivolts;
+    batteryData.voltage = reading.battMillivolts / 1000.0f;
+    batteryData.vbusVoltage = reading.vbusMillivolts / 1000.0f;
+    batteryData.systemVoltage = reading.systemMillivolts / 1000.0f;
     
     if (batteryData.voltage > 2.5f) {
         batteryData.percentage = constrain(map(batteryData.voltage * 100, 300, 420, 0, 100), 0, 100);
@@ -307,11 +637,10 @@ void updateBatteryData() {
         batteryData.percentage = 0;
     }
     
-    batteryData.usbConnected = PMU.isVbusIn();
+    batteryData.usbConnected = reading.usbConnected;
     batteryData.isConnected = (batteryData.voltage > 2.5f);
     
-    uint8_t chargeStatus = PMU.chargeStatus();
-    switch (chargeStatus) {
+    switch (reading.chargeStatus) {
         case 0x00: batteryData.chargeStatus = "Not Charging"; break;
         case 0x01: batteryData.chargeStatus = "Pre-charge"; break;
         case 0x02: batteryData.chargeStatus = "Fast Charge"; break;
@@ -332,18 +661,18 @@ void updateBatteryData() {
 }
 
 
+// Scheduler job - queue a PMU read; the result is applied by processUIData()
 void updateBatteryLevel() {
-        updateBatteryData();
+    if (!systemData.pmuAvailable) return;
+    i2cBus.submitJob(I2C_DEVICE_PMU, readPMUJob, nullptr, nullptr, nullptr);
 }
 
 bool initSDCard() {
     debugPrintln("📱 Initializing SD card...");
     
-    SPI.end();
-    delay(100);
-    
-    SPI.begin(BOARD_SPI_SCK, BOARD_SPI_MISO, BOARD_SPI_MOSI);
-    delay(100);
+    // The bus is shared with the display - never restart it here
+    spiArbiter.begin(SPI, BOARD_SPI_SCK, BOARD_SPI_MISO, BOARD_SPI_MOSI);
+    SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
     
     if (!SD.begin(BOARD_SD_CS, SPI, 4000000)) {
         if (!SD.begin(BOARD_SD_CS, SPI, 1000000)) {
@@ -374,6 +703,16 @@ bool initSDCard() {
     return false;
 }
 
+// Die temperature - scale and offset differ per chip
+TempCentiC imuTemperature(int16_t raw) {
+    if (imuChipType == 0x68) {
+        // 340 LSB/°C, 36.53 °C at 0
+        return TempCentiC(fixedCast<TempCentiC>(Fixed<int16_t, std::ratio<1, 340>>(raw)).count + 3653);
+    }
+    // 333.87 LSB/°C, 21 °C at 0
+    return TempCentiC(fixedCast<TempCentiC>(Fixed<int16_t, std::ratio<100, 33387>>(raw)).count + 2100);
+}
+
 bool initMPU6050() {
     debugPrintln("🔄 Initializing IMU...");
     
@@ -382,6 +721,8 @@ bool initMPU6050() {
     uint8_t whoami = readRegister(MPU6xxx_WHO_AM_I);
     debugPrintf("📋 WHO_AM_I register: 0x%02X\n", whoami);
     
+    imuChipType = whoami;
+    
     switch (whoami) {
         case 0x68:
             debugPrintln("✅ Detected: MPU6050");
@@ -410,34 +751,55 @@ bool initMPU6050() {
     writeRegister(MPU6xxx_GYRO_CONFIG, 0x00);
     debugPrintln("✅ Gyroscope range set to ±250°/s");
     
-    int16_t accelX = readRegister16(MPU6xxx_ACCEL_XOUT_H);
-    int16_t accelY = readRegister16(MPU6xxx_ACCEL_XOUT_H + 2);
-    int16_t accelZ = readRegister16(MPU6xxx_ACCEL_XOUT_H + 4);
-    int16_t temp = readRegister16(MPU6xxx_TEMP_OUT_H);
-    
-    float accelX_g = accelX / 16384.0;
-    float accelY_g = accelY / 16384.0;
-    float accelZ_g = accelZ / 16384.0;
-    
-    float temp_c;
-    if (whoami == 0x68) {
-        temp_c = (temp / 340.0) + 36.53;
-    } else {
-        temp_c = (temp / 333.87) + 21.0;
-    }
+    AccelG accelX((int16_t)readRegister16(MPU6xxx_ACCEL_XOUT_H));
+    AccelG accelY((int16_t)readRegister16(MPU6xxx_ACCEL_XOUT_H + 2));
+    AccelG accelZ((int16_t)readRegister16(MPU6xxx_ACCEL_XOUT_H + 4));
+    TempCentiC temp = imuTemperature((int16_t)readRegister16(MPU6xxx_TEMP_OUT_H));
     
     debugPrintf("✅ Test read successful:\n");
-    debugPrintf("   Accel: %.2f, %.2f, %.2f g\n", accelX_g, accelY_g, accelZ_g);
-    debugPrintf("   Temperature: %.1f°C\n", temp_c);
+    debugPrintf("   Accel: %.2f, %.2f, %.2f g\n", accelX.toFloat(), accelY.toFloat(), accelZ.toFloat());
+    debugPrintf("   Temperature: %.1f°C\n", temp.toFloat());
     
     systemData.mpuAvailable = true;
     debugPrintln("✅ IMU configured successfully using direct I2C");
     return true;
 }
 
-bool configureGNSS() {
-    debugPrintln("🛰️ Configuring GNSS...");
-    
+// Send one CFG-VALSET / CFG-VALGET through the library. The response, if
+// any, replaces the payload and its length.
+sfe_ublox_status_e sendGNSSConfigPacket(uint8_t msgId, uint8_t* payload, uint16_t& length) {
+    ubxPacket packet = {0, 0, 0, 0, 0, payload, 0, 0,
+                        SFE_UBLOX_PACKET_VALIDITY_NOT_DEFINED, SFE_UBLOX_PACKET_VALIDITY_NOT_DEFINED};
+    packet.cls = UBX_CLASS_CFG;
+    packet.id = msgId;
+    packet.len = length;
+    sfe_ublox_status_e status = myGNSS.sendCommand(&packet, 1100);
+    length = packet.len;
+    return status;
+}
+
+// Read the configuration back in one CFG-VALGET and compare it to the table
+bool verifyGNSSConfig() {
+    static uint8_t payload[MAX_PAYLOAD_SIZE];
+    uint16_t length = gnssConfig.buildValget(GNSS_LAYER_RAM, payload, sizeof(payload));
+    if (length == 0) return false;
+    if (sendGNSSConfigPacket(UBX_CFG_VALGET, payload, length) != SFE_UBLOX_STATUS_DATA_RECEIVED) {
+        return false;
+    }
+    return gnssConfig.matchesValget(payload, length);
+}
+
+// Whole configuration in one CFG-VALSET, kept in battery-backed RAM too
+bool applyGNSSConfig() {
+    static uint8_t payload[MAX_PAYLOAD_SIZE];
+    uint16_t length = gnssConfig.buildValset(GNSS_LAYER_RAM_MASK | GNSS_LAYER_BBR_MASK,
+                                             payload, sizeof(payload));
+    if (length == 0) return false;
+    return sendGNSSConfigPacket(UBX_CFG_VALSET, payload, length) == SFE_UBLOX_STATUS_DATA_SENT;
+}
+
+// Receivers before generation 9 have no configuration interface
+void configureGNSSLegacy() {
     myGNSS.setUART1Output(COM_TYPE_UBX);
     myGNSS.setNavigationFrequency(25);
     myGNSS.setAutoPVT(true);
@@ -445,69 +807,149 @@ bool configureGNSS() {
     
     myGNSS.enableGNSS(true, SFE_UBLOX_GNSS_ID_GPS);
     myGNSS.enableGNSS(true, SFE_UBLOX_GNSS_ID_GALILEO);
-    
-    debugPrintln("✅ GNSS configured");
-    return true;
 }
 
-void readMPU6050() {
-    if (!systemData.mpuAvailable) return;
-    
-    int16_t accelX = readRegister16(MPU6xxx_ACCEL_XOUT_H);
-    int16_t accelY = readRegister16(MPU6xxx_ACCEL_XOUT_H + 2);
-    int16_t accelZ = readRegister16(MPU6xxx_ACCEL_XOUT_H + 4);
+uint8_t configureGNSS(Preferences& gnssPrefs) {
+    uint32_t hash = gnssConfig.hash();
     
-    int16_t gyroX = readRegister16(MPU6xxx_GYRO_XOUT_H);
-    int16_t gyroY = readRegister16(MPU6xxx_GYRO_XOUT_H + 2);
-    int16_t gyroZ = readRegister16(MPU6xxx_GYRO_XOUT_H + 4);
-    
-    int16_t temp = readRegister16(MPU6xxx_TEMP_OUT_H);
+    // Same table as last applied - only confirm the receiver still holds it
+    if (gnssPrefs.getULong("cfghash", 0) == hash && verifyGNSSConfig()) {
+        debugPrintf("✅ GNSS configuration verified (hash %08lx)\n", hash);
+        return GNSS_CONFIG_VERIFIED;
+    }
     
-    // Convert to real units
-    float rawAccelX = accelX / 16384.0;
-    float rawAccelY = accelY / 16384.0;
-    float rawAccelZ = accelZ / 16384.0;
+    debugPrintln("🛰️ Configuring GNSS...");
+    if (applyGNSSConfig()) {
+        gnssPrefs.putULong("cfghash", hash);
+        debugPrintf("✅ GNSS configured (%u keys, hash %08lx)\n", gnssConfig.count(), hash);
+        return GNSS_CONFIG_APPLIED;
+    }
     
-    float rawGyroX = gyroX / 131.0;
-    float rawGyroY = gyroY / 131.0;
-    float rawGyroZ = gyroZ / 131.0;
+    debugPrintln("⚠️ CFG-VALSET not acknowledged - using legacy configuration");
+    configureGNSSLegacy();
+    return GNSS_CONFIG_LEGACY;
+}
+
+// Convert one 14-byte accel/temp/gyro frame (register or FIFO order).
+// Integer only - the sample keeps sensor counts, scaled by its types.
+void convertIMUFrame(const uint8_t* frame, IMUSample& sample) {
+    sample.accelX = AccelG((int16_t)((frame[0] << 8) | frame[1]));
+    sample.accelY = AccelG((int16_t)((frame[2] << 8) | frame[3]));
+    sample.accelZ = AccelG((int16_t)((frame[4] << 8) | frame[5]));
+    int16_t temp  = (int16_t)((frame[6] << 8) | frame[7]);
+    sample.gyroX  = GyroDps((int16_t)((frame[8] << 8) | frame[9]));
+    sample.gyroY  = GyroDps((int16_t)((frame[10] << 8) | frame[11]));
+    sample.gyroZ  = GyroDps((int16_t)((frame[12] << 8) | frame[13]));
     
     // Apply calibration if available
     if (imuData.isCalibrated) {
-        imuData.accelX = rawAccelX - imuData.accelOffsetX;
-        imuData.accelY = rawAccelY - imuData.accelOffsetY;
-        imuData.accelZ = rawAccelZ - imuData.accelOffsetZ;
+        sample.accelX = sample.accelX - imuData.accelOffsetCounts[0];
+        sample.accelY = sample.accelY - imuData.accelOffsetCounts[1];
+        sample.accelZ = sample.accelZ - imuData.accelOffsetCounts[2];
         
-        imuData.gyroX = rawGyroX - imuData.gyroOffsetX;
-        imuData.gyroY = rawGyroY - imuData.gyroOffsetY;
-        imuData.gyroZ = rawGyroZ - imuData.gyroOffsetZ;
-    } else {
-        // Use raw values if not calibrated
-        imuData.accelX = rawAccelX;
-        imuData.accelY = rawAccelY;
-        imuData.accelZ = rawAccelZ;
-        
-        imuData.gyroX = rawGyroX;
-        imuData.gyroY = rawGyroY;
-        imuData.gyroZ = rawGyroZ;
+        sample.gyroX = sample.gyroX - imuData.gyroOffsetCounts[0];
+        sample.gyroY = sample.gyroY - imuData.gyroOffsetCounts[1];
+        sample.gyroZ = sample.gyroZ - imuData.gyroOffsetCounts[2];
     }
     
-    // Temperature calculation
-    static uint8_t chipType = 0;
-    if (chipType == 0) {
-        chipType = readRegister(MPU6xxx_WHO_AM_I);
+    sample.temperature = imuTemperature(temp);
+}
+
+// Called from the acquisition task - polled fallback when FIFO is unavailable
+bool readIMUSample(IMUSample& sample) {
+    uint8_t frame[IMU_FIFO_FRAME_SIZE];
+    if (!readRegisters(MPU6xxx_ACCEL_XOUT_H, frame, sizeof(frame))) return false;
+    
+    sample.timestampMicros = esp_timer_get_time();
+    sample.gnssTimeMicros = timeBase.toGnssMicros(sample.timestampMicros);
+    convertIMUFrame(frame, sample);
+    return true;
+}
+
+void resetIMUFifo() {
+    writeRegister(MPU6xxx_USER_CTRL, 0x04);    // FIFO_RESET
+    writeRegister(MPU6xxx_USER_CTRL, 0x40);    // FIFO_EN
+}
+
+// Configure sample rate divider and FIFO for accel + temp + gyro frames
+bool initIMUFifo() {
+    writeRegister(MPU6xxx_CONFIG, 0x01);       // DLPF 184 Hz, 1 kHz gyro clock
+    writeRegister(MPU6xxx_SMPLRT_DIV, (1000 / IMU_FIFO_RATE_HZ) - 1);
+    writeRegister(MPU6xxx_INT_ENABLE, 0x10);   // FIFO_OFLOW_INT
+    writeRegister(MPU6xxx_FIFO_EN, 0xF8);      // TEMP, XG, YG, ZG, ACCEL
+    resetIMUFifo();
+    delay(10);
+    
+    uint16_t count = (uint16_t)readRegister16(MPU6xxx_FIFO_COUNTH);
+    if (count == 0 || count > IMU_FIFO_SIZE * 2) {
+        writeRegister(MPU6xxx_FIFO_EN, 0x00);
+        writeRegister(MPU6xxx_USER_CTRL, 0x00);
+        debugPrintf("⚠️ IMU FIFO not filling (count %u), using polled reads\n", count);
+        return false;
     }
     
-    if (chipType == 0x68) {
-        imuData.temperature = (temp / 340.0) + 36.53;
-    } else {
-        imuData.temperature = (temp / 333.87) + 21.0;
+    imuData.fifoEnabled = true;
+    imuData.sampleRateHz = IMU_FIFO_RATE_HZ;
+    debugPrintf("✅ IMU FIFO capture at %d Hz\n", IMU_FIFO_RATE_HZ);
+    return true;
+}
+
+// Called from the acquisition task - burst-drains every complete FIFO frame.
+// Frames are timestamped backwards from now at the configured sample period.
+void drainIMUFifo(IMUSample& latest) {
+    // Reading INT_STATUS clears the overflow flag
+    if (readRegister(MPU6xxx_INT_STATUS) & 0x10) {
+        imuData.fifoOverflows++;
+        resetIMUFifo();
+        return;
+    }
+    
+    uint16_t count = (uint16_t)readRegister16(MPU6xxx_FIFO_COUNTH);
+    uint16_t frames = count / IMU_FIFO_FRAME_SIZE;
+    if (frames == 0) return;
+    
+    const int64_t periodUs = 1000000 / IMU_FIFO_RATE_HZ;
+    int64_t now = esp_timer_get_time();
+    uint8_t buffer[IMU_FIFO_BURST_FRAMES * IMU_FIFO_FRAME_SIZE];
+    uint16_t remaining = frames;
+    
+    while (remaining > 0) {
+        uint16_t burst = min(remaining, (uint16_t)IMU_FIFO_BURST_FRAMES);
+        if (!readRegisters(MPU6xxx_FIFO_R_W, buffer, burst * IMU_FIFO_FRAME_SIZE)) {
+            // Lost frame alignment - start over
+            resetIMUFifo();
+            return;
+        }
+        
+        for (uint16_t i = 0; i < burst; i++) {
+            remaining--;
+            IMUSample sample;
+            sample.timestampMicros = now - remaining * periodUs;
+            sample.gnssTimeMicros = timeBase.toGnssMicros(sample.timestampMicros);
+            convertIMUFrame(&buffer[i * IMU_FIFO_FRAME_SIZE], sample);
+            imuUIRing.push(sample);
+            if (usbStreamEnabled) imuUsbRing.push(sample);
+            latest = sample;
+        }
     }
     
+    imuData.fifoSamples += frames;
+}
+
+// Called from the main loop for every sample drained from imuUIRing
+void updateMotionState(const IMUSample& sample) {
+    imuData.accelX = sample.accelX.toFloat();
+    imuData.accelY = sample.accelY.toFloat();
+    imuData.accelZ = sample.accelZ.toFloat();
+    imuData.gyroX = sample.gyroX.toFloat();
+    imuData.gyroY = sample.gyroY.toFloat();
+    imuData.gyroZ = sample.gyroZ.toFloat();
+    imuData.temperature = sample.temperature.toFloat();
+    
     // Calculate magnitude using calibrated values
-    imuData.magnitude = sqrt(imuData.accelX * imuData.accelX + 
-                            imuData.accelY * imuData.accelY + 
-                            imuData.accelZ * imuData.accelZ);
+    imuData.magnitude = sqrtf(imuData.accelX * imuData.accelX + 
+                              imuData.accelY * imuData.accelY + 
+                              imuData.accelZ * imuData.accelZ);
     
     // Motion detection with calibrated values
     if (imuData.magnitude > MOTION_THRESHOLD) {
@@ -529,167 +971,979 @@ void readMPU6050() {
         debugPrintf("💥 IMPACT DETECTED! Magnitude: %.2fg (calibrated)\n", imuData.magnitude);
         uiManager.requestUpdate();
     }
-}
-////=========================================part3
-bool createLogFile() {
-    if (!systemData.sdCardAvailable) return false;
     
-    sprintf(currentLogFilename, "/gps_%04d%02d%02d_%02d%02d%02d.bin",
-        myGNSS.getYear(), myGNSS.getMonth(), myGNSS.getDay(),
-        myGNSS.getHour(), myGNSS.getMinute(), myGNSS.getSecond());
+    trackIMUBias(sample);
+}
+
+// Called from the acquisition task - one pass from NAV-PVT fields to the fix
+void buildGPSSample(GPSSample& sample, const UbxNavPvt& pvt, const IMUSample& imu) {
+    sample.arrivalMicros = pvt.arrivalMicros;
+    sample.gnssTimeMicros = pvt.epochMicros();
+    if (sample.gnssTimeMicros == 0) {
+        sample.gnssTimeMicros = timeBase.toGnssMicros(pvt.arrivalMicros);
+    }
     
-    logFile = SD.open(currentLogFilename, FILE_WRITE);
-    if (!logFile) {
-        debugPrintln("❌ Failed to create log file");
-        return false;
+    GPSData& data = sample.data;
+    data.timestamp = pvt.unixEpoch();
+    data.latitude = DegreesE7(pvt.lat);
+    data.longitude = DegreesE7(pvt.lon);
+    data.altitude = pvt.height / 1000; // mm to m
+    // Display and rate-governor values - single precision, scale from the type
+    data.speed = SpeedKmh(pvt.gSpeed).toFloat();
+    data.heading = DegreesE5(pvt.headMot).toFloat();
+    data.fixType = pvt.fixType;
+    data.satellites = pvt.numSV;
+    data.year = pvt.year;
+    data.month = pvt.month;
+    data.day = pvt.day;
+    data.hour = pvt.hour;
+    data.minute = pvt.minute;
+    data.second = pvt.second;
+    
+    // Create GPS packet for transmission
+    GPSPacket& packet = sample.packet;
+    packet.timestamp = data.timestamp;
+    packet.timestamp_us = 0;
+    if (sample.gnssTimeMicros > 0) {
+        packet.timestamp = (uint32_t)(sample.gnssTimeMicros / 1000000);
+        packet.timestamp_us = (uint32_t)(sample.gnssTimeMicros % 1000000);
     }
+    packet.latitude = pvt.lat;
+    packet.longitude = pvt.lon;
+    packet.altitude = pvt.height;
+    packet.speed = pvt.gSpeed;
+    packet.heading = pvt.headMot;
+    packet.fixType = data.fixType;
+    packet.satellites = data.satellites;
     
-    debugPrintf("📄 Created: %s\n", currentLogFilename);
+    packet.battery_mv = batteryData.millivolts;
+    packet.battery_pct = batteryData.percentage;
     
-    const char* header = "GPS_LOG_V1.0\n";
-    logFile.write((uint8_t*)header, strlen(header));
-    logFile.flush();
+    if (systemData.mpuAvailable) {
+        packet.accel_x = fixedCast<AccelMilliG>(imu.accelX).count;
+        packet.accel_y = fixedCast<AccelMilliG>(imu.accelY).count;
+        packet.accel_z = fixedCast<AccelMilliG>(imu.accelZ).count;
+        packet.gyro_x = fixedCast<GyroCentiDps>(imu.gyroX).count;
+        packet.gyro_y = fixedCast<GyroCentiDps>(imu.gyroY).count;
+    } else {
+        packet.accel_x = packet.accel_y = packet.accel_z = 0;
+        packet.gyro_x = packet.gyro_y = 0;
+    }
     
-    return true;
+    // PMU status byte
+    packet.pmu_status = (batteryData.isCharging ? 0x01 : 0x00) |
+                       (batteryData.usbConnected ? 0x02 : 0x00) |
+                       (batteryData.isConnected ? 0x04 : 0x00);
+    
+    GPSPacketCodec::seal(packet);
 }
 
-void toggleLogging() {
-    if (systemData.loggingActive) {
-        systemData.loggingActive = false;
-        if (logFile) {
-            logFile.close();
-            debugPrintln("⚪ Logging stopped");
-        }
-    } else {
-        if (systemData.sdCardAvailable && myGNSS.getFixType() >= 2) {
-            systemData.loggingActive = true;
-            if (createLogFile()) {
-                debugPrintln("🔴 Logging started");
-            } else {
-                systemData.loggingActive = false;
-                debugPrintln("❌ Failed to create log file");
-            }
-        }
+// UART event task context - hand each validated NAV-PVT to the acquisition task
+void onNavPvt(const UbxNavPvt& pvt, void* context) {
+    pvtRing.push(pvt);
+    if (acquisitionTaskHandle) {
+        xTaskNotifyGive(acquisitionTaskHandle);
     }
-    
-    uiManager.requestUpdate();
 }
 
-// DIRECT File Transfer Functions (called from main loop - safe context)
-void sendFileResponse(String response) {
-    if (!fileTransferChar) {
-        debugPrintln("❌ File transfer characteristic not available");
+// UART event task context - collect the navigation database dump and
+// acknowledge replayed frames
+void onUbxFrame(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length, void* context) {
+    // Runtime CFG-VALSET acknowledgements from the rate governor
+    if (msgClass == UBX_CLASS_ACK && length >= 2 &&
+        payload[0] == UBX_CLASS_CFG && payload[1] == UBX_CFG_VALSET) {
+        if (msgId == UBX_ACK_ACK) navConfigAcks++;
+        else navConfigNaks++;
         return;
     }
     
-    // Split large responses into chunks (proven working approach)
-    int maxChunkSize = 400; // Conservative size that works
-    for (int i = 0; i < response.length(); i += maxChunkSize) {
-        String chunk = response.substring(i, min(i + maxChunkSize, (int)response.length()));
-        fileTransferChar->setValue(chunk.c_str());
-        fileTransferChar->notify();
-        delay(50); // Small delay between chunks
+    if (msgClass == UBX_CLASS_MGA && msgId == UBX_MGA_ACK) {
+        if (!gnssAssistReplaying) return;
+        portENTER_CRITICAL(&gnssAssistLock);
+        gnssAssistReplay.onAck(payload, length);
+        portEXIT_CRITICAL(&gnssAssistLock);
+        return;
+    }
+    
+    if (!gnssAssistCapturing || msgClass != UBX_CLASS_MGA) return;
+    portENTER_CRITICAL(&gnssAssistLock);
+    if (gnssAssistCapturing) {
+        gnssAssist.addFrame(msgClass, msgId, payload, length);
     }
+    portEXIT_CRITICAL(&gnssAssistLock);
 }
 
-void listSDFiles() {
-    if (!systemData.sdCardAvailable) {
-        sendFileResponse("ERROR:NO_SD_CARD");
-        return;
+// Write a saved blob back to the receiver, each frame once the last one
+// was acknowledged. Returns the number of frames the receiver took.
+uint16_t replayGNSSAssist(const uint8_t* blob, uint32_t length) {
+    portENTER_CRITICAL(&gnssAssistLock);
+    gnssAssistReplay.begin(blob, length, GNSS_ASSIST_ACK_TIMEOUT_MS, GNSS_ASSIST_PACE_MS);
+    gnssAssistReplaying = true;
+    portEXIT_CRITICAL(&gnssAssistLock);
+    
+    bool done = false;
+    while (!done) {
+        const uint8_t* frame = nullptr;
+        uint32_t now = millis();
+        portENTER_CRITICAL(&gnssAssistLock);
+        uint16_t n = gnssAssistReplay.next(now, frame);
+        done = gnssAssistReplay.done();
+        portEXIT_CRITICAL(&gnssAssistLock);
+        
+        if (n > 0) {
+            GNSS_Serial.write(frame, n);
+        } else if (!done) {
+            delay(1);
+        }
     }
-    
-    debugPrintln("📁 Listing SD card files...");
-    String fileList = "FILES:";
-    File root = SD.open("/");
-    if (!root) {
-        sendFileResponse("ERROR:CANT_OPEN_ROOT");
-        return;
+    gnssAssistReplaying = false;
+    GNSS_Serial.flush();
+    
+    const GnssAssistReplay& r = gnssAssistReplay;
+    if (!r.acknowledged()) {
+        debugPrintf("⚠️ GNSS database replay not acknowledged - sent %u frames unpaced\n",
+                    r.sentFrames());
+        return r.sentFrames() - r.timedOutFrames();
+    }
+    debugPrintf("🛰️ GNSS database replay: %u sent, %u accepted, %u rejected, %u timed out, %u retried\n",
+                r.sentFrames(), r.ackedFrames(), r.rejectedFrames(), r.timedOutFrames(),
+                r.retriedFrames());
+    return r.ackedFrames();
+}
+
+bool loadGNSSDatabase() {
+    SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+    File file = SD.open(GNSS_ASSIST_FILE, FILE_READ);
+    if (!file) return false;
+    
+    uint32_t length = file.size();
+    bool ok = length <= GNSS_ASSIST_CAPACITY &&
+              file.read(gnssAssistBuffer, length) == length;
+    file.close();
+    if (!ok) return false;
+    
+    GnssAssistHeader header;
+    if (!GnssAssist::validateBlob(gnssAssistBuffer, length, header)) {
+        debugPrintln("⚠️ Saved GNSS database is corrupt - ignoring");
+        return false;
+    }
+    uint16_t frames = replayGNSSAssist(gnssAssistBuffer, length);
+    debugPrintf("✅ GNSS database restored: %u frames saved at %lu\n", frames, header.savedUnix);
+    return frames > 0;
+}
+
+// Boot stage - seed the receiver before its first navigation epoch
+bool bootGNSSAssist() {
+    if (gnssBaud == 0) return false;
+    
+    gnssAssistBuffer = (uint8_t*)ps_malloc(GNSS_ASSIST_CAPACITY);
+    uint8_t frame[40];
+    uint16_t n;
+    uint8_t assist = 0;
+    
+    // Time first, then position, then the database - as the receiver expects
+    uint32_t now = time(nullptr);
+    if (now > GNSS_ASSIST_MIN_UNIX) {
+        // System time survives a reset but not a power cycle
+        n = GnssAssist::buildTimeUTC(now, GNSS_ASSIST_TIME_ACC_S, frame, sizeof(frame));
+        GNSS_Serial.write(frame, n);
+        assist |= GNSS_ASSIST_TIME;
     }
     
-    int fileCount = 0;
-    File file = root.openNextFile();
-    while (file) {
-        if (!file.isDirectory()) {
-            String filename = file.name();
-            if (filename.endsWith(".bin") || filename.endsWith(".log") || 
-                filename.endsWith(".txt") || filename.endsWith(".csv")) {
-                fileList += filename + ":" + String(file.size()) + ";";
-                fileCount++;
-                debugPrintf("📄 Found: %s (%d bytes)\n", filename.c_str(), file.size());
-            }
+    Preferences gnssPrefs;
+    if (gnssPrefs.begin(GNSS_PREFS_NAMESPACE, true)) {
+        if (gnssPrefs.isKey("lat")) {
+            n = GnssAssist::buildPositionLLH(gnssPrefs.getLong("lat"), gnssPrefs.getLong("lon"),
+                                             gnssPrefs.getLong("alt"), GNSS_ASSIST_POS_ACC_CM,
+                                             frame, sizeof(frame));
+            GNSS_Serial.write(frame, n);
+            assist |= GNSS_ASSIST_POSITION;
         }
-        file.close();
-        file = root.openNextFile();
+        gnssPrefs.end();
     }
-    root.close();
     
-    fileList += "COUNT:" + String(fileCount);
-    sendFileResponse(fileList);
-    debugPrintf("📁 File list sent: %d files found\n", fileCount);
-    uiManager.requestUpdate();
+    if (gnssAssistBuffer && systemData.sdCardAvailable && loadGNSSDatabase()) {
+        assist |= GNSS_ASSIST_DATABASE;
+    }
+    
+    bootTimeline.gnssAssist = assist;
+    debugPrintf("🛰️ GNSS assist: %s%s%s%s\n", assist ? "" : "none (cold start)",
+                (assist & GNSS_ASSIST_TIME) ? "time " : "",
+                (assist & GNSS_ASSIST_POSITION) ? "position " : "",
+                (assist & GNSS_ASSIST_DATABASE) ? "database" : "");
+    return true;
 }
 
-void startFileTransfer(String filename) {
-    if (!systemData.sdCardAvailable) {
-        sendFileResponse("ERROR:NO_SD_CARD");
+void saveGNSSDatabase(uint32_t length) {
+    if (length == 0 || !systemData.sdCardAvailable) return;
+    
+    SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+    File file = SD.open(GNSS_ASSIST_TMP_FILE, FILE_WRITE);
+    if (!file) return;
+    bool ok = file.write(gnssAssistBuffer, length) == length;
+    file.close();
+    
+    // Replace the old copy only once the new one is complete
+    if (ok) {
+        SD.remove(GNSS_ASSIST_FILE);
+        ok = SD.rename(GNSS_ASSIST_TMP_FILE, GNSS_ASSIST_FILE);
+    }
+    debugPrintf("%s GNSS database saved: %u frames, %lu bytes\n", ok ? "💾" : "❌",
+                gnssAssist.capturedFrames(), length);
+}
+
+// One line per boot so cold and assisted starts can be compared
+void recordTTFF() {
+    if (ttffRecorded || bootTimeline.firstPvtMs == 0 || !systemData.sdCardAvailable) return;
+    ttffRecorded = true;
+    
+    SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+    File file = SD.open(GNSS_TTFF_FILE, FILE_APPEND);
+    if (!file) return;
+    if (file.size() == 0) {
+        file.print("boot,assist,gnss_setup_ms,ttff_ms\n");
+    }
+    file.printf("%lu,%u,%lu,%lu\n", gnssBootCount, bootTimeline.gnssAssist,
+                bootTimeline.stageEndMs[BOOT_STAGE_GNSS] - bootTimeline.stageStartMs[BOOT_STAGE_GNSS],
+                bootTimeline.firstPvtMs);
+    file.close();
+}
+
+// Scheduler job - keep the saved aiding data fresh while there is a fix
+void gnssAssistJob() {
+    if (!gnssAssistBuffer || gnssBaud == 0) return;
+    
+    recordTTFF();
+    
+    if (gnssAssistCapturing) {
+        if (millis() - gnssAssistCaptureStart < GNSS_ASSIST_CAPTURE_MS) return;
+        portENTER_CRITICAL(&gnssAssistLock);
+        gnssAssistCapturing = false;
+        portEXIT_CRITICAL(&gnssAssistLock);
+        saveGNSSDatabase(gnssAssist.finishCapture());
         return;
     }
     
-    String fullPath = "/" + filename;
-    if (!SD.exists(fullPath.c_str())) {
-        sendFileResponse("ERROR:FILE_NOT_FOUND:" + filename);
-        debugPrintf("❌ File not found: %s\n", filename.c_str());
+    if (gpsData.fixType < 3 || !timeBase.isLocked()) return;
+    unsigned long sinceFix = millis() - bootTimeline.firstPvtMs;
+    if (lastGNSSAssistSave == 0 ? sinceFix < GNSS_ASSIST_FIRST_SAVE_MS
+                                : millis() - lastGNSSAssistSave < GNSS_ASSIST_INTERVAL_MS) {
         return;
     }
+    lastGNSSAssistSave = millis();
+    
+    // System time carries across a reset for the time aiding. The time base
+    // is fed from the acquisition core; toGnssMicros() converts with a
+    // consistent copy of its reference, so this is never a mix of two edges.
+    int64_t utcMicros = timeBase.toGnssMicros(esp_timer_get_time());
+    if (utcMicros <= 0) return;
+    struct timeval tv = {(time_t)(utcMicros / 1000000), (suseconds_t)(utcMicros % 1000000)};
+    settimeofday(&tv, nullptr);
+    
+    Preferences gnssPrefs;
+    if (gnssPrefs.begin(GNSS_PREFS_NAMESPACE, false)) {
+        gnssPrefs.putLong("lat", gpsData.latitude.count);
+        gnssPrefs.putLong("lon", gpsData.longitude.count);
+        gnssPrefs.putLong("alt", gpsData.altitude * 100);
+        gnssPrefs.end();
+    }
     
-    // Close any existing transfer
-    if (fileTransfer.active && fileTransfer.transferFile) {
-        fileTransfer.transferFile.close();
+    // Empty MGA-DBD poll - the receiver answers with its whole database
+    uint8_t poll[8];
+    uint16_t n = GnssAssist::buildDbdPoll(poll, sizeof(poll));
+    gnssAssist.beginCapture(gnssAssistBuffer, GNSS_ASSIST_CAPACITY, tv.tv_sec);
+    gnssAssistCaptureStart = millis();
+    gnssAssistCapturing = true;
+    GNSS_Serial.write(poll, n);
+}
+
+// Rate (and, around parked mode, constellation set) in one RAM-only VALSET.
+// Signal changes restart the receiver's tracking, so they are only made
+// when entering or leaving parked mode.
+void applyNavMode(NavRateMode from, NavRateMode to) {
+    GnssConfigItem items[2];
+    uint8_t count = 0;
+    items[count++] = {GNSS_KEY_RATE_MEAS, navModeMeasMs[to]};
+    if ((from == NAV_MODE_PARKED) != (to == NAV_MODE_PARKED)) {
+        items[count++] = {GNSS_KEY_SIGNAL_GAL_ENA, to == NAV_MODE_PARKED ? 0UL : 1UL};
     }
     
-    fileTransfer.transferFile = SD.open(fullPath.c_str(), FILE_READ);
-    if (!fileTransfer.transferFile) {
-        sendFileResponse("ERROR:CANT_OPEN_FILE:" + filename);
-        debugPrintf("❌ Cannot open file: %s\n", filename.c_str());
+    GnssConfig config(items, count);
+    uint8_t payload[32];
+    uint8_t frame[48];
+    uint16_t length = config.buildValset(GNSS_LAYER_RAM_MASK, payload, sizeof(payload));
+    uint16_t n = GnssAssist::buildFrame(UBX_CLASS_CFG, UBX_CFG_VALSET, payload, length, frame, sizeof(frame));
+    GNSS_Serial.write(frame, n);
+}
+
+void logNavEvent(uint32_t now) {
+    const char* from = NavRateGovernor::modeName(navGovernor.previousMode());
+    const char* to = NavRateGovernor::modeName(navGovernor.mode());
+    const char* reason = NavRateGovernor::reasonName(navGovernor.reason());
+    debugPrintf("🛰️ Nav rate %s -> %s (%s, %.1f km/h) %u Hz\n", from, to, reason, gpsData.speed,
+                1000 / navModeMeasMs[navGovernor.mode()]);
+    
+    if (!systemData.sdCardAvailable) return;
+    SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+    File file = SD.open(GNSS_EVENTS_FILE, FILE_APPEND);
+    if (!file) return;
+    if (file.size() == 0) {
+        file.print("boot,uptime_ms,utc,from,to,reason,speed_kmh\n");
+    }
+    file.printf("%lu,%lu,%04d-%02d-%02dT%02d:%02d:%02dZ,%s,%s,%s,%.1f\n",
+                gnssBootCount, now, gpsData.year, gpsData.month, gpsData.day,
+                gpsData.hour, gpsData.minute, gpsData.second, from, to, reason, gpsData.speed);
+    file.close();
+}
+
+// Scheduler job - step the navigation rate with motion
+void navRateJob() {
+    // The UART belongs to the parser once acquisition is up; assist data first
+    if (gnssBaud == 0 || !bootSequence.isFinished(BOOT_STAGE_ACQUISITION) ||
+        !bootSequence.isFinished(BOOT_STAGE_GNSS_ASSIST)) {
         return;
     }
     
-    fileTransfer.active = true;
-    fileTransfer.filename = filename;
-    fileTransfer.fileSize = fileTransfer.transferFile.size();
-    fileTransfer.bytesSent = 0;
-    fileTransfer.lastChunkTime = millis();
-    fileTransfer.progressPercent = 0.0f;
-    fileTransfer.transferStartTime = millis();
+    uint32_t now = millis();
+    if (!navGovernor.update(imuData.motionDetected, gpsData.fixType >= 2, gpsData.speed, now)) return;
     
-    // Send file info
-    String response = "START:" + filename + ":" + String(fileTransfer.fileSize);
-    sendFileResponse(response);
+    applyNavMode(navGovernor.previousMode(), navGovernor.mode());
+    
+    // Packet interval stats are per rate
+    perfStats.expectedRateHz = 1000.0f / navModeMeasMs[navGovernor.mode()];
+    perfStats.minDelta = 9999;
+    perfStats.maxDelta = 0;
     
-    debugPrintf("📤 Starting transfer: %s (%d bytes)\n", filename.c_str(), fileTransfer.fileSize);
+    logNavEvent(now);
     uiManager.requestUpdate();
 }
 
-void processFileTransfer() {
-    if (!fileTransfer.active || !fileTransfer.transferFile) return;
-    
-    unsigned long now = millis();
-    if (now - fileTransfer.lastChunkTime < 100) return; // Rate limiting
-    
-    const int chunkSize = 400; // Conservative chunk size for BLE
-    uint8_t buffer[chunkSize];
+// UART event task context - called on RX FIFO threshold or idle timeout
+void onGNSSReceive() {
+    uint8_t buffer[256];
+    size_t available;
+    while ((available = GNSS_Serial.available()) > 0) {
+        size_t n = GNSS_Serial.read(buffer, min(available, sizeof(buffer)));
+        ubxParser.feed(buffer, n, esp_timer_get_time());
+    }
+}
+
+#ifdef GNSS_PPS
+void IRAM_ATTR onGNSSPps() {
+    ppsLocalMicros = esp_timer_get_time();
+    ppsPending = true;
+}
+#endif
+
+// Called from the acquisition task - discipline the local clock with each fix
+void updateTimeBase(const UbxNavPvt& pvt) {
+    int64_t epochMicros = pvt.epochMicros();
+    if (epochMicros == 0) return;
+
+#ifdef GNSS_PPS
+    if (ppsPending) {
+        ppsPending = false;
+        // The pulse marks the top of the UTC second it precedes this fix by
+        int64_t edgeLocal = ppsLocalMicros;
+        int64_t approx = epochMicros - (pvt.arrivalMicros - edgeLocal);
+        int64_t second = (approx + 500000) / 1000000 * 1000000;
+        timeBase.addEdge(edgeLocal, second, TimeBase::EDGE_PPS);
+    }
+#endif
     
-    int bytesRead = fileTransfer.transferFile.read(buffer, chunkSize);
-    if (bytesRead > 0) {
+    timeBase.addEdge(pvt.arrivalMicros, epochMicros, TimeBase::EDGE_NAV_PVT);
+}
+
+// Take the UART away from the SparkFun polling path once configuration is done
+void startUbxReceiver() {
+    ubxParser.setBaudRate(gnssBaud);
+    ubxParser.setPvtCallback(onNavPvt, nullptr);
+    ubxParser.setFrameCallback(onUbxFrame, nullptr);
+    GNSS_Serial.onReceive(onGNSSReceive);
+    debugPrintf("✅ UBX receiver attached at %lu baud\n", gnssBaud);
+
+#ifdef GNSS_PPS
+    pinMode(GNSS_PPS, INPUT);
+    attachInterrupt(GNSS_PPS, onGNSSPps, RISING);
+    debugPrintf("✅ PPS input on GPIO %d\n", GNSS_PPS);
+#endif
+}
+
+// Sensor acquisition task - sole owner of the IMU after setup().
+// Runs pinned to its own core so SD flushes, BLE chunk delays and WiFi
+// reconnects in loop() can no longer delay a GNSS or IMU sample.
+void acquisitionTask(void* param) {
+    IMUSample latestIMU;
+    uint32_t lastIMURead = 0;
+    
+    // A hang here resets the device through the task watchdog
+    esp_task_wdt_add(nullptr);
+    
+    for (;;) {
+        esp_task_wdt_reset();
+        {
+            StallScope stall(stallMonitor, stallAcquisition);
+            
+            if (systemData.mpuAvailable) {
+                if (imuData.fifoEnabled) {
+                    drainIMUFifo(latestIMU);
+                } else if (micros() - lastIMURead >= IMU_SAMPLE_PERIOD_US) {
+                    lastIMURead = micros();
+                    if (readIMUSample(latestIMU)) {
+                        imuUIRing.push(latestIMU);
+                        if (usbStreamEnabled) imuUsbRing.push(latestIMU);
+                    }
+                }
+            }
+            
+            UbxNavPvt pvt;
+            while (pvtRing.pop(pvt)) {
+                updateTimeBase(pvt);
+                GPSSample sample;
+                buildGPSSample(sample, pvt, latestIMU);
+                gpsLogRing.push(sample);
+                gpsTelemetryRing.push(sample);
+                gpsUIRing.push(sample);
+                if (usbStreamEnabled) gpsUsbRing.push(sample);
+            }
+        }
+        
+        // Woken early by onNavPvt, otherwise every tick for the IMU FIFO
+        ulTaskNotifyTake(pdTRUE, 1);
+    }
+}
+
+void startAcquisitionTask() {
+    xTaskCreatePinnedToCore(acquisitionTask, "acquisition", ACQUISITION_TASK_STACK,
+                            nullptr, ACQUISITION_TASK_PRIORITY, &acquisitionTaskHandle,
+                            ACQUISITION_TASK_CORE);
+    debugPrintf("✅ Acquisition task started on core %d\n", ACQUISITION_TASK_CORE);
+    
+    if (gnssBaud > 0) {
+        startUbxReceiver();
+    }
+}
+
+// Text debug output and binary frames share the port - only one at a time
+void applyUsbStream(bool enabled) {
+    if (enabled == usbStreamEnabled) return;
+    if (enabled) {
+        debugPrintln("🔌 USB binary stream on - debug text paused");
+        usbStreamDebugMode = debugMode;
+        debugMode = false;
+        imuUsbRing.clear();
+        gpsUsbRing.clear();
+        usbStreamEnabled = true;
+        // Terminates any partial text so the first frame decodes
+        uint8_t delimiter = 0x00;
+        Serial.write(&delimiter, 1);
+    } else {
+        usbStreamEnabled = false;
+        debugMode = usbStreamDebugMode;
+        debugPrintln("🔌 USB binary stream off");
+    }
+}
+
+void writeUsbStream(const uint8_t* data, size_t length) {
+    size_t written = Serial.write(data, length);
+    usbStreamBytes += written;
+    if (written < length) usbStreamShortWrites++;
+}
+
+void usbStreamTask(void* parameter) {
+    static uint8_t out[2048];
+    char command[24];
+    uint8_t commandLength = 0;
+    unsigned long lastSchemaMs = 0;
+    
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(USB_STREAM_PERIOD_MS));
+        
+        // "STREAM ON" / "STREAM OFF" typed on the port switch without BLE
+        while (Serial.available() > 0) {
+            char c = Serial.read();
+            if (c == '\n' || c == '\r') {
+                command[commandLength] = '\0';
+                if (strcmp(command, "STREAM ON") == 0) usbStreamRequest = 1;
+                else if (strcmp(command, "STREAM OFF") == 0) usbStreamRequest = 0;
+                commandLength = 0;
+            } else if (commandLength < sizeof(command) - 1) {
+                command[commandLength++] = c;
+            }
+        }
+        if (usbStreamRequest >= 0) {
+            bool enable = usbStreamRequest == 1;
+            usbStreamRequest = -1;
+            applyUsbStream(enable);
+            lastSchemaMs = 0;
+        }
+        if (!usbStreamEnabled) continue;
+        
+        StallScope stall(stallMonitor, stallUsb);
+        size_t n = 0;
+        
+        if (lastSchemaMs == 0 || millis() - lastSchemaMs >= USB_STREAM_SCHEMA_MS) {
+            lastSchemaMs = millis();
+            char schema[USB_FRAME_MAX_PAYLOAD];
+            size_t len = writeSchemaDescriptor(gpsPacketSchema, schema, sizeof(schema) - 1);
+            len += snprintf(schema + len, sizeof(schema) - len, "\n%s", STREAM_IMU_SCHEMA);
+            n += usbFramer.frame(USB_FRAME_SCHEMA, schema, min(len, sizeof(schema) - 1), out + n);
+        }
+        
+        GPSSample gps;
+        while (gpsUsbRing.pop(gps)) {
+            if (n + USB_FRAME_MAX_ENCODED(sizeof(GPSPacket)) > sizeof(out)) {
+                writeUsbStream(out, n);
+                n = 0;
+            }
+            n += usbFramer.frame(USB_FRAME_GPS, &gps.packet, sizeof(GPSPacket), out + n);
+        }
+        
+        IMUSample imu;
+        while (imuUsbRing.pop(imu)) {
+            if (n + USB_FRAME_MAX_ENCODED(sizeof(StreamIMURecord)) > sizeof(out)) {
+                writeUsbStream(out, n);
+                n = 0;
+            }
+            StreamIMURecord record;
+            record.timestampMicros = imu.timestampMicros;
+            record.gnssTimeMicros = imu.gnssTimeMicros;
+            record.accel[0] = imu.accelX.count;
+            record.accel[1] = imu.accelY.count;
+            record.accel[2] = imu.accelZ.count;
+            record.gyro[0] = imu.gyroX.count;
+            record.gyro[1] = imu.gyroY.count;
+            record.gyro[2] = imu.gyroZ.count;
+            record.temperature = imu.temperature.count;
+            n += usbFramer.frame(USB_FRAME_IMU, &record, sizeof(record), out + n);
+        }
+        
+        if (n > 0) writeUsbStream(out, n);
+    }
+}
+
+void startUsbStreamTask() {
+    xTaskCreatePinnedToCore(usbStreamTask, "usbstream", USB_STREAM_STACK, nullptr,
+                            USB_STREAM_PRIORITY, nullptr, 1);
+}
+////=========================================part3
+// SD writer task - a file is named in NVS from when it is opened until it
+// is finished and trimmed. Own handle: called from the writer task.
+void logFileHook(const char* path, bool open) {
+    Preferences logPrefs;
+    if (!logPrefs.begin(LOG_PREFS_NAMESPACE, false)) return;
+    if (open) {
+        logPrefs.putString("open", path);
+    } else if (logPrefs.getString("open") == path) {
+        logPrefs.remove("open");
+    }
+    logPrefs.end();
+}
+
+// Boot, before logging can start - finishes the log file the last session
+// left open. Bounded by log2 of the file size, not by what it holds.
+void recoverUnfinishedLog() {
+    Preferences logPrefs;
+    if (!logPrefs.begin(LOG_PREFS_NAMESPACE, false)) return;
+    size_t len = logPrefs.getString("open", logRecoveryFile, sizeof(logRecoveryFile));
+    if (len == 0) {
+        logPrefs.end();
+        return;
+    }
+    
+    char fatPath[SD_WRITER_PATH_MAX + 4];
+    char indexPath[SD_WRITER_PATH_MAX];
+    char fatIndexPath[SD_WRITER_PATH_MAX + 4];
+    snprintf(fatPath, sizeof(fatPath), "%s%s", SD_FATFS_DRIVE, logRecoveryFile);
+    bool indexed = logIndexPath(logRecoveryFile, indexPath, sizeof(indexPath));
+    snprintf(fatIndexPath, sizeof(fatIndexPath), "%s%s", SD_FATFS_DRIVE, indexPath);
+    {
+        SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+        recoverLogFile(fatPath, indexed ? fatIndexPath : nullptr, logRecovery);
+    }
+    // Tried once - a file that cannot be recovered is not retried every boot
+    logPrefs.remove("open");
+    logPrefs.end();
+    
+    debugPrintf("🩹 Unfinished log %s: status %u, %lu -> %lu bytes, %lu blocks kept, %lu bytes lost, %lu reads in %lu ms\n",
+                logRecoveryFile, logRecovery.status, logRecovery.originalBytes, logRecovery.finalBytes,
+                logRecovery.blocks, logRecovery.lostBytes, logRecovery.blockReads, logRecovery.micros / 1000);
+    debugPrintf("🩹 Index: %lu entries, %lu rebuilt\n", logRecovery.indexEntries, logRecovery.indexAdded);
+}
+
+// Ends the current file's blocks with its summary; false if the ring is full
+bool appendLogSummary() {
+    char text[96];
+    int len = snprintf(text, sizeof(text), "#SUMMARY blocks=%lu records=%lu\n",
+                       logBlocks.fileBlocks(), logBlocks.fileRecords());
+    logBlocks.takeSummary(text, min(len, (int)sizeof(text) - 1), logBlock);
+    if (sdWriter.append(logBlock, LOG_BLOCK_SIZE)) return true;
+    logBlocks.untake();
+    return false;
+}
+
+// Also rolls an open log over to a new file. The SD writer task creates it
+// (preallocated to logFileBytes()) once everything before it is written, so
+// nothing here waits for the card.
+bool createLogFile() {
+    if (!systemData.sdCardAvailable) return false;
+    // The previous file is still draining, or the last roll is still pending
+    if ((sdWriter.busy() && !sdWriter.isOpen()) || sdWriter.rolling()) return false;
+    // The old file's summary and the new file's metadata block must both fit
+    // in the ring, or the roll waits for a later pass with the old file open
+    if (sdWriter.freeSpace() < 2 * LOG_BLOCK_SIZE) return false;
+    
+    char filename[sizeof(currentLogFilename)];
+    int nameLen = snprintf(filename, sizeof(filename), "/gps_%04d%02d%02d_%02d%02d%02d",
+                           gpsData.year, gpsData.month, gpsData.day,
+                           gpsData.hour, gpsData.minute, gpsData.second);
+    // A roll within the same second must not reuse the name
+    static uint8_t part = 0;
+    part = strncmp(filename, currentLogFilename, nameLen) == 0 ? part + 1 : 0;
+    if (part > 0) nameLen += snprintf(filename + nameLen, sizeof(filename) - nameLen, "_%u", part);
+    snprintf(filename + nameLen, sizeof(filename) - nameLen, ".bin");
+    
+    char indexPath[sizeof(filename)];
+    if (!logIndexPath(filename, indexPath, sizeof(indexPath))) indexPath[0] = '\0';
+    
+    // The file rolled from gets its summary first
+    uint32_t preallocate = logFileBytes();
+    if (sdWriter.isOpen() && !appendLogSummary()) return false;
+    if (!sdWriter.startFile(filename, preallocate, indexPath[0] ? indexPath : nullptr)) {
+        debugPrintln("❌ Failed to create log file");
+        return false;
+    }
+    logFileCapacity = preallocate;
+    
+    // V2: a metadata block with the header lines, then record blocks
+    static char metadata[1024];
+    int len = snprintf(metadata, sizeof(metadata), "GPS_LOG_V2.0\n");
+    
+    // Boot timeline as a comment line - readers skip lines starting with "#BOOT "
+    len += snprintf(metadata + len, sizeof(metadata) - len,
+                    "#BOOT ui=%lu complete=%lu first_pvt=%lu log_open=%lu gnss_cfg=%u gnss_baud=%lu gnss_assist=%u",
+                    bootTimeline.uiReadyMs, bootTimeline.bootCompleteMs,
+                    bootTimeline.firstPvtMs, millis(),
+                    bootTimeline.gnssConfig, bootTimeline.gnssBaud, bootTimeline.gnssAssist);
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT && len < (int)sizeof(metadata) - 1; i++) {
+        len += snprintf(metadata + len, sizeof(metadata) - len, " %s=%lu-%lu",
+                        bootSequence.stageName((BootStage)i),
+                        bootTimeline.stageStartMs[i], bootTimeline.stageEndMs[i]);
+    }
+    if (len > (int)sizeof(metadata) - 2) len = sizeof(metadata) - 2;
+    metadata[len++] = '\n';
+    
+    size_t schemaLen = writeSchemaDescriptor(gpsPacketSchema, metadata + len, sizeof(metadata) - len - 1);
+    if (schemaLen > 0) {
+        len += schemaLen;
+        metadata[len++] = '\n';
+    }
+    
+    // Records follow as keyframe/delta frames instead of fixed-size packets
+    logFileEncoding = logEncoding;
+    if (logFileEncoding == RECORD_ENCODING_DELTA && len < (int)sizeof(metadata)) {
+        len += snprintf(metadata + len, sizeof(metadata) - len, "#ENCODING delta v%u\n",
+                        RECORD_STREAM_VERSION);
+        if (len > (int)sizeof(metadata)) len = sizeof(metadata);
+    }
+    
+    logBlocks.startFile(esp_random());
+    logBlocks.setDelta(logFileEncoding == RECORD_ENCODING_DELTA);
+    logBlocks.takeMetadata(metadata, len, logBlock);
+    // Room was checked above and nothing else appends in between
+    sdWriter.append(logBlock, LOG_BLOCK_SIZE);
+    strlcpy(currentLogFilename, filename, sizeof(currentLogFilename));
+    debugPrintf("📄 Created: %s (%lu bytes preallocated)\n", currentLogFilename, preallocate);
+    
+    LogIndexHeader indexHeader;
+    makeLogIndexHeader(logBlocks.firstSequence(), indexHeader);
+    sdWriter.appendSidecar((const uint8_t*)&indexHeader, sizeof(indexHeader));
+    logIndexer.startFile();
+    
+    return true;
+}
+
+void toggleLogging() {
+    if (systemData.loggingActive) {
+        systemData.loggingActive = false;
+        // processLogging() closes the file after its last block
+        if (sdWriter.isOpen()) {
+            debugPrintln("⚪ Logging stopped");
+        }
+    } else {
+        if (systemData.sdCardAvailable && gpsData.fixType >= 2) {
+            systemData.loggingActive = true;
+            if (createLogFile()) {
+                debugPrintln("🔴 Logging started");
+            } else {
+                systemData.loggingActive = false;
+                debugPrintln("❌ Failed to create log file");
+            }
+        }
+    }
+    
+    uiManager.requestUpdate();
+}
+
+// DIRECT File Transfer Functions (called from main loop - safe context)
+#define FILE_RESPONSE_CHUNK 400 // Conservative size that works
+
+void sendFileResponseChunk(const char* data, size_t length) {
+    fileTransferChar->setValue((uint8_t*)data, length);
+    fileTransferChar->notify();
+    delay(50); // Small delay between chunks
+}
+
+void sendFileResponse(const char* response) {
+    if (!fileTransferChar) {
+        debugPrintln("❌ File transfer characteristic not available");
+        return;
+    }
+    
+    // Split large responses into chunks (proven working approach)
+    size_t length = strlen(response);
+    for (size_t i = 0; i < length; i += FILE_RESPONSE_CHUNK) {
+        sendFileResponseChunk(response + i, min(length - i, (size_t)FILE_RESPONSE_CHUNK));
+    }
+}
+
+// Response of any length, built in place and sent in the same chunks as
+// sendFileResponse() as it fills
+class FileResponseWriter {
+public:
+    FileResponseWriter() : length(0) {}
+    
+    void printf(const char* format, ...) {
+        char text[128];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        if (n > 0) append(text, min(n, (int)sizeof(text) - 1));
+    }
+    
+    void finish() {
+        if (length > 0 && fileTransferChar) sendFileResponseChunk(buffer, length);
+        length = 0;
+    }
+    
+private:
+    void append(const char* text, size_t n) {
+        while (n > 0) {
+            size_t room = min(n, sizeof(buffer) - length);
+            memcpy(buffer + length, text, room);
+            length += room;
+            text += room;
+            n -= room;
+            if (length == sizeof(buffer) && fileTransferChar) {
+                sendFileResponseChunk(buffer, length);
+                length = 0;
+            }
+        }
+    }
+    
+    char buffer[FILE_RESPONSE_CHUNK];
+    size_t length;
+};
+
+void listSDFiles() {
+    if (!systemData.sdCardAvailable) {
+        sendFileResponse("ERROR:NO_SD_CARD");
+        return;
+    }
+    
+    debugPrintln("📁 Listing SD card files...");
+    FileResponseWriter fileList;
+    fileList.printf("FILES:");
+    int fileCount = 0;
+    {
+        // Hold the SD lease for the directory walk only, not the BLE send
+        SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+        File root = SD.open("/");
+        if (!root) {
+            sendFileResponse("ERROR:CANT_OPEN_ROOT");
+            return;
+        }
+        
+        File file = root.openNextFile();
+        while (file) {
+            if (!file.isDirectory()) {
+                const char* filename = file.name();
+                const char* ext = strrchr(filename, '.');
+                if (ext && (strcmp(ext, ".bin") == 0 || strcmp(ext, ".log") == 0 ||
+                            strcmp(ext, ".txt") == 0 || strcmp(ext, ".csv") == 0 ||
+                            strcmp(ext, ".idx") == 0)) {
+                    fileList.printf("%s:%u;", filename, (unsigned)file.size());
+                    fileCount++;
+                    debugPrintf("📄 Found: %s (%d bytes)\n", filename, file.size());
+                }
+            }
+            file.close();
+            file = root.openNextFile();
+        }
+        root.close();
+    }
+    
+    fileList.printf("COUNT:%d", fileCount);
+    fileList.finish();
+    debugPrintf("📁 File list sent: %d files found\n", fileCount);
+    uiManager.requestUpdate();
+}
+
+static bool readIndexEntry(void* context, uint32_t i, LogIndexEntry& entry) {
+    File& index = *static_cast<File*>(context);
+    return index.seek(sizeof(LogIndexHeader) + i * sizeof(entry)) &&
+           index.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+}
+
+// Narrows the open transfer to the blocks of a V2 log holding fromMicros
+// to toMicros, found in its index sidecar; the metadata block goes first
+// so the result reads as a log on its own. Under the SD lease.
+bool setTransferRange(const char* fullPath, int64_t fromMicros, int64_t toMicros) {
+    File& log = fileTransfer.transferFile;
+    LogBlockHeader logHeader;
+    if (log.read((uint8_t*)&logHeader, sizeof(logHeader)) != sizeof(logHeader) ||
+        logHeader.sync != LOG_BLOCK_SYNC || logHeader.kind != LOG_BLOCK_METADATA || !log.seek(0)) {
+        return false;
+    }
+    
+    // The log still being written is preallocated: only what the SD writer
+    // has put on the card counts, not the unwritten space after it
+    uint32_t blockCount = fileTransfer.fileSize / LOG_BLOCK_SIZE;
+    if (sdWriter.isOpen() && strcmp(fullPath, currentLogFilename) == 0) {
+        uint32_t appended = sdWriter.fileBytes();
+        uint32_t pending = sdWriter.stats().pending;
+        blockCount = min(blockCount, (appended > pending ? appended - pending : 0) / LOG_BLOCK_SIZE);
+    }
+    
+    char indexPath[72];
+    if (!logIndexPath(fullPath, indexPath, sizeof(indexPath))) return false;
+    File index = SD.open(indexPath, FILE_READ);
+    if (!index) return false;
+    LogIndexHeader indexHeader;
+    uint32_t first, end;
+    bool found = index.read((uint8_t*)&indexHeader, sizeof(indexHeader)) == sizeof(indexHeader) &&
+                 checkLogIndexHeader(indexHeader, logHeader.sequence) &&
+                 findLogIndexRange(readIndexEntry, &index,
+                                   (index.size() - sizeof(indexHeader)) / sizeof(LogIndexEntry),
+                                   blockCount, fromMicros, toMicros, first, end);
+    index.close();
+    if (!found) return false;
+    
+    fileTransfer.rangeHead = LOG_BLOCK_SIZE;
+    fileTransfer.rangeStart = (size_t)first * LOG_BLOCK_SIZE;
+    fileTransfer.rangeEnd = (size_t)end * LOG_BLOCK_SIZE;
+    fileTransfer.fileSize = fileTransfer.rangeHead + fileTransfer.rangeEnd - fileTransfer.rangeStart;
+    return true;
+}
+
+// Next bytes of the transfer - for a range, the head of the file then the range
+int readTransferChunk(uint8_t* buffer, int size) {
+    File& file = fileTransfer.transferFile;
+    if (fileTransfer.rangeEnd == 0) return file.read(buffer, size);
+    
+    int n = 0;
+    while (n < size) {
+        size_t at = file.position();
+        if (at == fileTransfer.rangeHead && at < fileTransfer.rangeStart) {
+            if (!file.seek(fileTransfer.rangeStart)) break;
+            continue;
+        }
+        size_t limit = at < fileTransfer.rangeHead ? fileTransfer.rangeHead : fileTransfer.rangeEnd;
+        if (at >= limit) break;
+        int got = file.read(buffer + n, min((size_t)(size - n), limit - at));
+        if (got <= 0) break;
+        n += got;
+    }
+    return n;
+}
+
+// ranged: only the blocks of a V2 log between fromMicros and toMicros (UTC)
+void startFileTransfer(const char* filename, bool ranged = false, int64_t fromMicros = 0,
+                       int64_t toMicros = 0) {
+    if (!systemData.sdCardAvailable) {
+        sendFileResponse("ERROR:NO_SD_CARD");
+        return;
+    }
+    
+    char fullPath[72];
+    char response[96];
+    snprintf(fullPath, sizeof(fullPath), "/%s", filename);
+    bool opened = false;
+    {
+        SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+        if (!SD.exists(fullPath)) {
+            snprintf(response, sizeof(response), "ERROR:FILE_NOT_FOUND:%s", filename);
+            sendFileResponse(response);
+            debugPrintf("❌ File not found: %s\n", filename);
+            return;
+        }
+        
+        // Close any existing transfer
+        if (fileTransfer.active && fileTransfer.transferFile) {
+            fileTransfer.transferFile.close();
+        }
+        
+        fileTransfer.transferFile = SD.open(fullPath, FILE_READ);
+        opened = fileTransfer.transferFile;
+        fileTransfer.rangeHead = fileTransfer.rangeStart = fileTransfer.rangeEnd = 0;
+        if (opened) fileTransfer.fileSize = fileTransfer.transferFile.size();
+        if (opened && ranged && !setTransferRange(fullPath, fromMicros, toMicros)) {
+            fileTransfer.transferFile.close();
+            fileTransfer.active = false;
+            snprintf(response, sizeof(response), "ERROR:NO_INDEX:%s", filename);
+            sendFileResponse(response);
+            debugPrintf("❌ No usable index for: %s\n", filename);
+            return;
+        }
+    }
+    if (!opened) {
+        snprintf(response, sizeof(response), "ERROR:CANT_OPEN_FILE:%s", filename);
+        sendFileResponse(response);
+        debugPrintf("❌ Cannot open file: %s\n", filename);
+        return;
+    }
+    
+    fileTransfer.active = true;
+    strlcpy(fileTransfer.filename, filename, sizeof(fileTransfer.filename));
+    fileTransfer.bytesSent = 0;
+    fileTransfer.lastChunkTime = millis();
+    fileTransfer.progressPercent = 0.0f;
+    fileTransfer.transferStartTime = millis();
+    
+    // Send file info
+    snprintf(response, sizeof(response), "START:%s:%u", filename, (unsigned)fileTransfer.fileSize);
+    sendFileResponse(response);
+    
+    debugPrintf("📤 Starting transfer: %s (%d bytes)\n", filename, fileTransfer.fileSize);
+    uiManager.requestUpdate();
+}
+
+void processFileTransfer() {
+    if (!fileTransfer.active || !fileTransfer.transferFile) return;
+    
+    unsigned long now = millis();
+    if (now - fileTransfer.lastChunkTime < 100) return; // Rate limiting
+    
+    const int chunkSize = 400; // Conservative chunk size for BLE
+    uint8_t buffer[chunkSize];
+    
+    int bytesRead;
+    {
+        SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+        bytesRead = readTransferChunk(buffer, chunkSize);
+        if (bytesRead <= 0) fileTransfer.transferFile.close();
+    }
+    if (bytesRead > 0) {
         // Convert to hex for reliable BLE transmission (from working code)
-        String chunk = "CHUNK:";
+        static const char hexDigits[] = "0123456789abcdef";
+        static char chunk[sizeof("CHUNK:") + 2 * chunkSize + sizeof(":SEQ:4294967295")];
+        int len = snprintf(chunk, sizeof(chunk), "CHUNK:");
         for (int i = 0; i < bytesRead; i++) {
-            if (buffer[i] < 16) chunk += "0";
-            chunk += String(buffer[i], HEX);
-            if (chunk.length() > 800) break; // Prevent overrun
+            chunk[len++] = hexDigits[buffer[i] >> 4];
+            chunk[len++] = hexDigits[buffer[i] & 0x0F];
         }
-        
-        chunk += ":SEQ:" + String(fileTransfer.bytesSent / chunkSize);
+        snprintf(chunk + len, sizeof(chunk) - len, ":SEQ:%u", (unsigned)(fileTransfer.bytesSent / chunkSize));
         
         sendFileResponse(chunk);
         fileTransfer.bytesSent += bytesRead;
@@ -715,15 +1969,16 @@ void processFileTransfer() {
             uiManager.requestUpdate();
         }
     } else {
-        // Transfer complete
-        fileTransfer.transferFile.close();
+        // Transfer complete - file was closed under the read lease
         fileTransfer.active = false;
         
         unsigned long totalTime = now - fileTransfer.transferStartTime;
         
-        sendFileResponse("COMPLETE:" + String(fileTransfer.bytesSent) + ":TIME:" + String(totalTime));
+        char response[64];
+        snprintf(response, sizeof(response), "COMPLETE:%u:TIME:%lu", (unsigned)fileTransfer.bytesSent, totalTime);
+        sendFileResponse(response);
         debugPrintf("✅ Transfer complete: %s (%d bytes in %.2fs)\n", 
-                     fileTransfer.filename.c_str(), fileTransfer.bytesSent, totalTime / 1000.0f);
+                     fileTransfer.filename, fileTransfer.bytesSent, totalTime / 1000.0f);
         
         fileTransfer.progressPercent = 0.0f;
         fileTransfer.estimatedTimeRemaining = 0;
@@ -731,24 +1986,40 @@ void processFileTransfer() {
     }
 }
 
-void deleteFile(String filename) {
+void deleteFile(const char* filename) {
     if (!systemData.sdCardAvailable) {
         sendFileResponse("ERROR:NO_SD_CARD");
         return;
     }
     
-    String fullPath = "/" + filename;
-    if (!SD.exists(fullPath.c_str())) {
-        sendFileResponse("ERROR:FILE_NOT_FOUND:" + filename);
+    char fullPath[72];
+    char response[96];
+    snprintf(fullPath, sizeof(fullPath), "/%s", filename);
+    bool exists, removed = false;
+    {
+        SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
+        exists = SD.exists(fullPath);
+        if (exists) removed = SD.remove(fullPath);
+        // A log's index sidecar goes with it
+        char indexPath[72];
+        if (removed && logIndexPath(fullPath, indexPath, sizeof(indexPath)) && SD.exists(indexPath)) {
+            SD.remove(indexPath);
+        }
+    }
+    if (!exists) {
+        snprintf(response, sizeof(response), "ERROR:FILE_NOT_FOUND:%s", filename);
+        sendFileResponse(response);
         return;
     }
     
-    if (SD.remove(fullPath.c_str())) {
-        sendFileResponse("DELETED:" + filename);
-        debugPrintf("🗑️ Deleted: %s\n", filename.c_str());
+    if (removed) {
+        snprintf(response, sizeof(response), "DELETED:%s", filename);
+        sendFileResponse(response);
+        debugPrintf("🗑️ Deleted: %s\n", filename);
     } else {
-        sendFileResponse("ERROR:DELETE_FAILED:" + filename);
-        debugPrintf("❌ Failed to delete: %s\n", filename.c_str());
+        snprintf(response, sizeof(response), "ERROR:DELETE_FAILED:%s", filename);
+        sendFileResponse(response);
+        debugPrintf("❌ Failed to delete: %s\n", filename);
     }
     
     uiManager.requestUpdate();
@@ -757,11 +2028,14 @@ void deleteFile(String filename) {
 void cancelFileTransfer() {
     if (fileTransfer.active) {
         if (fileTransfer.transferFile) {
+            SPIBusLease lease(spiArbiter, SPI_DEVICE_SD, SPI_SD_DEADLINE_US);
             fileTransfer.transferFile.close();
         }
         fileTransfer.active = false;
-        sendFileResponse("CANCELLED:" + fileTransfer.filename);
-        debugPrintf("⏹️ Transfer cancelled: %s\n", fileTransfer.filename.c_str());
+        char response[80];
+        snprintf(response, sizeof(response), "CANCELLED:%s", fileTransfer.filename);
+        sendFileResponse(response);
+        debugPrintf("⏹️ Transfer cancelled: %s\n", fileTransfer.filename);
         
         fileTransfer.progressPercent = 0.0f;
         fileTransfer.estimatedTimeRemaining = 0;
@@ -769,6 +2043,136 @@ void cancelFileTransfer() {
     }
 }
 
+static uint32_t crcBenchClock() {
+    return micros();
+}
+
+// Throughput of every CRC16 backend on this chip, cross-checked against the
+// bitwise reference; the fastest correct one becomes the default
+// Format: CRC:name,MBps,ok;...;selected
+void runCrcBenchmark() {
+    const size_t length = 4096;
+    uint8_t* buffer = (uint8_t*)malloc(length);
+    if (!buffer) {
+        sendFileResponse("ERROR:CRC_BENCH:NO_MEMORY");
+        return;
+    }
+    for (size_t i = 0; i < length; i++) buffer[i] = esp_random();
+    
+    char response[256];
+    int len = snprintf(response, sizeof(response), "CRC:");
+    Crc16Backend fastest = crc16Backend();
+    float fastestRate = 0.0f;
+    for (uint8_t b = 0; b < CRC16_BACKEND_COUNT && len < (int)sizeof(response); b++) {
+        Crc16Backend backend = (Crc16Backend)b;
+        if (!crc16BackendAvailable(backend)) continue;
+        Crc16BenchResult result = crc16Benchmark(backend, buffer, length, 32, crcBenchClock);
+        len += snprintf(response + len, sizeof(response) - len, "%s,%.1f,%d;",
+                        crc16BackendName(backend), result.megabytesPerSecond, result.matchesReference);
+        debugPrintf("🧮 CRC16 %-7s %6.1f MB/s %s\n", crc16BackendName(backend),
+                    result.megabytesPerSecond, result.matchesReference ? "ok" : "MISMATCH");
+        if (result.matchesReference && result.megabytesPerSecond > fastestRate) {
+            fastest = backend;
+            fastestRate = result.megabytesPerSecond;
+        }
+    }
+    free(buffer);
+    
+    crc16SetBackend(fastest);
+    if (len < (int)sizeof(response)) {
+        snprintf(response + len, sizeof(response) - len, "%s", crc16BackendName(fastest));
+    }
+    sendFileResponse(response);
+}
+
+// Sensor conversion as it was before fixed_point.h - double literals, soft
+// double math on the S3. Kept only as the CONVERT_BENCH baseline.
+static void convertIMUFrameDouble(const uint8_t* frame, IMUData& out, GPSPacket& packet) {
+    out.accelX = (int16_t)((frame[0] << 8) | frame[1]) / 16384.0 - imuData.accelOffsetX;
+    out.accelY = (int16_t)((frame[2] << 8) | frame[3]) / 16384.0 - imuData.accelOffsetY;
+    out.accelZ = (int16_t)((frame[4] << 8) | frame[5]) / 16384.0 - imuData.accelOffsetZ;
+    out.temperature = ((int16_t)((frame[6] << 8) | frame[7]) / 340.0) + 36.53;
+    out.gyroX = (int16_t)((frame[8] << 8) | frame[9]) / 131.0 - imuData.gyroOffsetX;
+    out.gyroY = (int16_t)((frame[10] << 8) | frame[11]) / 131.0 - imuData.gyroOffsetY;
+    out.gyroZ = (int16_t)((frame[12] << 8) | frame[13]) / 131.0 - imuData.gyroOffsetZ;
+    packet.accel_x = (int16_t)(out.accelX * 1000);
+    packet.accel_y = (int16_t)(out.accelY * 1000);
+    packet.accel_z = (int16_t)(out.accelZ * 1000);
+    packet.gyro_x = (int16_t)(out.gyroX * 100);
+    packet.gyro_y = (int16_t)(out.gyroY * 100);
+}
+
+static void convertPvtDouble(const UbxNavPvt& pvt, float* out) {
+    out[0] = pvt.lat / 1e7;
+    out[1] = pvt.lon / 1e7;
+    out[2] = pvt.gSpeed * 0.0036;
+    out[3] = pvt.headMot / 100000.0;
+}
+
+// CPU cycles per sample, double baseline against the fixed-point path:
+// CONV:imu,<before>,<after>;pvt,<before>,<after>
+void runConvertBenchmark() {
+    const int samples = 256;
+    static uint8_t frames[samples * IMU_FIFO_FRAME_SIZE];
+    for (size_t i = 0; i < sizeof(frames); i++) frames[i] = esp_random();
+    static UbxNavPvt pvts[16];
+    for (int i = 0; i < 16; i++) {
+        pvts[i].lat = (int32_t)esp_random() % 900000000;
+        pvts[i].lon = (int32_t)esp_random() % 1800000000;
+        pvts[i].gSpeed = esp_random() % 60000;
+        pvts[i].headMot = esp_random() % 36000000;
+    }
+    
+    static IMUData doubleOut;
+    static IMUSample fixedOut;
+    static GPSPacket packet;
+    static volatile float sink[4];
+    static GPSData data;
+    
+    uint32_t start = ESP.getCycleCount();
+    for (int i = 0; i < samples; i++) {
+        convertIMUFrameDouble(&frames[i * IMU_FIFO_FRAME_SIZE], doubleOut, packet);
+    }
+    uint32_t imuBefore = (ESP.getCycleCount() - start) / samples;
+    
+    start = ESP.getCycleCount();
+    for (int i = 0; i < samples; i++) {
+        convertIMUFrame(&frames[i * IMU_FIFO_FRAME_SIZE], fixedOut);
+        packet.accel_x = fixedCast<AccelMilliG>(fixedOut.accelX).count;
+        packet.accel_y = fixedCast<AccelMilliG>(fixedOut.accelY).count;
+        packet.accel_z = fixedCast<AccelMilliG>(fixedOut.accelZ).count;
+        packet.gyro_x = fixedCast<GyroCentiDps>(fixedOut.gyroX).count;
+        packet.gyro_y = fixedCast<GyroCentiDps>(fixedOut.gyroY).count;
+    }
+    uint32_t imuAfter = (ESP.getCycleCount() - start) / samples;
+    
+    float values[4];
+    start = ESP.getCycleCount();
+    for (int i = 0; i < samples; i++) {
+        convertPvtDouble(pvts[i & 15], values);
+        sink[i & 3] = values[i & 3];
+    }
+    uint32_t pvtBefore = (ESP.getCycleCount() - start) / samples;
+    
+    start = ESP.getCycleCount();
+    for (int i = 0; i < samples; i++) {
+        const UbxNavPvt& pvt = pvts[i & 15];
+        data.latitude = DegreesE7(pvt.lat);
+        data.longitude = DegreesE7(pvt.lon);
+        data.speed = SpeedKmh(pvt.gSpeed).toFloat();
+        data.heading = DegreesE5(pvt.headMot).toFloat();
+        sink[i & 3] = data.speed;
+    }
+    uint32_t pvtAfter = (ESP.getCycleCount() - start) / samples;
+    
+    char response[96];
+    snprintf(response, sizeof(response), "CONV:imu,%lu,%lu;pvt,%lu,%lu",
+             imuBefore, imuAfter, pvtBefore, pvtAfter);
+    debugPrintf("🧮 Sensor conversion cycles/sample: IMU %lu -> %lu, PVT %lu -> %lu\n",
+                imuBefore, imuAfter, pvtBefore, pvtAfter);
+    sendFileResponse(response);
+}
+
 // MINIMAL DEFERRED PROCESSING - Called from main loop (safe stack context)
 void processDeferredFileOperations() {
     // Process one operation per loop iteration to prevent blocking
@@ -778,18 +2182,27 @@ void processDeferredFileOperations() {
         listSDFiles();
     } else if (pendingStartTransfer) {
         pendingStartTransfer = false;
-        debugPrintf("🔄 Processing deferred START_TRANSFER: %s\n", pendingFilename.c_str());
-        startFileTransfer(pendingFilename);
-        pendingFilename = "";
+        debugPrintf("🔄 Processing deferred START_TRANSFER: %s\n", pendingFilename);
+        startFileTransfer(pendingFilename, pendingRanged, pendingRangeFromMicros, pendingRangeToMicros);
+        pendingRanged = false;
+        pendingFilename[0] = '\0';
     } else if (pendingDeleteFile) {
         pendingDeleteFile = false;
-        debugPrintf("🔄 Processing deferred DELETE_FILE: %s\n", pendingFilename.c_str());
+        debugPrintf("🔄 Processing deferred DELETE_FILE: %s\n", pendingFilename);
         deleteFile(pendingFilename);
-        pendingFilename = "";
+        pendingFilename[0] = '\0';
     } else if (pendingCancelTransfer) {
         pendingCancelTransfer = false;
         debugPrintln("🔄 Processing deferred CANCEL_TRANSFER");
         cancelFileTransfer();
+    } else if (pendingCrcBenchmark) {
+        pendingCrcBenchmark = false;
+        debugPrintln("🔄 Processing deferred CRC_BENCH");
+        runCrcBenchmark();
+    } else if (pendingConvertBenchmark) {
+        pendingConvertBenchmark = false;
+        debugPrintln("🔄 Processing deferred CONVERT_BENCH");
+        runConvertBenchmark();
     }
 }
 //=========================================part4
@@ -797,6 +2210,7 @@ void processDeferredFileOperations() {
 // MINIMAL BLE Callbacks - ZERO file system operations to prevent stack overflow
 class EnhancedConfigCallbacks : public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic* pCharacteristic) {
+        StallScope stall(stallMonitor, stallBleConfig);
         std::string stdValue = pCharacteristic->getValue();
         String value = String(stdValue.c_str());
         
@@ -806,7 +2220,7 @@ class EnhancedConfigCallbacks : public BLECharacteristicCallbacks {
         
         // Handle simple operations immediately (NO file system access)
         if (value == "START_LOG") {
-            if (systemData.sdCardAvailable && myGNSS.getFixType() >= 2) {
+            if (systemData.sdCardAvailable && gpsData.fixType >= 2) {
                 systemData.loggingActive = true;
                 // Note: createLogFile() will be called from main loop during next GPS packet
                 uiManager.requestUpdate();
@@ -814,7 +2228,6 @@ class EnhancedConfigCallbacks : public BLECharacteristicCallbacks {
             }
         } else if (value == "STOP_LOG") {
             systemData.loggingActive = false;
-            if (logFile) logFile.close();
             uiManager.requestUpdate();
             debugPrintln("⚪ Logging stopped via BLE");
         } 
@@ -823,16 +2236,66 @@ class EnhancedConfigCallbacks : public BLECharacteristicCallbacks {
             pendingListFiles = true;
             debugPrintln("📝 Queued LIST_FILES for deferred processing");
         } else if (value.startsWith("DOWNLOAD:")) {
-            pendingFilename = value.substring(9);
+            strlcpy(pendingFilename, value.c_str() + 9, sizeof(pendingFilename));
+            pendingRanged = false;
             pendingStartTransfer = true;
-            debugPrintf("📝 Queued START_TRANSFER for: %s\n", pendingFilename.c_str());
+            debugPrintf("📝 Queued START_TRANSFER for: %s\n", pendingFilename);
         } else if (value.startsWith("DELETE:")) {
-            pendingFilename = value.substring(7);
+            strlcpy(pendingFilename, value.c_str() + 7, sizeof(pendingFilename));
             pendingDeleteFile = true;
-            debugPrintf("📝 Queued DELETE_FILE for: %s\n", pendingFilename.c_str());
+            debugPrintf("📝 Queued DELETE_FILE for: %s\n", pendingFilename);
         } else if (value == "CANCEL_TRANSFER") {
             pendingCancelTransfer = true;
             debugPrintln("📝 Queued CANCEL_TRANSFER");
+        } else if (value == "CALIBRATE_IMU") {
+            // Runs on the main loop from the live sample stream
+            pendingIMUCalibration = true;
+            debugPrintln("📝 Queued IMU calibration");
+        } else if (value.startsWith("SET_STALL_BUDGET:")) {
+            // SET_STALL_BUDGET:<section>:<microseconds>
+            int split = value.lastIndexOf(':');
+            String name = value.substring(17, split);
+            int8_t id = stallMonitor.findSection(name.c_str());
+            if (id >= 0 && split > 17) {
+                stallMonitor.setBudget(id, value.substring(split + 1).toInt());
+                debugPrintf("📝 Stall budget %s = %lu us\n", name.c_str(),
+                            stallMonitor.section(id).budgetMicros);
+            }
+        } else if (value.startsWith("SET_ENCODING:")) {
+            // SET_ENCODING:<LOG|NET>:<RAW|DELTA> - LOG applies from the next log file
+            bool toLog = value.startsWith("SET_ENCODING:LOG:");
+            bool toNet = value.startsWith("SET_ENCODING:NET:");
+            String mode = value.substring(17);
+            if ((toLog || toNet) && (mode == "RAW" || mode == "DELTA")) {
+                RecordEncoding encoding = mode == "DELTA" ? RECORD_ENCODING_DELTA : RECORD_ENCODING_RAW;
+                if (toLog) {
+                    logEncoding = encoding;
+                } else {
+                    netStream.reset();
+                    netEncoding = encoding;
+                }
+                debugPrintf("📝 %s encoding: %s\n", toLog ? "Log" : "Telemetry", mode.c_str());
+            }
+        } else if (value.startsWith("SET_UDP_BATCH:")) {
+            // SET_UDP_BATCH:<records>:<latency ms> - applies to the next frame
+            int split = value.lastIndexOf(':');
+            int records = value.substring(14, split).toInt();
+            int latencyMs = value.substring(split + 1).toInt();
+            if (split > 14 && records >= 1 && records <= TELEMETRY_MAX_RECORDS && latencyMs >= 0) {
+                telemetryBatcher.configure(records, latencyMs * 1000UL);
+                debugPrintf("📝 UDP batch: %d records, %d ms\n", records, latencyMs);
+            }
+        } else if (value == "SET_USB_STREAM:ON" || value == "SET_USB_STREAM:OFF") {
+            // Applied by the USB stream task
+            usbStreamRequest = value.endsWith("ON") ? 1 : 0;
+            debugPrintf("📝 USB stream %s queued\n", usbStreamRequest ? "on" : "off");
+        } else if (value.startsWith("SET_LOG_FILE:")) {
+            // SET_LOG_FILE:<seconds> - preallocated log length, 0 to grow files as written
+            long seconds = value.substring(13).toInt();
+            if (seconds >= 0 && seconds <= LOG_FILE_MAX_SECONDS) {
+                logFileSeconds = seconds;
+                debugPrintf("📝 Log files: %lu s, %lu bytes preallocated\n", logFileSeconds, logFileBytes());
+            }
         } else if (value.startsWith("SET_MTU:")) {
             uint16_t mtu = value.substring(8).toInt();
             if (mtu >= 23 && mtu <= 512) {
@@ -847,41 +2310,225 @@ class EnhancedConfigCallbacks : public BLECharacteristicCallbacks {
 
 class EnhancedFileTransferCallbacks : public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic* pCharacteristic) {
+        StallScope stall(stallMonitor, stallBleTransfer);
         std::string stdValue = pCharacteristic->getValue();
         String value = String(stdValue.c_str());
         
         debugPrintf("📤 File transfer command: %s\n", value.c_str());
         
-        // DEFER all file operations with simple flags - NO file system access in callback
+        // DEFER all file operations with simple flags - NO file system access in callback.
+        // Queries (SCHED onwards) read memory only and are answered immediately.
         if (value == "LIST") {
             pendingListFiles = true;
             debugPrintln("📤 Queued LIST for deferred processing");
         } else if (value.startsWith("GET:")) {
-            pendingFilename = value.substring(4);
+            strlcpy(pendingFilename, value.c_str() + 4, sizeof(pendingFilename));
+            pendingRanged = false;
             pendingStartTransfer = true;
-            debugPrintf("📤 Queued GET for: %s\n", pendingFilename.c_str());
+            debugPrintf("📤 Queued GET for: %s\n", pendingFilename);
+        } else if (value.startsWith("GET_RANGE:")) {
+            // GET_RANGE:filename,fromUtcSeconds,toUtcSeconds - the blocks of a
+            // V2 log covering that time, found through its .idx sidecar
+            const char* args = value.c_str() + 10;
+            const char* to = strrchr(args, ',');
+            const char* from = strchr(args, ',');
+            if (from && from < to && (size_t)(from - args) < sizeof(pendingFilename)) {
+                strlcpy(pendingFilename, args, from - args + 1);
+                pendingRangeFromMicros = strtoll(from + 1, nullptr, 10) * 1000000LL;
+                pendingRangeToMicros = strtoll(to + 1, nullptr, 10) * 1000000LL;
+                pendingRanged = true;
+                pendingStartTransfer = true;
+                debugPrintf("📤 Queued GET_RANGE for: %s\n", pendingFilename);
+            }
         } else if (value.startsWith("DEL:")) {
-            pendingFilename = value.substring(4);
+            strlcpy(pendingFilename, value.c_str() + 4, sizeof(pendingFilename));
             pendingDeleteFile = true;
-            debugPrintf("📤 Queued DEL for: %s\n", pendingFilename.c_str());
+            debugPrintf("📤 Queued DEL for: %s\n", pendingFilename);
         } else if (value == "STOP" || value == "CANCEL") {
             pendingCancelTransfer = true;
             debugPrintln("📤 Queued CANCEL");
+        } else if (value == "CRC_BENCH") {
+            // Seconds of CPU time - runs on the main loop, result arrives as CRC:...
+            pendingCrcBenchmark = true;
+            debugPrintln("📤 Queued CRC_BENCH");
+        } else if (value == "CONVERT_BENCH") {
+            // Result arrives as CONV:...
+            pendingConvertBenchmark = true;
+            debugPrintln("📤 Queued CONVERT_BENCH");
+        } else if (value == "SCHED") {
+            // Scheduler counters
+            // Format: SCHED:name,runs,maxJitterUs,maxDurationUs,overruns,misses;...
+            char response[512];
+            int len = snprintf(response, sizeof(response), "SCHED:");
+            for (uint8_t i = 0; i < scheduler.taskCount() && len < (int)sizeof(response); i++) {
+                const SchedulerTask& t = scheduler.task(i);
+                len += snprintf(response + len, sizeof(response) - len, "%s,%lu,%lu,%lu,%lu,%lu;",
+                                t.name, t.runs, t.maxJitterMicros, t.maxDurationMicros,
+                                t.overruns, t.deadlineMisses);
+            }
+            
+            sendQueryResponse(response);
+        } else if (value == "STALLS") {
+            // Last stalls, newest first
+            // Format: STALLS:total;section,kind,durationUs,atMs;...
+            char response[512];
+            int len = snprintf(response, sizeof(response), "STALLS:%lu;", stallMonitor.totalStalls());
+            StallRecord record;
+            for (uint8_t i = 0; stallMonitor.getRecord(i, record) && len < (int)sizeof(response); i++) {
+                len += snprintf(response + len, sizeof(response) - len, "%s,%s,%lu,%lu;",
+                                stallMonitor.section(record.section).name,
+                                StallMonitor::kindName(record.kind),
+                                record.durationMicros, record.atMs);
+            }
+            
+            sendQueryResponse(response);
+        } else if (value == "STREAM") {
+            // Record stream encoders
+            // Format: STREAM:sink,encoding,records,bytes,keyframes,encodeNsPerRecord;...
+            char response[160];
+            int len = snprintf(response, sizeof(response), "STREAM:");
+            const RecordStreamEncoder* encoders[] = {&logStream, &netStream};
+            const RecordEncoding encodings[] = {logEncoding, netEncoding};
+            const int64_t encodeMicros[] = {logStreamEncodeMicros, netStreamEncodeMicros};
+            for (uint8_t i = 0; i < 2 && len < (int)sizeof(response); i++) {
+                uint32_t records = encoders[i]->records();
+                len += snprintf(response + len, sizeof(response) - len, "%s,%s,%lu,%lu,%lu,%lu;",
+                                i ? "net" : "log",
+                                encodings[i] == RECORD_ENCODING_DELTA ? "delta" : "raw",
+                                records, encoders[i]->bytes(), encoders[i]->keyframes(),
+                                records ? (uint32_t)(encodeMicros[i] * 1000 / records) : 0);
+            }
+            
+            sendQueryResponse(response);
+        } else if (value == "UDP") {
+            // UDP telemetry frames
+            // Format: UDP:frames,records,sent,errors,offline,queueOverflows,queueHighWater,batch,latencyMs
+            char response[128];
+            snprintf(response, sizeof(response), "UDP:%lu,%lu,%lu,%lu,%lu,%lu,%lu,%u,%lu",
+                     telemetryBatcher.frames(), telemetryBatcher.records(),
+                     udpFramesSent, udpSendErrors, udpFramesOffline,
+                     udpFrameRing.overflowCount(), udpFrameRing.highWaterMark(),
+                     telemetryBatcher.maxRecords(), telemetryBatcher.latencyBudgetMicros() / 1000);
+            
+            sendQueryResponse(response);
+        } else if (value == "HEAP") {
+            // Heap and allocation counters
+            // Format: HEAP:free,largest,minFree,frag%;start:free,largest,frag%;end:free,largest,frag%;
+            //         allocs:total,loop,steady;job,allocs,steady;...
+            HeapSnapshot now = heapSnapshot();
+            char response[512];
+            int len = snprintf(response, sizeof(response),
+                               "HEAP:%lu,%lu,%lu,%u;start:%lu,%lu,%u;end:%lu,%lu,%u;allocs:%lu,%lu,%lu",
+                               now.freeBytes, now.largestBlock, now.minimumFree, now.fragmentationPct,
+                               heapSessionStart.freeBytes, heapSessionStart.largestBlock,
+                               heapSessionStart.fragmentationPct,
+                               heapSessionEnd.freeBytes, heapSessionEnd.largestBlock,
+                               heapSessionEnd.fragmentationPct,
+                               allocCounterTotal(), allocCounterWatched(), steadyAllocations);
+            if (!allocCounterActive() && len < (int)sizeof(response)) {
+                len += snprintf(response + len, sizeof(response) - len, ",uncounted");
+            }
+            for (uint8_t i = 0; i < scheduler.taskCount() && len < (int)sizeof(response); i++) {
+                if (jobAllocations[i] == 0) continue;
+                len += snprintf(response + len, sizeof(response) - len, ";%s,%lu,%lu",
+                                scheduler.task(i).name, jobAllocations[i], steadyAllocationsOfJob[i]);
+            }
+            
+            sendQueryResponse(response);
+        } else if (value == "SD") {
+            // SD writer
+            // Format: SD:open,capacity,pending,highWater,queued,written,writes,syncs,
+            //         lastWriteUs,maxWriteUs,stalls,writeErrors,overflows,dropped,
+            //         files,preallocated,openErrors,sidecarErrors,sidecarOverflows
+            SdWriterStats sd = sdWriter.stats();
+            char response[240];
+            snprintf(response, sizeof(response),
+                     "SD:%d,%lu,%lu,%lu,%llu,%llu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+                     sdWriter.isOpen(), sd.capacity, sd.pending, sd.highWater,
+                     sd.bytesQueued, sd.bytesWritten, sd.writes, sd.syncs,
+                     sd.lastWriteMicros, sd.maxWriteMicros, sd.stalls, sd.writeErrors,
+                     sd.overflows, sd.bytesDropped, sd.files, sd.preallocated, sd.openErrors,
+                     sd.sidecarErrors, sd.sidecarOverflows);
+            
+            sendQueryResponse(response);
+        } else if (value == "SD_HIST") {
+            // SD write latency, log2 ms buckets (<1, 1, 2-3, 4-7 ... >=512 ms),
+            // for files grown as written and preallocated ones
+            // Format: SD_HIST:seconds;grown:n,n,...;prealloc:n,n,...
+            char response[256];
+            int len = snprintf(response, sizeof(response), "SD_HIST:%lu", logFileSeconds);
+            for (uint8_t set = 0; set < 2; set++) {
+                const uint32_t* counts = sdWriter.latencyHistogram(set == 1);
+                len += snprintf(response + len, sizeof(response) - len, ";%s:", set ? "prealloc" : "grown");
+                for (uint8_t i = 0; i < SD_LATENCY_BUCKETS && len < (int)sizeof(response); i++) {
+                    len += snprintf(response + len, sizeof(response) - len, i ? ",%lu" : "%lu", counts[i]);
+                }
+            }
+            
+            sendQueryResponse(response);
+        } else if (value == "RECOVERY") {
+            // Log file left open by the last session, finished at boot
+            // Format: RECOVERY:status,file,originalBytes,finalBytes,blocks,lostBytes,reads,us,
+            //         indexEntries,indexRebuilt
+            // status: 0 none, 1 was finished, 2 recovered, 3 not a V2 log, 4 failed
+            char response[176];
+            snprintf(response, sizeof(response), "RECOVERY:%u,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+                     logRecovery.status, logRecoveryFile, logRecovery.originalBytes,
+                     logRecovery.finalBytes, logRecovery.blocks, logRecovery.lostBytes,
+                     logRecovery.blockReads, logRecovery.micros,
+                     logRecovery.indexEntries, logRecovery.indexAdded);
+            
+            sendQueryResponse(response);
+        } else if (value == "USB") {
+            // USB binary stream
+            // Format: USB:enabled,frames,bytes,shortWrites,imuOverflows,gpsOverflows
+            char response[96];
+            snprintf(response, sizeof(response), "USB:%d,%lu,%lu,%lu,%lu,%lu",
+                     usbStreamEnabled, usbFramer.frames(), usbStreamBytes, usbStreamShortWrites,
+                     imuUsbRing.overflowCount(), gpsUsbRing.overflowCount());
+            
+            sendQueryResponse(response);
+        } else if (value == "NAV") {
+            // Navigation rate governor
+            // Format: NAV:mode,rateHz,changes,stillMs,acks,naks
+            char response[96];
+            snprintf(response, sizeof(response), "NAV:%s,%u,%lu,%lu,%lu,%lu",
+                     NavRateGovernor::modeName(navGovernor.mode()),
+                     1000 / navModeMeasMs[navGovernor.mode()], navGovernor.changes(),
+                     navGovernor.stillForMs(millis()), navConfigAcks, navConfigNaks);
+            
+            sendQueryResponse(response);
+        } else if (value == "BUS") {
+            // I2C bus usage per device
+            // Format: BUS:device,transactions,errors,busMicros,maxBusMicros,maxWaitMicros;...
+            char response[384];
+            int len = snprintf(response, sizeof(response), "BUS:");
+            for (uint8_t d = 0; d < I2C_DEVICE_COUNT && len < (int)sizeof(response); d++) {
+                const I2CDeviceStats& bus = i2cBus.stats((I2CDevice)d);
+                len += snprintf(response + len, sizeof(response) - len, "%s,%lu,%lu,%llu,%lu,%lu;",
+                                I2CBus::deviceName((I2CDevice)d), bus.transactions, bus.errors,
+                                bus.busMicros, bus.maxBusMicros, bus.maxWaitMicros);
+            }
+            // SPI devices use the same columns, busMicros being time held
+            for (uint8_t d = 0; d < SPI_DEVICE_COUNT && len < (int)sizeof(response); d++) {
+                const SPIDeviceStats& bus = spiArbiter.stats((SPIDevice)d);
+                len += snprintf(response + len, sizeof(response) - len, "%s,%lu,%lu,%llu,%lu,%lu;",
+                                SPIArbiter::deviceName((SPIDevice)d), bus.grants, bus.deadlineMisses,
+                                bus.holdMicros, bus.maxHoldMicros, bus.maxWaitMicros);
+            }
+            
+            sendQueryResponse(response);
         } else if (value == "STATUS") {
             // STATUS is safe - no file system access, just memory reads
-            String status = "STATUS:";
+            char status[96];
             if (fileTransfer.active) {
-                status += "ACTIVE:" + fileTransfer.filename + ":" + 
-                         String((int)fileTransfer.progressPercent);
+                snprintf(status, sizeof(status), "STATUS:ACTIVE:%s:%d",
+                         fileTransfer.filename, (int)fileTransfer.progressPercent);
             } else {
-                status += "IDLE";
+                snprintf(status, sizeof(status), "STATUS:IDLE");
             }
             
-            // Send response immediately - no file system access
-            if (fileTransferChar) {
-                fileTransferChar->setValue(status.c_str());
-                fileTransferChar->notify();
-            }
+            sendQueryResponse(status);
         }
         // Callback returns immediately - ZERO file system operations!
     }
@@ -932,114 +2579,85 @@ class EnhancedServerCallbacks : public BLEServerCallbacks {
     }
 };
 //=========================================part5
-void setup() {
-    Serial.begin(115200);
-    delay(3000);
-    Serial.println("🚀 T-Display-S3-Pro GPS Logger v5.1 Starting...");
-    
-    // Initialize display first
-    pinMode(TFT_POWER, OUTPUT);
-    digitalWrite(TFT_POWER, HIGH);
-    pinMode(BOARD_TFT_BL, OUTPUT);
-    digitalWrite(BOARD_TFT_BL, HIGH);
-    
-    initDisplay();
-    
-    // LVGL Splash Label - Booting
-    lv_obj_t* splashLabel = lv_label_create(lv_scr_act());
-    lv_label_set_text(splashLabel, "Booting...\nInitializing Display");
-    lv_obj_align(splashLabel, LV_ALIGN_CENTER, 0, 0);
-    lv_timer_handler();
-    delay(1000);
-    
-    // LVGL Splash Label - I2C
-    lv_label_set_text(splashLabel, "Initializing I2C Bus");
-    lv_timer_handler();
-    delay(500);
-
-    // Initialize I2C bus
-    Wire.begin(BOARD_I2C_SDA, BOARD_I2C_SCL);
-    debugPrintf("🔍 I2C on SDA:%d, SCL:%d\n", BOARD_I2C_SDA, BOARD_I2C_SCL);
-
-    // LVGL Splash Label - Touch
-    lv_label_set_text(splashLabel, "Initializing Touch");
-    lv_timer_handler();
-
-    // Initialize peripherals
-    initTouch();
-
-    // LVGL Splash Label - IMU
-    lv_label_set_text(splashLabel, "Initializing IMU");
-    lv_timer_handler();
-
-systemData.mpuAvailable = initMPU6050();
+// Boot stages - each runs in its own task, see startBootSequence()
+bool bootTouch() {
+    return initTouch();
+}
 
-// Auto-calibrate IMU every boot
-    if (systemData.mpuAvailable) {
-    lv_label_set_text(splashLabel, "Calibrating IMU");
-    lv_timer_handler();
+bool bootIMU() {
+    systemData.mpuAvailable = initMPU6050();
     
-    calibrateAccelerometer();
-}    
-    // LVGL Splash Label - PMU
-    lv_label_set_text(splashLabel, "Initializing PMU");
-    lv_timer_handler();
+    // Saved offsets apply immediately; only a first boot captures new ones,
+    // from the sample stream once acquisition is running
+    if (systemData.mpuAvailable) {
+        if (!loadIMUCalibration()) {
+            debugPrintln("🔧 No stored IMU calibration - capturing from the first 2 s of data");
+            imuData.isCalibrated = true;
+            pendingIMUCalibration = true;
+        }
+        initIMUFifo();
+        uiManager.requestUpdate();
+    }
+    return systemData.mpuAvailable;
+}
 
-    systemData.pmuAvailable = initPMU();
+bool bootPMU() {
+    return initPMU();
+}
 
-    // LVGL Splash Label - SD Card
-    lv_label_set_text(splashLabel, "Initializing SD Card");
-    lv_timer_handler();
+bool bootSD() {
+    bool available = initSDCard();
+    if (available) recoverUnfinishedLog();
+    systemData.sdCardAvailable = available;
+    uiManager.requestUpdate();
+    return systemData.sdCardAvailable;
+}
 
-    systemData.sdCardAvailable = initSDCard();
-    
-    // LVGL Splash Label - GNSS
-    lv_label_set_text(splashLabel, "Starting GNSS");
-    lv_timer_handler();
+bool beginGNSSAt(uint32_t baud) {
+    GNSS_Serial.end();
+    GNSS_Serial.setRxBufferSize(GNSS_RX_BUFFER_SIZE);
+    GNSS_Serial.begin(baud, SERIAL_8N1, GNSS_RX, GNSS_TX);
+    return myGNSS.begin(GNSS_Serial);
+}
 
-    // Initialize GNSS
+bool bootGNSS() {
     debugPrintln("🛰️ Starting GNSS...");
-    GNSS_Serial.begin(921600, SERIAL_8N1, GNSS_RX, GNSS_TX);
-    if (!myGNSS.begin(GNSS_Serial)) {
-        GNSS_Serial.end();
-        delay(100);
-        GNSS_Serial.begin(115200, SERIAL_8N1, GNSS_RX, GNSS_TX);
-        delay(100);
-        if (!myGNSS.begin(GNSS_Serial)) {
-            debugPrintln("❌ GNSS not detected!");
-        } else {
-            configureGNSS();
+    
+    // Own handle - other boot stages use NVS concurrently
+    Preferences gnssPrefs;
+    gnssPrefs.begin(GNSS_PREFS_NAMESPACE, false);
+    
+    // Last working baud first, then the rates the receiver is known to use
+    uint32_t cachedBaud = gnssPrefs.getULong("baud", GNSS_DEFAULT_BAUD);
+    const uint32_t candidates[] = {cachedBaud, 921600, 115200};
+    for (uint8_t i = 0; i < 3 && gnssBaud == 0; i++) {
+        if (i > 0 && candidates[i] == cachedBaud) continue;
+        if (beginGNSSAt(candidates[i])) {
+            gnssBaud = candidates[i];
         }
-    } else {
-        configureGNSS();
     }
-if (wifiUDPEnabled){    
-    // LVGL Splash Label - WiFi
-    lv_label_set_text(splashLabel, "Connecting WiFi");
-    lv_timer_handler();
-
-    // Initialize WiFi
-    debugPrintln("📡 Connecting to WiFi...");
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid, password);
     
-    unsigned long wifiStart = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - wifiStart < 20000) {
-        delay(1000);
-        debugPrint(".");
+    if (gnssBaud == 0) {
+        debugPrintln("❌ GNSS not detected!");
+        bootTimeline.gnssConfig = GNSS_CONFIG_FAILED;
+        gnssPrefs.end();
+        return false;
     }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        debugPrintln("\n✅ WiFi connected!");
-        debugPrintf("📍 IP: %s\n", WiFi.localIP().toString().c_str());
-    } else {
-        debugPrintln("\n❌ WiFi failed!");
+    if (gnssBaud != cachedBaud) {
+        gnssPrefs.putULong("baud", gnssBaud);
     }
-}    
-    // LVGL Splash Label - BLE
-    lv_label_set_text(splashLabel, "Starting BLE");
-    lv_timer_handler();
+    
+    gnssBootCount = gnssPrefs.getULong("boots", 0) + 1;
+    gnssPrefs.putULong("boots", gnssBootCount);
+    
+    bootTimeline.gnssBaud = gnssBaud;
+    bootTimeline.gnssConfig = configureGNSS(gnssPrefs);
+    gnssPrefs.end();
+    uiManager.requestUpdate();
+    return true;
+}
 
+bool bootBLE() {
     // Initialize BLE with minimal callbacks (no file system access)
     debugPrintln("🔵 Initializing BLE...");
     BLEDevice::init("ESP32_GPS_Logger");
@@ -1048,21 +2666,21 @@ if (wifiUDPEnabled){
     
     BLEService* pService = pServer->createService(telemetryServiceUUID);
     
-    telemetryChar = pService->createCharacteristic(telemetryCharUUID, BLECharacteristic::PROPERTY_NOTIFY);
+    BLECharacteristic* notifyChar = pService->createCharacteristic(telemetryCharUUID, BLECharacteristic::PROPERTY_NOTIFY);
     telemetryDescriptor = new BLE2902();
-    telemetryChar->addDescriptor(telemetryDescriptor);
+    notifyChar->addDescriptor(telemetryDescriptor);
     
     configChar = pService->createCharacteristic(configCharUUID, BLECharacteristic::PROPERTY_WRITE);
     configChar->setCallbacks(new EnhancedConfigCallbacks());
     
     // File transfer characteristic
-    fileTransferChar = pService->createCharacteristic(
+    BLECharacteristic* transferChar = pService->createCharacteristic(
         fileTransferCharUUID,
         BLECharacteristic::PROPERTY_READ | 
         BLECharacteristic::PROPERTY_WRITE | 
         BLECharacteristic::PROPERTY_NOTIFY
     );
-    fileTransferChar->setCallbacks(new EnhancedFileTransferCallbacks());
+    transferChar->setCallbacks(new EnhancedFileTransferCallbacks());
     
     pService->start();
     
@@ -1071,23 +2689,141 @@ if (wifiUDPEnabled){
     pAdvertising->setScanResponse(true);
     pAdvertising->start();
     
+    // Publish only once the service is up - the main loop checks these pointers
+    fileTransferChar = transferChar;
+    telemetryChar = notifyChar;
+    
     debugPrintln("✅ BLE with minimal deferred file transfer ready");
+    return true;
+}
+
+void udpSenderTask(void* parameter) {
+    static TelemetryFrame frame;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        while (udpFrameRing.pop(frame)) {
+            if (WiFi.status() != WL_CONNECTED) {
+                udpFramesOffline++;
+                continue;
+            }
+            StallScope stall(stallMonitor, stallUdp);
+            TelemetryBatcher::stampSent(frame, timeBase.toGnssMicros(esp_timer_get_time()));
+            udp.beginPacket(remoteIP, remotePort);
+            udp.write(frame.data, frame.length);
+            if (udp.endPacket()) {
+                udpFramesSent++;
+            } else {
+                udpSendErrors++;
+            }
+        }
+    }
+}
+
+bool bootWiFi() {
+    // Initialize WiFi
+    debugPrintln("📡 Connecting to WiFi...");
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(ssid, password);
     
-    // LVGL Splash Label - UI
-    lv_label_set_text(splashLabel, "Starting UI");
-    lv_timer_handler();
+    // Sends once WiFi is up, including after a later reconnect
+    telemetryBatcher.setDeviceId((uint32_t)ESP.getEfuseMac());
+    telemetryBatcher.configure(UDP_BATCH_RECORDS, UDP_BATCH_LATENCY_US);
+    xTaskCreatePinnedToCore(udpSenderTask, "udp", UDP_SENDER_STACK, nullptr,
+                            UDP_SENDER_PRIORITY, &udpSenderTaskHandle, 0);
+    
+    unsigned long wifiStart = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - wifiStart < 20000) {
+        delay(250);
+    }
+    
+    if (WiFi.status() == WL_CONNECTED) {
+        debugPrintln("✅ WiFi connected!");
+        debugPrintf("📍 IP: %s\n", WiFi.localIP().toString().c_str());
+        uiManager.requestUpdate();
+        return true;
+    }
+    debugPrintln("❌ WiFi failed!");
+    return false;
+}
+
+bool bootAcquisition() {
+    // Hand the GNSS receiver and IMU over to the acquisition task
+    startAcquisitionTask();
+    return true;
+}
+
+void startBootSequence() {
+    //                     stage                    name     function         depends on          stack
+    bootSequence.addStage(BOOT_STAGE_TOUCH,       "touch", bootTouch,       0,                  4096);
+    bootSequence.addStage(BOOT_STAGE_IMU,         "imu",   bootIMU,         0,                  4096);
+    bootSequence.addStage(BOOT_STAGE_PMU,         "pmu",   bootPMU,         0,                  4096);
+    bootSequence.addStage(BOOT_STAGE_SD,          "sd",    bootSD,          0,                  6144);
+    bootSequence.addStage(BOOT_STAGE_GNSS,        "gnss",  bootGNSS,        0,                  6144);
+    // Assist waits for acquisition: the UART parser delivers the MGA acknowledgements
+    bootSequence.addStage(BOOT_STAGE_GNSS_ASSIST, "assist", bootGNSSAssist,
+                          BootSequence::bit(BOOT_STAGE_GNSS) | BootSequence::bit(BOOT_STAGE_SD) |
+                          BootSequence::bit(BOOT_STAGE_ACQUISITION), 6144);
+    bootSequence.addStage(BOOT_STAGE_BLE,         "ble",   bootBLE,         0,                  8192);
+    bootSequence.addStage(BOOT_STAGE_WIFI,        "wifi",  bootWiFi,        0,                  4096);
+    bootSequence.addStage(BOOT_STAGE_ACQUISITION, "acq",   bootAcquisition, 
+                          BootSequence::bit(BOOT_STAGE_IMU) | BootSequence::bit(BOOT_STAGE_GNSS), 4096);
+    
+    if (!wifiUDPEnabled) {
+        bootSequence.skipStage(BOOT_STAGE_WIFI);
+    }
+    
+    bootSequence.update();
+}
+
+void setup() {
+    // setup() and loop() share the Arduino loop task
+    allocCounterWatch(xTaskGetCurrentTaskHandle());
+    Serial.begin(115200);
+    Serial.println("🚀 T-Display-S3-Pro GPS Logger v5.1 Starting...");
+    
+    // Initialize display first - the UI is live before anything else comes up
+    pinMode(TFT_POWER, OUTPUT);
+    digitalWrite(TFT_POWER, HIGH);
+    pinMode(BOARD_TFT_BL, OUTPUT);
+    digitalWrite(BOARD_TFT_BL, HIGH);
+    
+    initDisplay();
+
+    // Initialize I2C bus - every device goes through i2cBus from here on
+    Wire.begin(BOARD_I2C_SDA, BOARD_I2C_SCL);
+    if (!i2cBus.begin(Wire, I2C_BUS_CLOCK_HZ, I2C_BUS_TASK_CORE, I2C_BUS_TASK_PRIORITY)) {
+        debugPrintln("❌ I2C bus task failed to start");
+    }
+    debugPrintf("🔍 I2C on SDA:%d, SCL:%d at %lu Hz\n", BOARD_I2C_SDA, BOARD_I2C_SCL, 
+                (unsigned long)I2C_BUS_CLOCK_HZ);
 
     // Initialize UI Manager with all data references
     uiManager.init(&systemData, &gpsData, &imuData, &batteryData, &perfStats);
     uiManager.setFileTransferData(&fileTransfer);
+    uiManager.setScheduler(&scheduler);
+    uiManager.setStallMonitor(&stallMonitor);
+    uiManager.setBootTimeline(&bootTimeline);
     uiManager.setLoggingCallback(toggleLogging);
+    lv_timer_handler();
     
-    // Remove splash label after UI is ready
-    lv_obj_del(splashLabel);
-
     perfStats.lastResetTime = millis();
     systemData.displayOn = true;
     systemData.lastDisplayActivity = millis();
+    bootTimeline.uiReadyMs = millis();
+    debugPrintf("⏱️ UI live %lu ms after reset\n", bootTimeline.uiReadyMs);
+    
+    // Jobs and stall sections exist before any boot stage can use them
+    startScheduler();
+    startStallMonitor();
+    startUsbStreamTask();
+    sdWriter.configure(SD_SYNC_INTERVAL_MS, SD_STALL_US);
+    sdWriter.setFileHook(logFileHook);
+    if (!sdWriter.begin(SD, SD_FATFS_DRIVE, SD_RING_BYTES, SD_WRITE_BLOCK, SD_WRITER_PRIORITY, 0)) {
+        debugPrintln("❌ SD writer failed to start");
+    }
+    
+    // Peripherals, GNSS and radios come up concurrently from here
+    startBootSequence();
     
     debugPrintln("🎯 T-Display-S3-Pro GPS Logger Ready!");
     debugPrintln("🖱️ Touch interface with minimal deferred file transfer");
@@ -1096,148 +2832,152 @@ if (wifiUDPEnabled){
     debugPrintln("⚡ All file operations deferred to main loop for stack safety");
 }
 //=========================================part6
-void loop() {
-    static unsigned long lastPacketTime = 0;
-    static unsigned long lastDebugTime = 0;
-    static unsigned long lastWiFiCheck = 0;
-    static unsigned long lastPerfReset = 0;
+// Consumer of gpsTelemetryRing - UDP and BLE notifications
+// Hand a closed frame to the sender task; a full queue drops it, which the
+// receiver sees as a gap in the frame sequence
+void queueTelemetryFrame() {
+    static TelemetryFrame frame;
+    if (!telemetryBatcher.take(frame)) return;
+    udpFrameRing.push(frame);
+    xTaskNotifyGive(udpSenderTaskHandle);
+}
+
+void processTelemetry() {
+    GPSSample sample;
+    uint8_t frame[GPS_STREAM_MAX_FRAME];
+    bool udpActive = udpSenderTaskHandle && WiFi.status() == WL_CONNECTED;
+    while (gpsTelemetryRing.pop(sample)) {
+        // Batch for UDP
+        if (udpActive) {
+            telemetryBatcher.setDelta(netEncoding == RECORD_ENCODING_DELTA);
+            if (telemetryBatcher.add((uint8_t*)&sample.packet, sample.arrivalMicros, sample.gnssTimeMicros)) {
+                queueTelemetryFrame();
+            }
+        }
+        
+        // Send via BLE
+        if (telemetryChar && telemetryDescriptor->getNotifications()) {
+            uint8_t* data = (uint8_t*)&sample.packet;
+            size_t length = sizeof(GPSPacket);
+            if (netEncoding == RECORD_ENCODING_DELTA) {
+                int64_t start = esp_timer_get_time();
+                length = netStream.encode(data, frame);
+                netStreamEncodeMicros += esp_timer_get_time() - start;
+                data = frame;
+            }
+            telemetryChar->setValue(data, length);
+            telemetryChar->notify();
+        }
+    }
     
-    // Handle LVGL tasks - this is critical for UI responsiveness
-    lv_timer_handler();
-    uiManager.update();
+    // Latency budget - a partial frame goes out rather than waiting for more records
+    if (udpActive && telemetryBatcher.due(esp_timer_get_time())) {
+        queueTelemetryFrame();
+    }
+}
+
+// Hands the open log block to the SD writer. While logging, rolls over to a
+// new file if the next block and the summary would outgrow the preallocated
+// one; stopping passes rollOver false, since the room kept for the last
+// block and the summary is already there.
+void appendLogBlock(bool rollOver = true) {
+    uint16_t records = logBlocks.pendingRecords();
+    if (!logBlocks.take(logBlock)) return;
+    if (!sdWriter.append(logBlock, LOG_BLOCK_SIZE)) {
+        // Writer ring full - the next block takes this one's place in the file
+        logBlocks.untake();
+        perfStats.droppedPackets += records;
+    } else {
+        LogBlockHeader header;
+        LogIndexEntry entry;
+        memcpy(&header, logBlock, sizeof(header));
+        if (logIndexer.add(header.sequence - logBlocks.firstSequence(), header.firstMicros, entry)) {
+            sdWriter.appendSidecar((const uint8_t*)&entry, sizeof(entry));
+        }
+    }
+    if (rollOver && logFileCapacity > 0 && sdWriter.fileBytes() + 2 * LOG_BLOCK_SIZE > logFileCapacity) {
+        createLogFile();
+    }
+}
+
+// Consumer of gpsLogRing - SD logging. Records are packed into log blocks
+// for the SD writer's ring; only its task touches the card.
+void processLogging() {
+    if (!systemData.loggingActive || !systemData.sdCardAvailable) {
+        gpsLogRing.clear();
+        // Stopped from the UI or over BLE - the open block and the summary go out
+        // with the file. The close waits for a pass with room for both in the
+        // ring: a file closed without its summary loses its recovery marker too.
+        if (sdWriter.isOpen() && sdWriter.freeSpace() >= 2 * LOG_BLOCK_SIZE) {
+            appendLogBlock(false);
+            if (appendLogSummary()) sdWriter.close();
+        }
+        return;
+    }
     
-    // CRITICAL: Process deferred file operations (called in main loop - safe stack)
-    processDeferredFileOperations();
+    // A slow nav rate still gets its records to the card
+    if (sdWriter.isOpen() && logBlocks.due(esp_timer_get_time(), LOG_BLOCK_MAX_AGE_MS * 1000UL)) {
+        appendLogBlock();
+    }
     
-    // Process file transfers (ongoing transfers)
-    processFileTransfer();
+    if (gpsLogRing.empty()) return;
     
-    // Update file transfer UI more frequently during transfer
-    if (fileTransfer.active) {
-        static unsigned long lastTransferUIUpdate = 0;
-        if (millis() - lastTransferUIUpdate > 500) {
-            uiManager.requestUpdate();
-            lastTransferUIUpdate = millis();
+    // Create log file if needed (safe in main loop); samples wait in the ring until it is
+    if (!sdWriter.isOpen() && !createLogFile()) return;
+    
+    GPSSample sample;
+    while (gpsLogRing.pop(sample)) {
+        int64_t start = esp_timer_get_time();
+        bool full = logBlocks.add((uint8_t*)&sample.packet, sample.arrivalMicros, sample.gnssTimeMicros);
+        if (logFileEncoding == RECORD_ENCODING_DELTA) logStreamEncodeMicros += esp_timer_get_time() - start;
+        if (full) appendLogBlock();
+        
+        if (bootTimeline.firstRecordMs == 0) {
+            bootTimeline.firstRecordMs = millis();
+            debugPrintf("⏱️ First SD record %lu ms after reset\n", bootTimeline.firstRecordMs);
         }
     }
+}
+
+// Consumer of gpsUIRing and imuUIRing - display state and performance stats
+void processUIData() {
+    static int64_t lastPacketMicros = 0;
+    static unsigned long lastDebugTime = 0;
     
-    // Update battery data
-    updateBatteryLevel();
-    
-    // Read IMU data
-    if (systemData.mpuAvailable) {
-        readMPU6050();
-    }
+    updateBatteryData();
     
-    // WiFi check every 30s
-    if (millis() - lastWiFiCheck > 30000) {
-        lastWiFiCheck = millis();
-        if (WiFi.status() != WL_CONNECTED) {
-            WiFi.disconnect();
-            delay(1000);
-            WiFi.begin(ssid, password);
-            uiManager.requestUpdate();
-        }
+    if (pendingIMUCalibration) {
+        pendingIMUCalibration = false;
+        imuBias.requestFullCalibration();
+        imuData.calibrationInProgress = true;
+        debugPrintln("🔧 IMU calibration started - keep the unit still");
+        uiManager.requestUpdate();
     }
     
-    // Reset performance stats every 5 minutes
-    if (millis() - lastPerfReset > 300000) {
-        lastPerfReset = millis();
-        perfStats.minDelta = 9999;
-        perfStats.maxDelta = 0;
-        perfStats.droppedPackets = 0;
-        perfStats.totalPackets = 0;
+    IMUSample imuSample;
+    while (imuUIRing.pop(imuSample)) {
+        updateMotionState(imuSample);
     }
     
-    // Process GPS data
-    if (myGNSS.getPVT()) {
-        unsigned long now = millis();
-        unsigned long delta = now - lastPacketTime;
+    GPSSample sample;
+    while (gpsUIRing.pop(sample)) {
+        unsigned long delta = (sample.arrivalMicros - lastPacketMicros) / 1000;
         
         // Update GPS data structure
-        gpsData.timestamp = myGNSS.getUnixEpoch();
-        gpsData.latitude = myGNSS.getLatitude() / 1e7;
-        gpsData.longitude = myGNSS.getLongitude() / 1e7;
-        gpsData.altitude = myGNSS.getAltitude() / 1000; // mm to m
-        gpsData.speed = myGNSS.getGroundSpeed() * 0.0036; // mm/s to km/h
-        gpsData.heading = myGNSS.getHeading() / 100000.0; // deg * 1e5 to deg
-        gpsData.fixType = myGNSS.getFixType();
-        gpsData.satellites = myGNSS.getSIV();
-        gpsData.year = myGNSS.getYear();
-        gpsData.month = myGNSS.getMonth();
-        gpsData.day = myGNSS.getDay();
-        gpsData.hour = myGNSS.getHour();
-        gpsData.minute = myGNSS.getMinute();
-        gpsData.second = myGNSS.getSecond();
+        gpsData = sample.data;
+        if (bootTimeline.firstPvtMs == 0 && gpsData.fixType >= 2) {
+            bootTimeline.firstPvtMs = (uint32_t)(sample.arrivalMicros / 1000);
+            debugPrintf("⏱️ First fix %lu ms after reset\n", bootTimeline.firstPvtMs);
+        }
         
         // Update performance stats
         perfStats.totalPackets++;
-        if (lastPacketTime > 0) {
+        if (lastPacketMicros > 0) {
             if (delta < perfStats.minDelta) perfStats.minDelta = delta;
             if (delta > perfStats.maxDelta) perfStats.maxDelta = delta;
             perfStats.avgDelta = (perfStats.avgDelta + delta) / 2;
         }
-        lastPacketTime = now;
-        
-        // Create GPS packet for transmission
-        GPSPacket packet;
-        packet.timestamp = gpsData.timestamp;
-        packet.latitude = myGNSS.getLatitude();
-        packet.longitude = myGNSS.getLongitude();
-        packet.altitude = myGNSS.getAltitude();
-        packet.speed = myGNSS.getGroundSpeed();
-        packet.heading = myGNSS.getHeading();
-        packet.fixType = gpsData.fixType;
-        packet.satellites = gpsData.satellites;
-        
-        packet.battery_mv = (uint16_t)(batteryData.voltage * 1000.0f);
-        packet.battery_pct = batteryData.percentage;
-        
-        if (systemData.mpuAvailable) {
-            packet.accel_x = (int16_t)(imuData.accelX * 1000);
-            packet.accel_y = (int16_t)(imuData.accelY * 1000);
-            packet.accel_z = (int16_t)(imuData.accelZ * 1000);
-            packet.gyro_x = (int16_t)(imuData.gyroX * 100);
-            packet.gyro_y = (int16_t)(imuData.gyroY * 100);
-        } else {
-            packet.accel_x = packet.accel_y = packet.accel_z = 0;
-            packet.gyro_x = packet.gyro_y = 0;
-        }
-        
-        // PMU status byte
-        packet.pmu_status = (batteryData.isCharging ? 0x01 : 0x00) |
-                           (batteryData.usbConnected ? 0x02 : 0x00) |
-                           (batteryData.isConnected ? 0x04 : 0x00);
-       
-        packet.crc = crc16((uint8_t*)&packet, sizeof(GPSPacket) - 2);
-        
-        // Send via UDP
-        if (WiFi.status() == WL_CONNECTED) {
-            udp.beginPacket(remoteIP, remotePort);
-            udp.write((uint8_t*)&packet, sizeof(GPSPacket));
-            udp.endPacket();
-        }
-        
-        // Send via BLE
-        if (telemetryChar && telemetryDescriptor->getNotifications()) {
-            telemetryChar->setValue((uint8_t*)&packet, sizeof(GPSPacket));
-            telemetryChar->notify();
-        }
-        
-        // Log to SD - create log file if needed (safe in main loop)
-        if (systemData.loggingActive && systemData.sdCardAvailable) {
-            if (!logFile) {
-                createLogFile();
-            }
-            if (logFile) {
-                size_t written = logFile.write((uint8_t*)&packet, sizeof(GPSPacket));
-                if (written != sizeof(GPSPacket)) {
-                    perfStats.droppedPackets++;
-                } else {
-                    logFile.flush();
-                }
-            }
-        }
+        lastPacketMicros = sample.arrivalMicros;
         
         // Update UI if significant changes
         static uint8_t lastFixType = 0;
@@ -1254,6 +2994,7 @@ void loop() {
         }
         
         // Debug output every 10 seconds
+        unsigned long now = millis();
         if (now - lastDebugTime >= 10000) {
             lastDebugTime = now;
             
@@ -1268,19 +3009,59 @@ void loop() {
             debugPrintf("⚡ Perf: Δ=%lums Pkts:%lu Drop:%lu RAM:%d\n",
                 delta, perfStats.totalPackets, perfStats.droppedPackets, ESP.getFreeHeap());
             
+            debugPrintf("🔁 Ring overflows: Log:%lu Tlm:%lu UI:%lu IMU:%lu PVT:%lu\n",
+                gpsLogRing.overflowCount(), gpsTelemetryRing.overflowCount(),
+                gpsUIRing.overflowCount(), imuUIRing.overflowCount(),
+                pvtRing.overflowCount());
+            
+            debugPrintf("🛰️ UBX: Frames:%lu PVT:%lu CkErr:%lu LenErr:%lu\n",
+                ubxParser.framesOk(), ubxParser.pvtFrames(),
+                ubxParser.checksumErrors(), ubxParser.lengthErrors());
+            
+            debugPrintf("⏱️ Time: %s %s Drift:%.2fppm Resid:%ldus Max:%luus Steps:%lu\n",
+                timeBase.isLocked() ? "Locked" : "Unlocked",
+                timeBase.hasPps() ? "PPS" : "PVT",
+                timeBase.driftPpm(), timeBase.lastResidualMicros(),
+                timeBase.maxResidualMicros(), timeBase.stepCount());
+            
+            float statsSeconds = (esp_timer_get_time() - i2cBus.statsStartMicros()) / 1e6f;
+            for (uint8_t d = 0; d < I2C_DEVICE_COUNT; d++) {
+                const I2CDeviceStats& bus = i2cBus.stats((I2CDevice)d);
+                debugPrintf("🔌 I2C %-5s Tx:%lu Err:%lu Full:%lu Bus:%.2f%% Max:%luus Wait:%luus\n",
+                    I2CBus::deviceName((I2CDevice)d), bus.transactions, bus.errors, bus.queueFull,
+                    statsSeconds > 0 ? bus.busMicros / 1e4f / statsSeconds : 0.0f,
+                    bus.maxBusMicros, bus.maxWaitMicros);
+            }
+            
+            for (uint8_t d = 0; d < SPI_DEVICE_COUNT; d++) {
+                const SPIDeviceStats& bus = spiArbiter.stats((SPIDevice)d);
+                debugPrintf("🔌 SPI %-5s Grants:%lu Cont:%lu Miss:%lu Wait:%lluus Max:%luus Hold:%lluus\n",
+                    SPIArbiter::deviceName((SPIDevice)d), bus.grants, bus.contended,
+                    bus.deadlineMisses, bus.waitMicros, bus.maxWaitMicros, bus.holdMicros);
+            }
+            
+            for (uint8_t i = 0; i < scheduler.taskCount(); i++) {
+                const SchedulerTask& t = scheduler.task(i);
+                debugPrintf("🗓️ %-10s Runs:%lu Jit:%luus Max:%luus Ovr:%lu Miss:%lu\n",
+                    t.name, t.runs, t.maxJitterMicros, t.maxDurationMicros,
+                    t.overruns, t.deadlineMisses);
+            }
+            
             // File transfer status
             if (fileTransfer.active) {
                 debugPrintf("📤 Transfer: %s %.1f%% (%d/%d bytes)\n",
-                    fileTransfer.filename.c_str(), fileTransfer.progressPercent,
+                    fileTransfer.filename, fileTransfer.progressPercent,
                     fileTransfer.bytesSent, fileTransfer.fileSize);
             }
             
             // IMU status
             if (systemData.mpuAvailable) {
-                debugPrintf("🔄 IMU: %.1fg %s Temp:%.1f°C\n",
+                debugPrintf("🔄 IMU: %.1fg %s Temp:%.1f°C FIFO:%s Samples:%lu Ovf:%lu\n",
                     imuData.magnitude, 
                     imuData.motionDetected ? "Motion" : "Still",
-                    imuData.temperature);
+                    imuData.temperature,
+                    imuData.fifoEnabled ? "ON" : "OFF",
+                    imuData.fifoSamples, imuData.fifoOverflows);
             }
             
             // System status
@@ -1301,7 +3082,209 @@ void loop() {
             }
         }
     }
+}
+
+// Main loop jobs - period, priority and budget are set in startScheduler()
+void uiRenderJob() {
+    lv_timer_handler();
+    uiManager.update();
+}
+
+void fileJob() {
+    // CRITICAL: Process deferred file operations (called in main loop - safe stack)
+    processDeferredFileOperations();
+    
+    // Process file transfers (ongoing transfers)
+    processFileTransfer();
+}
+
+void transferUIJob() {
+    // Update file transfer UI more frequently during transfer
+    if (fileTransfer.active) {
+        uiManager.requestUpdate();
+    }
+}
+
+void wifiJob() {
+    // The WiFi boot stage owns the first association attempt
+    if (!bootSequence.isFinished(BOOT_STAGE_WIFI)) return;
+    
+    unsigned long now = millis();
+    if (wifiReconnecting) {
+        // Driver had its settle time after the disconnect - associate again
+        if (now - wifiStepMs < WIFI_SETTLE_MS) return;
+        WiFi.begin(ssid, password);
+        wifiReconnecting = false;
+        wifiStepMs = now;
+        uiManager.requestUpdate();
+        return;
+    }
+    
+    if (now - wifiStepMs < WIFI_CHECK_INTERVAL_MS) return;
+    wifiStepMs = now;
+    if (WiFi.status() != WL_CONNECTED) {
+        WiFi.disconnect();
+        wifiReconnecting = true;
+    }
+}
+
+void perfResetJob() {
+    perfStats.minDelta = 9999;
+    perfStats.maxDelta = 0;
+    perfStats.droppedPackets = 0;
+    perfStats.totalPackets = 0;
+    i2cBus.resetStats();
+    spiArbiter.resetStats();
+}
+
+void bootJob() {
+    if (bootSequence.isComplete()) return;
+    
+    bootSequence.update();
+    if (bootSequence.isComplete()) {
+        debugPrintf("⏱️ Boot complete %lu ms after reset (UI live at %lu ms)\n",
+                    bootTimeline.bootCompleteMs, bootTimeline.uiReadyMs);
+        for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+            debugPrintf("⏱️   %-6s %6lu - %6lu ms  %s\n", bootSequence.stageName((BootStage)i),
+                        bootTimeline.stageStartMs[i], bootTimeline.stageEndMs[i],
+                        bootTimeline.stageState[i] == BOOT_DONE ? "ok" :
+                        bootTimeline.stageState[i] == BOOT_SKIPPED ? "skipped" : "failed");
+        }
+        uiManager.requestUpdate();
+    }
+}
+
+void startScheduler() {
+    // Rate-monotonic: shorter period gets the higher priority
+    //                 name         job                   period (us) prio budget (us)
+    scheduler.addTask("boot",      bootJob,              50000,      5,   2000);
+    scheduler.addTask("telemetry", processTelemetry,     10000,      9,   2000);
+    scheduler.addTask("ui",        uiRenderJob,          10000,      8,   20000);
+    scheduler.addTask("logging",   processLogging,       20000,      7,   10000);
+    scheduler.addTask("uidata",    processUIData,        20000,      7,   2000);
+    scheduler.addTask("navrate",   navRateJob,           20000,      6,   20000);
+    scheduler.addTask("files",     fileJob,              20000,      6,   100000);
+    scheduler.addTask("xferui",    transferUIJob,        500000,     3,   1000);
+    scheduler.addTask("battery",   updateBatteryLevel,   5000000,    2,   5000);
+    scheduler.addTask("imucal",    imuCalibrationJob,    60000000,   1,   50000);
+    scheduler.addTask("assist",    gnssAssistJob,        1000000,    1,   50000);
+    scheduler.addTask("wifi",      wifiJob,              1000000,    1,   20000);
+    scheduler.addTask("perfreset", perfResetJob,         300000000,  0,   1000);
+    
+    debugPrintf("✅ Scheduler started with %u jobs\n", scheduler.taskCount());
+}
+
+void stallRunHook(uint8_t index, bool starting) {
+    int8_t id = stallSectionOfTask[index];
+    if (id < 0) return;
+    if (starting) stallMonitor.enter(id);
+    else stallMonitor.exit(id);
+}
+
+// A logging session brackets the heap report: snapshot when it starts,
+// compared when it stops
+void trackHeapSession() {
+    if (systemData.loggingActive == heapSessionLogging) return;
+    heapSessionLogging = systemData.loggingActive;
+    if (heapSessionLogging) {
+        heapSessionStart = heapSnapshot();
+        heapSessionStartMs = millis();
+        return;
+    }
+    heapSessionEnd = heapSnapshot();
+    debugPrintf("🧠 Heap over %lu s of logging: free %lu -> %lu, largest %lu -> %lu, frag %u%% -> %u%%, "
+                "%lu steady-state allocations\n",
+                (millis() - heapSessionStartMs) / 1000,
+                heapSessionStart.freeBytes, heapSessionEnd.freeBytes,
+                heapSessionStart.largestBlock, heapSessionEnd.largestBlock,
+                heapSessionStart.fragmentationPct, heapSessionEnd.fragmentationPct,
+                steadyAllocations);
+}
+
+// Scheduler jobs should not touch the heap once logging has settled
+void allocRunHook(uint8_t index, bool starting) {
+    if (starting) {
+        trackHeapSession();
+        jobAllocStart = allocCounterWatched();
+        return;
+    }
+    uint32_t n = allocCounterWatched() - jobAllocStart;
+    if (n == 0) return;
+    jobAllocations[index] += n;
+    if (!heapSessionLogging || millis() - heapSessionStartMs < ALLOC_SETTLE_MS) return;
     
-    // Small delay to prevent overwhelming the system
-    delay(5);
+    if (steadyAllocationsOfJob[index] == 0) {
+        debugPrintf("⚠️ %s allocated %lu times while logging\n", scheduler.task(index).name, n);
+    }
+    steadyAllocationsOfJob[index] += n;
+    steadyAllocations += n;
+#if ALLOC_ABORT_ON_STEADY
+    abort();
+#endif
+}
+
+void schedulerRunHook(uint8_t index, bool starting) {
+    stallRunHook(index, starting);
+    allocRunHook(index, starting);
+}
+
+// esp_timer task - keeps running while the main loop is blocked
+void stallCheck(void* arg) {
+    stallMonitor.check();
+}
+
+// Task watchdog interrupt, just before the panic reset - note where it hung
+extern "C" void esp_task_wdt_isr_user_handler(void) {
+    uint32_t openMicros;
+    stallHang.section = stallMonitor.longestOpenSection(openMicros);
+    stallHang.openMicros = openMicros;
+    stallHang.atMs = millis();
+    stallHang.magic = STALL_HANG_MAGIC;
+}
+
+void startStallMonitor() {
+    for (uint8_t i = 0; i < scheduler.taskCount(); i++) {
+        const SchedulerTask& t = scheduler.task(i);
+        stallSectionOfTask[i] = stallMonitor.addSection(t.name, max(t.budgetMicros, (uint32_t)STALL_MIN_BUDGET_US));
+    }
+    scheduler.setRunHook(schedulerRunHook);
+    
+    stallAcquisition = stallMonitor.addSection("acq", 10000);
+    stallBleConfig = stallMonitor.addSection("ble_cfg", STALL_MIN_BUDGET_US);
+    stallBleTransfer = stallMonitor.addSection("ble_xfer", STALL_MIN_BUDGET_US);
+    stallUdp = stallMonitor.addSection("udp", 20000);
+    stallUsb = stallMonitor.addSection("usb", STALL_MIN_BUDGET_US);
+    stallSd = stallMonitor.addSection("sd", SD_STALL_US);
+    sdWriter.setStallSection(stallSd);
+    
+    // A hang in the previous session, attributed by the watchdog interrupt
+    if (esp_reset_reason() == ESP_RST_TASK_WDT && stallHang.magic == STALL_HANG_MAGIC &&
+        stallHang.section >= 0) {
+        stallMonitor.recordHang(stallHang.section, stallHang.openMicros, stallHang.atMs);
+        debugPrintf("💥 Reset by task watchdog in %s after %lu ms\n",
+                    stallMonitor.section(stallHang.section).name, stallHang.openMicros / 1000);
+    }
+    stallHang.magic = 0;
+    
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = stallCheck;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "stall";
+    if (esp_timer_create(&timerArgs, &stallCheckTimer) == ESP_OK) {
+        esp_timer_start_periodic(stallCheckTimer, STALL_CHECK_PERIOD_US);
+    }
+    
+    // Hard hangs: the loop task and the acquisition task feed the watchdog
+    esp_task_wdt_init(STALL_WDT_TIMEOUT_S, true);
+    enableLoopWDT();
+    
+    debugPrintf("✅ Stall monitor: %u sections, watchdog %d s\n", stallMonitor.sectionCount(), STALL_WDT_TIMEOUT_S);
+}
+
+void loop() {
+    // Run the highest-priority due job; sleep when everything is idle
+    if (!scheduler.runOnce()) {
+        uint32_t idleUs = scheduler.microsUntilNextRelease();
+        delay(idleUs > 5000 ? 5 : idleUs / 1000 + 1);
+    }
 }
@@ -0,0 +1,62 @@
+#include "nav_rate_governor.h"
+
+NavRateGovernor::NavRateGovernor(uint32_t idleAfterMs, uint32_t parkedAfterMs, float movingSpeedKmh) :
+    idleAfterMs(idleAfterMs),
+    parkedAfterMs(parkedAfterMs),
+    movingSpeedKmh(movingSpeedKmh),
+    currentMode(NAV_MODE_ACTIVE),
+    lastMode(NAV_MODE_ACTIVE),
+    lastReason(REASON_NONE),
+    lastMovingMs(0),
+    changeCount(0)
+{
+}
+
+bool NavRateGovernor::update(bool motion, bool hasFix, float speedKmh, uint32_t nowMs) {
+    bool fast = hasFix && speedKmh >= movingSpeedKmh;
+    if (motion || fast) {
+        lastMovingMs = nowMs;
+        if (currentMode != NAV_MODE_ACTIVE) {
+            change(NAV_MODE_ACTIVE, motion ? REASON_MOTION : REASON_SPEED);
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t still = nowMs - lastMovingMs;
+    if (currentMode == NAV_MODE_ACTIVE && still >= idleAfterMs) {
+        change(NAV_MODE_IDLE, REASON_STILL);
+        return true;
+    }
+    if (currentMode == NAV_MODE_IDLE && still >= parkedAfterMs) {
+        change(NAV_MODE_PARKED, REASON_PARKED);
+        return true;
+    }
+    return false;
+}
+
+void NavRateGovernor::change(NavRateMode mode, Reason reason) {
+    lastMode = currentMode;
+    currentMode = mode;
+    lastReason = reason;
+    changeCount++;
+}
+
+const char* NavRateGovernor::modeName(NavRateMode mode) {
+    switch (mode) {
+        case NAV_MODE_ACTIVE: return "active";
+        case NAV_MODE_IDLE:   return "idle";
+        case NAV_MODE_PARKED: return "parked";
+        default:              return "?";
+    }
+}
+
+const char* NavRateGovernor::reasonName(Reason reason) {
+    switch (reason) {
+        case REASON_MOTION: return "motion";
+        case REASON_SPEED:  return "speed";
+        case REASON_STILL:  return "still";
+        case REASON_PARKED: return "parked";
+        default:            return "none";
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef NAV_RATE_GOVERNOR_H
+#define NAV_RATE_GOVERNOR_H
+
+#include <stdint.h>
+
+enum NavRateMode {
+    NAV_MODE_ACTIVE = 0,    // full rate, full constellation set
+    NAV_MODE_IDLE,          // stopped briefly - reduced rate
+    NAV_MODE_PARKED,        // stopped for long - minimum rate, reduced constellation set
+    NAV_MODE_COUNT
+};
+
+// Picks the GNSS navigation mode from the IMU motion detector and ground
+// speed. Any sign of movement returns to NAV_MODE_ACTIVE on the next update;
+// stepping down needs the unit to have been still for idleAfterMs and then
+// parkedAfterMs. Speed only counts while there is a fix.
+// No Arduino dependencies so recorded drives can be replayed on the host.
+class NavRateGovernor {
+public:
+    enum Reason {
+        REASON_NONE = 0,
+        REASON_MOTION,      // IMU motion detector
+        REASON_SPEED,       // ground speed above the moving threshold
+        REASON_STILL,       // still for idleAfterMs
+        REASON_PARKED       // still for parkedAfterMs
+    };
+
+    NavRateGovernor(uint32_t idleAfterMs, uint32_t parkedAfterMs, float movingSpeedKmh);
+
+    // True when the mode changed; mode() and reason() describe the change
+    bool update(bool motion, bool hasFix, float speedKmh, uint32_t nowMs);
+
+    NavRateMode mode() const { return currentMode; }
+    NavRateMode previousMode() const { return lastMode; }
+    Reason reason() const { return lastReason; }
+    uint32_t changes() const { return changeCount; }
+    uint32_t stillForMs(uint32_t nowMs) const { return nowMs - lastMovingMs; }
+
+    static const char* modeName(NavRateMode mode);
+    static const char* reasonName(Reason reason);
+
+private:
+    uint32_t idleAfterMs;
+    uint32_t parkedAfterMs;
+    float movingSpeedKmh;
+
+    NavRateMode currentMode;
+    NavRateMode lastMode;
+    Reason lastReason;
+    uint32_t lastMovingMs;
+    uint32_t changeCount;
+
+    void change(NavRateMode mode, Reason reason);
+};
+
+#endif // NAV_RATE_GOVERNOR_H
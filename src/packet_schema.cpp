@@ -0,0 +1,31 @@
+#include "packet_schema.h"
+#include <stdio.h>
+
+#define GPS_SCHEMA_FIELD(type, name, scale, unit) \
+    { #name, SchemaTypeOf<type>::code, (uint16_t)offsetof(GPSPacket, name), (float)(scale), unit },
+
+static const SchemaField gpsPacketFields[] = {
+    GPS_PACKET_FIELDS(GPS_SCHEMA_FIELD)
+};
+#undef GPS_SCHEMA_FIELD
+
+const RecordSchema gpsPacketSchema = {
+    "gps",
+    GPS_PACKET_VERSION,
+    sizeof(GPSPacket),
+    (uint16_t)offsetof(GPSPacket, crc),
+    gpsPacketFields,
+    sizeof(gpsPacketFields) / sizeof(gpsPacketFields[0])
+};
+
+size_t writeSchemaDescriptor(const RecordSchema& schema, char* buffer, size_t size) {
+    int len = snprintf(buffer, size, "#SCHEMA %s v%u size=%u crc=%u fields=",
+                       schema.name, schema.version, schema.size, schema.crcOffset);
+    for (uint8_t i = 0; i < schema.fieldCount && len < (int)size; i++) {
+        const SchemaField& f = schema.fields[i];
+        len += snprintf(buffer + len, size - len, "%s%s:%c:%g:%s",
+                        i ? "," : "", f.name, f.type, f.scale, f.unit);
+    }
+    if (len < 0 || len >= (int)size) return 0;
+    return len;
+}
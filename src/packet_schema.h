@@ -0,0 +1,134 @@
+#ifndef PACKET_SCHEMA_H
+#define PACKET_SCHEMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "crc.h"
+
+// GPS record schema, in wire order - expands into GPSPacket below and into
+// the #SCHEMA descriptor in the log header. New fields go at the end,
+// before the CRC, with GPS_PACKET_VERSION bumped; readers find fields by
+// name, so older readers skip ones they don't know. No Arduino
+// dependencies so the host tests build the same record as the firmware.
+//  type      name          scale   unit
+#define GPS_PACKET_FIELDS(X) \
+    X(uint32_t, timestamp,    1,      "s")    /* Unix epoch */ \
+    X(int32_t,  latitude,     1e-7,   "deg")  \
+    X(int32_t,  longitude,    1e-7,   "deg")  \
+    X(int32_t,  altitude,     1e-3,   "m")    \
+    X(uint16_t, speed,        1e-3,   "m/s")  \
+    X(uint32_t, heading,      1e-5,   "deg")  \
+    X(uint8_t,  fixType,      1,      "")     /* 0-5 */ \
+    X(uint8_t,  satellites,   1,      "")     \
+    X(uint16_t, battery_mv,   1,      "mV")   \
+    X(uint8_t,  battery_pct,  1,      "%")    \
+    X(int16_t,  accel_x,      1e-3,   "g")    \
+    X(int16_t,  accel_y,      1e-3,   "g")    \
+    X(int16_t,  accel_z,      1e-3,   "g")    \
+    X(int16_t,  gyro_x,       1e-2,   "deg/s") \
+    X(int16_t,  gyro_y,       1e-2,   "deg/s") \
+    X(uint8_t,  pmu_status,   1,      "")     /* PMU status flags */ \
+    X(uint32_t, timestamp_us, 1,      "us")   /* past timestamp, GNSS-disciplined */
+
+#define GPS_PACKET_VERSION 2    // 1: V1.0 logs, without timestamp_us
+#define GPS_PACKET_SIZE    44   // wire size - a change here breaks every reader
+
+// GPS Packet Structure (44 bytes) for transmission
+struct __attribute__((packed)) GPSPacket {
+#define GPS_PACKET_MEMBER(type, name, scale, unit) type name;
+    GPS_PACKET_FIELDS(GPS_PACKET_MEMBER)
+#undef GPS_PACKET_MEMBER
+    uint16_t crc;            // CRC16 over every byte before it
+};
+
+// How GPS records are written to a sink (SD log, UDP/BLE telemetry)
+enum RecordEncoding {
+    RECORD_ENCODING_RAW = 0,    // fixed-size GPSPacket
+    RECORD_ENCODING_DELTA       // record_stream.h keyframe/delta frames
+};
+
+// Field types, spelled as Python struct codes so host tools can build their
+// unpack format straight from the descriptor
+template<typename T> struct SchemaTypeOf;
+template<> struct SchemaTypeOf<uint8_t>  { static const char code = 'B'; };
+template<> struct SchemaTypeOf<int8_t>   { static const char code = 'b'; };
+template<> struct SchemaTypeOf<uint16_t> { static const char code = 'H'; };
+template<> struct SchemaTypeOf<int16_t>  { static const char code = 'h'; };
+template<> struct SchemaTypeOf<uint32_t> { static const char code = 'I'; };
+template<> struct SchemaTypeOf<int32_t>  { static const char code = 'i'; };
+
+struct SchemaField {
+    const char* name;
+    char type;              // struct code
+    uint16_t offset;
+    float scale;            // raw * scale = value in unit
+    const char* unit;
+};
+
+struct RecordSchema {
+    const char* name;
+    uint8_t version;
+    uint16_t size;          // whole record, CRC included
+    uint16_t crcOffset;     // CRC16 covers [0, crcOffset)
+    const SchemaField* fields;
+    uint8_t fieldCount;
+};
+
+// One-line descriptor for log headers:
+// #SCHEMA gps v2 size=44 crc=42 fields=timestamp:I:1:s,latitude:i:1e-07:deg,...
+// Returns the length written without the trailing '\n', 0 if it does not fit
+size_t writeSchemaDescriptor(const RecordSchema& schema, char* buffer, size_t size);
+
+// Encode/decode for a packed record that ends in a uint16_t crc. The record
+// struct is itself the wire format, so decoding is a checked cast.
+template<typename Record>
+class RecordCodec {
+public:
+    static const size_t size = sizeof(Record);
+    static const size_t crcOffset = offsetof(Record, crc);
+
+    static_assert(crcOffset + sizeof(uint16_t) == sizeof(Record), "CRC must be the last field");
+    static_assert(alignof(Record) == 1, "Record must be packed");
+
+    // Fill the CRC trailer once every other field is set
+    static void seal(Record& record) {
+        record.crc = crc16(bytes(record), crcOffset);
+    }
+
+    static bool valid(const Record& record) {
+        return crc16(bytes(record), crcOffset) == record.crc;
+    }
+
+    // Zero-copy view of a record in a receive or file buffer, nullptr if the
+    // buffer is short or the CRC does not match
+    static const Record* view(const uint8_t* data, size_t length) {
+        if (length < size) return nullptr;
+        const Record* record = reinterpret_cast<const Record*>(data);
+        return valid(*record) ? record : nullptr;
+    }
+
+    static const uint8_t* bytes(const Record& record) {
+        return reinterpret_cast<const uint8_t*>(&record);
+    }
+};
+
+// GPS record - fields come from GPS_PACKET_FIELDS above
+#define GPS_PACKET_FIELD_SIZE(type, name, scale, unit) + sizeof(type)
+static_assert(0 GPS_PACKET_FIELDS(GPS_PACKET_FIELD_SIZE) + sizeof(uint16_t) == sizeof(GPSPacket),
+              "GPSPacket has padding between fields");
+#undef GPS_PACKET_FIELD_SIZE
+static_assert(sizeof(GPSPacket) == GPS_PACKET_SIZE, "GPSPacket wire size changed");
+
+// Field indices, for per-field masks
+#define GPS_PACKET_FIELD_INDEX(type, name, scale, unit) GPS_FIELD_##name,
+enum GPSPacketField {
+    GPS_PACKET_FIELDS(GPS_PACKET_FIELD_INDEX)
+    GPS_FIELD_COUNT
+};
+#undef GPS_PACKET_FIELD_INDEX
+static_assert(GPS_FIELD_COUNT <= 32, "GPS field masks are 32 bits");
+
+typedef RecordCodec<GPSPacket> GPSPacketCodec;
+extern const RecordSchema gpsPacketSchema;
+
+#endif // PACKET_SCHEMA_H
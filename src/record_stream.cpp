@@ -0,0 +1,208 @@
+#include "record_stream.h"
+#include <string.h>
+
+// Little-endian field access by struct code - records are packed
+static int64_t readField(const uint8_t* record, const SchemaField& field) {
+    const uint8_t* p = record + field.offset;
+    switch (field.type) {
+        case 'B': return p[0];
+        case 'b': return (int8_t)p[0];
+        case 'H': return (uint16_t)(p[0] | (p[1] << 8));
+        case 'h': return (int16_t)(p[0] | (p[1] << 8));
+        case 'I': { uint32_t v; memcpy(&v, p, 4); return v; }
+        case 'i': { int32_t v; memcpy(&v, p, 4); return v; }
+        default:  return 0;
+    }
+}
+
+static void writeField(uint8_t* record, const SchemaField& field, int64_t value) {
+    uint8_t* p = record + field.offset;
+    switch (field.type) {
+        case 'B': case 'b': p[0] = (uint8_t)value; break;
+        case 'H': case 'h': p[0] = (uint8_t)value; p[1] = (uint8_t)(value >> 8); break;
+        case 'I': case 'i': { uint32_t v = (uint32_t)value; memcpy(p, &v, 4); break; }
+    }
+}
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline size_t putVarint(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Returns bytes read, 0 if the varint runs past the end or is over-long
+static size_t getVarint(const uint8_t* data, size_t length, uint64_t& v) {
+    v = 0;
+    for (size_t n = 0; n < length && n < 10; n++) {
+        v |= (uint64_t)(data[n] & 0x7F) << (7 * n);
+        if (!(data[n] & 0x80)) return n + 1;
+    }
+    return 0;
+}
+
+RecordStreamEncoder::RecordStreamEncoder(const RecordSchema& schema, uint32_t linearMask, uint8_t keyframeInterval) :
+    schema(schema),
+    linearMask(linearMask),
+    keyframeInterval(keyframeInterval ? keyframeInterval : 1),
+    sinceKeyframe(0),
+    sequence(0),
+    needKeyframe(true),
+    recordCount(0),
+    keyframeCount(0),
+    byteCount(0)
+{
+    memset(previous, 0, sizeof(previous));
+    memset(slope, 0, sizeof(slope));
+}
+
+void RecordStreamEncoder::reset() {
+    needKeyframe = true;
+}
+
+size_t RecordStreamEncoder::encode(const uint8_t* record, uint8_t* out) {
+    uint8_t fields = schema.fieldCount;
+    if (fields > RECORD_STREAM_MAX_FIELDS) fields = RECORD_STREAM_MAX_FIELDS;
+
+    bool key = needKeyframe || sinceKeyframe >= keyframeInterval;
+    size_t n = 1;
+    out[0] = ((key ? RECORD_FRAME_KEY : RECORD_FRAME_DELTA) << 6) | (sequence & 0x3F);
+    sequence++;
+
+    if (key) {
+        n += putVarint(out + n, linearMask);
+        out[n++] = fields;
+        for (uint8_t i = 0; i < fields; i++) {
+            int64_t value = readField(record, schema.fields[i]);
+            n += putVarint(out + n, zigzag(value));
+            slope[i] = 0;
+            previous[i] = value;
+        }
+        needKeyframe = false;
+        sinceKeyframe = 0;
+        keyframeCount++;
+    } else {
+        // Residuals first, mask in front of them once it is known
+        uint8_t residuals[RECORD_STREAM_MAX_FIELDS * 10];
+        size_t r = 0;
+        uint32_t changed = 0;
+        for (uint8_t i = 0; i < fields; i++) {
+            int64_t value = readField(record, schema.fields[i]);
+            int64_t predicted = previous[i] + ((linearMask >> i) & 1 ? slope[i] : 0);
+            if (value != predicted) {
+                changed |= 1UL << i;
+                r += putVarint(residuals + r, zigzag(value - predicted));
+            }
+            slope[i] = value - previous[i];
+            previous[i] = value;
+        }
+        n += putVarint(out + n, changed);
+        memcpy(out + n, residuals, r);
+        n += r;
+    }
+
+    sinceKeyframe++;
+    recordCount++;
+    byteCount += n;
+    return n;
+}
+
+RecordStreamDecoder::RecordStreamDecoder(const RecordSchema& schema) :
+    schema(schema),
+    linearMask(0),
+    synced(false),
+    sequence(0),
+    skippedCount(0)
+{
+    memset(previous, 0, sizeof(previous));
+    memset(slope, 0, sizeof(slope));
+}
+
+void RecordStreamDecoder::reset() {
+    synced = false;
+}
+
+RecordStreamStatus RecordStreamDecoder::decode(const uint8_t* data, size_t length, size_t& consumed, uint8_t* record) {
+    if (length == 0) return RECORD_STREAM_INCOMPLETE;
+    uint8_t fields = schema.fieldCount;
+    if (fields > RECORD_STREAM_MAX_FIELDS) fields = RECORD_STREAM_MAX_FIELDS;
+
+    uint8_t kind = data[0] >> 6;
+    uint8_t seq = data[0] & 0x3F;
+    size_t n = 1;
+    uint64_t v;
+    size_t used;
+
+    if (kind == RECORD_FRAME_KEY) {
+        int64_t values[RECORD_STREAM_MAX_FIELDS];
+        uint64_t mask;
+        if (!(used = getVarint(data + n, length - n, mask))) return RECORD_STREAM_INCOMPLETE;
+        n += used;
+        if (n >= length) return RECORD_STREAM_INCOMPLETE;
+        if (data[n++] != fields) {
+            consumed = 1;
+            return RECORD_STREAM_ERROR;
+        }
+        for (uint8_t i = 0; i < fields; i++) {
+            if (!(used = getVarint(data + n, length - n, v))) return RECORD_STREAM_INCOMPLETE;
+            n += used;
+            values[i] = unzigzag(v);
+        }
+        linearMask = (uint32_t)mask;
+        for (uint8_t i = 0; i < fields; i++) {
+            previous[i] = values[i];
+            slope[i] = 0;
+        }
+        synced = true;
+    } else if (kind == RECORD_FRAME_DELTA) {
+        uint64_t changed;
+        if (!(used = getVarint(data + n, length - n, changed))) return RECORD_STREAM_INCOMPLETE;
+        n += used;
+        int64_t residuals[RECORD_STREAM_MAX_FIELDS];
+        for (uint8_t i = 0; i < fields; i++) {
+            residuals[i] = 0;
+            if (!((changed >> i) & 1)) continue;
+            if (!(used = getVarint(data + n, length - n, v))) return RECORD_STREAM_INCOMPLETE;
+            n += used;
+            residuals[i] = unzigzag(v);
+        }
+        // A lost frame breaks the prediction chain until the next keyframe
+        if (!synced || seq != ((sequence + 1) & 0x3F)) {
+            synced = false;
+            sequence = seq;
+            skippedCount++;
+            consumed = n;
+            return RECORD_STREAM_SKIPPED;
+        }
+        for (uint8_t i = 0; i < fields; i++) {
+            int64_t value = previous[i] + ((linearMask >> i) & 1 ? slope[i] : 0) + residuals[i];
+            slope[i] = value - previous[i];
+            previous[i] = value;
+        }
+    } else {
+        consumed = 1;
+        return RECORD_STREAM_ERROR;
+    }
+
+    sequence = seq;
+    consumed = n;
+    memset(record, 0, schema.size);
+    for (uint8_t i = 0; i < fields; i++) {
+        writeField(record, schema.fields[i], previous[i]);
+    }
+    uint16_t crc = crc16(record, schema.crcOffset);
+    record[schema.crcOffset] = (uint8_t)crc;
+    record[schema.crcOffset + 1] = (uint8_t)(crc >> 8);
+    return RECORD_STREAM_RECORD;
+}
@@ -0,0 +1,93 @@
+#ifndef RECORD_STREAM_H
+#define RECORD_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "packet_schema.h"
+
+#define RECORD_STREAM_VERSION    1
+#define RECORD_STREAM_MAX_FIELDS 32
+#define RECORD_STREAM_KEYFRAME_INTERVAL 25  // 1 s at the active nav rate
+
+// Frame header byte: kind in the top two bits, 6-bit sequence below
+#define RECORD_FRAME_KEY   0
+#define RECORD_FRAME_DELTA 1
+
+// Largest frame for a schema: header, 32-bit mask varint, 10-byte varint per field
+#define RECORD_STREAM_MAX_FRAME(fieldCount) (1 + 5 + 1 + 10 * (fieldCount))
+
+// GPS records: time and position move smoothly, everything else holds
+#define GPS_STREAM_LINEAR_FIELDS ((1UL << GPS_FIELD_timestamp) | (1UL << GPS_FIELD_timestamp_us) | \
+                                  (1UL << GPS_FIELD_latitude) | (1UL << GPS_FIELD_longitude) | \
+                                  (1UL << GPS_FIELD_altitude))
+#define GPS_STREAM_MAX_FRAME     RECORD_STREAM_MAX_FRAME(GPS_FIELD_COUNT)
+
+enum RecordStreamStatus {
+    RECORD_STREAM_RECORD = 0,   // frame decoded into a record
+    RECORD_STREAM_SKIPPED,      // delta frame after a gap - waiting for a keyframe
+    RECORD_STREAM_INCOMPLETE,   // need more bytes
+    RECORD_STREAM_ERROR         // not a frame of this schema
+};
+
+// Lossless compression of a record stream described by a RecordSchema.
+// Every keyframeInterval records a keyframe carries every field; frames
+// in between carry a bitmask of fields that differ from their prediction
+// and a zig-zag varint residual for each of those. A field is predicted
+// as its previous value, or - for fields in linearMask, which move
+// smoothly (time, position) - extrapolated from the previous two.
+// The CRC is not transmitted; the decoder recomputes it.
+//
+// Keyframe: header, varint linearMask, field count, varint value per field
+// Delta:    header, varint changed mask, varint residual per changed field
+class RecordStreamEncoder {
+public:
+    RecordStreamEncoder(const RecordSchema& schema, uint32_t linearMask,
+                        uint8_t keyframeInterval = RECORD_STREAM_KEYFRAME_INTERVAL);
+
+    // Next frame is a keyframe - new file, new subscriber
+    void reset();
+    // Returns the frame length; out must hold maxFrameSize() bytes
+    size_t encode(const uint8_t* record, uint8_t* out);
+    size_t maxFrameSize() const { return RECORD_STREAM_MAX_FRAME(schema.fieldCount); }
+
+    uint32_t records() const { return recordCount; }
+    uint32_t keyframes() const { return keyframeCount; }
+    uint32_t bytes() const { return byteCount; }
+
+private:
+    const RecordSchema& schema;
+    uint32_t linearMask;
+    uint8_t keyframeInterval;
+    uint8_t sinceKeyframe;
+    uint8_t sequence;
+    bool needKeyframe;
+    int64_t previous[RECORD_STREAM_MAX_FIELDS];
+    int64_t slope[RECORD_STREAM_MAX_FIELDS];
+
+    uint32_t recordCount;
+    uint32_t keyframeCount;
+    uint32_t byteCount;
+};
+
+class RecordStreamDecoder {
+public:
+    explicit RecordStreamDecoder(const RecordSchema& schema);
+
+    void reset();
+    // Decodes one frame from data; consumed is set for every status except
+    // INCOMPLETE. record must hold schema.size bytes and is sealed with its CRC.
+    RecordStreamStatus decode(const uint8_t* data, size_t length, size_t& consumed, uint8_t* record);
+
+    uint32_t skipped() const { return skippedCount; }
+
+private:
+    const RecordSchema& schema;
+    uint32_t linearMask;
+    bool synced;
+    uint8_t sequence;
+    int64_t previous[RECORD_STREAM_MAX_FIELDS];
+    int64_t slope[RECORD_STREAM_MAX_FIELDS];
+    uint32_t skippedCount;
+};
+
+#endif // RECORD_STREAM_H
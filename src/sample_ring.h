@@ -0,0 +1,75 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring buffer.
+// The acquisition task is the only writer and exactly one consumer
+// (logger, telemetry or UI) reads each ring, so no locks are needed.
+// Capacity must be a power of two; one slot is never left empty because
+// head/tail are free-running counters masked on access.
+// No Arduino dependencies so the ring can also be built on the host.
+template <typename T, size_t Capacity>
+class SampleRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SampleRing capacity must be a power of two");
+
+public:
+    SampleRing() : head(0), tail(0), overflows(0), highWater(0) {}
+
+    // Producer side. Returns false (and counts an overflow) when full;
+    // the newest sample is dropped so the consumer never sees torn data.
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        uint32_t used = h - t;
+        if (used >= Capacity) {
+            overflows.store(overflows.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        if (used + 1 > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(used + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side. Returns false when the ring is empty.
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        if (t == h) return false;
+        item = slots[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Drops everything currently queued.
+    void clear() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+    uint32_t overflowCount() const { return overflows.load(std::memory_order_relaxed); }
+    uint32_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+
+private:
+    T slots[Capacity];
+    // Keep producer and consumer indices on separate cache lines
+    alignas(32) std::atomic<uint32_t> head;
+    alignas(32) std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> overflows;
+    std::atomic<uint32_t> highWater;
+};
+
+#endif // SAMPLE_RING_H
@@ -0,0 +1,119 @@
+#include "scheduler.h"
+
+Scheduler::Scheduler(ClockFunction clock) :
+    clock(clock),
+    runHook(nullptr),
+    count(0)
+{
+}
+
+int Scheduler::addTask(const char* name, void (*callback)(), uint32_t periodMicros,
+                       uint8_t priority, uint32_t budgetMicros) {
+    if (count >= MAX_TASKS || !callback || periodMicros == 0) return -1;
+
+    SchedulerTask& t = tasks[count];
+    t.name = name;
+    t.callback = callback;
+    t.periodMicros = periodMicros;
+    t.budgetMicros = budgetMicros;
+    t.priority = priority;
+    t.nextRelease = clock();
+    t.runs = 0;
+    t.overruns = 0;
+    t.deadlineMisses = 0;
+    t.lastJitterMicros = 0;
+    t.maxJitterMicros = 0;
+    t.lastDurationMicros = 0;
+    t.maxDurationMicros = 0;
+
+    return count++;
+}
+
+bool Scheduler::runOnce() {
+    uint32_t now = clock();
+
+    // Highest-priority due task; ties go to the one released earliest
+    SchedulerTask* next = nullptr;
+    for (uint8_t i = 0; i < count; i++) {
+        SchedulerTask& t = tasks[i];
+        if ((int32_t)(now - t.nextRelease) < 0) continue;
+        if (!next || t.priority > next->priority ||
+            (t.priority == next->priority &&
+             (int32_t)(t.nextRelease - next->nextRelease) < 0)) {
+            next = &t;
+        }
+    }
+    if (!next) return false;
+
+    uint32_t jitter = now - next->nextRelease;
+    next->lastJitterMicros = jitter;
+    if (jitter > next->maxJitterMicros) next->maxJitterMicros = jitter;
+
+    // Skip releases that were missed entirely instead of running back to back
+    uint32_t missed = jitter / next->periodMicros;
+    next->deadlineMisses += missed;
+    next->nextRelease += (missed + 1) * next->periodMicros;
+
+    uint8_t index = next - tasks;
+    if (runHook) runHook(index, true);
+    next->callback();
+    if (runHook) runHook(index, false);
+
+    uint32_t duration = clock() - now;
+    next->runs++;
+    next->lastDurationMicros = duration;
+    if (duration > next->maxDurationMicros) next->maxDurationMicros = duration;
+    if (next->budgetMicros > 0 && duration > next->budgetMicros) next->overruns++;
+
+    return true;
+}
+
+uint32_t Scheduler::microsUntilNextRelease() const {
+    if (count == 0) return 0;
+
+    uint32_t now = clock();
+    int32_t earliest = (int32_t)(tasks[0].nextRelease - now);
+    for (uint8_t i = 1; i < count; i++) {
+        int32_t wait = (int32_t)(tasks[i].nextRelease - now);
+        if (wait < earliest) earliest = wait;
+    }
+    return earliest > 0 ? (uint32_t)earliest : 0;
+}
+
+void Scheduler::resetStats() {
+    for (uint8_t i = 0; i < count; i++) {
+        SchedulerTask& t = tasks[i];
+        t.runs = 0;
+        t.overruns = 0;
+        t.deadlineMisses = 0;
+        t.lastJitterMicros = 0;
+        t.maxJitterMicros = 0;
+        t.lastDurationMicros = 0;
+        t.maxDurationMicros = 0;
+    }
+}
+
+const SchedulerTask* Scheduler::worstTask() const {
+    const SchedulerTask* worst = nullptr;
+    uint32_t worstScore = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t score = tasks[i].overruns + tasks[i].deadlineMisses;
+        if (score > worstScore) {
+            worstScore = score;
+            worst = &tasks[i];
+        }
+    }
+    return worst;
+}
+
+uint32_t Scheduler::totalOverruns() const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++) total += tasks[i].overruns;
+    return total;
+}
+
+uint32_t Scheduler::totalDeadlineMisses() const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++) total += tasks[i].deadlineMisses;
+    return total;
+}
@@ -0,0 +1,67 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// Periodic task with its timing statistics
+struct SchedulerTask {
+    const char* name;
+    void (*callback)();
+    uint32_t periodMicros;
+    uint32_t budgetMicros;
+    uint8_t priority;            // higher value runs first
+    uint32_t nextRelease;
+
+    // Statistics
+    uint32_t runs;
+    uint32_t overruns;           // runs that took longer than budgetMicros
+    uint32_t deadlineMisses;     // whole periods skipped because the task ran late
+    uint32_t lastJitterMicros;   // start time minus release time
+    uint32_t maxJitterMicros;
+    uint32_t lastDurationMicros;
+    uint32_t maxDurationMicros;
+};
+
+// Cooperative fixed-priority scheduler for the main loop.
+// Each call to runOnce() runs the highest-priority task whose release time has
+// passed. The clock is injected so the scheduler can be driven by a fake clock
+// on the host; all time arithmetic is wrap-safe on 32-bit microseconds.
+class Scheduler {
+public:
+    typedef uint32_t (*ClockFunction)();
+    typedef void (*RunHook)(uint8_t index, bool starting);
+    static const uint8_t MAX_TASKS = 16;
+
+    explicit Scheduler(ClockFunction clock);
+
+    // Returns the task index, or -1 if the table is full
+    int addTask(const char* name, void (*callback)(), uint32_t periodMicros,
+                uint8_t priority, uint32_t budgetMicros);
+
+    // Called around every task run, e.g. to attribute stalls
+    void setRunHook(RunHook hook) { runHook = hook; }
+
+    // Run the highest-priority due task. Returns false if nothing was due.
+    bool runOnce();
+
+    // Time until the earliest release, 0 if a task is already due
+    uint32_t microsUntilNextRelease() const;
+
+    void resetStats();
+
+    uint8_t taskCount() const { return count; }
+    const SchedulerTask& task(uint8_t index) const { return tasks[index]; }
+
+    // Task with the most overruns + deadline misses, nullptr if all are clean
+    const SchedulerTask* worstTask() const;
+    uint32_t totalOverruns() const;
+    uint32_t totalDeadlineMisses() const;
+
+private:
+    ClockFunction clock;
+    RunHook runHook;
+    SchedulerTask tasks[MAX_TASKS];
+    uint8_t count;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,384 @@
+#include "sd_writer.h"
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include "ff.h"
+
+#define SD_WRITER_STACK         6144    // FatFs calls for preallocation and trimming
+#define SD_WRITER_POLL_MS       100     // timed sync and close checks
+#define SD_WRITER_RETRY_MS      200     // after a short write or a failed open
+#define SD_WRITER_GIVE_UP       10      // failures before a file is abandoned
+
+SdWriter::SdWriter(SPIArbiter& arbiter, uint32_t busDeadlineMicros, StallMonitor& monitor) :
+    arbiter(arbiter),
+    busDeadline(busDeadlineMicros),
+    monitor(monitor),
+    fs(nullptr),
+    fatDrive(""),
+    ring(nullptr),
+    capacity(0),
+    block(nullptr),
+    blockBytes(0),
+    syncInterval(2000),
+    stallThreshold(100000),
+    stallSection(-1),
+    fileHook(nullptr),
+    task(nullptr),
+    open(false),
+    closeRequested(false),
+    nextPending(false),
+    nextAt(0),
+    nextPreallocate(0),
+    fileStartAt(0),
+    head(0),
+    tail(0),
+    sidecarNextAt(0),
+    sidecarHead(0),
+    sidecarTail(0),
+    fileOpen(false),
+    fileAllocated(0),
+    fileWritten(0),
+    lastSyncMs(0),
+    failures(0)
+{
+    nextPath[0] = '\0';
+    nextSidecarPath[0] = '\0';
+    path[0] = '\0';
+    memset(&counters, 0, sizeof(counters));
+    memset(histogram, 0, sizeof(histogram));
+}
+
+bool SdWriter::begin(fs::FS& volume, const char* drive, size_t ringBytes, size_t blockSize,
+                     UBaseType_t priority, BaseType_t core) {
+    if (task) return true;
+    fs = &volume;
+    fatDrive = drive;
+
+    // PSRAM when there is some - the ring only ever sees memcpy
+    ring = (uint8_t*)heap_caps_malloc(ringBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring) {
+        ringBytes /= 16;
+        ring = (uint8_t*)heap_caps_malloc(ringBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    block = (uint8_t*)heap_caps_malloc(blockSize, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (!ring || !block) {
+        free(ring);
+        free(block);
+        ring = block = nullptr;
+        return false;
+    }
+    capacity = ringBytes;
+    blockBytes = blockSize;
+    counters.capacity = capacity;
+
+    return xTaskCreatePinnedToCore(taskEntry, "sdwriter", SD_WRITER_STACK, this, priority, &task, core) == pdPASS;
+}
+
+void SdWriter::configure(uint32_t syncIntervalMs, uint32_t stallMicros) {
+    syncInterval = syncIntervalMs;
+    stallThreshold = stallMicros;
+}
+
+bool SdWriter::startFile(const char* filePath, uint32_t preallocateBytes, const char* sidecarPath) {
+    if (!task || closeRequested || nextPending.load(std::memory_order_acquire)) return false;
+    strlcpy(nextPath, filePath, sizeof(nextPath));
+    strlcpy(nextSidecarPath, sidecarPath ? sidecarPath : "", sizeof(nextSidecarPath));
+    nextPreallocate = preallocateBytes;
+    nextAt = fileStartAt = head.load(std::memory_order_relaxed);
+    sidecarNextAt = sidecarHead.load(std::memory_order_relaxed);
+    nextPending.store(true, std::memory_order_release);
+    open = true;
+    xTaskNotifyGive(task);
+    return true;
+}
+
+void SdWriter::close() {
+    if (!open || closeRequested) return;
+    closeRequested = true;
+    xTaskNotifyGive(task);
+}
+
+size_t SdWriter::freeSpace() const {
+    return capacity - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+}
+
+bool SdWriter::append(const uint8_t* data, size_t length) {
+    if (!open || closeRequested) return false;
+
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t pending = h - tail.load(std::memory_order_acquire);
+    if (capacity - pending < length) {
+        counters.overflows++;
+        return false;
+    }
+
+    size_t at = h % capacity;
+    size_t first = min(length, capacity - at);
+    memcpy(ring + at, data, first);
+    memcpy(ring, data + first, length - first);
+    head.store(h + length, std::memory_order_release);
+
+    counters.bytesQueued += length;
+    pending += length;
+    if (pending > counters.highWater) counters.highWater = pending;
+    // Wake the task only when a whole block is ready
+    if (pending >= blockBytes && pending - length < blockBytes) xTaskNotifyGive(task);
+    return true;
+}
+
+bool SdWriter::appendSidecar(const uint8_t* data, size_t length) {
+    if (!open || closeRequested) return false;
+
+    uint32_t h = sidecarHead.load(std::memory_order_relaxed);
+    if (SD_SIDECAR_RING - (h - sidecarTail.load(std::memory_order_acquire)) < length) {
+        counters.sidecarOverflows++;
+        return false;
+    }
+    size_t at = h % SD_SIDECAR_RING;
+    size_t first = min(length, SD_SIDECAR_RING - at);
+    memcpy(sidecarRing + at, data, first);
+    memcpy(sidecarRing, data + first, length - first);
+    sidecarHead.store(h + length, std::memory_order_release);
+    return true;
+}
+
+SdWriterStats SdWriter::stats() const {
+    SdWriterStats s = counters;
+    s.pending = head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    return s;
+}
+
+void SdWriter::resetStats() {
+    counters.highWater = stats().pending;
+    counters.maxWriteMicros = 0;
+    counters.stalls = 0;
+    memset(histogram, 0, sizeof(histogram));
+}
+
+void SdWriter::taskEntry(void* parameter) {
+    static_cast<SdWriter*>(parameter)->run();
+}
+
+void SdWriter::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SD_WRITER_POLL_MS));
+        if (!open) continue;
+        if (!service()) vTaskDelay(pdMS_TO_TICKS(SD_WRITER_RETRY_MS));
+    }
+}
+
+bool SdWriter::service() {
+    for (;;) {
+        // A pending start bounds what belongs to the current file
+        bool switching = nextPending.load(std::memory_order_acquire);
+        uint32_t end = switching ? nextAt : head.load(std::memory_order_acquire);
+        uint32_t sidecarEnd = switching ? sidecarNextAt : sidecarHead.load(std::memory_order_acquire);
+        bool ending = switching || closeRequested;
+
+        if (!fileOpen) {
+            // Left over from a file that could not be opened
+            drop(end);
+            writeSidecar(sidecarEnd);
+            if (switching) {
+                if (!openNext()) return false;
+                nextPending.store(false, std::memory_order_release);
+                continue;
+            }
+            if (closeRequested) {
+                closeRequested = false;
+                open = false;
+            }
+            return true;
+        }
+
+        // Whole blocks as soon as they fill
+        uint32_t pending = end - tail.load(std::memory_order_relaxed);
+        bool ok = true;
+        while (ok && pending >= blockBytes) {
+            ok = writeQueued(blockBytes);
+            pending = end - tail.load(std::memory_order_relaxed);
+        }
+
+        if (ok && ending) {
+            // The tail too - the only write that may end mid-sector
+            while (ok && pending > 0) {
+                ok = writeQueued(min(pending, (uint32_t)blockBytes));
+                pending = end - tail.load(std::memory_order_relaxed);
+            }
+            if (ok || ++failures >= SD_WRITER_GIVE_UP) {
+                finishFile(end, sidecarEnd);
+                continue;
+            }
+            return false;
+        }
+        if (ok && millis() - lastSyncMs >= syncInterval) {
+            ok = writeWholeSectors(pending);
+            if (ok) {
+                StallScope stall(monitor, stallSection);
+                SPIBusLease lease(arbiter, SPI_DEVICE_SD, busDeadline);
+                file.flush();
+                // After the data it describes
+                writeSidecar(sidecarEnd);
+                lastSyncMs = millis();
+                counters.syncs++;
+            }
+        }
+        return ok;
+    }
+}
+
+bool SdWriter::openNext() {
+    strlcpy(path, nextPath, sizeof(path));
+    fileAllocated = 0;
+    fileWritten = 0;
+    {
+        StallScope stall(monitor, stallSection);
+        SPIBusLease lease(arbiter, SPI_DEVICE_SD, busDeadline);
+        // A file that cannot be preallocated is still logged, grown as written
+        if (nextPreallocate > 0 && preallocate(path, nextPreallocate)) fileAllocated = nextPreallocate;
+        file = fs->open(path, fileAllocated ? "r+" : FILE_WRITE);
+        if (file && nextSidecarPath[0]) {
+            sidecar = fs->open(nextSidecarPath, FILE_WRITE);
+            if (!sidecar) counters.sidecarErrors++;
+        }
+    }
+    if (!file) {
+        counters.openErrors++;
+        if (++failures < SD_WRITER_GIVE_UP) return false;
+        // Give up on the whole session - the producer starts a new file when it notices
+        failures = 0;
+        open = false;
+        closeRequested = false;
+        nextPending.store(false, std::memory_order_release);
+        drop(head.load(std::memory_order_acquire));
+        writeSidecar(sidecarHead.load(std::memory_order_acquire));
+        return false;
+    }
+    failures = 0;
+    fileOpen = true;
+    lastSyncMs = millis();
+    counters.files++;
+    if (fileAllocated) counters.preallocated++;
+    if (fileHook) fileHook(path, true);
+    return true;
+}
+
+void SdWriter::finishFile(uint32_t end, uint32_t sidecarEnd) {
+    drop(end);
+    {
+        StallScope stall(monitor, stallSection);
+        SPIBusLease lease(arbiter, SPI_DEVICE_SD, busDeadline);
+        file.flush();
+        file.close();
+        writeSidecar(sidecarEnd);
+        if (sidecar) sidecar.close();
+        if (fileWritten < fileAllocated) trim(path, fileWritten);
+    }
+    counters.syncs++;
+    fileOpen = false;
+    failures = 0;
+    if (fileHook) fileHook(path, false);
+}
+
+void SdWriter::drop(uint32_t end) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (end == t) return;
+    counters.bytesDropped += end - t;
+    tail.store(end, std::memory_order_release);
+}
+
+void SdWriter::writeSidecar(uint32_t end) {
+    uint32_t t = sidecarTail.load(std::memory_order_relaxed);
+    if (end == t) return;
+    if (sidecar) {
+        size_t length = end - t;
+        size_t at = t % SD_SIDECAR_RING;
+        size_t first = min(length, SD_SIDECAR_RING - at);
+        size_t written = sidecar.write(sidecarRing + at, first);
+        if (first < length) written += sidecar.write(sidecarRing, length - first);
+        if (written != length) counters.sidecarErrors++;
+        sidecar.flush();
+    }
+    sidecarTail.store(end, std::memory_order_release);
+}
+
+bool SdWriter::writeWholeSectors(uint32_t pending) {
+    uint32_t whole = pending - pending % SD_SECTOR_SIZE;
+    while (whole > 0) {
+        uint32_t n = min(whole, (uint32_t)blockBytes);
+        if (!writeQueued(n)) return false;
+        whole -= n;
+    }
+    return true;
+}
+
+bool SdWriter::writeQueued(size_t length) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    size_t at = t % capacity;
+    size_t first = min(length, capacity - at);
+    memcpy(block, ring + at, first);
+    memcpy(block + first, ring, length - first);
+
+    int64_t start = esp_timer_get_time();
+    size_t written;
+    {
+        StallScope stall(monitor, stallSection);
+        SPIBusLease lease(arbiter, SPI_DEVICE_SD, busDeadline);
+        written = file.write(block, length);
+    }
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+    counters.writes++;
+    counters.lastWriteMicros = elapsed;
+    if (elapsed > counters.maxWriteMicros) counters.maxWriteMicros = elapsed;
+    if (elapsed >= stallThreshold) counters.stalls++;
+    uint8_t bucket = 0;
+    for (uint32_t ms = elapsed / 1000; ms > 0 && bucket < SD_LATENCY_BUCKETS - 1; ms >>= 1) bucket++;
+    histogram[fileAllocated ? 1 : 0][bucket]++;
+
+    // Whatever reached the file is done; the rest goes again later
+    tail.store(t + written, std::memory_order_release);
+    counters.bytesWritten += written;
+    fileWritten += written;
+    if (written != length) {
+        counters.writeErrors++;
+        return false;
+    }
+    return true;
+}
+
+bool SdWriter::fatPath(const char* filePath, char* out, size_t size) const {
+    return snprintf(out, size, "%s%s", fatDrive, filePath) < (int)size;
+}
+
+// Both run under the SD lease, on a file the VFS does not have open.
+// FIL carries a sector buffer, too big for the task stack.
+bool SdWriter::preallocate(const char* filePath, uint32_t bytes) {
+    static FIL fil;
+    char name[SD_WRITER_PATH_MAX + 4];
+    if (!fatPath(filePath, name, sizeof(name))) return false;
+    if (f_open(&fil, name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return false;
+
+    FRESULT result = FR_DENIED;
+#if FF_USE_EXPAND
+    // One contiguous run of clusters, FR_DENIED if the card has none that long
+    result = f_expand(&fil, bytes, 1);
+#endif
+    if (result != FR_OK) {
+        // Seeking past the end allocates the chain now, from the next free
+        // cluster on - contiguous on a card that is written sequentially
+        result = f_lseek(&fil, bytes);
+        if (result == FR_OK && f_tell(&fil) != bytes) result = FR_DENIED;
+    }
+    f_close(&fil);
+    if (result != FR_OK) f_unlink(name);
+    return result == FR_OK;
+}
+
+void SdWriter::trim(const char* filePath, uint32_t bytes) {
+    static FIL fil;
+    char name[SD_WRITER_PATH_MAX + 4];
+    if (!fatPath(filePath, name, sizeof(name))) return;
+    if (f_open(&fil, name, FA_WRITE | FA_OPEN_EXISTING) != FR_OK) return;
+    if (f_lseek(&fil, bytes) == FR_OK) f_truncate(&fil);
+    f_close(&fil);
+}
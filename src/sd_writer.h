@@ -0,0 +1,162 @@
+#ifndef SD_WRITER_H
+#define SD_WRITER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "spi_arbiter.h"
+#include "stall_monitor.h"
+
+#define SD_SECTOR_SIZE      512
+#define SD_WRITER_PATH_MAX  64
+#define SD_SIDECAR_RING     1024        // bytes of sidecar data waiting for a sync
+// Card write latency, log2 buckets: <1 ms, 1 ms, 2-3 ms, 4-7 ms ... >=512 ms
+#define SD_LATENCY_BUCKETS  11
+
+// Called from the task with a file it has just opened (open) or finished
+typedef void (*SdFileHook)(const char* path, bool open);
+
+struct SdWriterStats {
+    uint32_t capacity;          // ring bytes
+    uint32_t pending;           // bytes waiting for the card
+    uint32_t highWater;         // most bytes ever waiting
+    uint64_t bytesQueued;
+    uint64_t bytesWritten;
+    uint32_t writes;            // write() calls to the card
+    uint32_t syncs;             // flushes of the FAT and directory entry
+    uint32_t lastWriteMicros;
+    uint32_t maxWriteMicros;
+    uint32_t stalls;            // writes slower than the stall threshold
+    uint32_t writeErrors;       // short writes - the rest stays queued and is retried
+    uint32_t overflows;         // appends refused because the ring was full
+    uint32_t bytesDropped;      // given up on when a file could not be written or opened
+    uint32_t files;             // files opened
+    uint32_t preallocated;      // of those, opened preallocated
+    uint32_t openErrors;
+    uint32_t sidecarErrors;     // sidecar opens and short writes
+    uint32_t sidecarOverflows;  // sidecar appends refused because its ring was full
+};
+
+// Elastic SD writer. The main loop appends encoded records to a large ring
+// (PSRAM when there is some) and a low-priority task moves them to the card
+// in whole multi-sector blocks, so the file grows in sector-aligned steps and
+// the card never sees a partial-sector read-modify-write. A timed sync writes
+// every whole sector queued and flushes the FAT; the sub-sector tail waits for
+// the next one, or for the end of the file. A slow or stalled card only fills
+// the ring - a short write is retried, nothing queued is dropped.
+//
+// Files are opened by the task too. startFile() marks where in the stream a
+// file begins, so a log can roll to its next file without a gap: the task
+// finishes the old one at that point and carries on in the new one. With
+// preallocateBytes the file is created at full size as one contiguous run of
+// clusters where FatFs can (f_expand), so writes never wait on cluster
+// allocation, and it is trimmed to what was written when it is finished.
+//
+// A file can have a sidecar - a small companion file, such as an index,
+// fed through its own ring with appendSidecar() and written at each timed
+// sync, after the data it describes, and when the file is finished. It is
+// best effort: data that cannot be written is counted and dropped.
+//
+// One producer (append, startFile, close) and one consumer (the task).
+class SdWriter {
+public:
+    SdWriter(SPIArbiter& arbiter, uint32_t busDeadlineMicros, StallMonitor& monitor);
+
+    // Allocates the ring and the DMA bounce block and starts the task.
+    // blockBytes is a multiple of SD_SECTOR_SIZE. fatDrive is the FatFs
+    // drive the volume is mounted from ("0:"), used for preallocation.
+    bool begin(fs::FS& fs, const char* fatDrive, size_t ringBytes, size_t blockBytes,
+               UBaseType_t priority, BaseType_t core);
+    void configure(uint32_t syncIntervalMs, uint32_t stallMicros);
+    void setStallSection(int8_t id) { stallSection = id; }
+    void setFileHook(SdFileHook hook) { fileHook = hook; }
+
+    // Everything appended from now on goes to path, and to sidecarPath if
+    // given. While a file is open this rolls over to the new one. False
+    // while a previous start or close is still pending in the task.
+    bool startFile(const char* path, uint32_t preallocateBytes, const char* sidecarPath = nullptr);
+    // Drains everything queued, then finishes the file in the task
+    void close();
+    bool isOpen() const { return open && !closeRequested; }
+    bool busy() const { return open; }
+    // A startFile() the task has not acted on yet
+    bool rolling() const { return nextPending.load(std::memory_order_acquire); }
+    // Bytes appended since the last startFile()
+    uint32_t fileBytes() const { return head.load(std::memory_order_relaxed) - fileStartAt; }
+
+    // Producer side. All or nothing - false if the ring cannot take it.
+    bool append(const uint8_t* data, size_t length);
+    bool appendSidecar(const uint8_t* data, size_t length);
+
+    size_t freeSpace() const;
+
+    SdWriterStats stats() const;
+    // Write count per SD_LATENCY_BUCKETS bucket, for preallocated files or grown ones
+    const uint32_t* latencyHistogram(bool preallocated) const { return histogram[preallocated ? 1 : 0]; }
+    void resetStats();
+
+private:
+    static void taskEntry(void* parameter);
+    void run();
+    // One pass over the queue; false if the card needs a moment
+    bool service();
+    bool openNext();
+    void finishFile(uint32_t end, uint32_t sidecarEnd);
+    void drop(uint32_t end);
+    // Writes the sidecar up to end, or drops it with no sidecar open
+    void writeSidecar(uint32_t end);
+    // Writes the next length queued bytes; false on a short write
+    bool writeQueued(size_t length);
+    bool writeWholeSectors(uint32_t pending);
+    bool preallocate(const char* path, uint32_t bytes);
+    void trim(const char* path, uint32_t bytes);
+    bool fatPath(const char* path, char* out, size_t size) const;
+
+    SPIArbiter& arbiter;
+    uint32_t busDeadline;
+    StallMonitor& monitor;
+    fs::FS* fs;
+    const char* fatDrive;
+    uint8_t* ring;
+    size_t capacity;
+    uint8_t* block;             // internal, DMA-capable
+    size_t blockBytes;
+    uint32_t syncInterval;
+    uint32_t stallThreshold;
+    int8_t stallSection;
+    SdFileHook fileHook;
+    TaskHandle_t task;
+
+    // Producer to task
+    volatile bool open;
+    volatile bool closeRequested;
+    std::atomic<bool> nextPending;
+    uint32_t nextAt;            // stream position the next file starts at
+    uint32_t nextPreallocate;
+    char nextPath[SD_WRITER_PATH_MAX];
+    uint32_t fileStartAt;       // producer's copy of nextAt
+    std::atomic<uint32_t> head;  // producer, total bytes appended
+    std::atomic<uint32_t> tail;  // consumer, total bytes written
+    char nextSidecarPath[SD_WRITER_PATH_MAX];
+    uint32_t sidecarNextAt;     // sidecar stream position the next file starts at
+    std::atomic<uint32_t> sidecarHead;
+    std::atomic<uint32_t> sidecarTail;
+    uint8_t sidecarRing[SD_SIDECAR_RING];
+
+    // Task only
+    File file;
+    bool fileOpen;
+    char path[SD_WRITER_PATH_MAX];
+    File sidecar;
+    uint32_t fileAllocated;     // preallocated size, 0 if the file grows as written
+    uint32_t fileWritten;
+    uint32_t lastSyncMs;
+    uint8_t failures;
+
+    SdWriterStats counters;
+    uint32_t histogram[2][SD_LATENCY_BUCKETS];
+};
+
+#endif // SD_WRITER_H
@@ -0,0 +1,115 @@
+#include "spi_arbiter.h"
+#include <esp_timer.h>
+
+SPIArbiter::SPIArbiter() :
+    spi(nullptr),
+    owner(-1)
+{
+    portMUX_INITIALIZE(&lock);
+    for (uint8_t i = 0; i < SPI_DEVICE_COUNT; i++) {
+        waiters[i].waiting = false;
+        waiters[i].deadline = 0;
+        depth[i] = 0;
+        grantedAt[i] = 0;
+        deviceLock[i] = nullptr;
+        grant[i] = nullptr;
+    }
+    memset(deviceStats, 0, sizeof(deviceStats));
+}
+
+bool SPIArbiter::begin(SPIClass& bus, int8_t sck, int8_t miso, int8_t mosi) {
+    if (spi) return true;
+
+    for (uint8_t i = 0; i < SPI_DEVICE_COUNT; i++) {
+        deviceLock[i] = xSemaphoreCreateRecursiveMutex();
+        grant[i] = xSemaphoreCreateBinary();
+        if (!deviceLock[i] || !grant[i]) return false;
+    }
+
+    // The display driver may already have started the bus - begin() is then a no-op
+    bus.begin(sck, miso, mosi);
+    spi = &bus;
+    return true;
+}
+
+void SPIArbiter::acquire(SPIDevice device, uint32_t deadlineMicros) {
+    if (!spi) return;
+
+    xSemaphoreTakeRecursive(deviceLock[device], portMAX_DELAY);
+    if (depth[device]++ > 0) return;
+
+    int64_t requested = esp_timer_get_time();
+    int64_t deadline = requested + deadlineMicros;
+    bool granted = false;
+
+    portENTER_CRITICAL(&lock);
+    if (owner < 0) {
+        owner = device;
+        granted = true;
+    } else {
+        waiters[device].waiting = true;
+        waiters[device].deadline = deadline;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    // release() hands the bus over directly, so owner is already set on wake
+    if (!granted) {
+        xSemaphoreTake(grant[device], portMAX_DELAY);
+    }
+
+    int64_t start = esp_timer_get_time();
+    uint32_t waited = (uint32_t)(start - requested);
+
+    SPIDeviceStats& s = deviceStats[device];
+    s.grants++;
+    if (!granted) s.contended++;
+    if (start > deadline) s.deadlineMisses++;
+    s.waitMicros += waited;
+    if (waited > s.maxWaitMicros) s.maxWaitMicros = waited;
+
+    grantedAt[device] = start;
+}
+
+void SPIArbiter::release(SPIDevice device) {
+    if (!spi || depth[device] == 0) return;
+
+    if (--depth[device] > 0) {
+        xSemaphoreGiveRecursive(deviceLock[device]);
+        return;
+    }
+
+    uint32_t held = (uint32_t)(esp_timer_get_time() - grantedAt[device]);
+    SPIDeviceStats& s = deviceStats[device];
+    s.holdMicros += held;
+    if (held > s.maxHoldMicros) s.maxHoldMicros = held;
+
+    // Earliest deadline first; device order breaks ties
+    int8_t next = -1;
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < SPI_DEVICE_COUNT; i++) {
+        if (!waiters[i].waiting) continue;
+        if (next < 0 || waiters[i].deadline < waiters[next].deadline) {
+            next = i;
+        }
+    }
+    owner = next;
+    if (next >= 0) waiters[next].waiting = false;
+    portEXIT_CRITICAL(&lock);
+
+    if (next >= 0) {
+        xSemaphoreGive(grant[next]);
+    }
+    xSemaphoreGiveRecursive(deviceLock[device]);
+}
+
+void SPIArbiter::resetStats() {
+    memset(deviceStats, 0, sizeof(deviceStats));
+}
+
+const char* SPIArbiter::deviceName(SPIDevice device) {
+    switch (device) {
+        case SPI_DEVICE_TFT: return "TFT";
+        case SPI_DEVICE_SD:  return "SD";
+        default:             return "?";
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef SPI_ARBITER_H
+#define SPI_ARBITER_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Devices sharing the SPI pins, in priority order (lower value wins ties)
+enum SPIDevice {
+    SPI_DEVICE_TFT = 0,
+    SPI_DEVICE_SD,
+    SPI_DEVICE_COUNT
+};
+
+// Per-device bus usage
+struct SPIDeviceStats {
+    uint32_t grants;
+    uint32_t contended;       // grants that had to wait for another device
+    uint32_t deadlineMisses;  // grants that came after the requested deadline
+    uint64_t waitMicros;
+    uint32_t maxWaitMicros;
+    uint64_t holdMicros;
+    uint32_t maxHoldMicros;
+};
+
+// Serializes access to the SPI bus shared by the display and the SD card.
+// A device holds the bus for one burst (a display band, an SD read or write)
+// and releases it; while it holds the bus, other requests wait and the next
+// grant goes to the earliest deadline, with device priority breaking ties.
+// acquire() is re-entrant per device so SD helpers can nest.
+class SPIArbiter {
+public:
+    SPIArbiter();
+
+    // Start the shared bus once; later calls are no-ops
+    bool begin(SPIClass& spi, int8_t sck, int8_t miso, int8_t mosi);
+
+    // Block until the device owns the bus. deadlineMicros is relative to now.
+    void acquire(SPIDevice device, uint32_t deadlineMicros);
+    void release(SPIDevice device);
+
+    const SPIDeviceStats& stats(SPIDevice device) const { return deviceStats[device]; }
+    void resetStats();
+
+    static const char* deviceName(SPIDevice device);
+
+private:
+    struct Waiter {
+        bool waiting;
+        int64_t deadline;
+    };
+
+    SPIClass* spi;
+    portMUX_TYPE lock;
+    int8_t owner;
+    Waiter waiters[SPI_DEVICE_COUNT];
+    uint8_t depth[SPI_DEVICE_COUNT];
+    int64_t grantedAt[SPI_DEVICE_COUNT];
+    SemaphoreHandle_t deviceLock[SPI_DEVICE_COUNT]; // serializes tasks using one device
+    SemaphoreHandle_t grant[SPI_DEVICE_COUNT];      // bus hand-over from release()
+    SPIDeviceStats deviceStats[SPI_DEVICE_COUNT];
+};
+
+// Scoped bus ownership
+class SPIBusLease {
+public:
+    SPIBusLease(SPIArbiter& arbiter, SPIDevice device, uint32_t deadlineMicros) :
+        arbiter(arbiter),
+        device(device)
+    {
+        arbiter.acquire(device, deadlineMicros);
+    }
+    ~SPIBusLease() { arbiter.release(device); }
+
+private:
+    SPIArbiter& arbiter;
+    SPIDevice device;
+
+    SPIBusLease(const SPIBusLease&);
+    SPIBusLease& operator=(const SPIBusLease&);
+};
+
+#endif // SPI_ARBITER_H
@@ -0,0 +1,160 @@
+#include "stall_monitor.h"
+#include <esp_timer.h>
+
+StallMonitor::StallMonitor() :
+    count(0),
+    head(0),
+    used(0),
+    nextSequence(1),
+    total(0)
+{
+    portMUX_INITIALIZE(&lock);
+    memset(sections, 0, sizeof(sections));
+    memset(ring, 0, sizeof(ring));
+}
+
+int8_t StallMonitor::addSection(const char* name, uint32_t budgetMicros) {
+    if (count >= STALL_MAX_SECTIONS) return -1;
+    StallSection& s = sections[count];
+    s.name = name;
+    s.budgetMicros = budgetMicros;
+    return count++;
+}
+
+int8_t StallMonitor::findSection(const char* name) const {
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcmp(sections[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+void StallMonitor::setBudget(uint8_t id, uint32_t budgetMicros) {
+    if (id < count) sections[id].budgetMicros = budgetMicros;
+}
+
+void StallMonitor::enter(uint8_t id) {
+    StallSection& s = sections[id];
+    s.entries++;
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    s.enteredAt = now ? now : 1;
+}
+
+void StallMonitor::exit(uint8_t id) {
+    StallSection& s = sections[id];
+    uint32_t entered = s.enteredAt;
+    if (entered == 0) return;
+    int64_t now = esp_timer_get_time();
+    uint32_t duration = (uint32_t)now - entered;
+
+    portENTER_CRITICAL(&lock);
+    s.enteredAt = 0;
+    if (duration > s.maxMicros) s.maxMicros = duration;
+    if (s.openSequence) {
+        // check() already reported it - record the final duration
+        extend(s.openSequence, STALL_STUCK, duration);
+        s.openSequence = 0;
+    } else if (s.budgetMicros > 0 && duration > s.budgetMicros) {
+        s.stalls++;
+        push(id, STALL_OVERRUN, duration, (uint32_t)((now - duration) / 1000));
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void StallMonitor::check() {
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < count; i++) {
+        StallSection& s = sections[i];
+        uint32_t entered = s.enteredAt;
+        if (entered == 0 || s.budgetMicros == 0) continue;
+
+        uint32_t open = (uint32_t)now - entered;
+        if (open <= s.budgetMicros) continue;
+
+        if (s.openSequence && extend(s.openSequence, STALL_STUCK, open)) continue;
+        s.stalls++;
+        s.openSequence = push(i, STALL_STUCK, open, (uint32_t)((now - open) / 1000));
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+int8_t StallMonitor::longestOpenSection(uint32_t& openMicros) const {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    int8_t longest = -1;
+    openMicros = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t entered = sections[i].enteredAt;
+        if (entered == 0) continue;
+        uint32_t open = now - entered;
+        if (longest < 0 || open > openMicros) {
+            longest = i;
+            openMicros = open;
+        }
+    }
+    return longest;
+}
+
+void StallMonitor::recordHang(uint8_t id, uint32_t durationMicros, uint32_t atMs) {
+    if (id >= count) return;
+    portENTER_CRITICAL(&lock);
+    sections[id].stalls++;
+    push(id, STALL_HANG, durationMicros, atMs);
+    portEXIT_CRITICAL(&lock);
+}
+
+bool StallMonitor::getRecord(uint8_t index, StallRecord& record) const {
+    if (index >= used) return false;
+    portENTER_CRITICAL(&lock);
+    record = ring[(head + STALL_RING_SIZE - 1 - index) % STALL_RING_SIZE];
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+void StallMonitor::resetStats() {
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < count; i++) {
+        sections[i].entries = 0;
+        sections[i].stalls = 0;
+        sections[i].maxMicros = 0;
+        sections[i].openSequence = 0;
+    }
+    head = 0;
+    used = 0;
+    nextSequence = 1;
+    total = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+const char* StallMonitor::kindName(uint8_t kind) {
+    switch (kind) {
+        case STALL_OVERRUN: return "overrun";
+        case STALL_STUCK:   return "stuck";
+        case STALL_HANG:    return "hang";
+        default:            return "?";
+    }
+}
+
+// Called with the lock held
+uint32_t StallMonitor::push(uint8_t id, uint8_t kind, uint32_t durationMicros, uint32_t atMs) {
+    StallRecord& r = ring[head];
+    r.sequence = nextSequence++;
+    r.section = id;
+    r.kind = kind;
+    r.durationMicros = durationMicros;
+    r.atMs = atMs;
+    head = (head + 1) % STALL_RING_SIZE;
+    if (used < STALL_RING_SIZE) used++;
+    total++;
+    return r.sequence;
+}
+
+// Called with the lock held; false once the record has been overwritten
+bool StallMonitor::extend(uint32_t sequence, uint8_t kind, uint32_t durationMicros) {
+    if (nextSequence - sequence > STALL_RING_SIZE) return false;
+    StallRecord& r = ring[(sequence - 1) % STALL_RING_SIZE];
+    if (r.sequence != sequence) return false;
+    r.kind = kind;
+    r.durationMicros = durationMicros;
+    return true;
+}
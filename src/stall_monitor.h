@@ -0,0 +1,107 @@
+#ifndef STALL_MONITOR_H
+#define STALL_MONITOR_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+#define STALL_MAX_SECTIONS  24
+#define STALL_RING_SIZE     16
+
+enum StallKind {
+    STALL_OVERRUN = 0,  // section finished, but over its budget
+    STALL_STUCK,        // still running when check() found it over budget
+    STALL_HANG          // reset by the task watchdog inside the section
+};
+
+struct StallRecord {
+    uint32_t sequence;
+    uint8_t section;
+    uint8_t kind;
+    uint32_t durationMicros;
+    uint32_t atMs;              // ms since boot when the section was entered
+};
+
+struct StallSection {
+    const char* name;
+    uint32_t budgetMicros;
+    // Low 32 bits of esp_timer µs, 0 while outside: one word, so check()
+    // and the watchdog ISR never read it half-written. Sections open for
+    // under 71 minutes still time correctly across the wrap.
+    volatile uint32_t enteredAt;
+    uint32_t entries;
+    uint32_t stalls;
+    uint32_t maxMicros;
+    uint32_t openSequence;      // record still being extended, 0 = none
+};
+
+// Attributes main loop and task hiccups to the subsystem that caused them.
+// Each monitored section - a scheduler job, a task loop, a BLE callback -
+// stamps enter() and exit(); a section that runs past its budget leaves a
+// record in a ring of the last STALL_RING_SIZE stalls. check(), called from
+// a context that keeps running while the main loop is blocked, catches a
+// section that is still stuck and keeps extending its record until it exits.
+// A section is only ever entered by one task at a time.
+class StallMonitor {
+public:
+    StallMonitor();
+
+    // Returns the section id, or -1 if the table is full
+    int8_t addSection(const char* name, uint32_t budgetMicros);
+    int8_t findSection(const char* name) const;
+    void setBudget(uint8_t id, uint32_t budgetMicros);
+
+    void enter(uint8_t id);
+    void exit(uint8_t id);
+    void check();
+
+    // Section open for longest, -1 if none - task watchdog attribution
+    int8_t longestOpenSection(uint32_t& openMicros) const;
+    // Hang carried across a watchdog reset
+    void recordHang(uint8_t id, uint32_t durationMicros, uint32_t atMs);
+
+    uint8_t sectionCount() const { return count; }
+    const StallSection& section(uint8_t id) const { return sections[id]; }
+    uint8_t recordCount() const { return used; }
+    // 0 = newest; false if there is no such record
+    bool getRecord(uint8_t index, StallRecord& record) const;
+    uint32_t totalStalls() const { return total; }
+
+    void resetStats();
+
+    static const char* kindName(uint8_t kind);
+
+private:
+    StallSection sections[STALL_MAX_SECTIONS];
+    uint8_t count;
+
+    StallRecord ring[STALL_RING_SIZE];
+    uint8_t head;               // next slot to write
+    uint8_t used;
+    uint32_t nextSequence;
+    uint32_t total;
+    mutable portMUX_TYPE lock;
+
+    uint32_t push(uint8_t id, uint8_t kind, uint32_t durationMicros, uint32_t atMs);
+    bool extend(uint32_t sequence, uint8_t kind, uint32_t durationMicros);
+};
+
+// Scoped section
+class StallScope {
+public:
+    StallScope(StallMonitor& monitor, int8_t id) :
+        monitor(monitor),
+        id(id)
+    {
+        if (id >= 0) monitor.enter(id);
+    }
+    ~StallScope() { if (id >= 0) monitor.exit(id); }
+
+private:
+    StallMonitor& monitor;
+    int8_t id;
+
+    StallScope(const StallScope&);
+    StallScope& operator=(const StallScope&);
+};
+
+#endif // STALL_MONITOR_H
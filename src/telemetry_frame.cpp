@@ -0,0 +1,80 @@
+#include "telemetry_frame.h"
+#include <string.h>
+
+TelemetryBatcher::TelemetryBatcher(const RecordSchema& schema, uint32_t linearMask) :
+    schema(schema),
+    encoder(schema, linearMask, TELEMETRY_MAX_RECORDS),
+    deviceId(0),
+    recordLimit(1),
+    latencyBudget(0),
+    wantDelta(false),
+    delta(false),
+    count(0),
+    used(0),
+    firstLocalMicros(0),
+    firstUtcMicros(0),
+    sequence(0),
+    recordTotal(0)
+{
+}
+
+void TelemetryBatcher::configure(uint8_t maxRecords, uint32_t latencyBudgetMicros) {
+    if (maxRecords < 1) maxRecords = 1;
+    if (maxRecords > TELEMETRY_MAX_RECORDS) maxRecords = TELEMETRY_MAX_RECORDS;
+    recordLimit = maxRecords;
+    latencyBudget = latencyBudgetMicros;
+}
+
+bool TelemetryBatcher::add(const uint8_t* record, int64_t localMicros, int64_t utcMicros) {
+    if (count == 0) {
+        delta = wantDelta;
+        firstLocalMicros = localMicros;
+        firstUtcMicros = utcMicros;
+        if (delta) encoder.reset();
+    }
+
+    if (delta) {
+        used += encoder.encode(record, payload + used);
+    } else {
+        memcpy(payload + used, record, schema.size);
+        used += schema.size;
+    }
+    count++;
+    recordTotal++;
+
+    // Full, or the next record might not fit
+    size_t worst = delta ? RECORD_STREAM_MAX_FRAME(schema.fieldCount) : schema.size;
+    return count >= recordLimit || used + worst > sizeof(payload);
+}
+
+bool TelemetryBatcher::due(int64_t nowLocalMicros) const {
+    return count > 0 && nowLocalMicros - firstLocalMicros >= (int64_t)latencyBudget;
+}
+
+bool TelemetryBatcher::take(TelemetryFrame& out) {
+    if (count == 0) return false;
+
+    TelemetryFrameHeader header;
+    header.magic = TELEMETRY_FRAME_MAGIC;
+    header.version = TELEMETRY_FRAME_VERSION;
+    header.flags = delta ? TELEMETRY_FRAME_DELTA : 0;
+    header.deviceId = deviceId;
+    header.sequence = sequence++;
+    header.firstSampleMicros = firstUtcMicros;
+    header.sentMicros = 0;
+    header.recordCount = count;
+    header.recordSize = delta ? 0 : schema.size;
+    header.payloadLength = used;
+
+    memcpy(out.data, &header, sizeof(header));
+    memcpy(out.data + sizeof(header), payload, used);
+    out.length = sizeof(header) + used;
+
+    count = 0;
+    used = 0;
+    return true;
+}
+
+void TelemetryBatcher::stampSent(TelemetryFrame& frame, int64_t utcMicros) {
+    memcpy(frame.data + offsetof(TelemetryFrameHeader, sentMicros), &utcMicros, sizeof(utcMicros));
+}
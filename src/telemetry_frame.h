@@ -0,0 +1,82 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "packet_schema.h"
+#include "record_stream.h"
+
+#define TELEMETRY_FRAME_MAGIC     0x4C47  // "GL" on the wire
+#define TELEMETRY_FRAME_VERSION   1
+#define TELEMETRY_FRAME_DELTA     0x01    // flags: records are record_stream frames
+#define TELEMETRY_FRAME_MAX_BYTES 1024    // well under a 1472-byte UDP payload
+#define TELEMETRY_MAX_RECORDS     32
+
+// Little-endian, followed by payloadLength bytes of records
+struct __attribute__((packed)) TelemetryFrameHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t deviceId;
+    uint32_t sequence;          // per frame, from 0 at boot
+    int64_t firstSampleMicros;  // UTC µs of the first record, 0 if time unknown
+    int64_t sentMicros;         // UTC µs when handed to the network, 0 if unknown
+    uint8_t recordCount;
+    uint8_t recordSize;         // raw record size, 0 for delta frames
+    uint16_t payloadLength;
+};
+
+struct TelemetryFrame {
+    uint16_t length;
+    uint8_t data[TELEMETRY_FRAME_MAX_BYTES];
+};
+
+// Packs consecutive records into one frame, closed when it holds
+// maxRecords or its first record is older than the latency budget.
+// Delta frames restart the record stream with a keyframe, so every
+// frame decodes on its own and a lost datagram costs only its records.
+class TelemetryBatcher {
+public:
+    TelemetryBatcher(const RecordSchema& schema, uint32_t linearMask);
+
+    void setDeviceId(uint32_t id) { deviceId = id; }
+    void configure(uint8_t maxRecords, uint32_t latencyBudgetMicros);
+    // Applies from the next frame
+    void setDelta(bool delta) { wantDelta = delta; }
+
+    // Returns true once the frame is full and should be taken
+    bool add(const uint8_t* record, int64_t localMicros, int64_t utcMicros);
+    // Open frame held longer than the latency budget
+    bool due(int64_t nowLocalMicros) const;
+    bool pending() const { return count > 0; }
+    // Closes the open frame into out; false if there is none
+    bool take(TelemetryFrame& out);
+
+    // Sender side, just before the frame goes out
+    static void stampSent(TelemetryFrame& frame, int64_t utcMicros);
+
+    uint8_t maxRecords() const { return recordLimit; }
+    uint32_t latencyBudgetMicros() const { return latencyBudget; }
+    uint32_t frames() const { return sequence; }
+    uint32_t records() const { return recordTotal; }
+
+private:
+    const RecordSchema& schema;
+    RecordStreamEncoder encoder;
+    uint32_t deviceId;
+    uint8_t recordLimit;
+    uint32_t latencyBudget;
+    bool wantDelta;
+
+    bool delta;                 // encoding of the open frame
+    uint8_t count;
+    size_t used;                // payload bytes
+    int64_t firstLocalMicros;
+    int64_t firstUtcMicros;
+    uint8_t payload[TELEMETRY_FRAME_MAX_BYTES - sizeof(TelemetryFrameHeader)];
+
+    uint32_t sequence;
+    uint32_t recordTotal;
+};
+
+#endif // TELEMETRY_FRAME_H
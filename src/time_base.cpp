@@ -0,0 +1,159 @@
+#include "time_base.h"
+
+// Errors beyond this re-step the clock instead of slewing it
+static const int64_t STEP_THRESHOLD_US = 100000;
+// Residual below which an edge counts towards lock
+static const int64_t LOCK_THRESHOLD_US = 1000;
+static const uint8_t LOCK_EDGES = 4;
+// PPS keeps NAV-PVT edges out of the loop for this long after each pulse
+static const int64_t PPS_HOLDOFF_US = 2000000;
+static const double MAX_RATE = 500e-6;
+// NAV-PVT edges are reduced to their least-delayed member per window
+static const int64_t PVT_WINDOW_US = 1000000;
+
+TimeBase::TimeBase() : version(0) {
+    reset();
+}
+
+void TimeBase::reset() {
+    initialized = false;
+    locked = false;
+    refLocal = 0;
+    refGnss = 0;
+    lastPpsLocal = 0;
+    rate = 0.0;
+    lastResidual = 0;
+    maxResidual = 0;
+    edges = 0;
+    ppsEdges = 0;
+    steps = 0;
+    goodEdges = 0;
+    windowCount = 0;
+    windowStart = 0;
+    bestLocal = 0;
+    bestGnss = 0;
+    publish();
+}
+
+void TimeBase::addEdge(int64_t localMicros, int64_t gnssMicros, EdgeSource source) {
+    edges++;
+
+    if (source == EDGE_PPS) {
+        ppsEdges++;
+        lastPpsLocal = localMicros;
+        discipline(localMicros, gnssMicros, 0.5, 0.1);
+        return;
+    }
+
+    if (ppsEdges > 0 && localMicros - lastPpsLocal < PPS_HOLDOFF_US) {
+        // PPS is disciplining the clock - message arrival adds nothing
+        return;
+    }
+
+    if (!initialized) {
+        discipline(localMicros, gnssMicros, 0.0, 0.0);
+        return;
+    }
+
+    // Latency only ever delays an arrival, so the smallest local-minus-GNSS
+    // difference in the window is the edge closest to the true epoch
+    if (windowCount == 0 || localMicros - gnssMicros < bestLocal - bestGnss) {
+        bestLocal = localMicros;
+        bestGnss = gnssMicros;
+    }
+    if (windowCount == 0) {
+        windowStart = localMicros;
+    }
+    windowCount++;
+
+    if (localMicros - windowStart >= PVT_WINDOW_US) {
+        windowCount = 0;
+        // Residual jitter is still ~1 ms here, so correct and integrate
+        // gently - faster gains let it walk the drift estimate by ±50 ppm
+        discipline(bestLocal, bestGnss, 0.1, 0.0005);
+    }
+}
+
+void TimeBase::discipline(int64_t localMicros, int64_t gnssMicros, double kp, double ki) {
+    if (!initialized) {
+        refLocal = localMicros;
+        refGnss = gnssMicros;
+        initialized = true;
+        publish();
+        return;
+    }
+
+    int64_t dt = localMicros - refLocal;
+    if (dt <= 0) return;
+
+    int64_t predicted = refGnss + dt + (int64_t)(dt * rate);
+    int64_t error = gnssMicros - predicted;
+
+    if (error > STEP_THRESHOLD_US || error < -STEP_THRESHOLD_US) {
+        // Receiver time jump or first lock after a long gap
+        steps++;
+        refLocal = localMicros;
+        refGnss = gnssMicros;
+        locked = false;
+        goodEdges = 0;
+        publish();
+        return;
+    }
+
+    refGnss = predicted + (int64_t)(kp * error);
+    refLocal = localMicros;
+    rate += ki * (double)error / (double)dt;
+    if (rate > MAX_RATE) rate = MAX_RATE;
+    if (rate < -MAX_RATE) rate = -MAX_RATE;
+    publish();
+
+    lastResidual = (int32_t)error;
+    uint32_t absError = (uint32_t)(error < 0 ? -error : error);
+
+    if (absError < LOCK_THRESHOLD_US) {
+        if (goodEdges < LOCK_EDGES) goodEdges++;
+    } else {
+        goodEdges = 0;
+    }
+    locked = goodEdges >= LOCK_EDGES;
+
+    if (locked && absError > maxResidual) {
+        maxResidual = absError;
+    }
+}
+
+void TimeBase::publish() {
+    uint32_t next = version.load(std::memory_order_relaxed) + 1;
+    Reference& slot = published[next & 1];
+    slot.valid = initialized;
+    slot.local = refLocal;
+    slot.gnss = refGnss;
+    slot.rate = rate;
+    version.store(next, std::memory_order_release);
+}
+
+// The slot read is the one the writer is not filling, unless an update
+// completed meanwhile and the next one began on it - then read again. The
+// writer never waits, so a reader that preempted it does not spin.
+TimeBase::Reference TimeBase::reference() const {
+    Reference copy;
+    uint32_t seen = version.load(std::memory_order_acquire);
+    for (;;) {
+        copy = published[seen & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t now = version.load(std::memory_order_acquire);
+        if (now == seen) return copy;
+        seen = now;
+    }
+}
+
+int64_t TimeBase::toGnssMicros(int64_t localMicros) const {
+    Reference ref = reference();
+    if (!ref.valid) return 0;
+    int64_t dt = localMicros - ref.local;
+    return ref.gnss + dt + (int64_t)(dt * ref.rate);
+}
+
+float TimeBase::driftPpm() const {
+    return (float)(reference().rate * 1e6);
+}
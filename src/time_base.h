@@ -0,0 +1,84 @@
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Maps the monotonic local microsecond clock (esp_timer) onto GNSS time,
+// expressed as UTC microseconds since 1970.
+//
+// Each reference edge pairs a local timestamp with the GNSS time it
+// represents. PPS edges feed the loop directly. NAV-PVT arrival stamps carry
+// a variable, always-positive receiver/UART latency, so only the earliest
+// arrival in each one second window is used; that removes the latency jitter
+// but leaves the minimum latency as a constant bias.
+// A second-order loop tracks both phase and the local oscillator drift.
+//
+// One task feeds edges; any task or core may convert. The reference point
+// is published to two alternating slots under a version count, so a
+// reader gets a consistent copy of the 64-bit fields without a lock and
+// never waits on the feeding task.
+// No Arduino dependencies so it can be exercised with a fake clock on the host.
+class TimeBase {
+public:
+    enum EdgeSource {
+        EDGE_PPS,
+        EDGE_NAV_PVT
+    };
+
+    TimeBase();
+
+    void reset();
+
+    // Feed one reference edge
+    void addEdge(int64_t localMicros, int64_t gnssMicros, EdgeSource source);
+
+    // Local clock to GNSS time; returns 0 until the first edge
+    int64_t toGnssMicros(int64_t localMicros) const;
+
+    bool isLocked() const { return locked; }
+    bool hasPps() const { return ppsEdges > 0; }
+    float driftPpm() const;
+    int32_t lastResidualMicros() const { return lastResidual; }
+    uint32_t maxResidualMicros() const { return maxResidual; }
+    uint32_t edgeCount() const { return edges; }
+    uint32_t stepCount() const { return steps; }
+
+private:
+    struct Reference {
+        bool valid;
+        int64_t local;
+        int64_t gnss;
+        double rate;
+    };
+
+    bool initialized;
+    bool locked;
+    int64_t refLocal;      // local time of the last reference point
+    int64_t refGnss;       // GNSS time at refLocal
+    int64_t lastPpsLocal;
+    double rate;           // fractional frequency error of the local clock
+    int32_t lastResidual;
+    uint32_t maxResidual;
+    uint32_t edges;
+    uint32_t ppsEdges;
+    uint32_t steps;
+    uint8_t goodEdges;
+
+    // NAV-PVT minimum-latency window
+    uint32_t windowCount;
+    int64_t windowStart;
+    int64_t bestLocal;
+    int64_t bestGnss;
+
+    // Published copy of initialized, refLocal, refGnss and rate: the
+    // feeding task writes slot version + 1 & 1, then bumps version
+    Reference published[2];
+    std::atomic<uint32_t> version;
+
+    void discipline(int64_t localMicros, int64_t gnssMicros, double kp, double ki);
+    void publish();
+    Reference reference() const;
+};
+
+#endif // TIME_BASE_H
@@ -0,0 +1,216 @@
+#include "ubx_parser.h"
+
+// Little-endian field readers straight from the frame buffer
+static inline uint16_t readU2(const uint8_t* p) {
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t readU4(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int32_t readI4(const uint8_t* p) {
+    return (int32_t)readU4(p);
+}
+
+// Time a byte was on the wire, from how many bytes followed it in its chunk
+static inline int64_t byteArrival(int64_t nowMicros, size_t later, uint32_t byteTimeNanos) {
+    return nowMicros - (int64_t)(((uint64_t)later * byteTimeNanos) / 1000);
+}
+
+uint32_t UbxNavPvt::unixEpoch() const {
+    // Days from civil (proleptic Gregorian), valid for 1970..2105
+    int32_t y = year;
+    uint32_t m = month;
+    y -= m <= 2;
+    int32_t era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + (int32_t)doe - 719468;
+    if (days < 0) return 0;
+    return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+int64_t UbxNavPvt::epochMicros() const {
+    if ((valid & 0x03) != 0x03) return 0; // validDate | validTime
+    // Date/time are rounded to the nearest second, nano holds the remainder
+    return (int64_t)unixEpoch() * 1000000LL + nano / 1000;
+}
+
+UbxParser::UbxParser() :
+    state(WAIT_SYNC_1),
+    msgClass(0),
+    msgId(0),
+    payloadLength(0),
+    payloadIndex(0),
+    ckA(0),
+    ckB(0),
+    rxCkA(0),
+    frameStartMicros(0),
+    byteTimeNanos(10851), // 921600 baud, 10 bits per byte
+    pvtCallback(nullptr),
+    pvtContext(nullptr),
+    frameCallback(nullptr),
+    frameContext(nullptr),
+    frameCount(0),
+    pvtCount(0),
+    checksumErrorCount(0),
+    lengthErrorCount(0)
+{
+}
+
+void UbxParser::setPvtCallback(PvtCallback callback, void* context) {
+    pvtCallback = callback;
+    pvtContext = context;
+}
+
+void UbxParser::setFrameCallback(FrameCallback callback, void* context) {
+    frameCallback = callback;
+    frameContext = context;
+}
+
+void UbxParser::setBaudRate(uint32_t baud) {
+    if (baud > 0) {
+        byteTimeNanos = 10000000000ULL / baud;
+    }
+}
+
+void UbxParser::reset() {
+    state = WAIT_SYNC_1;
+}
+
+void UbxParser::feed(const uint8_t* data, size_t length, int64_t nowMicros) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t b = data[i];
+
+        switch (state) {
+            case WAIT_SYNC_1:
+                if (b == UBX_SYNC_1) {
+                    // Back-date to when this byte was on the wire
+                    frameStartMicros = byteArrival(nowMicros, length - 1 - i, byteTimeNanos);
+                    state = WAIT_SYNC_2;
+                }
+                break;
+
+            case WAIT_SYNC_2:
+                if (b == UBX_SYNC_2) {
+                    state = READ_CLASS;
+                } else if (b == UBX_SYNC_1) {
+                    // The earlier one was noise - this may be the frame start
+                    frameStartMicros = byteArrival(nowMicros, length - 1 - i, byteTimeNanos);
+                } else {
+                    state = WAIT_SYNC_1;
+                }
+                break;
+
+            case READ_CLASS:
+                msgClass = b;
+                ckA = ckB = 0;
+                checksum(b);
+                state = READ_ID;
+                break;
+
+            case READ_ID:
+                msgId = b;
+                checksum(b);
+                state = READ_LENGTH_1;
+                break;
+
+            case READ_LENGTH_1:
+                payloadLength = b;
+                checksum(b);
+                state = READ_LENGTH_2;
+                break;
+
+            case READ_LENGTH_2:
+                payloadLength |= (uint16_t)b << 8;
+                checksum(b);
+                payloadIndex = 0;
+                if (payloadLength > UBX_MAX_PAYLOAD) {
+                    lengthErrorCount++;
+                    state = WAIT_SYNC_1;
+                } else {
+                    state = payloadLength > 0 ? READ_PAYLOAD : READ_CK_A;
+                }
+                break;
+
+            case READ_PAYLOAD: {
+                // Copy as much of the payload as this chunk holds in one go
+                size_t n = payloadLength - payloadIndex;
+                if (n > length - i) n = length - i;
+                for (size_t k = 0; k < n; k++) {
+                    uint8_t c = data[i + k];
+                    payload[payloadIndex + k] = c;
+                    checksum(c);
+                }
+                payloadIndex += n;
+                i += n - 1;
+                if (payloadIndex >= payloadLength) {
+                    state = READ_CK_A;
+                }
+                break;
+            }
+
+            case READ_CK_A:
+                rxCkA = b;
+                state = READ_CK_B;
+                break;
+
+            case READ_CK_B:
+                if (rxCkA == ckA && b == ckB) {
+                    frameCount++;
+                    dispatchFrame();
+                } else {
+                    checksumErrorCount++;
+                }
+                state = WAIT_SYNC_1;
+                break;
+        }
+    }
+}
+
+void UbxParser::dispatchFrame() {
+    if (msgClass == UBX_CLASS_NAV && msgId == UBX_NAV_PVT) {
+        UbxNavPvt pvt;
+        if (decodeNavPvt(payload, payloadLength, pvt)) {
+            pvt.arrivalMicros = frameStartMicros;
+            pvtCount++;
+            if (pvtCallback) pvtCallback(pvt, pvtContext);
+        }
+    }
+
+    if (frameCallback) {
+        frameCallback(msgClass, msgId, payload, payloadLength, frameContext);
+    }
+}
+
+bool UbxParser::decodeNavPvt(const uint8_t* p, uint16_t length, UbxNavPvt& pvt) {
+    if (length < UBX_NAV_PVT_LEN) return false;
+
+    pvt.arrivalMicros = 0;
+    pvt.iTOW    = readU4(p + 0);
+    pvt.year    = readU2(p + 4);
+    pvt.month   = p[6];
+    pvt.day     = p[7];
+    pvt.hour    = p[8];
+    pvt.minute  = p[9];
+    pvt.second  = p[10];
+    pvt.valid   = p[11];
+    pvt.tAcc    = readU4(p + 12);
+    pvt.nano    = readI4(p + 16);
+    pvt.fixType = p[20];
+    pvt.flags   = p[21];
+    pvt.numSV   = p[23];
+    pvt.lon     = readI4(p + 24);
+    pvt.lat     = readI4(p + 28);
+    pvt.height  = readI4(p + 32);
+    pvt.hMSL    = readI4(p + 36);
+    pvt.hAcc    = readU4(p + 40);
+    pvt.vAcc    = readU4(p + 44);
+    pvt.gSpeed  = readI4(p + 60);
+    pvt.headMot = readI4(p + 64);
+    pvt.pDOP    = readU2(p + 76);
+    return true;
+}
@@ -0,0 +1,115 @@
+#ifndef UBX_PARSER_H
+#define UBX_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// UBX protocol constants
+#define UBX_SYNC_1          0xB5
+#define UBX_SYNC_2          0x62
+#define UBX_CLASS_NAV       0x01
+#define UBX_CLASS_ACK       0x05
+#define UBX_NAV_PVT         0x07
+#define UBX_NAV_PVT_LEN     92
+#define UBX_MAX_PAYLOAD     512
+
+// Decoded UBX-NAV-PVT, fields in receiver units
+struct UbxNavPvt {
+    int64_t arrivalMicros;   // local time the first sync byte arrived
+    uint32_t iTOW;           // ms GPS time of week
+    uint16_t year;
+    uint8_t month, day, hour, minute, second;
+    uint8_t valid;           // validDate / validTime / fullyResolved bits
+    uint32_t tAcc;           // ns
+    int32_t nano;            // ns fraction of second, may be negative
+    uint8_t fixType;
+    uint8_t flags;
+    uint8_t numSV;
+    int32_t lon, lat;        // deg * 1e7
+    int32_t height;          // mm above ellipsoid
+    int32_t hMSL;            // mm above mean sea level
+    uint32_t hAcc, vAcc;     // mm
+    int32_t gSpeed;          // mm/s
+    int32_t headMot;         // deg * 1e5
+    uint16_t pDOP;           // 0.01
+
+    // Seconds since 1970-01-01 UTC from the date/time fields
+    uint32_t unixEpoch() const;
+    // Navigation epoch in UTC microseconds, 0 unless date and time are valid
+    int64_t epochMicros() const;
+};
+
+// Streaming UBX frame parser.
+// Bytes may arrive in arbitrary fragments (UART FIFO chunks); the checksum is
+// accumulated as the bytes go past and NAV-PVT is decoded directly from the
+// frame buffer once the checksum matches. No Arduino dependencies so captured
+// byte streams can be replayed on the host.
+class UbxParser {
+public:
+    typedef void (*PvtCallback)(const UbxNavPvt& pvt, void* context);
+    typedef void (*FrameCallback)(uint8_t msgClass, uint8_t msgId,
+                                  const uint8_t* payload, uint16_t length, void* context);
+
+    UbxParser();
+
+    void setPvtCallback(PvtCallback callback, void* context);
+    void setFrameCallback(FrameCallback callback, void* context);
+
+    // Byte period on the wire, used to back-date arrival stamps within a chunk
+    void setBaudRate(uint32_t baud);
+
+    // Feed a chunk of received bytes. nowMicros is the time the last byte of
+    // the chunk was received.
+    void feed(const uint8_t* data, size_t length, int64_t nowMicros);
+    void reset();
+
+    // Statistics
+    uint32_t framesOk() const { return frameCount; }
+    uint32_t pvtFrames() const { return pvtCount; }
+    uint32_t checksumErrors() const { return checksumErrorCount; }
+    uint32_t lengthErrors() const { return lengthErrorCount; }
+
+    static bool decodeNavPvt(const uint8_t* payload, uint16_t length, UbxNavPvt& pvt);
+
+private:
+    enum State {
+        WAIT_SYNC_1,
+        WAIT_SYNC_2,
+        READ_CLASS,
+        READ_ID,
+        READ_LENGTH_1,
+        READ_LENGTH_2,
+        READ_PAYLOAD,
+        READ_CK_A,
+        READ_CK_B
+    };
+
+    State state;
+    uint8_t msgClass;
+    uint8_t msgId;
+    uint16_t payloadLength;
+    uint16_t payloadIndex;
+    uint8_t ckA, ckB;
+    uint8_t rxCkA;
+    int64_t frameStartMicros;
+    uint32_t byteTimeNanos;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+
+    PvtCallback pvtCallback;
+    void* pvtContext;
+    FrameCallback frameCallback;
+    void* frameContext;
+
+    uint32_t frameCount;
+    uint32_t pvtCount;
+    uint32_t checksumErrorCount;
+    uint32_t lengthErrorCount;
+
+    inline void checksum(uint8_t b) {
+        ckA += b;
+        ckB += ckA;
+    }
+    void dispatchFrame();
+};
+
+#endif // UBX_PARSER_H
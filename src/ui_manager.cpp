@@ -8,6 +8,9 @@ UIManager::UIManager() :
     batteryData(nullptr),
     perfStats(nullptr),
     fileTransferPtr(nullptr),
+    scheduler(nullptr),
+    stallMonitor(nullptr),
+    bootTimeline(nullptr),
     mainScreen(nullptr),
     currentScreen(SCREEN_SPEEDOMETER),
     updateRequested(true),
@@ -443,6 +446,18 @@ void UIManager::createSystemScreen() {
     lv_obj_set_style_text_color(logStatusLabel, UI_COLOR_TEXT_MUTED, 0);
     lv_obj_set_style_text_font(logStatusLabel, UI_FONT_SMALL, 0);
     lv_obj_set_pos(logStatusLabel, 250, 115);
+    
+    bootInfoLabel = lv_label_create(systemPanel);
+    lv_label_set_text(bootInfoLabel, "Boot: starting");
+    lv_obj_set_style_text_color(bootInfoLabel, UI_COLOR_TEXT_MUTED, 0);
+    lv_obj_set_style_text_font(bootInfoLabel, UI_FONT_SMALL, 0);
+    lv_obj_set_pos(bootInfoLabel, 20, 135);
+    
+    gnssInfoLabel = lv_label_create(systemPanel);
+    lv_label_set_text(gnssInfoLabel, "GNSS: starting");
+    lv_obj_set_style_text_color(gnssInfoLabel, UI_COLOR_TEXT_MUTED, 0);
+    lv_obj_set_style_text_font(gnssInfoLabel, UI_FONT_SMALL, 0);
+    lv_obj_set_pos(gnssInfoLabel, 250, 135);
 }
 
 void UIManager::createPerformanceScreen() {
@@ -522,11 +537,23 @@ void UIManager::createPerformanceScreen() {
     lv_obj_set_style_text_font(dataRateLabel, UI_FONT_SMALL, 0);
     lv_obj_set_pos(dataRateLabel, 250, 95);
     
+    schedulerLabel = lv_label_create(performancePanel);
+    lv_label_set_text(schedulerLabel, "Sched: OK");
+    lv_obj_set_style_text_color(schedulerLabel, UI_COLOR_SUCCESS, 0);
+    lv_obj_set_style_text_font(schedulerLabel, UI_FONT_SMALL, 0);
+    lv_obj_set_pos(schedulerLabel, 250, 115);
+    
     resetStatsLabel = lv_label_create(performancePanel);
     lv_label_set_text(resetStatsLabel, "Touch center to reset stats");
     lv_obj_set_style_text_color(resetStatsLabel, UI_COLOR_TEXT_MUTED, 0);
     lv_obj_set_style_text_font(resetStatsLabel, UI_FONT_SMALL, 0);
-    lv_obj_set_pos(resetStatsLabel, 120, 115);
+    lv_obj_set_pos(resetStatsLabel, 20, 135);
+    
+    stallLabel = lv_label_create(performancePanel);
+    lv_label_set_text(stallLabel, "Stalls: 0");
+    lv_obj_set_style_text_color(stallLabel, UI_COLOR_SUCCESS, 0);
+    lv_obj_set_style_text_font(stallLabel, UI_FONT_SMALL, 0);
+    lv_obj_set_pos(stallLabel, 250, 135);
 }
 
 // File Transfer UI Function
@@ -548,12 +575,14 @@ void UIManager::updateFileTransferUI() {
         
         lv_bar_set_value(progressBar, (int32_t)fileTransferPtr->progressPercent, LV_ANIM_OFF);
         
-        String text = "Transfer: " + fileTransferPtr->filename + " (" + 
-                     String(fileTransferPtr->progressPercent, 1) + "%)";
-        if (fileTransferPtr->estimatedTimeRemaining > 0) {
-            text += " - " + String(fileTransferPtr->estimatedTimeRemaining / 1000) + "s";
+        char text[112];
+        int len = snprintf(text, sizeof(text), "Transfer: %s (%.1f%%)",
+                           fileTransferPtr->filename, fileTransferPtr->progressPercent);
+        if (fileTransferPtr->estimatedTimeRemaining > 0 && len < (int)sizeof(text)) {
+            snprintf(text + len, sizeof(text) - len, " - %lus",
+                     (unsigned long)(fileTransferPtr->estimatedTimeRemaining / 1000));
         }
-        lv_label_set_text(transferLabel, text.c_str());
+        lv_label_set_text(transferLabel, text);
         
         lv_obj_clear_flag(progressBar, LV_OBJ_FLAG_HIDDEN);
         lv_obj_clear_flag(transferLabel, LV_OBJ_FLAG_HIDDEN);
@@ -695,7 +724,7 @@ void UIManager::updateSpeedometerScreen() {
         // Coordinates
         char coordStr[64];
         snprintf(coordStr, sizeof(coordStr), "LAT: %.5f° LON: %.5f°", 
-                 gpsData->latitude, gpsData->longitude);
+                 gpsData->latitude.toFloat(), gpsData->longitude.toFloat());
         lv_label_set_text(coordsLabel, coordStr);
         
         // Altitude and heading
@@ -832,7 +861,18 @@ void UIManager::updateSystemScreen() {
     lv_label_set_text(touchInfoLabel, statusStr);
     
     // IMU
-    if (systemData->mpuAvailable) {
+    if (systemData->mpuAvailable && imuData && imuData->fifoEnabled) {
+        if (imuData->calibrationInProgress) {
+            snprintf(statusStr, sizeof(statusStr), "IMU: %dHz Ovf:%lu Cal:...",
+                     imuData->sampleRateHz, imuData->fifoOverflows);
+        } else {
+            snprintf(statusStr, sizeof(statusStr), "IMU: %dHz Ovf:%lu Cal:%d%%",
+                     imuData->sampleRateHz, imuData->fifoOverflows,
+                     (int)(imuData->calibrationConfidence * 100));
+        }
+        lv_obj_set_style_text_color(imuInfoLabel, 
+            imuData->fifoOverflows > 0 ? UI_COLOR_WARNING : UI_COLOR_SUCCESS, 0);
+    } else if (systemData->mpuAvailable) {
         snprintf(statusStr, sizeof(statusStr), "IMU: Ready");
         lv_obj_set_style_text_color(imuInfoLabel, UI_COLOR_SUCCESS, 0);
     } else {
@@ -885,6 +925,50 @@ void UIManager::updateSystemScreen() {
         lv_obj_set_style_text_color(logStatusLabel, UI_COLOR_TEXT_MUTED, 0);
     }
     lv_label_set_text(logStatusLabel, statusStr);
+    
+    // Boot timeline
+    if (bootTimeline) {
+        if (bootTimeline->bootCompleteMs == 0) {
+            uint8_t finished = 0;
+            for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+                uint8_t state = bootTimeline->stageState[i];
+                if (state == BOOT_DONE || state == BOOT_FAILED || state == BOOT_SKIPPED) finished++;
+            }
+            snprintf(statusStr, sizeof(statusStr), "Boot: %u/%u stages", finished, BOOT_STAGE_COUNT);
+            lv_obj_set_style_text_color(bootInfoLabel, UI_COLOR_WARNING, 0);
+        } else {
+            char logStr[12] = "--";
+            if (bootTimeline->firstRecordMs) {
+                snprintf(logStr, sizeof(logStr), "%.1fs", bootTimeline->firstRecordMs / 1000.0f);
+            }
+            snprintf(statusStr, sizeof(statusStr), "Boot: UI %.1fs Ready %.1fs Log %s",
+                     bootTimeline->uiReadyMs / 1000.0f, bootTimeline->bootCompleteMs / 1000.0f,
+                     logStr);
+            lv_obj_set_style_text_color(bootInfoLabel, UI_COLOR_TEXT_MUTED, 0);
+        }
+        lv_label_set_text(bootInfoLabel, statusStr);
+        
+        // GNSS setup time and whether the receiver had to be reprogrammed
+        static const char* const configNames[] = {"...", "kept", "set", "legacy", "none"};
+        uint8_t config = bootTimeline->gnssConfig;
+        if (config == GNSS_CONFIG_PENDING || bootTimeline->stageEndMs[BOOT_STAGE_GNSS] == 0) {
+            snprintf(statusStr, sizeof(statusStr), "GNSS: starting");
+        } else {
+            char fixStr[12] = "--";
+            if (bootTimeline->firstPvtMs) {
+                snprintf(fixStr, sizeof(fixStr), "%.1fs", bootTimeline->firstPvtMs / 1000.0f);
+            }
+            uint32_t setupMs = bootTimeline->stageEndMs[BOOT_STAGE_GNSS] -
+                               bootTimeline->stageStartMs[BOOT_STAGE_GNSS];
+            snprintf(statusStr, sizeof(statusStr), "GNSS: %.1fs cfg %s%s Fix %s",
+                     setupMs / 1000.0f, configNames[config],
+                     bootTimeline->gnssAssist ? " hot" : "", fixStr);
+        }
+        lv_obj_set_style_text_color(gnssInfoLabel,
+            config == GNSS_CONFIG_FAILED ? UI_COLOR_DANGER :
+            config == GNSS_CONFIG_LEGACY ? UI_COLOR_WARNING : UI_COLOR_TEXT_MUTED, 0);
+        lv_label_set_text(gnssInfoLabel, statusStr);
+    }
 }
 
 void UIManager::updatePerformanceScreen() {
@@ -927,16 +1011,17 @@ void UIManager::updatePerformanceScreen() {
     // Calculate and display data rate
     if (perfStats->avgDelta > 0) {
         float dataRate = 1000.0f / perfStats->avgDelta;
-        snprintf(perfStr, sizeof(perfStr), "Rate: %.1f pps", dataRate);
+        snprintf(perfStr, sizeof(perfStr), "Rate: %.1f/%.0f pps", dataRate, perfStats->expectedRateHz);
         lv_label_set_text(dataRateLabel, perfStr);
         
-        // Performance status
+        // Performance status, relative to the rate the receiver is set to
+        float ratio = dataRate / perfStats->expectedRateHz;
         lv_color_t perfColor = UI_COLOR_DANGER;
         const char* perfStatus = "POOR";
-        if (dataRate >= 20) {
+        if (ratio >= 0.8f) {
             perfColor = UI_COLOR_SUCCESS;
             perfStatus = "EXCELLENT";
-        } else if (dataRate >= 10) {
+        } else if (ratio >= 0.4f) {
             perfColor = UI_COLOR_WARNING;
             perfStatus = "GOOD";
         }
@@ -959,6 +1044,37 @@ void UIManager::updatePerformanceScreen() {
     
     lv_color_t memColor = getPerformanceColor(freeHeap, 100000, 200000);
     lv_obj_set_style_text_color(memoryLabel, memColor, 0);
+    
+    // Main loop scheduler - show the task with the most overruns / misses
+    if (scheduler) {
+        const SchedulerTask* worst = scheduler->worstTask();
+        if (worst) {
+            snprintf(perfStr, sizeof(perfStr), "Sched: %s O:%lu M:%lu", worst->name,
+                     worst->overruns, worst->deadlineMisses);
+            lv_obj_set_style_text_color(schedulerLabel, 
+                worst->deadlineMisses > 0 ? UI_COLOR_DANGER : UI_COLOR_WARNING, 0);
+        } else {
+            snprintf(perfStr, sizeof(perfStr), "Sched: OK (%u tasks)", scheduler->taskCount());
+            lv_obj_set_style_text_color(schedulerLabel, UI_COLOR_SUCCESS, 0);
+        }
+        lv_label_set_text(schedulerLabel, perfStr);
+    }
+    
+    // Most recent stall and the section it was attributed to
+    if (stallMonitor) {
+        StallRecord last;
+        if (stallMonitor->getRecord(0, last)) {
+            snprintf(perfStr, sizeof(perfStr), "Stalls: %lu %s %lums %s", stallMonitor->totalStalls(),
+                     stallMonitor->section(last.section).name, last.durationMicros / 1000,
+                     StallMonitor::kindName(last.kind));
+            lv_obj_set_style_text_color(stallLabel,
+                last.kind == STALL_OVERRUN ? UI_COLOR_WARNING : UI_COLOR_DANGER, 0);
+        } else {
+            snprintf(perfStr, sizeof(perfStr), "Stalls: 0");
+            lv_obj_set_style_text_color(stallLabel, UI_COLOR_SUCCESS, 0);
+        }
+        lv_label_set_text(stallLabel, perfStr);
+    }
 }
 
 // Screen management
@@ -1087,6 +1203,8 @@ void UIManager::screenEventHandler(lv_event_t* e) {
             ui->perfStats->minDelta = 9999;
             ui->perfStats->maxDelta = 0;
             ui->perfStats->avgDelta = 0;
+            if (ui->scheduler) ui->scheduler->resetStats();
+            if (ui->stallMonitor) ui->stallMonitor->resetStats();
             ui->requestUpdate();
         }
     }
@@ -3,6 +3,8 @@
 
 #include <lvgl.h>
 #include "data_structures.h"
+#include "scheduler.h"
+#include "stall_monitor.h"
 
 class UIManager {
 public:
@@ -32,6 +34,15 @@ public:
     void setFileTransferData(FileTransferState* ft) { fileTransferPtr = ft; }
     void updateFileTransferUI();
     
+    // Main loop scheduler statistics
+    void setScheduler(Scheduler* sched) { scheduler = sched; }
+    
+    // Stall records for the Performance screen
+    void setStallMonitor(StallMonitor* monitor) { stallMonitor = monitor; }
+    
+    // Boot timeline for the System screen
+    void setBootTimeline(const BootTimeline* timeline) { bootTimeline = timeline; }
+    
     // Force refresh
     void forceRefresh();
     
@@ -43,6 +54,9 @@ private:
     BatteryData* batteryData;
     PerformanceStats* perfStats;
     FileTransferState* fileTransferPtr;
+    Scheduler* scheduler;
+    StallMonitor* stallMonitor;
+    const BootTimeline* bootTimeline;
     
     // LVGL objects
     lv_obj_t* mainScreen;
@@ -116,6 +130,8 @@ private:
     lv_obj_t* batteryInfoLabel;
     lv_obj_t* chargingInfoLabel;
     lv_obj_t* logStatusLabel;
+    lv_obj_t* bootInfoLabel;
+    lv_obj_t* gnssInfoLabel;
     
     // Performance screen
     lv_obj_t* throughputPanel;
@@ -130,6 +146,8 @@ private:
     lv_obj_t* dataRateLabel;
     lv_obj_t* perfStatusLabel;
     lv_obj_t* memoryLabel;
+    lv_obj_t* schedulerLabel;
+    lv_obj_t* stallLabel;
     lv_obj_t* resetStatsLabel;
     
     // State variables
@@ -0,0 +1,60 @@
+#include "usb_stream.h"
+#include <string.h>
+#include "crc.h"
+
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t code = 0;    // where the current block's length byte goes
+    size_t n = 1;
+    uint8_t run = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] == 0) {
+            out[code] = run;
+            code = n++;
+            run = 1;
+            continue;
+        }
+        out[n++] = in[i];
+        if (++run == 0xFF) {
+            out[code] = run;
+            code = n++;
+            run = 1;
+        }
+    }
+    out[code] = run;
+    return n;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t n = 0;
+    size_t i = 0;
+    while (i < length) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > length) return 0;
+        for (uint8_t k = 1; k < code; k++) {
+            if (in[i] == 0) return 0;
+            out[n++] = in[i++];
+        }
+        // A full block carries no implied zero; neither does the last one
+        if (code != 0xFF && i < length) out[n++] = 0;
+    }
+    return n;
+}
+
+size_t UsbStreamFramer::frame(uint8_t type, const void* payload, size_t length, uint8_t* out) {
+    if (length > USB_FRAME_MAX_PAYLOAD) return 0;
+
+    uint8_t raw[USB_FRAME_MAX_PAYLOAD + 5];
+    raw[0] = type;
+    raw[1] = (uint8_t)sequence;
+    raw[2] = (uint8_t)(sequence >> 8);
+    memcpy(raw + 3, payload, length);
+    uint16_t crc = crc16(raw, length + 3);
+    raw[length + 3] = (uint8_t)crc;
+    raw[length + 4] = (uint8_t)(crc >> 8);
+
+    size_t n = cobsEncode(raw, length + 5, out);
+    out[n++] = 0x00;
+    sequence++;
+    frameCount++;
+    return n;
+}
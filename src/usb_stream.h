@@ -0,0 +1,58 @@
+#ifndef USB_STREAM_H
+#define USB_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary streaming over the USB CDC port. Each frame is
+//   type (1) | sequence (2, LE) | payload | CRC16 over all before it (2, LE)
+// COBS-encoded and terminated by a 0x00 byte. A reader that attaches
+// mid-stream discards bytes up to the next 0x00 and is in sync from the
+// following frame; the sequence shows frames lost in between.
+#define USB_FRAME_SCHEMA 0x00   // text: #SCHEMA lines for the record types below
+#define USB_FRAME_GPS    0x01   // GPSPacket
+#define USB_FRAME_IMU    0x02   // StreamIMURecord
+
+#define USB_FRAME_MAX_PAYLOAD 768
+// COBS adds one byte per 254 plus one, then the delimiter
+#define USB_FRAME_MAX_ENCODED(payload) ((payload) + 5 + ((payload) + 5) / 254 + 2)
+
+// IMU sample as streamed - sensor counts as the acquisition task keeps
+// them (fixed_point.h), scales in the descriptor
+struct __attribute__((packed)) StreamIMURecord {
+    int64_t timestampMicros;    // local esp_timer µs
+    int64_t gnssTimeMicros;     // UTC µs, 0 until time is known
+    int16_t accel[3];           // AccelG counts
+    int16_t gyro[3];            // GyroDps counts
+    int16_t temperature;        // 0.01 °C
+};
+static_assert(sizeof(StreamIMURecord) == 30, "StreamIMURecord must match STREAM_IMU_SCHEMA");
+
+// No crc= - the frame CRC covers it. Scales are 1/16384 and 1/131.
+#define STREAM_IMU_SCHEMA "#SCHEMA imu v2 size=30 fields=" \
+    "timestampMicros:q:1:us,gnssTimeMicros:q:1:us," \
+    "accel_x:h:6.103515625e-05:g,accel_y:h:6.103515625e-05:g,accel_z:h:6.103515625e-05:g," \
+    "gyro_x:h:0.0076335877862595:deg/s,gyro_y:h:0.0076335877862595:deg/s,gyro_z:h:0.0076335877862595:deg/s," \
+    "temperature:h:0.01:C"
+
+// COBS - returns the encoded/decoded length; out needs length + length/254 + 1
+// bytes to encode. Decode returns 0 for malformed input.
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out);
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out);
+
+class UsbStreamFramer {
+public:
+    UsbStreamFramer() : sequence(0), frameCount(0) {}
+
+    // Encoded frame with its 0x00 delimiter; out must hold
+    // USB_FRAME_MAX_ENCODED(length) bytes. 0 if the payload is too long.
+    size_t frame(uint8_t type, const void* payload, size_t length, uint8_t* out);
+
+    uint32_t frames() const { return frameCount; }
+
+private:
+    uint16_t sequence;
+    uint32_t frameCount;
+};
+
+#endif // USB_STREAM_H
@@ -0,0 +1,136 @@
+// FatFs stand-in for host tests of code that uses FatFs directly
+// (src/log_recovery.cpp). Files live in memory by path; a test fills and
+// inspects them through hostFatFs() and can make one file's reads fail
+// after a count.
+// Header-only, so builds that never open a file link without it.
+#ifndef HOST_FF_H
+#define HOST_FF_H
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef uint32_t FSIZE_t;
+
+typedef enum {
+    FR_OK = 0,
+    FR_DISK_ERR,
+    FR_INT_ERR,
+    FR_NOT_READY,
+    FR_NO_FILE,
+    FR_NO_PATH,
+    FR_INVALID_NAME,
+    FR_DENIED,
+    FR_EXIST,
+    FR_INVALID_OBJECT
+} FRESULT;
+
+#define FA_READ             0x01
+#define FA_WRITE            0x02
+#define FA_OPEN_EXISTING    0x00
+#define FA_CREATE_NEW       0x04
+#define FA_CREATE_ALWAYS    0x08
+#define FA_OPEN_ALWAYS      0x10
+#define FA_OPEN_APPEND      0x30
+
+struct HostFatFs {
+    std::map<std::string, std::vector<uint8_t> > files;
+    std::string failPath;       // reads of this file fail once readsLeft reaches 0
+    uint32_t readsLeft;
+
+    HostFatFs() : readsLeft(0) {}
+    void reset() {
+        files.clear();
+        failPath.clear();
+        readsLeft = 0;
+    }
+};
+
+inline HostFatFs& hostFatFs() {
+    static HostFatFs fs;
+    return fs;
+}
+
+struct FIL {
+    const std::string* path;
+    std::vector<uint8_t>* data;
+    FSIZE_t fptr;
+    FSIZE_t obj_size;           // mirrors data->size() for f_size()
+};
+
+#define f_size(fp) ((fp)->obj_size)
+#define f_tell(fp) ((fp)->fptr)
+
+inline FRESULT f_open(FIL* fp, const char* path, BYTE mode) {
+    std::map<std::string, std::vector<uint8_t> >& files = hostFatFs().files;
+    if (files.find(path) == files.end()) {
+        if (!(mode & (FA_OPEN_ALWAYS | FA_CREATE_ALWAYS | FA_CREATE_NEW))) return FR_NO_FILE;
+        files[path];
+    } else if (mode & FA_CREATE_NEW) {
+        return FR_EXIST;
+    }
+    std::map<std::string, std::vector<uint8_t> >::iterator it = files.find(path);
+    fp->path = &it->first;
+    fp->data = &it->second;
+    if (mode & FA_CREATE_ALWAYS) fp->data->clear();
+    fp->fptr = 0;
+    fp->obj_size = fp->data->size();
+    return FR_OK;
+}
+
+inline FRESULT f_close(FIL* fp) {
+    if (!fp->data) return FR_INVALID_OBJECT;
+    fp->data = nullptr;
+    return FR_OK;
+}
+
+// Like FatFs, seeking past the end of a writable file extends it
+inline FRESULT f_lseek(FIL* fp, FSIZE_t ofs) {
+    if (!fp->data) return FR_INVALID_OBJECT;
+    if (ofs > fp->data->size()) {
+        fp->data->resize(ofs);
+        fp->obj_size = ofs;
+    }
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+inline FRESULT f_read(FIL* fp, void* buff, UINT btr, UINT* br) {
+    *br = 0;
+    if (!fp->data) return FR_INVALID_OBJECT;
+    HostFatFs& fs = hostFatFs();
+    if (*fp->path == fs.failPath) {
+        if (fs.readsLeft == 0) return FR_DISK_ERR;
+        fs.readsLeft--;
+    }
+    FSIZE_t left = fp->data->size() - fp->fptr;
+    UINT n = btr < left ? btr : (UINT)left;
+    memcpy(buff, fp->data->data() + fp->fptr, n);
+    fp->fptr += n;
+    *br = n;
+    return FR_OK;
+}
+
+inline FRESULT f_write(FIL* fp, const void* buff, UINT btw, UINT* bw) {
+    *bw = 0;
+    if (!fp->data) return FR_INVALID_OBJECT;
+    if (fp->fptr + btw > fp->data->size()) fp->data->resize(fp->fptr + btw);
+    memcpy(fp->data->data() + fp->fptr, buff, btw);
+    fp->fptr += btw;
+    fp->obj_size = fp->data->size();
+    *bw = btw;
+    return FR_OK;
+}
+
+inline FRESULT f_truncate(FIL* fp) {
+    if (!fp->data) return FR_INVALID_OBJECT;
+    fp->data->resize(fp->fptr);
+    fp->obj_size = fp->fptr;
+    return FR_OK;
+}
+
+#endif // HOST_FF_H
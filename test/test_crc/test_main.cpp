@@ -0,0 +1,149 @@
+// CRC backends (src/crc.h) cross-checked on the host: every table backend
+// against the bitwise reference at every length and alignment, streaming
+// against one-shot, and published check values. Ends with the same
+// throughput comparison the device CRC_BENCH command prints.
+// pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "crc.h"
+
+#define MAX_LENGTH   300
+#define MAX_OFFSET   4
+#define BENCH_LENGTH 4096
+#define BENCH_ROUNDS 2000
+
+static uint8_t data[MAX_LENGTH + MAX_OFFSET];
+static const uint8_t CHECK[] = "123456789";
+
+static uint32_t hostMicros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Bit-at-a-time CRC-32, straight from the definition
+static uint32_t crc32Reference(const uint8_t* p, size_t length, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= p[i];
+        for (uint8_t b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+void setUp() {
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < sizeof(data); i++) {
+        x = x * 1103515245u + 12345u;
+        data[i] = (uint8_t)(x >> 16);
+    }
+    crc16SetBackend(CRC16_BITWISE);
+}
+void tearDown() {}
+
+void test_check_values() {
+    for (uint8_t b = 0; b < CRC16_BACKEND_COUNT; b++) {
+        Crc16Backend backend = (Crc16Backend)b;
+        if (!crc16BackendAvailable(backend)) continue;
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(0x31C3, crc16With(backend, CHECK, 9),
+                                        crc16BackendName(backend));
+        TEST_ASSERT_EQUAL_HEX16(0x0000, crc16With(backend, CHECK, 0));
+    }
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32(CHECK, 9));
+    const char* fox = "The quick brown fox jumps over the lazy dog";
+    TEST_ASSERT_EQUAL_HEX32(0x414FA339, crc32((const uint8_t*)fox, strlen(fox)));
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, crc32(CHECK, 0));
+}
+
+void test_backends_match_bitwise_at_every_length_and_alignment() {
+    TEST_ASSERT_FALSE(crc16BackendAvailable(CRC16_BACKEND_COUNT));
+    for (uint8_t b = 0; b < CRC16_BACKEND_COUNT; b++) {
+        Crc16Backend backend = (Crc16Backend)b;
+        if (!crc16BackendAvailable(backend)) continue;
+        for (size_t offset = 0; offset < MAX_OFFSET; offset++) {
+            for (size_t length = 0; length < MAX_LENGTH; length++) {
+                const uint8_t* p = data + offset;
+                uint16_t expected = crc16With(CRC16_BITWISE, p, length);
+                if (crc16With(backend, p, length) != expected) {
+                    char message[64];
+                    snprintf(message, sizeof(message), "%s length %u offset %u",
+                             crc16BackendName(backend), (unsigned)length, (unsigned)offset);
+                    TEST_FAIL_MESSAGE(message);
+                }
+                // Non-zero starting value, as a continued stream passes in
+                TEST_ASSERT_EQUAL_HEX16(crc16With(CRC16_BITWISE, p, length, 0xA5C3),
+                                        crc16With(backend, p, length, 0xA5C3));
+            }
+        }
+    }
+}
+
+void test_crc32_matches_reference_at_every_length_and_alignment() {
+    for (size_t offset = 0; offset < MAX_OFFSET; offset++) {
+        for (size_t length = 0; length < MAX_LENGTH; length++) {
+            const uint8_t* p = data + offset;
+            TEST_ASSERT_EQUAL_HEX32(crc32Reference(p, length, 0), crc32(p, length));
+            TEST_ASSERT_EQUAL_HEX32(crc32Reference(p, length, 0xDEADBEEF), crc32(p, length, 0xDEADBEEF));
+        }
+    }
+}
+
+void test_streaming_matches_one_shot_at_every_split() {
+    for (uint8_t b = 0; b < CRC16_BACKEND_COUNT; b++) {
+        Crc16Backend backend = (Crc16Backend)b;
+        if (!crc16BackendAvailable(backend)) continue;
+        crc16SetBackend(backend);
+        TEST_ASSERT_EQUAL(backend, crc16Backend());
+
+        uint16_t whole = crc16(data, MAX_LENGTH);
+        uint32_t whole32 = crc32(data, MAX_LENGTH);
+        for (size_t split = 0; split <= MAX_LENGTH; split++) {
+            Crc16 stream;
+            stream.update(data, split);
+            stream.update(data + split, MAX_LENGTH - split);
+            TEST_ASSERT_EQUAL_HEX16(whole, stream.result());
+            TEST_ASSERT_EQUAL_HEX32(whole32, crc32(data + split, MAX_LENGTH - split,
+                                                   crc32(data, split)));
+        }
+        Crc16 stream;
+        stream.update(data, 17);
+        stream.reset();
+        stream.update(CHECK, 9);
+        TEST_ASSERT_EQUAL_HEX16(0x31C3, stream.result());
+    }
+}
+
+void test_throughput() {
+    static uint8_t buffer[BENCH_LENGTH];
+    for (size_t i = 0; i < sizeof(buffer); i++) buffer[i] = (uint8_t)(i * 131 + 7);
+
+    float bitwise = 0;
+    for (uint8_t b = 0; b < CRC16_BACKEND_COUNT; b++) {
+        Crc16Backend backend = (Crc16Backend)b;
+        if (!crc16BackendAvailable(backend)) continue;
+        uint16_t rounds = backend == CRC16_BITWISE ? BENCH_ROUNDS / 10 : BENCH_ROUNDS;
+        Crc16BenchResult r = crc16Benchmark(backend, buffer, sizeof(buffer), rounds, hostMicros);
+        TEST_ASSERT_TRUE(r.matchesReference);
+        if (backend == CRC16_BITWISE) bitwise = r.megabytesPerSecond;
+
+        char message[96];
+        snprintf(message, sizeof(message), "%-8s %8.1f MB/s  %5.1fx bitwise",
+                 crc16BackendName(backend), r.megabytesPerSecond,
+                 bitwise > 0 ? r.megabytesPerSecond / bitwise : 0.0f);
+        TEST_MESSAGE(message);
+    }
+    Crc16BenchResult none = crc16Benchmark(CRC16_BACKEND_COUNT, buffer, sizeof(buffer), 1, hostMicros);
+    TEST_ASSERT_FALSE(none.matchesReference);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_check_values);
+    RUN_TEST(test_backends_match_bitwise_at_every_length_and_alignment);
+    RUN_TEST(test_crc32_matches_reference_at_every_length_and_alignment);
+    RUN_TEST(test_streaming_matches_one_shot_at_every_split);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
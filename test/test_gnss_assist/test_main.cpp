@@ -0,0 +1,285 @@
+// GnssAssistReplay (src/gnss_assist.h) against a simulated receiver: a
+// saved database is replayed into a stand-in UART, and the receiver's
+// MGA-ACK-DATA0 answers come back through UbxParser in arbitrary chunks.
+// pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "gnss_assist.h"
+#include "ubx_parser.h"
+
+#define DATABASE_FRAMES 24
+#define ACK_TIMEOUT_MS  250
+#define PACE_MS         2
+#define RUN_LIMIT_MS    60000
+
+typedef std::vector<uint8_t> Bytes;
+
+static uint8_t blob[4096];
+static uint32_t blobLength;
+
+// Deterministic noise for chunk sizes and latencies
+static uint32_t lcg = 1;
+static uint32_t noise(uint32_t range) {
+    lcg = lcg * 1664525u + 1013904223u;
+    return (lcg >> 8) % range;
+}
+
+// Captured database of MGA-DBD frames; like the receiver's they all start
+// with 12 reserved bytes, so the acknowledgement echo cannot tell them apart
+static void buildDatabase() {
+    GnssAssist capture;
+    capture.beginCapture(blob, sizeof(blob), 1709987696);
+    for (uint8_t i = 0; i < DATABASE_FRAMES; i++) {
+        uint8_t payload[12 + 64] = {0};
+        uint16_t length = 12 + 16 + (i * 7) % 48;
+        for (uint16_t j = 12; j < length; j++) payload[j] = (uint8_t)(i * 31 + j);
+        TEST_ASSERT_TRUE(capture.addFrame(UBX_CLASS_MGA, UBX_MGA_DBD, payload, length));
+    }
+    blobLength = capture.finishCapture();
+    TEST_ASSERT_GREATER_THAN_UINT32(0, blobLength);
+}
+
+static Bytes databaseFrame(uint16_t index) {
+    uint32_t offset = sizeof(GnssAssistHeader);
+    for (uint16_t i = 0; i < index; i++) offset += GnssAssist::frameAt(blob, blobLength, offset);
+    uint16_t n = GnssAssist::frameAt(blob, blobLength, offset);
+    return Bytes(blob + offset, blob + offset + n);
+}
+
+// Receiver model. Each frame it takes in is answered according to plan:
+// 'a' accept, 'n' reject, '-' no answer; past the plan everything is
+// accepted. A silent receiver never answers (aiding ACKs disabled).
+struct Receiver {
+    const char* plan;
+    bool silent;
+    uint16_t received;
+    std::vector<std::pair<uint32_t, Bytes>> replies;   // due time, bytes
+
+    void take(const uint8_t* frame, uint32_t nowMs) {
+        char action = (plan && received < strlen(plan)) ? plan[received] : 'a';
+        received++;
+        if (silent || action == '-') return;
+
+        uint8_t ack[8] = {0};
+        ack[0] = action == 'a' ? 1 : 0;
+        ack[2] = action == 'a' ? 0 : 4;     // infoCode: database not accepted
+        ack[3] = frame[3];
+        memcpy(ack + 4, frame + 6, 4);
+        uint8_t reply[16];
+        uint16_t n = GnssAssist::buildFrame(UBX_CLASS_MGA, UBX_MGA_ACK, ack, sizeof(ack),
+                                            reply, sizeof(reply));
+        replies.push_back(std::make_pair(nowMs + 1 + noise(40), Bytes(reply, reply + n)));
+    }
+};
+
+struct Write {
+    uint32_t atMs;
+    Bytes frame;
+};
+
+static void onFrame(uint8_t msgClass, uint8_t msgId, const uint8_t* payload,
+                    uint16_t length, void* context) {
+    if (msgClass == UBX_CLASS_MGA && msgId == UBX_MGA_ACK) {
+        ((GnssAssistReplay*)context)->onAck(payload, length);
+    }
+}
+
+// Run a whole replay on a 1 ms tick; returns the stand-in UART's writes
+static std::vector<Write> replay(GnssAssistReplay& r, Receiver& receiver,
+                                 const uint8_t* data, uint32_t length) {
+    UbxParser parser;
+    parser.setFrameCallback(onFrame, &r);
+    std::vector<Write> uart;
+    r.begin(data, length, ACK_TIMEOUT_MS, PACE_MS);
+
+    for (uint32_t now = 0; now < RUN_LIMIT_MS && !r.done(); now++) {
+        // Answers due by now arrive in UART FIFO sized pieces
+        for (size_t i = 0; i < receiver.replies.size();) {
+            if ((int32_t)(now - receiver.replies[i].first) < 0) {
+                i++;
+                continue;
+            }
+            const Bytes& bytes = receiver.replies[i].second;
+            for (size_t at = 0; at < bytes.size();) {
+                size_t chunk = 1 + noise(6);
+                if (chunk > bytes.size() - at) chunk = bytes.size() - at;
+                parser.feed(&bytes[at], chunk, (int64_t)now * 1000);
+                at += chunk;
+            }
+            receiver.replies.erase(receiver.replies.begin() + i);
+        }
+
+        const uint8_t* frame = nullptr;
+        uint16_t n;
+        while ((n = r.next(now, frame)) > 0) {
+            Write w;
+            w.atMs = now;
+            w.frame.assign(frame, frame + n);
+            uart.push_back(w);
+            receiver.take(frame, now);
+        }
+    }
+    TEST_ASSERT_TRUE_MESSAGE(r.done(), "replay did not finish");
+    return uart;
+}
+
+// Every UART write is exactly one complete, checksummed frame
+static void assertWholeFrames(const std::vector<Write>& uart) {
+    for (size_t i = 0; i < uart.size(); i++) {
+        const Bytes& f = uart[i].frame;
+        TEST_ASSERT_EQUAL_UINT32(f.size(), GnssAssist::frameAt(f.data(), f.size(), 0));
+    }
+}
+
+void setUp() {
+    lcg = 1;
+    buildDatabase();
+}
+void tearDown() {}
+
+void test_every_frame_waits_for_its_acknowledgement() {
+    Receiver receiver = {nullptr, false, 0, {}};
+    GnssAssistReplay r;
+    std::vector<Write> uart = replay(r, receiver, blob, blobLength);
+
+    assertWholeFrames(uart);
+    TEST_ASSERT_EQUAL_UINT32(DATABASE_FRAMES, uart.size());
+    for (uint16_t i = 0; i < DATABASE_FRAMES; i++) {
+        Bytes expected = databaseFrame(i);
+        TEST_ASSERT_EQUAL_UINT32(expected.size(), uart[i].frame.size());
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), uart[i].frame.data(), expected.size());
+    }
+    // Never more than one frame outstanding: nothing went out in the same tick
+    for (size_t i = 1; i < uart.size(); i++) {
+        TEST_ASSERT_GREATER_THAN_UINT32(uart[i - 1].atMs, uart[i].atMs);
+    }
+    TEST_ASSERT_EQUAL_UINT16(DATABASE_FRAMES, r.sentFrames());
+    TEST_ASSERT_EQUAL_UINT16(DATABASE_FRAMES, r.ackedFrames());
+    TEST_ASSERT_EQUAL_UINT16(0, r.rejectedFrames());
+    TEST_ASSERT_EQUAL_UINT16(0, r.timedOutFrames());
+    TEST_ASSERT_EQUAL_UINT16(0, r.retriedFrames());
+    TEST_ASSERT_TRUE(r.acknowledged());
+}
+
+void test_rejected_frame_is_not_sent_again() {
+    Receiver receiver = {"aaaaan", false, 0, {}};
+    GnssAssistReplay r;
+    std::vector<Write> uart = replay(r, receiver, blob, blobLength);
+
+    assertWholeFrames(uart);
+    TEST_ASSERT_EQUAL_UINT32(DATABASE_FRAMES, uart.size());
+    TEST_ASSERT_EQUAL_UINT16(DATABASE_FRAMES - 1, r.ackedFrames());
+    TEST_ASSERT_EQUAL_UINT16(1, r.rejectedFrames());
+    TEST_ASSERT_EQUAL_UINT16(0, r.retriedFrames());
+}
+
+void test_lost_acknowledgement_sends_the_frame_again() {
+    Receiver receiver = {"aaa-", false, 0, {}};
+    GnssAssistReplay r;
+    std::vector<Write> uart = replay(r, receiver, blob, blobLength);
+
+    assertWholeFrames(uart);
+    TEST_ASSERT_EQUAL_UINT32(DATABASE_FRAMES + 1, uart.size());
+    Bytes fourth = databaseFrame(3);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(fourth.data(), uart[3].frame.data(), fourth.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(fourth.data(), uart[4].frame.data(), fourth.size());
+    TEST_ASSERT_EQUAL_UINT32(ACK_TIMEOUT_MS, uart[4].atMs - uart[3].atMs);
+    TEST_ASSERT_EQUAL_UINT16(DATABASE_FRAMES, r.ackedFrames());
+    TEST_ASSERT_EQUAL_UINT16(1, r.retriedFrames());
+    TEST_ASSERT_EQUAL_UINT16(0, r.timedOutFrames());
+    TEST_ASSERT_TRUE(r.acknowledged());
+}
+
+void test_frame_never_acknowledged_is_skipped() {
+    Receiver receiver = {"aa--", false, 0, {}};
+    GnssAssistReplay r;
+    std::vector<Write> uart = replay(r, receiver, blob, blobLength);
+
+    assertWholeFrames(uart);
+    TEST_ASSERT_EQUAL_UINT32(DATABASE_FRAMES + 1, uart.size());
+    // Third frame sent twice, then the fourth after the second timeout
+    Bytes fourth = databaseFrame(3);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(fourth.data(), uart[4].frame.data(), fourth.size());
+    TEST_ASSERT_EQUAL_UINT32(ACK_TIMEOUT_MS, uart[4].atMs - uart[3].atMs);
+    TEST_ASSERT_EQUAL_UINT16(DATABASE_FRAMES - 1, r.ackedFrames());
+    TEST_ASSERT_EQUAL_UINT16(1, r.timedOutFrames());
+    TEST_ASSERT_EQUAL_UINT16(1, r.retriedFrames());
+    TEST_ASSERT_TRUE(r.acknowledged());
+}
+
+void test_silent_receiver_falls_back_to_paced_writes() {
+    Receiver receiver = {nullptr, true, 0, {}};
+    GnssAssistReplay r;
+    std::vector<Write> uart = replay(r, receiver, blob, blobLength);
+
+    assertWholeFrames(uart);
+    // The first frame costs two timeouts; the rest go out unacknowledged
+    TEST_ASSERT_EQUAL_UINT32(DATABASE_FRAMES + 1, uart.size());
+    TEST_ASSERT_FALSE(r.acknowledged());
+    TEST_ASSERT_EQUAL_UINT16(DATABASE_FRAMES, r.sentFrames());
+    TEST_ASSERT_EQUAL_UINT16(0, r.ackedFrames());
+    TEST_ASSERT_EQUAL_UINT16(1, r.timedOutFrames());
+    for (size_t i = 3; i < uart.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(PACE_MS, uart[i].atMs - uart[i - 1].atMs);
+    }
+    TEST_ASSERT_LESS_THAN_UINT32(2 * ACK_TIMEOUT_MS + DATABASE_FRAMES * PACE_MS + 1,
+                                 uart.back().atMs);
+}
+
+void test_acknowledgements_for_other_messages_are_ignored() {
+    GnssAssistReplay r;
+    r.begin(blob, blobLength, ACK_TIMEOUT_MS, PACE_MS);
+    const uint8_t* frame = nullptr;
+    TEST_ASSERT_GREATER_THAN_UINT16(0, r.next(0, frame));
+
+    // Late answer to the MGA-INI time frame written before the replay
+    uint8_t ini[8] = {1, 0, 0, UBX_MGA_INI, 0x10, 0, 0, 0x80};
+    r.onAck(ini, sizeof(ini));
+    uint8_t shortAck[4] = {1, 0, 0, UBX_MGA_DBD};
+    r.onAck(shortAck, sizeof(shortAck));
+    TEST_ASSERT_EQUAL_UINT16(0, r.ackedFrames());
+    TEST_ASSERT_EQUAL_UINT16(0, r.next(1, frame));
+
+    uint8_t dbd[8] = {1, 0, 0, UBX_MGA_DBD, 0, 0, 0, 0};
+    r.onAck(dbd, sizeof(dbd));
+    TEST_ASSERT_EQUAL_UINT16(1, r.ackedFrames());
+    TEST_ASSERT_GREATER_THAN_UINT16(0, r.next(2, frame));
+}
+
+void test_corrupt_blob_stops_at_the_damage() {
+    // Flip a byte inside the sixth frame
+    uint32_t offset = sizeof(GnssAssistHeader);
+    for (uint8_t i = 0; i < 5; i++) offset += GnssAssist::frameAt(blob, blobLength, offset);
+    blob[offset + 20] ^= 0x40;
+
+    GnssAssistHeader header;
+    TEST_ASSERT_FALSE(GnssAssist::validateBlob(blob, blobLength, header));
+
+    Receiver receiver = {nullptr, false, 0, {}};
+    GnssAssistReplay r;
+    std::vector<Write> uart = replay(r, receiver, blob, blobLength);
+    TEST_ASSERT_EQUAL_UINT32(5, uart.size());
+    TEST_ASSERT_EQUAL_UINT16(5, r.ackedFrames());
+}
+
+void test_saved_blob_validates() {
+    GnssAssistHeader header;
+    TEST_ASSERT_TRUE(GnssAssist::validateBlob(blob, blobLength, header));
+    TEST_ASSERT_EQUAL_UINT16(DATABASE_FRAMES, header.frames);
+    TEST_ASSERT_FALSE(GnssAssist::validateBlob(blob, blobLength - 1, header));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_saved_blob_validates);
+    RUN_TEST(test_every_frame_waits_for_its_acknowledgement);
+    RUN_TEST(test_rejected_frame_is_not_sent_again);
+    RUN_TEST(test_lost_acknowledgement_sends_the_frame_again);
+    RUN_TEST(test_frame_never_acknowledged_is_skipped);
+    RUN_TEST(test_silent_receiver_falls_back_to_paced_writes);
+    RUN_TEST(test_acknowledgements_for_other_messages_are_ignored);
+    RUN_TEST(test_corrupt_blob_stops_at_the_damage);
+    return UNITY_END();
+}
@@ -0,0 +1,400 @@
+// V2 log blocks (src/log_block.h), the time index (src/log_index.h) and
+// boot-time recovery (src/log_recovery.h) over FatFs stubbed in memory
+// (test/host/ff.h): torn and stale blocks, a grown file ending mid-block,
+// a finished but untrimmed file, index rebuilds and read errors.
+// pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "ff.h"
+#include "log_block.h"
+#include "log_index.h"
+#include "log_recovery.h"
+
+#define LOG_PATH        "0:/gps_test.bin"
+#define INDEX_PATH      "0:/gps_test.idx"
+#define FIRST_SEQUENCE  0xFFFFFFF0u     // block numbers wrap inside the file
+#define OLD_SEQUENCE    0x12340000u     // an earlier file's, left on the card
+#define WRITTEN_BLOCKS  41              // metadata block and 40 record blocks
+#define PREALLOCATED    256             // blocks, as the logger creates it
+#define START_MICROS    1709987696000000LL
+
+typedef std::vector<uint8_t> Bytes;
+
+static int64_t blockMicros(uint32_t index) {
+    return START_MICROS + (int64_t)index * 1000000;
+}
+
+// Block index of a log starting at firstSequence: metadata at 0, then
+// record blocks of three 44-byte entries each
+static void makeBlock(uint8_t* out, uint32_t firstSequence, uint32_t index, uint8_t kind) {
+    LogBlockHeader header;
+    memset(&header, 0, sizeof(header));
+    header.kind = kind;
+    header.sequence = firstSequence + index;
+    uint8_t* payload = out + sizeof(header);
+    if (kind == LOG_BLOCK_RECORDS) {
+        header.typeMask = 1 << LOG_RECORD_GPS;
+        header.recordCount = 3;
+        header.firstMicros = blockMicros(index);
+        header.lastMicros = blockMicros(index) + 900000;
+        for (int r = 0; r < 3; r++) {
+            payload[header.payloadLength++] = LOG_RECORD_GPS;
+            payload[header.payloadLength++] = 44;
+            memset(payload + header.payloadLength, (uint8_t)(index + r), 44);
+            header.payloadLength += 44;
+        }
+    } else {
+        const char* text = kind == LOG_BLOCK_METADATA ? "GPS_LOG_V2.0\n" : "#SUMMARY blocks=41 records=120\n";
+        header.payloadLength = strlen(text);
+        memcpy(payload, text, header.payloadLength);
+    }
+    sealLogBlock(out, header);
+}
+
+// The first written blocks of a log, then zeros up to blocks
+static Bytes& writeLog(uint32_t written, uint32_t blocks) {
+    Bytes& file = hostFatFs().files[LOG_PATH];
+    file.assign((size_t)blocks * LOG_BLOCK_SIZE, 0);
+    for (uint32_t i = 0; i < written; i++) {
+        makeBlock(&file[(size_t)i * LOG_BLOCK_SIZE], FIRST_SEQUENCE, i, i == 0 ? LOG_BLOCK_METADATA : LOG_BLOCK_RECORDS);
+    }
+    return file;
+}
+
+// The index the logger writes for record blocks 1 to last
+static Bytes makeIndex(uint32_t firstSequence, uint32_t last) {
+    Bytes index(sizeof(LogIndexHeader));
+    LogIndexHeader header;
+    makeLogIndexHeader(firstSequence, header);
+    memcpy(index.data(), &header, sizeof(header));
+    LogIndexer indexer;
+    LogIndexEntry entry;
+    for (uint32_t block = 1; block <= last; block++) {
+        if (!indexer.add(block, blockMicros(block), entry)) continue;
+        const uint8_t* bytes = (const uint8_t*)&entry;
+        index.insert(index.end(), bytes, bytes + sizeof(entry));
+    }
+    return index;
+}
+
+static bool readHeader(const Bytes& file, uint32_t index, LogBlockHeader& header) {
+    if ((size_t)(index + 1) * LOG_BLOCK_SIZE > file.size()) return false;
+    return checkLogBlock(&file[(size_t)index * LOG_BLOCK_SIZE], header);
+}
+
+static void recover(LogRecoveryResult& result, bool withIndex = false) {
+    recoverLogFile(LOG_PATH, withIndex ? INDEX_PATH : nullptr, result);
+}
+
+// The recovered summary right after block last
+static void assertRecoveredSummary(const Bytes& file, uint32_t last, uint32_t lostBytes) {
+    TEST_ASSERT_EQUAL_UINT32((last + 2) * LOG_BLOCK_SIZE, file.size());
+    LogBlockHeader header;
+    TEST_ASSERT_TRUE(readHeader(file, last + 1, header));
+    TEST_ASSERT_EQUAL_UINT8(LOG_BLOCK_SUMMARY, header.kind);
+    TEST_ASSERT_EQUAL_UINT8(LOG_BLOCK_RECOVERED, header.flags);
+    TEST_ASSERT_EQUAL_UINT32(FIRST_SEQUENCE + last + 1, header.sequence);
+    TEST_ASSERT_TRUE(blockMicros(1) == header.firstMicros);
+    TEST_ASSERT_TRUE(blockMicros(last) + 900000 == header.lastMicros);
+
+    char expected[96];
+    snprintf(expected, sizeof(expected), "#SUMMARY blocks=%u recovered=1 lost_bytes=%u\n", last + 1, lostBytes);
+    TEST_ASSERT_EQUAL_UINT16(strlen(expected), header.payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY(expected, &file[(last + 1) * LOG_BLOCK_SIZE + sizeof(header)], header.payloadLength);
+}
+
+void setUp() {
+    hostFatFs().reset();
+}
+
+void tearDown() {}
+
+void test_block_round_trip() {
+    uint8_t block[LOG_BLOCK_SIZE];
+    memset(block, 0xEE, sizeof(block));
+    makeBlock(block, FIRST_SEQUENCE, 7, LOG_BLOCK_RECORDS);
+
+    LogBlockHeader header;
+    TEST_ASSERT_TRUE(checkLogBlock(block, header));
+    TEST_ASSERT_EQUAL_UINT32(LOG_BLOCK_SYNC, header.sync);
+    TEST_ASSERT_EQUAL_UINT8(LOG_BLOCK_VERSION, header.version);
+    TEST_ASSERT_EQUAL_UINT32(FIRST_SEQUENCE + 7, header.sequence);
+    TEST_ASSERT_EQUAL_UINT16(3, header.recordCount);
+    TEST_ASSERT_TRUE(blockMicros(7) == header.firstMicros);
+    // Padding is zeroed whatever the buffer held
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, block + sizeof(header) + header.payloadLength,
+                                 LOG_BLOCK_SIZE - sizeof(header) - header.payloadLength);
+
+    LogBlockRecords records(block, header);
+    uint8_t type, length;
+    const uint8_t* data;
+    for (int r = 0; r < 3; r++) {
+        TEST_ASSERT_TRUE(records.next(type, data, length));
+        TEST_ASSERT_EQUAL_UINT8(LOG_RECORD_GPS, type);
+        TEST_ASSERT_EQUAL_UINT8(44, length);
+        TEST_ASSERT_EACH_EQUAL_UINT8(7 + r, data, length);
+    }
+    TEST_ASSERT_FALSE(records.next(type, data, length));
+    TEST_ASSERT_FALSE(records.malformed());
+
+    // Every byte of header and payload is covered
+    const size_t covered[] = {0, offsetof(LogBlockHeader, sequence), offsetof(LogBlockHeader, crc),
+                              sizeof(header), sizeof(header) + header.payloadLength - 1};
+    for (size_t i = 0; i < sizeof(covered) / sizeof(covered[0]); i++) {
+        block[covered[i]] ^= 0x01;
+        TEST_ASSERT_FALSE(checkLogBlock(block, header));
+        block[covered[i]] ^= 0x01;
+    }
+    TEST_ASSERT_TRUE(checkLogBlock(block, header));
+
+    // An entry running past the payload ends the walk as malformed
+    block[sizeof(header) + 2 * 46 + 1] = 60;
+    LogBlockHeader resealed = header;
+    sealLogBlock(block, resealed);
+    LogBlockRecords broken(block, resealed);
+    TEST_ASSERT_TRUE(broken.next(type, data, length));
+    TEST_ASSERT_TRUE(broken.next(type, data, length));
+    TEST_ASSERT_FALSE(broken.next(type, data, length));
+    TEST_ASSERT_TRUE(broken.malformed());
+}
+
+void test_find_block_after_lost_bytes() {
+    Bytes data(333 + 2 * LOG_BLOCK_SIZE, 0x5A);
+    makeBlock(&data[333], FIRST_SEQUENCE, 1, LOG_BLOCK_RECORDS);
+    makeBlock(&data[333 + LOG_BLOCK_SIZE], FIRST_SEQUENCE, 2, LOG_BLOCK_RECORDS);
+    TEST_ASSERT_EQUAL_size_t(333, findLogBlock(data.data(), data.size(), 0));
+    TEST_ASSERT_EQUAL_size_t(333 + LOG_BLOCK_SIZE, findLogBlock(data.data(), data.size(), 334));
+
+    // A damaged block is passed over, and a block cut short is not one
+    data[333 + 100] ^= 0xFF;
+    TEST_ASSERT_EQUAL_size_t(333 + LOG_BLOCK_SIZE, findLogBlock(data.data(), data.size(), 0));
+    TEST_ASSERT_EQUAL_size_t(data.size() - 1, findLogBlock(data.data(), data.size() - 1, 0));
+}
+
+static bool readEntries(void* context, uint32_t i, LogIndexEntry& entry) {
+    const Bytes& index = *(const Bytes*)context;
+    size_t at = sizeof(LogIndexHeader) + (size_t)i * sizeof(entry);
+    if (at + sizeof(entry) > index.size()) return false;
+    memcpy(&entry, &index[at], sizeof(entry));
+    return true;
+}
+
+void test_index_range() {
+    // Entries for blocks 1, 9, ... 57 of a 65-block log
+    Bytes index = makeIndex(FIRST_SEQUENCE, 64);
+    uint32_t count = (index.size() - sizeof(LogIndexHeader)) / sizeof(LogIndexEntry);
+    TEST_ASSERT_EQUAL_UINT32(8, count);
+    uint32_t first, end;
+
+    TEST_ASSERT_TRUE(findLogIndexRange(readEntries, &index, count, 65, blockMicros(20), blockMicros(30), first, end));
+    TEST_ASSERT_EQUAL_UINT32(17, first);
+    TEST_ASSERT_EQUAL_UINT32(33, end);
+
+    // Exactly on an entry's time: its group starts there
+    TEST_ASSERT_TRUE(findLogIndexRange(readEntries, &index, count, 65, blockMicros(25), blockMicros(25), first, end));
+    TEST_ASSERT_EQUAL_UINT32(25, first);
+    TEST_ASSERT_EQUAL_UINT32(33, end);
+
+    // Before the log and after it
+    TEST_ASSERT_TRUE(findLogIndexRange(readEntries, &index, count, 65, 0, START_MICROS, first, end));
+    TEST_ASSERT_EQUAL_UINT32(1, first);
+    TEST_ASSERT_EQUAL_UINT32(1, end);
+    TEST_ASSERT_TRUE(findLogIndexRange(readEntries, &index, count, 65, blockMicros(100), blockMicros(200), first, end));
+    TEST_ASSERT_EQUAL_UINT32(57, first);
+    TEST_ASSERT_EQUAL_UINT32(65, end);
+
+    // No entries: every record block
+    TEST_ASSERT_TRUE(findLogIndexRange(readEntries, &index, 0, 65, blockMicros(20), blockMicros(30), first, end));
+    TEST_ASSERT_EQUAL_UINT32(1, first);
+    TEST_ASSERT_EQUAL_UINT32(65, end);
+
+    // An index claiming more entries than it holds is a read error
+    TEST_ASSERT_FALSE(findLogIndexRange(readEntries, &index, 9, 65, blockMicros(100), blockMicros(200), first, end));
+}
+
+void test_recovers_preallocated_file() {
+    const Bytes& file = writeLog(WRITTEN_BLOCKS, PREALLOCATED);
+    LogRecoveryResult result;
+    recover(result);
+
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_RECOVERED, result.status);
+    TEST_ASSERT_EQUAL_UINT32(PREALLOCATED * LOG_BLOCK_SIZE, result.originalBytes);
+    TEST_ASSERT_EQUAL_UINT32((WRITTEN_BLOCKS + 1) * LOG_BLOCK_SIZE, result.finalBytes);
+    TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS, result.blocks);
+    TEST_ASSERT_EQUAL_UINT32(0, result.lostBytes);
+    assertRecoveredSummary(file, WRITTEN_BLOCKS - 1, 0);
+
+    // Recovering again finds the summary and leaves the file as it is
+    Bytes before = file;
+    recover(result);
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_CLEAN, result.status);
+    TEST_ASSERT_TRUE(before == file);
+}
+
+void test_reads_grow_with_log2_of_size() {
+    char line[96];
+    uint32_t sizes[] = {PREALLOCATED, 16 * PREALLOCATED};
+    uint32_t reads[2];
+    for (int s = 0; s < 2; s++) {
+        hostFatFs().reset();
+        writeLog(WRITTEN_BLOCKS, sizes[s]);
+        LogRecoveryResult result;
+        recover(result);
+        TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_RECOVERED, result.status);
+        TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS, result.blocks);
+        reads[s] = result.blockReads;
+        snprintf(line, sizeof(line), "%6u blocks preallocated: %3u block reads", sizes[s], reads[s]);
+        TEST_MESSAGE(line);
+    }
+    // 16x the file is 4 more halvings, each reading at most a probe's worth
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(reads[0] + 4 * LOG_RECOVERY_PROBE, reads[1]);
+    TEST_ASSERT_LESS_THAN_UINT32(sizes[1] / 32, reads[1]);
+}
+
+void test_steps_over_torn_blocks() {
+    Bytes& file = writeLog(WRITTEN_BLOCKS, PREALLOCATED);
+    // Every fifth record block damaged; never a probe's worth in a row
+    for (uint32_t i = 5; i < WRITTEN_BLOCKS - 1; i += 5) file[(size_t)i * LOG_BLOCK_SIZE + 200] ^= 0xFF;
+    LogRecoveryResult result;
+    recover(result);
+
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_RECOVERED, result.status);
+    TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS, result.blocks);
+    assertRecoveredSummary(file, WRITTEN_BLOCKS - 1, 0);
+}
+
+void test_torn_tail_is_counted_lost() {
+    Bytes& file = writeLog(WRITTEN_BLOCKS + 2, PREALLOCATED);
+    // The last two writes got their headers out but not their payloads
+    for (uint32_t i = WRITTEN_BLOCKS; i < WRITTEN_BLOCKS + 2; i++) {
+        memset(&file[(size_t)i * LOG_BLOCK_SIZE + sizeof(LogBlockHeader)], 0, 64);
+    }
+    LogRecoveryResult result;
+    recover(result);
+
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_RECOVERED, result.status);
+    TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS, result.blocks);
+    TEST_ASSERT_EQUAL_UINT32(2 * LOG_BLOCK_SIZE, result.lostBytes);
+    assertRecoveredSummary(file, WRITTEN_BLOCKS - 1, 2 * LOG_BLOCK_SIZE);
+}
+
+void test_stale_blocks_are_not_this_files() {
+    Bytes& file = writeLog(WRITTEN_BLOCKS, PREALLOCATED);
+    // An earlier, longer log on the same clusters: intact blocks, wrong numbers
+    for (uint32_t i = WRITTEN_BLOCKS; i < PREALLOCATED; i++) {
+        makeBlock(&file[(size_t)i * LOG_BLOCK_SIZE], OLD_SEQUENCE, i, LOG_BLOCK_RECORDS);
+    }
+    // One of this file's blocks out of its place
+    makeBlock(&file[(size_t)(WRITTEN_BLOCKS + 3) * LOG_BLOCK_SIZE], FIRST_SEQUENCE, 20, LOG_BLOCK_RECORDS);
+    LogRecoveryResult result;
+    recover(result);
+
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_RECOVERED, result.status);
+    TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS, result.blocks);
+    TEST_ASSERT_EQUAL_UINT32(0, result.lostBytes);
+    assertRecoveredSummary(file, WRITTEN_BLOCKS - 1, 0);
+}
+
+void test_grown_file_ending_mid_block() {
+    // Not preallocated: the file ends where the last write stopped
+    Bytes& file = writeLog(WRITTEN_BLOCKS + 1, WRITTEN_BLOCKS + 1);
+    file.resize(WRITTEN_BLOCKS * LOG_BLOCK_SIZE + 700);
+    LogRecoveryResult result;
+    recover(result);
+
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_RECOVERED, result.status);
+    TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS * LOG_BLOCK_SIZE + 700, result.originalBytes);
+    TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS, result.blocks);
+    TEST_ASSERT_EQUAL_UINT32(700, result.lostBytes);
+    assertRecoveredSummary(file, WRITTEN_BLOCKS - 1, 700);
+}
+
+void test_finished_file_is_only_trimmed() {
+    Bytes& file = writeLog(WRITTEN_BLOCKS, PREALLOCATED);
+    makeBlock(&file[(size_t)WRITTEN_BLOCKS * LOG_BLOCK_SIZE], FIRST_SEQUENCE, WRITTEN_BLOCKS, LOG_BLOCK_SUMMARY);
+    Bytes written(file.begin(), file.begin() + (WRITTEN_BLOCKS + 1) * LOG_BLOCK_SIZE);
+    LogRecoveryResult result;
+    recover(result);
+
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_CLEAN, result.status);
+    TEST_ASSERT_EQUAL_UINT32(WRITTEN_BLOCKS, result.blocks);
+    TEST_ASSERT_EQUAL_UINT32((WRITTEN_BLOCKS + 1) * LOG_BLOCK_SIZE, result.finalBytes);
+    TEST_ASSERT_TRUE(written == file);
+}
+
+void test_unreadable_file_is_left_alone() {
+    Bytes& file = writeLog(0, PREALLOCATED);
+    LogRecoveryResult result;
+    recover(result);
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_UNREADABLE, result.status);
+    TEST_ASSERT_EQUAL_UINT32(PREALLOCATED * LOG_BLOCK_SIZE, file.size());
+
+    hostFatFs().files.erase(LOG_PATH);
+    recover(result);
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_FAILED, result.status);
+}
+
+void test_index_is_rebuilt() {
+    const Bytes full = makeIndex(FIRST_SEQUENCE, WRITTEN_BLOCKS - 1);
+    const uint32_t entries = (full.size() - sizeof(LogIndexHeader)) / sizeof(LogIndexEntry);
+    TEST_ASSERT_EQUAL_UINT32(5, entries);
+    struct Case {
+        const char* name;
+        Bytes index;
+        bool present;
+        uint32_t added;
+    } cases[] = {
+        {"last sync missed two entries", makeIndex(FIRST_SEQUENCE, 24), true, 2},
+        {"entries for blocks that were lost", makeIndex(FIRST_SEQUENCE, 100), true, 0},
+        {"another log's index", makeIndex(OLD_SEQUENCE, WRITTEN_BLOCKS - 1), true, entries},
+        {"no index", Bytes(), false, entries},
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        hostFatFs().reset();
+        writeLog(WRITTEN_BLOCKS, PREALLOCATED);
+        if (cases[c].present) hostFatFs().files[INDEX_PATH] = cases[c].index;
+        LogRecoveryResult result;
+        recover(result, true);
+
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(LOG_RECOVERY_RECOVERED, result.status, cases[c].name);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(entries, result.indexEntries, cases[c].name);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(cases[c].added, result.indexAdded, cases[c].name);
+        TEST_ASSERT_TRUE_MESSAGE(full == hostFatFs().files[INDEX_PATH], cases[c].name);
+    }
+}
+
+void test_index_read_error_fails_recovery() {
+    Bytes& file = writeLog(WRITTEN_BLOCKS, PREALLOCATED);
+    hostFatFs().files[INDEX_PATH] = makeIndex(FIRST_SEQUENCE, 24);
+    // The header reads, the first entry of the bisection does not
+    hostFatFs().failPath = INDEX_PATH;
+    hostFatFs().readsLeft = 1;
+    LogRecoveryResult result;
+    recover(result, true);
+
+    TEST_ASSERT_EQUAL_UINT8(LOG_RECOVERY_FAILED, result.status);
+    TEST_ASSERT_EQUAL_UINT32(PREALLOCATED * LOG_BLOCK_SIZE, file.size());
+    TEST_ASSERT_TRUE(makeIndex(FIRST_SEQUENCE, 24) == hostFatFs().files[INDEX_PATH]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_block_round_trip);
+    RUN_TEST(test_find_block_after_lost_bytes);
+    RUN_TEST(test_index_range);
+    RUN_TEST(test_recovers_preallocated_file);
+    RUN_TEST(test_reads_grow_with_log2_of_size);
+    RUN_TEST(test_steps_over_torn_blocks);
+    RUN_TEST(test_torn_tail_is_counted_lost);
+    RUN_TEST(test_stale_blocks_are_not_this_files);
+    RUN_TEST(test_grown_file_ending_mid_block);
+    RUN_TEST(test_finished_file_is_only_trimmed);
+    RUN_TEST(test_unreadable_file_is_left_alone);
+    RUN_TEST(test_index_is_rebuilt);
+    RUN_TEST(test_index_read_error_fails_recovery);
+    return UNITY_END();
+}
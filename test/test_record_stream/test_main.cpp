@@ -0,0 +1,316 @@
+// Record stream (src/record_stream.h) on a synthetic 25 Hz drive: lossless
+// round trip, lost frames, byte-at-a-time input, parity with the Python
+// codec, and a size/speed bench against the raw 44-byte record.
+// pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "packet_schema.h"
+#include "record_stream.h"
+
+#define DRIVE_RECORDS   15000   // 10 minutes at 25 Hz
+#define PARITY_RECORDS  500
+
+typedef std::vector<uint8_t> Bytes;
+
+static std::vector<GPSPacket> drive;
+
+// Integer-only generator, so a Python copy of it can feed record_codec the
+// same records (test_matches_python_codec)
+static uint32_t lcg;
+static int32_t noise(int32_t range) {
+    lcg = lcg * 1664525u + 1013904223u;
+    return (int32_t)((lcg >> 8) % (uint32_t)(2 * range + 1)) - range;
+}
+
+static void generateDrive(std::vector<GPSPacket>& out, uint32_t count) {
+    lcg = 2024;
+    int32_t lat = 521234567, lon = 210123456, alt = 112000;
+    int32_t vLat = 40, vLon = 95;           // 1e-7 deg per epoch, ~12 m/s
+    int32_t speed = 12500, heading = 6700000;
+    uint16_t batteryMv = 3950;
+    uint8_t satellites = 14;
+    out.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        vLat += noise(1);
+        vLon += noise(1);
+        lat += vLat;
+        lon += vLon;
+        alt += noise(4);
+        speed += noise(15);
+        heading += noise(800);
+        if (i % 250 == 249) satellites = (uint8_t)(13 + noise(2));
+        if (i % 1500 == 1499) batteryMv--;
+
+        GPSPacket& p = out[i];
+        memset(&p, 0, sizeof(p));
+        p.timestamp = 1709987696 + i / 25;
+        p.timestamp_us = (i % 25) * 40000 + 2 + noise(2);
+        p.latitude = lat + noise(1);
+        p.longitude = lon + noise(1);
+        p.altitude = alt;
+        p.speed = (uint16_t)speed;
+        p.heading = (uint32_t)heading;
+        p.fixType = 3;
+        p.satellites = satellites;
+        p.battery_mv = batteryMv;
+        p.battery_pct = 81;
+        p.accel_x = (int16_t)noise(40);
+        p.accel_y = (int16_t)noise(40);
+        p.accel_z = (int16_t)(1000 + noise(30));
+        p.gyro_x = (int16_t)noise(50);
+        p.gyro_y = (int16_t)noise(50);
+        p.pmu_status = 0x05;
+        GPSPacketCodec::seal(p);
+    }
+}
+
+static const uint8_t* bytesOf(const GPSPacket& p) { return GPSPacketCodec::bytes(p); }
+
+// Whole-stream encode; frame boundaries returned in ends
+static Bytes encodeAll(const std::vector<GPSPacket>& records, uint32_t linearMask,
+                       std::vector<size_t>* ends = nullptr) {
+    RecordStreamEncoder encoder(gpsPacketSchema, linearMask);
+    Bytes stream;
+    uint8_t frame[GPS_STREAM_MAX_FRAME];
+    for (size_t i = 0; i < records.size(); i++) {
+        size_t n = encoder.encode(bytesOf(records[i]), frame);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(encoder.maxFrameSize(), n);
+        stream.insert(stream.end(), frame, frame + n);
+        if (ends) ends->push_back(stream.size());
+    }
+    TEST_ASSERT_EQUAL_UINT32(stream.size(), encoder.bytes());
+    TEST_ASSERT_EQUAL_UINT32(records.size(), encoder.records());
+    TEST_ASSERT_EQUAL_UINT32((records.size() + RECORD_STREAM_KEYFRAME_INTERVAL - 1) /
+                             RECORD_STREAM_KEYFRAME_INTERVAL, encoder.keyframes());
+    return stream;
+}
+
+static uint32_t crc32Of(const Bytes& data) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < data.size(); i++) {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static uint64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void setUp() {
+    if (drive.empty()) generateDrive(drive, DRIVE_RECORDS);
+}
+void tearDown() {}
+
+void test_round_trip_is_lossless() {
+    Bytes stream = encodeAll(drive, GPS_STREAM_LINEAR_FIELDS);
+    RecordStreamDecoder decoder(gpsPacketSchema);
+    GPSPacket out;
+    size_t pos = 0, consumed = 0;
+    for (size_t i = 0; i < drive.size(); i++) {
+        TEST_ASSERT_EQUAL(RECORD_STREAM_RECORD,
+                          decoder.decode(&stream[pos], stream.size() - pos, consumed, (uint8_t*)&out));
+        pos += consumed;
+        // CRC included - the decoder reseals every record
+        TEST_ASSERT_EQUAL_MEMORY(&drive[i], &out, sizeof(out));
+    }
+    TEST_ASSERT_EQUAL_UINT32(stream.size(), pos);
+    TEST_ASSERT_EQUAL(RECORD_STREAM_INCOMPLETE, decoder.decode(&stream[pos], 0, consumed, (uint8_t*)&out));
+}
+
+void test_byte_at_a_time() {
+    std::vector<GPSPacket> records(drive.begin(), drive.begin() + 200);
+    Bytes stream = encodeAll(records, GPS_STREAM_LINEAR_FIELDS);
+    RecordStreamDecoder decoder(gpsPacketSchema);
+    GPSPacket out;
+
+    // Feed one more byte until a frame completes, as from a slow link
+    size_t start = 0, available = 0, decoded = 0, consumed = 0;
+    while (start < stream.size()) {
+        available++;
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(stream.size() - start, available);
+        RecordStreamStatus status = decoder.decode(&stream[start], available, consumed, (uint8_t*)&out);
+        if (status == RECORD_STREAM_INCOMPLETE) continue;
+        TEST_ASSERT_EQUAL(RECORD_STREAM_RECORD, status);
+        TEST_ASSERT_EQUAL_UINT32(available, consumed);
+        TEST_ASSERT_EQUAL_MEMORY(&records[decoded], &out, sizeof(out));
+        decoded++;
+        start += consumed;
+        available = 0;
+    }
+    TEST_ASSERT_EQUAL_UINT32(records.size(), decoded);
+}
+
+void test_lost_frame_skips_to_next_keyframe() {
+    std::vector<GPSPacket> records(drive.begin(), drive.begin() + 100);
+    std::vector<size_t> ends;
+    Bytes stream = encodeAll(records, GPS_STREAM_LINEAR_FIELDS, &ends);
+
+    // Drop record 30's frame, a delta inside the second keyframe interval
+    Bytes lossy(stream.begin(), stream.begin() + ends[29]);
+    lossy.insert(lossy.end(), stream.begin() + ends[30], stream.end());
+
+    RecordStreamDecoder decoder(gpsPacketSchema);
+    GPSPacket out;
+    size_t pos = 0, consumed = 0;
+    std::vector<size_t> recovered;
+    for (size_t frame = 0; pos < lossy.size(); frame++) {
+        size_t index = frame < 30 ? frame : frame + 1;
+        RecordStreamStatus status = decoder.decode(&lossy[pos], lossy.size() - pos, consumed, (uint8_t*)&out);
+        pos += consumed;
+        if (status == RECORD_STREAM_SKIPPED) continue;
+        TEST_ASSERT_EQUAL(RECORD_STREAM_RECORD, status);
+        TEST_ASSERT_EQUAL_MEMORY(&records[index], &out, sizeof(out));
+        recovered.push_back(index);
+    }
+    // Records 31-49 wait for the keyframe at 50; nothing wrong is ever emitted
+    TEST_ASSERT_EQUAL_UINT32(19, decoder.skipped());
+    TEST_ASSERT_EQUAL_UINT32(100 - 1 - 19, recovered.size());
+    TEST_ASSERT_EQUAL_UINT32(29, recovered[29]);
+    TEST_ASSERT_EQUAL_UINT32(50, recovered[30]);
+}
+
+void test_encoder_reset_starts_with_a_keyframe() {
+    RecordStreamEncoder encoder(gpsPacketSchema, GPS_STREAM_LINEAR_FIELDS);
+    uint8_t frame[GPS_STREAM_MAX_FRAME];
+    encoder.encode(bytesOf(drive[0]), frame);
+    TEST_ASSERT_EQUAL_UINT8(RECORD_FRAME_KEY, frame[0] >> 6);
+    encoder.encode(bytesOf(drive[1]), frame);
+    TEST_ASSERT_EQUAL_UINT8(RECORD_FRAME_DELTA, frame[0] >> 6);
+    encoder.reset();
+    encoder.encode(bytesOf(drive[2]), frame);
+    TEST_ASSERT_EQUAL_UINT8(RECORD_FRAME_KEY, frame[0] >> 6);
+
+    // A new subscriber joining mid-stream syncs on that keyframe
+    RecordStreamDecoder decoder(gpsPacketSchema);
+    GPSPacket out;
+    size_t consumed;
+    size_t n = encoder.encode(bytesOf(drive[3]), frame);
+    TEST_ASSERT_EQUAL(RECORD_STREAM_SKIPPED, decoder.decode(frame, n, consumed, (uint8_t*)&out));
+    TEST_ASSERT_EQUAL_UINT32(n, consumed);
+
+    uint8_t bad[2] = {0xC0, 0x00};      // frame kind 3 does not exist
+    TEST_ASSERT_EQUAL(RECORD_STREAM_ERROR, decoder.decode(bad, sizeof(bad), consumed, (uint8_t*)&out));
+    TEST_ASSERT_EQUAL_UINT32(1, consumed);
+}
+
+// Length and CRC-32 of what record_codec.StreamEncoder produces for the
+// first PARITY_RECORDS records, from a Python copy of generateDrive(). A
+// change to the frame format has to change both codecs and these.
+#define PYTHON_STREAM_LENGTH 8437
+#define PYTHON_STREAM_CRC32  0x6959DA51u
+
+void test_matches_python_codec() {
+    std::vector<GPSPacket> records(drive.begin(), drive.begin() + PARITY_RECORDS);
+    Bytes stream = encodeAll(records, GPS_STREAM_LINEAR_FIELDS);
+    TEST_ASSERT_EQUAL_UINT32(PYTHON_STREAM_LENGTH, stream.size());
+    TEST_ASSERT_EQUAL_HEX32(PYTHON_STREAM_CRC32, crc32Of(stream));
+}
+
+void test_bench() {
+    const double records = (double)drive.size();
+    char line[96];
+
+    // Sizes: the raw record, previous-value deltas, the firmware's
+    // extrapolating predictor, and the GNSS fields on their own
+    std::vector<GPSPacket> gnssOnly(drive);
+    for (size_t i = 0; i < gnssOnly.size(); i++) {
+        GPSPacket& p = gnssOnly[i];
+        p.accel_x = p.accel_y = p.gyro_x = p.gyro_y = 0;
+        p.accel_z = 1000;
+    }
+    double previousOnly = encodeAll(drive, 0).size() / records;
+    double firmware = encodeAll(drive, GPS_STREAM_LINEAR_FIELDS).size() / records;
+    double gnss = encodeAll(gnssOnly, GPS_STREAM_LINEAR_FIELDS).size() / records;
+
+    TEST_MESSAGE("bytes/record over a 10 min 25 Hz drive:");
+    snprintf(line, sizeof(line), "  raw GPSPacket            %6.2f  1.00x", (double)sizeof(GPSPacket));
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "  delta, previous value    %6.2f  %.2fx", previousOnly, sizeof(GPSPacket) / previousOnly);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "  delta, firmware          %6.2f  %.2fx", firmware, sizeof(GPSPacket) / firmware);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "  delta, IMU held still    %6.2f  %.2fx", gnss, sizeof(GPSPacket) / gnss);
+    TEST_MESSAGE(line);
+
+    // Where the bytes go: a field costs what holding it still would save
+    std::vector<GPSPacket> still(drive.size(), drive[0]);
+    double overhead = encodeAll(still, GPS_STREAM_LINEAR_FIELDS).size() / records;
+    // Framing: frame header and change mask of every frame, plus keyframes
+    snprintf(line, sizeof(line), "  of which %-12s %5.2f", "framing", overhead);
+    TEST_MESSAGE(line);
+    for (uint8_t f = 0; f < gpsPacketSchema.fieldCount; f++) {
+        const SchemaField& field = gpsPacketSchema.fields[f];
+        size_t width = (field.type == 'I' || field.type == 'i') ? 4 :
+                       (field.type == 'H' || field.type == 'h') ? 2 : 1;
+        std::vector<GPSPacket> held(drive);
+        for (size_t i = 0; i < held.size(); i++) {
+            memcpy((uint8_t*)&held[i] + field.offset, bytesOf(drive[0]) + field.offset, width);
+        }
+        double cost = firmware - encodeAll(held, GPS_STREAM_LINEAR_FIELDS).size() / records;
+        if (cost < 0.005) continue;
+        snprintf(line, sizeof(line), "  of which %-12s %5.2f", field.name, cost);
+        TEST_MESSAGE(line);
+    }
+
+    // Speed: raw sealing and copying, encode, decode
+    static uint8_t rawOut[DRIVE_RECORDS * sizeof(GPSPacket)];
+    uint64_t start = nowNanos();
+    for (size_t i = 0; i < drive.size(); i++) {
+        GPSPacket p = drive[i];
+        GPSPacketCodec::seal(p);
+        memcpy(rawOut + i * sizeof(p), &p, sizeof(p));
+    }
+    double rawNs = (nowNanos() - start) / records;
+
+    RecordStreamEncoder encoder(gpsPacketSchema, GPS_STREAM_LINEAR_FIELDS);
+    Bytes stream(drive.size() * GPS_STREAM_MAX_FRAME);
+    size_t length = 0;
+    start = nowNanos();
+    for (size_t i = 0; i < drive.size(); i++) {
+        length += encoder.encode(bytesOf(drive[i]), &stream[length]);
+    }
+    double encodeNs = (nowNanos() - start) / records;
+
+    RecordStreamDecoder decoder(gpsPacketSchema);
+    GPSPacket out;
+    size_t pos = 0, consumed, decoded = 0;
+    start = nowNanos();
+    while (pos < length && decoder.decode(&stream[pos], length - pos, consumed, (uint8_t*)&out) ==
+                           RECORD_STREAM_RECORD) {
+        pos += consumed;
+        decoded++;
+    }
+    double decodeNs = (nowNanos() - start) / records;
+    TEST_ASSERT_EQUAL_UINT32(drive.size(), decoded);
+    TEST_ASSERT_EQUAL_MEMORY(&drive.back(), &out, sizeof(out));
+    TEST_ASSERT_EQUAL_MEMORY(&drive.back(), rawOut + (drive.size() - 1) * sizeof(out), sizeof(out));
+
+    TEST_MESSAGE("ns/record on this host:");
+    snprintf(line, sizeof(line), "  raw seal + copy          %6.1f", rawNs);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "  delta encode             %6.1f", encodeNs);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "  delta decode + seal      %6.1f", decodeNs);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_LESS_THAN(previousOnly, firmware);
+    TEST_ASSERT_LESS_THAN(firmware, gnss);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_is_lossless);
+    RUN_TEST(test_byte_at_a_time);
+    RUN_TEST(test_lost_frame_skips_to_next_keyframe);
+    RUN_TEST(test_encoder_reset_starts_with_a_keyframe);
+    RUN_TEST(test_matches_python_codec);
+    RUN_TEST(test_bench);
+    return UNITY_END();
+}
@@ -0,0 +1,180 @@
+// SampleRing (src/sample_ring.h) on the host: boundaries, then one producer
+// and one consumer thread hammering the same ring. pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "sample_ring.h"
+
+// Large enough that a torn copy would show up in the check fields
+struct Item {
+    uint32_t sequence;
+    uint32_t inverse;
+    uint64_t square;
+};
+
+static Item makeItem(uint32_t sequence) {
+    Item item;
+    item.sequence = sequence;
+    item.inverse = ~sequence;
+    item.square = (uint64_t)sequence * sequence;
+    return item;
+}
+
+static bool intact(const Item& item) {
+    return item.inverse == ~item.sequence && item.square == (uint64_t)item.sequence * item.sequence;
+}
+
+static const uint32_t STRESS_ITEMS = 500000;
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_ring() {
+    SampleRing<Item, 8> ring;
+    Item item;
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+    TEST_ASSERT_FALSE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.overflowCount());
+}
+
+void test_full_ring_drops_newest() {
+    SampleRing<Item, 8> ring;
+    for (uint32_t i = 0; i < 8; i++) TEST_ASSERT_TRUE(ring.push(makeItem(i)));
+    TEST_ASSERT_EQUAL_UINT32(8, ring.size());
+    TEST_ASSERT_FALSE(ring.push(makeItem(8)));
+    TEST_ASSERT_FALSE(ring.push(makeItem(9)));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.overflowCount());
+    TEST_ASSERT_EQUAL_UINT32(8, ring.highWaterMark());
+
+    // The oldest survive, in order; one slot freed takes one more
+    Item item;
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, item.sequence);
+    TEST_ASSERT_TRUE(ring.push(makeItem(10)));
+    TEST_ASSERT_FALSE(ring.push(makeItem(11)));
+    for (uint32_t expected = 1; expected < 8; expected++) {
+        TEST_ASSERT_TRUE(ring.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(expected, item.sequence);
+    }
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(10, item.sequence);
+    TEST_ASSERT_FALSE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(3, ring.overflowCount());
+}
+
+void test_indices_wrap_the_mask() {
+    // Free-running counters cross the slot mask many times over
+    SampleRing<Item, 4> ring;
+    Item item;
+    uint32_t next = 0;
+    uint32_t overflows = 0;
+    for (uint32_t round = 0; round < 1000; round++) {
+        uint32_t batch = round % 7;
+        for (uint32_t i = 0; i < batch; i++) ring.push(makeItem(next + i));
+        uint32_t accepted = batch < 4 ? batch : 4;
+        overflows += batch - accepted;
+        for (uint32_t i = 0; i < accepted; i++) {
+            TEST_ASSERT_TRUE(ring.pop(item));
+            TEST_ASSERT_EQUAL_UINT32(next + i, item.sequence);
+        }
+        TEST_ASSERT_FALSE(ring.pop(item));
+        next += batch;
+    }
+    TEST_ASSERT_EQUAL_UINT32(overflows, ring.overflowCount());
+    TEST_ASSERT_EQUAL_UINT32(4, ring.highWaterMark());
+}
+
+void test_clear() {
+    SampleRing<Item, 8> ring;
+    for (uint32_t i = 0; i < 5; i++) ring.push(makeItem(i));
+    ring.clear();
+    Item item;
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_FALSE(ring.pop(item));
+    TEST_ASSERT_TRUE(ring.push(makeItem(5)));
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(5, item.sequence);
+}
+
+// A producer that waits for space loses nothing: every item arrives, once,
+// in order and whole
+void test_spsc_no_loss_when_producer_waits() {
+    static SampleRing<Item, 64> ring;
+    std::atomic<uint32_t> fullPushes(0);
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+            while (!ring.push(makeItem(i))) {
+                fullPushes.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t torn = 0;
+    uint32_t outOfOrder = 0;
+    Item item;
+    while (expected < STRESS_ITEMS) {
+        if (!ring.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!intact(item)) torn++;
+        if (item.sequence != expected) outOfOrder++;
+        expected = item.sequence + 1;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    TEST_ASSERT_FALSE(ring.pop(item));
+    // Every failed push was a full ring, and each one was counted
+    TEST_ASSERT_EQUAL_UINT32(fullPushes.load(), ring.overflowCount());
+    TEST_ASSERT_TRUE(ring.highWaterMark() <= 64);
+}
+
+// The acquisition task never waits: items are either delivered in order or
+// counted as overflows, never lost silently
+void test_spsc_overflow_accounting() {
+    static SampleRing<Item, 16> ring;
+    std::atomic<bool> producing(true);
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) ring.push(makeItem(i));
+        producing.store(false, std::memory_order_release);
+    });
+
+    uint32_t received = 0;
+    uint32_t torn = 0;
+    uint32_t backwards = 0;
+    int64_t last = -1;
+    Item item;
+    while (producing.load(std::memory_order_acquire) || !ring.empty()) {
+        if (!ring.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        received++;
+        if (!intact(item)) torn++;
+        if ((int64_t)item.sequence <= last) backwards++;
+        last = item.sequence;
+    }
+    producer.join();
+    while (ring.pop(item)) received++;
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, backwards);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, received + ring.overflowCount());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_ring);
+    RUN_TEST(test_full_ring_drops_newest);
+    RUN_TEST(test_indices_wrap_the_mask);
+    RUN_TEST(test_clear);
+    RUN_TEST(test_spsc_no_loss_when_producer_waits);
+    RUN_TEST(test_spsc_overflow_accounting);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+// Scheduler (src/scheduler.h) on a fake clock: which task runs, budget
+// overruns, deadline misses and re-arming. pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "scheduler.h"
+
+// The clock only moves when a test or a task moves it
+static uint32_t fakeNow;
+static uint32_t fakeClock() { return fakeNow; }
+
+// Each task logs its run and takes its configured time
+static char runLog[64];
+static uint8_t runCount;
+static uint32_t costA, costB, costC;
+
+static void logRun(char name, uint32_t cost) {
+    if (runCount < sizeof(runLog) - 1) runLog[runCount++] = name;
+    fakeNow += cost;
+}
+static void taskA() { logRun('A', costA); }
+static void taskB() { logRun('B', costB); }
+static void taskC() { logRun('C', costC); }
+
+static uint8_t hookCalls;
+static void runHook(uint8_t, bool) { hookCalls++; }
+
+// Run everything due now, in the order the scheduler picks
+static void drain(Scheduler& scheduler) {
+    while (scheduler.runOnce()) {}
+}
+
+void setUp() {
+    fakeNow = 1000;
+    memset(runLog, 0, sizeof(runLog));
+    runCount = 0;
+    costA = costB = costC = 0;
+    hookCalls = 0;
+}
+void tearDown() {}
+
+void test_highest_priority_due_task_runs_first() {
+    Scheduler scheduler(fakeClock);
+    scheduler.addTask("a", taskA, 10000, 1, 0);
+    scheduler.addTask("b", taskB, 10000, 3, 0);
+    scheduler.addTask("c", taskC, 10000, 2, 0);
+
+    drain(scheduler);
+    TEST_ASSERT_EQUAL_STRING("BCA", runLog);
+    TEST_ASSERT_FALSE(scheduler.runOnce());
+    TEST_ASSERT_EQUAL_UINT32(10000, scheduler.microsUntilNextRelease());
+}
+
+void test_equal_priority_runs_earliest_release_first() {
+    Scheduler scheduler(fakeClock);
+    scheduler.addTask("a", taskA, 10000, 1, 0);
+    drain(scheduler);
+    // New tasks are released at once: b at 3000 in, a again at 10000
+    fakeNow += 3000;
+    scheduler.addTask("b", taskB, 4000, 1, 0);
+    fakeNow = 1000 + 10000;
+    drain(scheduler);
+    TEST_ASSERT_EQUAL_STRING("ABA", runLog);
+
+    // b skipped its 7000 release and re-armed at 11000; nothing runs early
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.task(1).deadlineMisses);
+    fakeNow = 1000 + 10999;
+    TEST_ASSERT_FALSE(scheduler.runOnce());
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.microsUntilNextRelease());
+    fakeNow++;
+    TEST_ASSERT_TRUE(scheduler.runOnce());
+    TEST_ASSERT_EQUAL_STRING("ABAB", runLog);
+}
+
+void test_a_long_task_delays_but_does_not_preempt() {
+    Scheduler scheduler(fakeClock);
+    scheduler.addTask("a", taskA, 10000, 1, 0);
+    scheduler.addTask("b", taskB, 10000, 5, 0);
+    costA = 0;
+    costB = 0;
+    drain(scheduler);
+
+    // a is due first; b comes due while a runs and waits for it
+    fakeNow += 9000;
+    costA = 0;
+    TEST_ASSERT_FALSE(scheduler.runOnce());
+    fakeNow += 1000;
+    costB = 2500;
+    TEST_ASSERT_TRUE(scheduler.runOnce());
+    TEST_ASSERT_TRUE(scheduler.runOnce());
+    TEST_ASSERT_EQUAL_STRING("BABA", runLog);
+    // a started 2500 µs after its release
+    TEST_ASSERT_EQUAL_UINT32(2500, scheduler.task(0).lastJitterMicros);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.task(0).deadlineMisses);
+}
+
+void test_budget_overruns_are_counted() {
+    Scheduler scheduler(fakeClock);
+    scheduler.addTask("a", taskA, 10000, 1, 1000);
+    scheduler.addTask("b", taskB, 10000, 2, 0);       // no budget - never overruns
+
+    uint32_t durations[] = {500, 1000, 1001, 4000, 200};
+    for (uint8_t i = 0; i < 5; i++) {
+        costA = durations[i];
+        costB = 5000;
+        drain(scheduler);
+        fakeNow += 10000 - (fakeNow - 1000) % 10000;
+    }
+    const SchedulerTask& a = scheduler.task(0);
+    TEST_ASSERT_EQUAL_UINT32(5, a.runs);
+    TEST_ASSERT_EQUAL_UINT32(2, a.overruns);
+    TEST_ASSERT_EQUAL_UINT32(200, a.lastDurationMicros);
+    TEST_ASSERT_EQUAL_UINT32(4000, a.maxDurationMicros);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.task(1).overruns);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.totalOverruns());
+    TEST_ASSERT_EQUAL_PTR(&a, scheduler.worstTask());
+
+    scheduler.resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.totalOverruns());
+    TEST_ASSERT_NULL(scheduler.worstTask());
+}
+
+void test_periodic_rearm_stays_on_its_grid() {
+    Scheduler scheduler(fakeClock);
+    scheduler.addTask("a", taskA, 10000, 1, 0);
+    TEST_ASSERT_TRUE(scheduler.runOnce());
+
+    // Late by 700 µs: the next release stays at 20000, not 20700
+    fakeNow = 1000 + 10700;
+    TEST_ASSERT_TRUE(scheduler.runOnce());
+    TEST_ASSERT_EQUAL_UINT32(700, scheduler.task(0).lastJitterMicros);
+    TEST_ASSERT_EQUAL_UINT32(1000 + 20000, scheduler.task(0).nextRelease);
+
+    // Late by 2.5 periods: two releases are skipped, not run back to back
+    fakeNow = 1000 + 45000;
+    TEST_ASSERT_TRUE(scheduler.runOnce());
+    TEST_ASSERT_FALSE(scheduler.runOnce());
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.task(0).deadlineMisses);
+    TEST_ASSERT_EQUAL_UINT32(1000 + 50000, scheduler.task(0).nextRelease);
+    TEST_ASSERT_EQUAL_UINT32(25000, scheduler.task(0).maxJitterMicros);
+    TEST_ASSERT_EQUAL_UINT32(3, scheduler.task(0).runs);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.totalDeadlineMisses());
+}
+
+void test_clock_wrap() {
+    // 32-bit microseconds wrap every 71 minutes
+    fakeNow = 0xFFFFF000u;
+    Scheduler scheduler(fakeClock);
+    scheduler.addTask("a", taskA, 1000, 1, 500);
+    costA = 100;
+    for (uint8_t i = 0; i < 10; i++) {
+        drain(scheduler);
+        TEST_ASSERT_EQUAL_UINT32(900, scheduler.microsUntilNextRelease());
+        fakeNow += 900;
+    }
+    const SchedulerTask& a = scheduler.task(0);
+    TEST_ASSERT_EQUAL_UINT32(10, a.runs);
+    TEST_ASSERT_EQUAL_UINT32(0, a.deadlineMisses);
+    TEST_ASSERT_EQUAL_UINT32(0, a.overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, a.maxJitterMicros);
+    TEST_ASSERT_EQUAL_UINT32(100, a.maxDurationMicros);
+}
+
+void test_run_hook_and_table_limits() {
+    Scheduler scheduler(fakeClock);
+    scheduler.setRunHook(runHook);
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.addTask("x", nullptr, 1000, 1, 0));
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.addTask("x", taskA, 0, 1, 0));
+    for (uint8_t i = 0; i < Scheduler::MAX_TASKS; i++) {
+        TEST_ASSERT_EQUAL_INT(i, scheduler.addTask("a", taskA, 1000, 1, 0));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.addTask("b", taskB, 1000, 1, 0));
+    drain(scheduler);
+    TEST_ASSERT_EQUAL_UINT8(2 * Scheduler::MAX_TASKS, hookCalls);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_highest_priority_due_task_runs_first);
+    RUN_TEST(test_equal_priority_runs_earliest_release_first);
+    RUN_TEST(test_a_long_task_delays_but_does_not_preempt);
+    RUN_TEST(test_budget_overruns_are_counted);
+    RUN_TEST(test_periodic_rearm_stays_on_its_grid);
+    RUN_TEST(test_clock_wrap);
+    RUN_TEST(test_run_hook_and_table_limits);
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+// TimeBase (src/time_base.h) fed synthetic PPS and NAV-PVT edges from a
+// drifting local clock, checking how well local time maps onto GNSS time.
+// pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "time_base.h"
+
+// Deterministic noise, so a failure reproduces
+static uint32_t noiseState;
+static uint32_t noise() {
+    noiseState = noiseState * 1664525u + 1013904223u;
+    return noiseState >> 8;
+}
+// Uniform in [-span, span]
+static int64_t jitter(int64_t span) {
+    return (int64_t)(noise() % (uint32_t)(2 * span + 1)) - span;
+}
+
+// Local esp_timer clock: its own epoch, running fast or slow by ppm
+struct LocalClock {
+    int64_t offset;
+    double ppm;
+    int64_t at(int64_t gnssMicros) const {
+        return offset + gnssMicros + (int64_t)((double)(gnssMicros - GNSS_START) * ppm * 1e-6);
+    }
+    static const int64_t GNSS_START = 1709987696000000LL;   // 2024-03-09 12:34:56 UTC
+};
+
+struct Alignment {
+    int64_t worst;       // largest |mapped - true| over the checked span
+    double meanError;
+};
+
+// Maps local instants between edges back to GNSS time over [from, to) s
+static Alignment measure(const TimeBase& timeBase, const LocalClock& clock, int64_t fromS, int64_t toS) {
+    Alignment a = {0, 0.0};
+    int64_t n = 0;
+    for (int64_t t = fromS * 1000000; t < toS * 1000000; t += 250000) {
+        int64_t truth = LocalClock::GNSS_START + t + 123457;
+        int64_t error = timeBase.toGnssMicros(clock.at(truth)) - truth;
+        int64_t magnitude = error < 0 ? -error : error;
+        if (magnitude > a.worst) a.worst = magnitude;
+        a.meanError += (double)error;
+        n++;
+    }
+    a.meanError /= (double)n;
+    return a;
+}
+
+static void report(const char* name, const TimeBase& timeBase, const Alignment& a) {
+    char line[160];
+    snprintf(line, sizeof(line), "%s: worst %lld us, mean %.1f us, drift %.2f ppm, max residual %u us",
+             name, (long long)a.worst, a.meanError, timeBase.driftPpm(),
+             (unsigned)timeBase.maxResidualMicros());
+    TEST_MESSAGE(line);
+}
+
+void setUp() {
+    noiseState = 12345;
+}
+void tearDown() {}
+
+void test_unset_until_first_edge() {
+    TimeBase timeBase;
+    TEST_ASSERT_TRUE(timeBase.toGnssMicros(1000) == 0);
+    TEST_ASSERT_FALSE(timeBase.isLocked());
+}
+
+// Interrupt-stamped PPS edges, ±3 µs of latency jitter, local clock 40 ppm fast
+void test_pps_edges_with_jitter() {
+    LocalClock clock = {-987654321LL, 40.0};
+    TimeBase timeBase;
+    for (int64_t s = 0; s < 300; s++) {
+        int64_t edge = LocalClock::GNSS_START + s * 1000000;
+        timeBase.addEdge(clock.at(edge) + jitter(3), edge, TimeBase::EDGE_PPS);
+        if (s == 60) {
+            TEST_ASSERT_TRUE(timeBase.isLocked());
+        }
+    }
+    TEST_ASSERT_TRUE(timeBase.isLocked());
+    TEST_ASSERT_TRUE(timeBase.hasPps());
+    TEST_ASSERT_EQUAL_UINT32(0, timeBase.stepCount());
+
+    Alignment a = measure(timeBase, clock, 290, 300);
+    report("PPS", timeBase, a);
+    TEST_ASSERT_TRUE(a.worst < 10);
+    // The local clock gains 40 µs a second; the loop takes it back out
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, -40.0f, timeBase.driftPpm());
+    // Edges stay well inside the lock threshold once settled
+    TEST_ASSERT_TRUE(timeBase.maxResidualMicros() < 100);
+    TEST_ASSERT_TRUE(timeBase.lastResidualMicros() < 10 && timeBase.lastResidualMicros() > -10);
+}
+
+// NAV-PVT arrival stamps at 25 Hz: 4 ms minimum latency plus up to 12 ms
+// of UART and receiver jitter, local clock 25 ppm slow. The minimum latency
+// stays as a bias; the jitter must not get through.
+void test_nav_pvt_edges_with_latency_jitter() {
+    LocalClock clock = {5000000LL, -25.0};
+    const int64_t minLatency = 4000;
+    TimeBase timeBase;
+    float worstDrift = 0.0f;
+    for (int64_t k = 0; k < 25 * 600; k++) {
+        int64_t epoch = LocalClock::GNSS_START + k * 40000;
+        int64_t latency = minLatency + (int64_t)(noise() % 12000);
+        timeBase.addEdge(clock.at(epoch + latency), epoch, TimeBase::EDGE_NAV_PVT);
+        // The drift estimate over the last five minutes, not just at the end
+        if (k >= 25 * 300) {
+            float error = timeBase.driftPpm() - 25.0f;
+            if (error < 0) error = -error;
+            if (error > worstDrift) worstDrift = error;
+        }
+    }
+    TEST_ASSERT_TRUE(timeBase.isLocked());
+    TEST_ASSERT_EQUAL_UINT32(0, timeBase.stepCount());
+
+    Alignment a = measure(timeBase, clock, 580, 600);
+    report("NAV-PVT", timeBase, a);
+    // Mapped time runs behind by the minimum latency, and within 1 ms of it
+    TEST_ASSERT_FLOAT_WITHIN(1000.0, (double)-minLatency, a.meanError);
+    TEST_ASSERT_TRUE(a.worst < minLatency + 1200);
+    TEST_ASSERT_TRUE(worstDrift < 12.0f);
+}
+
+// With PPS present, message arrival times stay out of the loop
+void test_pps_overrides_nav_pvt() {
+    LocalClock clock = {0, 15.0};
+    TimeBase timeBase;
+    for (int64_t k = 0; k < 25 * 120; k++) {
+        int64_t epoch = LocalClock::GNSS_START + k * 40000;
+        if (k % 25 == 0) timeBase.addEdge(clock.at(epoch) + jitter(3), epoch, TimeBase::EDGE_PPS);
+        int64_t latency = 4000 + (int64_t)(noise() % 12000);
+        timeBase.addEdge(clock.at(epoch + latency), epoch, TimeBase::EDGE_NAV_PVT);
+    }
+    Alignment a = measure(timeBase, clock, 110, 120);
+    report("PPS + NAV-PVT", timeBase, a);
+    TEST_ASSERT_TRUE(a.worst < 10);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, -15.0f, timeBase.driftPpm());
+}
+
+// A receiver time jump re-steps the clock and it locks again
+void test_time_jump_steps_and_relocks() {
+    LocalClock clock = {0, 10.0};
+    TimeBase timeBase;
+    int64_t shift = 0;
+    for (int64_t s = 0; s < 200; s++) {
+        if (s == 100) shift = 2000000;   // receiver corrects its time by 2 s
+        int64_t edge = LocalClock::GNSS_START + s * 1000000;
+        timeBase.addEdge(clock.at(edge) + jitter(3), edge + shift, TimeBase::EDGE_PPS);
+        if (s == 100) {
+            TEST_ASSERT_FALSE(timeBase.isLocked());
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, timeBase.stepCount());
+    TEST_ASSERT_TRUE(timeBase.isLocked());
+    int64_t truth = LocalClock::GNSS_START + 199500000LL;
+    int64_t error = timeBase.toGnssMicros(clock.at(truth)) - (truth + shift);
+    TEST_ASSERT_TRUE(error < 10 && error > -10);
+}
+
+// One task feeds edges while another converts: on an exact clock every
+// consistent reference maps a local instant to the same GNSS time, so any
+// other answer is a reference point mixed from two edges
+void test_readers_see_a_consistent_reference() {
+    const int64_t offset = 5000000;
+    const int64_t probe = LocalClock::GNSS_START - offset + 777777;
+    TimeBase timeBase;
+    timeBase.addEdge(LocalClock::GNSS_START - offset, LocalClock::GNSS_START, TimeBase::EDGE_PPS);
+
+    std::atomic<bool> feeding(true);
+    std::thread feeder([&]() {
+        for (int64_t k = 1; k <= 400000; k++) {
+            int64_t edge = LocalClock::GNSS_START + k * 1000000;
+            timeBase.addEdge(edge - offset, edge, TimeBase::EDGE_PPS);
+        }
+        feeding.store(false);
+    });
+    uint32_t reads = 0;
+    uint32_t wrong = 0;
+    while (feeding.load()) {
+        if (timeBase.toGnssMicros(probe) != probe + offset) wrong++;
+        reads++;
+    }
+    feeder.join();
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u conversions during 400000 edges, %u inconsistent", reads, wrong);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, wrong);
+    TEST_ASSERT_TRUE(timeBase.toGnssMicros(probe) == probe + offset);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unset_until_first_edge);
+    RUN_TEST(test_pps_edges_with_jitter);
+    RUN_TEST(test_nav_pvt_edges_with_latency_jitter);
+    RUN_TEST(test_pps_overrides_nav_pvt);
+    RUN_TEST(test_time_jump_steps_and_relocks);
+    RUN_TEST(test_readers_see_a_consistent_reference);
+    return UNITY_END();
+}
@@ -0,0 +1,277 @@
+// UbxParser (src/ubx_parser.h) against a receiver byte stream: decoding,
+// fragmented delivery, resync and checksum errors, and throughput.
+// pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "ubx_parser.h"
+
+// Receiver output as it appears on the UART: an NMEA sentence the port
+// still emits, NAV-PVT for 2024-03-09 12:34:56 UTC (nano -120000), and an
+// ACK-ACK for CFG-VALSET. Checksums computed independently of the parser.
+static const uint8_t capture[] = {
+    0x24, 0x47, 0x4e, 0x47, 0x47, 0x41, 0x2c, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x2e, 0x30, 0x30,
+    0x2c, 0x35, 0x32, 0x31, 0x32, 0x2e, 0x33, 0x34, 0x35, 0x36, 0x37, 0x2c, 0x4e, 0x2c, 0x30, 0x32,
+    0x31, 0x30, 0x30, 0x2e, 0x37, 0x34, 0x30, 0x37, 0x34, 0x2c, 0x45, 0x2c, 0x31, 0x2c, 0x31, 0x37,
+    0x2c, 0x30, 0x2e, 0x39, 0x2c, 0x31, 0x31, 0x38, 0x2e, 0x34, 0x2c, 0x4d, 0x2c, 0x33, 0x33, 0x2e,
+    0x30, 0x2c, 0x4d, 0x2c, 0x2c, 0x2a, 0x35, 0x42, 0x0d, 0x0a, 0xb5, 0x62, 0x01, 0x07, 0x5c, 0x00,
+    0xd0, 0x3b, 0x73, 0x1c, 0xe8, 0x07, 0x03, 0x09, 0x0c, 0x22, 0x38, 0x37, 0x2d, 0x00, 0x00, 0x00,
+    0x40, 0x2b, 0xfe, 0xff, 0x03, 0x01, 0x00, 0x11, 0xc0, 0x3a, 0x86, 0x0c, 0x87, 0x68, 0x11, 0x1f,
+    0xc2, 0x4e, 0x02, 0x00, 0xb8, 0xce, 0x01, 0x00, 0xb0, 0x04, 0x00, 0x00, 0x08, 0x07, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x36, 0x00, 0x00,
+    0x19, 0xce, 0xa3, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x84, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xce, 0x4a, 0xb5, 0x62,
+    0x05, 0x01, 0x02, 0x00, 0x06, 0x8a, 0x98, 0xc1,
+};
+static const size_t NMEA_LENGTH = 74;
+static const size_t PVT_FRAME_LENGTH = 100;
+static const size_t ACK_FRAME_LENGTH = 10;
+
+static const uint32_t BAUD = 921600;
+static const uint32_t BYTE_NANOS = 10000000000ULL / BAUD;
+
+struct Received {
+    std::vector<UbxNavPvt> pvts;
+    std::vector<uint16_t> frames;    // class << 8 | id
+};
+
+static void onPvt(const UbxNavPvt& pvt, void* context) {
+    static_cast<Received*>(context)->pvts.push_back(pvt);
+}
+
+static void onFrame(uint8_t msgClass, uint8_t msgId, const uint8_t*, uint16_t, void* context) {
+    static_cast<Received*>(context)->frames.push_back((uint16_t)(msgClass << 8 | msgId));
+}
+
+static void attach(UbxParser& parser, Received& received) {
+    parser.setBaudRate(BAUD);
+    parser.setPvtCallback(onPvt, &received);
+    parser.setFrameCallback(onFrame, &received);
+}
+
+static std::vector<uint8_t> ubxFrame(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length) {
+    std::vector<uint8_t> frame;
+    frame.push_back(UBX_SYNC_1);
+    frame.push_back(UBX_SYNC_2);
+    frame.push_back(msgClass);
+    frame.push_back(msgId);
+    frame.push_back((uint8_t)length);
+    frame.push_back((uint8_t)(length >> 8));
+    frame.insert(frame.end(), payload, payload + length);
+    uint8_t ckA = 0, ckB = 0;
+    for (size_t i = 2; i < frame.size(); i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame.push_back(ckA);
+    frame.push_back(ckB);
+    return frame;
+}
+
+static std::vector<uint8_t> pvtFrame() {
+    return std::vector<uint8_t>(capture + NMEA_LENGTH, capture + NMEA_LENGTH + PVT_FRAME_LENGTH);
+}
+
+static void checkFixture(const UbxNavPvt& pvt) {
+    TEST_ASSERT_EQUAL_UINT32(477314000, pvt.iTOW);
+    TEST_ASSERT_EQUAL_UINT16(2024, pvt.year);
+    TEST_ASSERT_EQUAL_UINT8(3, pvt.month);
+    TEST_ASSERT_EQUAL_UINT8(9, pvt.day);
+    TEST_ASSERT_EQUAL_UINT8(56, pvt.second);
+    TEST_ASSERT_EQUAL_INT32(-120000, pvt.nano);
+    TEST_ASSERT_EQUAL_UINT8(3, pvt.fixType);
+    TEST_ASSERT_EQUAL_UINT8(17, pvt.numSV);
+    TEST_ASSERT_EQUAL_INT32(210123456, pvt.lon);
+    TEST_ASSERT_EQUAL_INT32(521234567, pvt.lat);
+    TEST_ASSERT_EQUAL_INT32(118456, pvt.hMSL);
+    TEST_ASSERT_EQUAL_UINT32(1200, pvt.hAcc);
+    TEST_ASSERT_EQUAL_INT32(13890, pvt.gSpeed);
+    TEST_ASSERT_EQUAL_INT32(27512345, pvt.headMot);
+    TEST_ASSERT_EQUAL_UINT16(132, pvt.pDOP);
+    TEST_ASSERT_EQUAL_UINT32(1709987696, pvt.unixEpoch());
+    TEST_ASSERT_TRUE(pvt.epochMicros() == 1709987695999880LL);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_capture_in_one_chunk() {
+    UbxParser parser;
+    Received received;
+    attach(parser, received);
+    parser.feed(capture, sizeof(capture), 5000000);
+
+    TEST_ASSERT_EQUAL_UINT32(1, received.pvts.size());
+    checkFixture(received.pvts[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, received.frames.size());
+    TEST_ASSERT_EQUAL_HEX16(0x0107, received.frames[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x0501, received.frames[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, parser.framesOk());
+    TEST_ASSERT_EQUAL_UINT32(1, parser.pvtFrames());
+    TEST_ASSERT_EQUAL_UINT32(0, parser.checksumErrors());
+    TEST_ASSERT_EQUAL_UINT32(0, parser.lengthErrors());
+
+    // Stamped when the NAV-PVT sync byte was on the wire
+    size_t after = sizeof(capture) - 1 - NMEA_LENGTH;
+    int64_t expected = 5000000 - (int64_t)(after * BYTE_NANOS / 1000);
+    TEST_ASSERT_TRUE(received.pvts[0].arrivalMicros == expected);
+}
+
+void test_capture_split_at_every_byte() {
+    // Two chunks, cut at every possible position - inside sync, header,
+    // payload and checksum
+    for (size_t cut = 1; cut < sizeof(capture); cut++) {
+        UbxParser parser;
+        Received received;
+        attach(parser, received);
+        parser.feed(capture, cut, 1000);
+        parser.feed(capture + cut, sizeof(capture) - cut, 2000);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, received.pvts.size(), "split capture");
+        TEST_ASSERT_EQUAL_UINT32(2, received.frames.size());
+        checkFixture(received.pvts[0]);
+    }
+}
+
+void test_capture_byte_by_byte() {
+    UbxParser parser;
+    Received received;
+    attach(parser, received);
+    for (size_t i = 0; i < sizeof(capture); i++) parser.feed(capture + i, 1, (int64_t)i * 11);
+    TEST_ASSERT_EQUAL_UINT32(1, received.pvts.size());
+    checkFixture(received.pvts[0]);
+    // Single-byte chunks are stamped exactly at their byte
+    TEST_ASSERT_TRUE(received.pvts[0].arrivalMicros == (int64_t)NMEA_LENGTH * 11);
+}
+
+void test_bad_checksum_drops_only_that_frame() {
+    std::vector<uint8_t> stream = pvtFrame();
+    stream[40] ^= 0x10;                                         // payload bit flip
+    std::vector<uint8_t> good = pvtFrame();
+    stream.insert(stream.end(), good.begin(), good.end());
+    std::vector<uint8_t> badCk = pvtFrame();
+    badCk[PVT_FRAME_LENGTH - 1] ^= 0xFF;                        // CK_B
+    stream.insert(stream.end(), badCk.begin(), badCk.end());
+    stream.insert(stream.end(), good.begin(), good.end());
+
+    UbxParser parser;
+    Received received;
+    attach(parser, received);
+    parser.feed(stream.data(), stream.size(), 0);
+    TEST_ASSERT_EQUAL_UINT32(2, parser.checksumErrors());
+    TEST_ASSERT_EQUAL_UINT32(2, parser.pvtFrames());
+    TEST_ASSERT_EQUAL_UINT32(2, received.pvts.size());
+    checkFixture(received.pvts[1]);
+}
+
+void test_resync_after_noise() {
+    std::vector<uint8_t> stream;
+    // Line noise with stray sync bytes, a header claiming an oversized
+    // payload, then a repeated first sync byte right before the real frame
+    const uint8_t noise[] = {0x00, 0xB5, 0x00, 0x62, 0xB5, 0x41, 0xFF};
+    stream.insert(stream.end(), noise, noise + sizeof(noise));
+    const uint8_t oversized[] = {0xB5, 0x62, 0x01, 0x07, 0xFF, 0x7F};
+    stream.insert(stream.end(), oversized, oversized + sizeof(oversized));
+    stream.push_back(0xB5);
+    size_t start = stream.size();
+    std::vector<uint8_t> good = pvtFrame();
+    stream.insert(stream.end(), good.begin(), good.end());
+
+    UbxParser parser;
+    Received received;
+    attach(parser, received);
+    parser.feed(stream.data(), stream.size(), 1000000);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.lengthErrors());
+    TEST_ASSERT_EQUAL_UINT32(1, received.pvts.size());
+    checkFixture(received.pvts[0]);
+    // Stamped at the sync byte that started the frame, not the stray one
+    size_t after = stream.size() - 1 - start;
+    TEST_ASSERT_TRUE(received.pvts[0].arrivalMicros == 1000000 - (int64_t)(after * BYTE_NANOS / 1000));
+}
+
+void test_truncated_frame_then_recovery() {
+    // A frame cut short swallows what follows as payload and fails its
+    // checksum; the parser is in step again for the frame after that
+    std::vector<uint8_t> stream = pvtFrame();
+    stream.resize(50);
+    for (int i = 0; i < 3; i++) {
+        std::vector<uint8_t> good = pvtFrame();
+        stream.insert(stream.end(), good.begin(), good.end());
+    }
+    UbxParser parser;
+    Received received;
+    attach(parser, received);
+    parser.feed(stream.data(), stream.size(), 0);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.checksumErrors());
+    TEST_ASSERT_EQUAL_UINT32(2, received.pvts.size());
+    checkFixture(received.pvts.back());
+}
+
+void test_short_nav_pvt_is_not_decoded() {
+    std::vector<uint8_t> payload(UBX_NAV_PVT_LEN - 8, 0);
+    std::vector<uint8_t> frame = ubxFrame(UBX_CLASS_NAV, UBX_NAV_PVT, payload.data(), payload.size());
+    UbxParser parser;
+    Received received;
+    attach(parser, received);
+    parser.feed(frame.data(), frame.size(), 0);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.framesOk());
+    TEST_ASSERT_EQUAL_UINT32(0, received.pvts.size());
+    TEST_ASSERT_EQUAL_UINT32(1, received.frames.size());
+}
+
+static uint32_t benchmarkChunks(const std::vector<uint8_t>& stream, size_t chunk, uint32_t frames) {
+    UbxParser parser;
+    Received received;
+    received.pvts.reserve(frames);
+    received.frames.reserve(frames * 2);
+    attach(parser, received);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t at = 0; at < stream.size(); at += chunk) {
+        size_t n = stream.size() - at < chunk ? stream.size() - at : chunk;
+        parser.feed(stream.data() + at, n, (int64_t)at);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Line rate: 921600 baud carries this many NAV-PVT frames a second
+    double lineRate = BAUD / 10.0 / PVT_FRAME_LENGTH;
+    char line[160];
+    snprintf(line, sizeof(line), "%4u-byte chunks: %.2f M NAV-PVT frames/s, %.0f MB/s, %.0fx line rate",
+             (unsigned)chunk, received.pvts.size() / seconds / 1e6,
+             stream.size() / seconds / 1e6, received.pvts.size() / seconds / lineRate);
+    TEST_MESSAGE(line);
+    return received.pvts.size();
+}
+
+// Frames per second through the parser. The UART callback hands it the
+// FIFO in chunks; one byte at a time is how the SparkFun library's serial
+// path feeds its own parser, and bounds the per-byte cost here.
+void test_throughput() {
+    const uint32_t frames = 200000;
+    std::vector<uint8_t> stream;
+    stream.reserve(frames * (PVT_FRAME_LENGTH + ACK_FRAME_LENGTH));
+    std::vector<uint8_t> pvt = pvtFrame();
+    const uint8_t* ack = capture + NMEA_LENGTH + PVT_FRAME_LENGTH;
+    for (uint32_t i = 0; i < frames; i++) {
+        stream.insert(stream.end(), pvt.begin(), pvt.end());
+        if (i % 25 == 0) stream.insert(stream.end(), ack, ack + ACK_FRAME_LENGTH);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(frames, benchmarkChunks(stream, 1, frames));
+    TEST_ASSERT_EQUAL_UINT32(frames, benchmarkChunks(stream, 256, frames));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_capture_in_one_chunk);
+    RUN_TEST(test_capture_split_at_every_byte);
+    RUN_TEST(test_capture_byte_by_byte);
+    RUN_TEST(test_bad_checksum_drops_only_that_frame);
+    RUN_TEST(test_resync_after_noise);
+    RUN_TEST(test_truncated_frame_then_recovery);
+    RUN_TEST(test_short_nav_pvt_is_not_decoded);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,549 @@
+// Reader for V2 block logs (src/log_block.h)
+//
+// Checks every block, resynchronizes on the next sync word after a damaged
+// one, and decodes the record blocks on several threads - each block
+// decodes on its own. Records go to stdout (or a file) as CSV with the
+// fields of the log's #SCHEMA line, scaled; block counts, damaged blocks,
+// sequence gaps and CRC failures go to stderr.
+//
+// With --from/--to only the blocks covering that time are read, found in
+// the log's .idx sidecar (src/log_index.h) - the rest of the file is
+// seeked past. Every record of those blocks is written, so a few either
+// side of the range come along. --bench-lookup times random lookups on a log three ways:
+// through the index, by bisecting the log's own block headers, and by
+// scanning them from the start, counting file reads for each.
+//
+// Build on the host:
+//   g++ -O2 -std=c++11 -pthread -Isrc tools/log_reader.cpp src/log_block.cpp src/log_index.cpp src/crc.cpp -o log_reader
+// Usage:
+//   log_reader [-j threads] [--blocks] [--from utc_s --to utc_s] <log.bin> [out.csv]
+//   log_reader --bench-lookup count <log.bin>
+//   --blocks lists the block headers instead of decoding records
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "log_block.h"
+#include "log_index.h"
+#include "crc.h"
+
+#define MAX_FIELDS 32
+
+struct Field {
+    std::string name;
+    char code;
+    double scale;
+    size_t offset;
+};
+
+struct Schema {
+    std::vector<Field> fields;
+    size_t size = 0;
+    size_t crcOffset = 0;
+};
+
+static size_t codeSize(char code) {
+    switch (code) {
+        case 'B': case 'b': return 1;
+        case 'H': case 'h': return 2;
+        case 'I': case 'i': case 'f': return 4;
+        case 'Q': case 'q': case 'd': return 8;
+        default: return 0;
+    }
+}
+
+// "#SCHEMA gps v2 size=44 crc=42 fields=name:code:scale:unit,..."
+static bool parseSchema(const std::string& line, Schema& schema) {
+    size_t at = line.find(" size=");
+    size_t crc = line.find(" crc=");
+    size_t fields = line.find(" fields=");
+    if (at == std::string::npos || crc == std::string::npos || fields == std::string::npos) return false;
+    schema.size = strtoul(line.c_str() + at + 6, nullptr, 10);
+    schema.crcOffset = strtoul(line.c_str() + crc + 5, nullptr, 10);
+
+    std::string list = line.substr(fields + 8);
+    size_t offset = 0;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(start, end - start);
+        size_t c1 = item.find(':');
+        size_t c2 = item.find(':', c1 + 1);
+        size_t c3 = item.find(':', c2 + 1);
+        if (c1 == std::string::npos || c2 == std::string::npos || c3 == std::string::npos) return false;
+        Field f;
+        f.name = item.substr(0, c1);
+        f.code = item[c1 + 1];
+        f.scale = atof(item.substr(c2 + 1, c3 - c2 - 1).c_str());
+        f.offset = offset;
+        if (codeSize(f.code) == 0) return false;
+        offset += codeSize(f.code);
+        schema.fields.push_back(f);
+        start = end + 1;
+    }
+    // The CRC16 trailer follows the fields
+    return !schema.fields.empty() && schema.fields.size() <= MAX_FIELDS &&
+           offset == schema.crcOffset && offset + 2 == schema.size;
+}
+
+static int64_t readField(const uint8_t* p, char code) {
+    switch (code) {
+        case 'B': return p[0];
+        case 'b': return (int8_t)p[0];
+        case 'H': return (uint16_t)(p[0] | (p[1] << 8));
+        case 'h': return (int16_t)(p[0] | (p[1] << 8));
+        case 'I': { uint32_t v; memcpy(&v, p, 4); return v; }
+        case 'i': { int32_t v; memcpy(&v, p, 4); return v; }
+        case 'q': case 'Q': { int64_t v; memcpy(&v, p, 8); return v; }
+        default:  return 0;
+    }
+}
+
+// Mirrors RecordStreamDecoder (src/record_stream.cpp) on field values
+// instead of a record buffer. A block starts with a keyframe.
+class DeltaDecoder {
+public:
+    explicit DeltaDecoder(size_t fields) : count(fields), linear(0), synced(false), sequence(0) {}
+
+    // True with values filled for a whole frame
+    bool decode(const uint8_t* data, size_t length, int64_t* values) {
+        if (length == 0) return false;
+        uint8_t kind = data[0] >> 6;
+        uint8_t seq = data[0] & 0x3F;
+        size_t n = 1;
+        uint64_t v;
+        if (kind == 0) {
+            if (!varint(data, length, n, v) || n >= length || data[n++] != count) return false;
+            linear = (uint32_t)v;
+            for (size_t i = 0; i < count; i++) {
+                if (!varint(data, length, n, v)) return false;
+                previous[i] = unzigzag(v);
+                slope[i] = 0;
+            }
+            synced = true;
+        } else if (kind == 1) {
+            uint64_t changed;
+            if (!varint(data, length, n, changed) || !synced || seq != ((sequence + 1) & 0x3F)) {
+                synced = false;
+                return false;
+            }
+            for (size_t i = 0; i < count; i++) {
+                int64_t residual = 0;
+                if ((changed >> i) & 1) {
+                    if (!varint(data, length, n, v)) return false;
+                    residual = unzigzag(v);
+                }
+                int64_t value = previous[i] + ((linear >> i) & 1 ? slope[i] : 0) + residual;
+                slope[i] = value - previous[i];
+                previous[i] = value;
+            }
+        } else {
+            return false;
+        }
+        sequence = seq;
+        memcpy(values, previous, count * sizeof(int64_t));
+        return true;
+    }
+
+private:
+    static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+    static bool varint(const uint8_t* data, size_t length, size_t& n, uint64_t& v) {
+        v = 0;
+        for (size_t i = 0; i < 10 && n < length; i++) {
+            uint8_t b = data[n++];
+            v |= (uint64_t)(b & 0x7F) << (7 * i);
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    size_t count;
+    uint32_t linear;
+    bool synced;
+    uint8_t sequence;
+    int64_t previous[MAX_FIELDS];
+    int64_t slope[MAX_FIELDS];
+};
+
+static void appendValue(std::string& out, const Field& field, int64_t value) {
+    char text[40];
+    if (field.scale == 1.0) {
+        snprintf(text, sizeof(text), "%lld", (long long)value);
+    } else {
+        snprintf(text, sizeof(text), "%.7f", value * field.scale);
+        // Trailing zeros off, as usb_reader does
+        char* end = text + strlen(text) - 1;
+        while (end > text && *end == '0') *end-- = '\0';
+        if (*end == '.') *end = '\0';
+    }
+    out += ',';
+    out += text;
+}
+
+struct BlockResult {
+    std::string csv;
+    uint32_t records = 0;
+    uint32_t badCrc = 0;
+    uint32_t undecoded = 0;
+};
+
+// Block numbers in the CSV count from the file's first block
+static void decodeBlock(const uint8_t* block, const LogBlockHeader& header, uint32_t firstSequence,
+                        const Schema& schema, BlockResult& result) {
+    LogBlockRecords records(block, header);
+    DeltaDecoder delta(schema.fields.size());
+    uint8_t type;
+    uint8_t length;
+    const uint8_t* data;
+    int64_t values[MAX_FIELDS];
+
+    while (records.next(type, data, length)) {
+        if (type != LOG_RECORD_GPS) {
+            result.undecoded++;
+            continue;
+        }
+        bool crcOk = true;
+        if (header.flags & LOG_BLOCK_DELTA) {
+            // The CRC is not stored - the decoder would only recompute it
+            if (!delta.decode(data, length, values)) {
+                result.undecoded++;
+                continue;
+            }
+        } else {
+            if (length != schema.size) {
+                result.undecoded++;
+                continue;
+            }
+            for (size_t i = 0; i < schema.fields.size(); i++) {
+                values[i] = readField(data + schema.fields[i].offset, schema.fields[i].code);
+            }
+            uint16_t stored = data[schema.crcOffset] | (data[schema.crcOffset + 1] << 8);
+            crcOk = crc16(data, schema.crcOffset) == stored;
+            if (!crcOk) result.badCrc++;
+        }
+
+        result.csv += std::to_string(header.sequence - firstSequence);
+        for (size_t i = 0; i < schema.fields.size(); i++) appendValue(result.csv, schema.fields[i], values[i]);
+        result.csv += crcOk ? ",1\n" : ",0\n";
+        result.records++;
+    }
+    if (records.malformed()) result.undecoded++;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) data.insert(data.end(), buffer, buffer + n);
+    fclose(f);
+    return true;
+}
+
+static bool allZero(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (data[i]) return false;
+    }
+    return true;
+}
+
+static std::string indexPathOf(const char* logPath) {
+    std::string path(logPath);
+    size_t dot = path.rfind('.');
+    return (dot == std::string::npos ? path : path.substr(0, dot)) + ".idx";
+}
+
+struct IndexFile {
+    FILE* file;
+    uint32_t count;             // entries
+    uint32_t reads;
+};
+
+static bool readIndexEntry(void* context, uint32_t i, LogIndexEntry& entry) {
+    IndexFile& index = *static_cast<IndexFile*>(context);
+    index.reads++;
+    return fseek(index.file, sizeof(LogIndexHeader) + (long)i * sizeof(entry), SEEK_SET) == 0 &&
+           fread(&entry, sizeof(entry), 1, index.file) == 1;
+}
+
+// Opens the index of an open log, if it belongs to the log
+static bool openIndex(const char* logPath, FILE* log, IndexFile& index, uint32_t& blockCount) {
+    uint8_t block[LOG_BLOCK_SIZE];
+    LogBlockHeader header;
+    if (fseek(log, 0, SEEK_SET) != 0 || fread(block, LOG_BLOCK_SIZE, 1, log) != 1 ||
+        !checkLogBlock(block, header) || header.kind != LOG_BLOCK_METADATA) return false;
+    fseek(log, 0, SEEK_END);
+    blockCount = ftell(log) / LOG_BLOCK_SIZE;
+
+    index.file = fopen(indexPathOf(logPath).c_str(), "rb");
+    index.reads = 0;
+    if (!index.file) return false;
+    LogIndexHeader indexHeader;
+    if (fread(&indexHeader, sizeof(indexHeader), 1, index.file) != 1 ||
+        !checkLogIndexHeader(indexHeader, header.sequence)) {
+        fclose(index.file);
+        return false;
+    }
+    fseek(index.file, 0, SEEK_END);
+    index.count = (ftell(index.file) - sizeof(indexHeader)) / sizeof(LogIndexEntry);
+    return true;
+}
+
+// The metadata block, then the blocks holding fromMicros to toMicros
+static bool readRange(const char* path, int64_t fromMicros, int64_t toMicros, std::vector<uint8_t>& data) {
+    FILE* log = fopen(path, "rb");
+    if (!log) return false;
+    IndexFile index;
+    uint32_t blockCount, first, end;
+    if (!openIndex(path, log, index, blockCount)) {
+        fprintf(stderr, "No index of %s at %s\n", path, indexPathOf(path).c_str());
+        fclose(log);
+        return false;
+    }
+    bool ok = findLogIndexRange(readIndexEntry, &index, index.count, blockCount, fromMicros, toMicros,
+                                first, end);
+    fclose(index.file);
+    if (ok) {
+        data.resize((size_t)(1 + end - first) * LOG_BLOCK_SIZE);
+        ok = fseek(log, 0, SEEK_SET) == 0 && fread(&data[0], LOG_BLOCK_SIZE, 1, log) == 1 &&
+             fseek(log, (long)first * LOG_BLOCK_SIZE, SEEK_SET) == 0 &&
+             fread(&data[LOG_BLOCK_SIZE], LOG_BLOCK_SIZE, end - first, log) == end - first;
+        fprintf(stderr, "range: blocks %u-%u of %u, %u index reads\n", first, end, blockCount, index.reads);
+    }
+    fclose(log);
+    return ok;
+}
+
+// Block of the last records block starting at or before micros, by
+// bisecting the log's block headers; blocks without a time count as before
+static uint32_t bisectHeaders(FILE* log, uint32_t blockCount, int64_t micros, uint32_t& reads) {
+    uint32_t low = 1;
+    uint32_t high = blockCount;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        LogBlockHeader header;
+        reads++;
+        fseek(log, (long)mid * LOG_BLOCK_SIZE, SEEK_SET);
+        bool before = fread(&header, sizeof(header), 1, log) != 1 || header.kind != LOG_BLOCK_RECORDS ||
+                      header.firstMicros == 0 || header.firstMicros <= micros;
+        if (before) low = mid + 1;
+        else high = mid;
+    }
+    return low > 1 ? low - 1 : 1;
+}
+
+static uint32_t scanHeaders(FILE* log, uint32_t blockCount, int64_t micros, uint32_t& reads) {
+    uint32_t found = 1;
+    for (uint32_t i = 1; i < blockCount; i++) {
+        LogBlockHeader header;
+        reads++;
+        fseek(log, (long)i * LOG_BLOCK_SIZE, SEEK_SET);
+        if (fread(&header, sizeof(header), 1, log) != 1) break;
+        if (header.kind != LOG_BLOCK_RECORDS || header.firstMicros == 0) continue;
+        if (header.firstMicros > micros) break;
+        found = i;
+    }
+    return found;
+}
+
+static int benchLookup(const char* path, unsigned lookups) {
+    FILE* log = fopen(path, "rb");
+    IndexFile index;
+    uint32_t blockCount;
+    if (!log || !openIndex(path, log, index, blockCount) || index.count == 0) {
+        fprintf(stderr, "%s needs a log with a non-empty index\n", path);
+        return 1;
+    }
+    LogIndexEntry firstEntry, lastEntry;
+    readIndexEntry(&index, 0, firstEntry);
+    readIndexEntry(&index, index.count - 1, lastEntry);
+    int64_t span = lastEntry.micros - firstEntry.micros;
+    printf("%s: %u blocks, %u index entries, %.1f h of records\n", path, blockCount, index.count,
+           span / 3.6e9);
+
+    std::vector<int64_t> times(lookups);
+    srand(1);
+    for (unsigned i = 0; i < lookups; i++) {
+        times[i] = firstEntry.micros + (int64_t)((double)rand() / RAND_MAX * span);
+    }
+    std::vector<uint32_t> byIndex(lookups), byBisect(lookups), byScan(lookups);
+    const char* names[] = {"index", "bisect headers", "scan headers"};
+    for (int method = 0; method < 3; method++) {
+        uint32_t reads = 0;
+        index.reads = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < lookups; i++) {
+            uint32_t first, end;
+            if (method == 0) {
+                findLogIndexRange(readIndexEntry, &index, index.count, blockCount, times[i], times[i], first, end);
+                byIndex[i] = first;
+            } else if (method == 1) {
+                byBisect[i] = bisectHeaders(log, blockCount, times[i], reads);
+            } else {
+                byScan[i] = scanHeaders(log, blockCount, times[i], reads);
+            }
+        }
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        if (method == 0) reads = index.reads;
+        printf("%-15s %9.2f us/lookup %8.1f reads/lookup\n", names[method], micros / lookups,
+               (double)reads / lookups);
+    }
+
+    // The index lands on the first block of the group holding the time
+    unsigned mismatches = 0;
+    for (unsigned i = 0; i < lookups; i++) {
+        if (byBisect[i] != byScan[i] || byIndex[i] > byScan[i] || byScan[i] - byIndex[i] >= LOG_INDEX_EVERY) {
+            mismatches++;
+        }
+    }
+    printf("%u lookups, %u disagree\n", lookups, mismatches);
+    fclose(index.file);
+    fclose(log);
+    return mismatches ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = std::thread::hardware_concurrency();
+    bool listBlocks = false;
+    bool ranged = false;
+    int64_t fromMicros = INT64_MIN;
+    int64_t toMicros = INT64_MAX;
+    unsigned benchLookups = 0;
+    const char* inPath = nullptr;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--blocks") == 0) listBlocks = true;
+        else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            fromMicros = (int64_t)(atof(argv[++i]) * 1e6);
+            ranged = true;
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            toMicros = (int64_t)(atof(argv[++i]) * 1e6);
+            ranged = true;
+        } else if (strcmp(argv[i], "--bench-lookup") == 0 && i + 1 < argc) benchLookups = atoi(argv[++i]);
+        else if (!inPath) inPath = argv[i];
+        else outPath = argv[i];
+    }
+    if (!inPath) {
+        fprintf(stderr, "Usage: %s [-j threads] [--blocks] [--from utc_s --to utc_s] <log.bin> [out.csv]\n"
+                        "       %s --bench-lookup count <log.bin>\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (benchLookups > 0) return benchLookup(inPath, benchLookups);
+    if (threads == 0) threads = 1;
+
+    std::vector<uint8_t> data;
+    if (ranged ? !readRange(inPath, fromMicros, toMicros, data) : !readFile(inPath, data)) {
+        fprintf(stderr, "Cannot read %s\n", inPath);
+        return 1;
+    }
+
+    // Find every intact block. A preallocated file that was never trimmed
+    // ends in unwritten space, which is not damage.
+    std::vector<size_t> offsets;
+    uint32_t damaged = 0;
+    uint32_t gaps = 0;
+    size_t skippedBytes = 0;
+    size_t unwritten = 0;
+    LogBlockHeader header;
+    size_t at = 0;
+    while (at + LOG_BLOCK_SIZE <= data.size()) {
+        if (checkLogBlock(&data[at], header)) {
+            offsets.push_back(at);
+            at += LOG_BLOCK_SIZE;
+            continue;
+        }
+        if (allZero(&data[at], LOG_BLOCK_SIZE)) {
+            unwritten += LOG_BLOCK_SIZE;
+            at += LOG_BLOCK_SIZE;
+            continue;
+        }
+        damaged++;
+        size_t next = findLogBlock(data.data(), data.size(), at + 1);
+        skippedBytes += next - at;
+        at = next;
+    }
+    size_t trailing = data.size() - at;
+
+    Schema schema;
+    bool haveSchema = false;
+    uint32_t previousSequence = 0;
+    uint32_t firstSequence = 0;
+    for (size_t i = 0; i < offsets.size(); i++) {
+        checkLogBlock(&data[offsets[i]], header);
+        if (i == 0) firstSequence = header.sequence;
+        // A range skips from the metadata block to its first block
+        if (i > 0 && header.sequence != previousSequence + 1 && !(ranged && i == 1)) gaps++;
+        previousSequence = header.sequence;
+        if (listBlocks) {
+            printf("%zu seq=%u kind=%u flags=0x%02x types=0x%02x records=%u payload=%u first=%lld last=%lld\n",
+                   offsets[i], header.sequence, header.kind, header.flags, header.typeMask,
+                   header.recordCount, header.payloadLength,
+                   (long long)header.firstMicros, (long long)header.lastMicros);
+        }
+        if (header.kind == LOG_BLOCK_METADATA && !haveSchema) {
+            std::string text((const char*)&data[offsets[i] + sizeof(header)], header.payloadLength);
+            size_t line = text.find("#SCHEMA ");
+            if (line != std::string::npos) {
+                haveSchema = parseSchema(text.substr(line, text.find('\n', line) - line), schema);
+            }
+        }
+        if (header.kind == LOG_BLOCK_SUMMARY) {
+            std::string text((const char*)&data[offsets[i] + sizeof(header)], header.payloadLength);
+            while (!text.empty() && text.back() == '\n') text.pop_back();
+            fprintf(stderr, "%s%s\n", text.c_str(),
+                    header.flags & LOG_BLOCK_RECOVERED ? " (written by boot-time recovery)" : "");
+        }
+    }
+
+    fprintf(stderr, "blocks %zu  damaged %u (%zu bytes skipped)  sequence gaps %u  unwritten %zu bytes  trailing %zu bytes\n",
+            offsets.size(), damaged, skippedBytes, gaps, unwritten, trailing);
+    if (listBlocks) return 0;
+    if (!haveSchema) {
+        fprintf(stderr, "No metadata block with a usable #SCHEMA line\n");
+        return 1;
+    }
+
+    // Blocks are independent, so they decode in any order on any thread
+    std::vector<BlockResult> results(offsets.size());
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t]() {
+            LogBlockHeader h;
+            for (size_t i = t; i < offsets.size(); i += threads) {
+                checkLogBlock(&data[offsets[i]], h);
+                if (h.kind == LOG_BLOCK_RECORDS) decodeBlock(&data[offsets[i]], h, firstSequence, schema, results[i]);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", outPath);
+        return 1;
+    }
+    fprintf(out, "block");
+    for (size_t i = 0; i < schema.fields.size(); i++) fprintf(out, ",%s", schema.fields[i].name.c_str());
+    fprintf(out, ",crc_ok\n");
+    uint32_t records = 0;
+    uint32_t badCrc = 0;
+    uint32_t undecoded = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        fwrite(results[i].csv.data(), 1, results[i].csv.size(), out);
+        records += results[i].records;
+        badCrc += results[i].badCrc;
+        undecoded += results[i].undecoded;
+    }
+    if (outPath) fclose(out);
+
+    fprintf(stderr, "records %u  record CRC failures %u  undecoded %u  threads %u\n",
+            records, badCrc, undecoded, threads);
+    return 0;
+}
@@ -0,0 +1,474 @@
+// Reader for the binary USB stream (src/usb_stream.h)
+//
+// Splits the bytes at each 0x00 delimiter, COBS-decodes and CRC-checks
+// every frame with the device's own routines, and writes GPS records and
+// IMU samples as CSV using the #SCHEMA lines of the schema frame that
+// repeats every second: one line per record prefixed with its type on
+// stdout, or one file per type with an output prefix. Frame counts, CRC
+// failures and sequence gaps go to stderr. A reader started mid-stream
+// syncs at the next 0x00 and decodes once a schema frame arrives. On a
+// serial port it sends STREAM ON first and STREAM OFF on exit or Ctrl-C.
+//
+// --bench decodes a capture - or a minute of stream built with the
+// device's framer at the device's rates - over and over, CSV formatting
+// included, and compares the rate with what the stream and the USB
+// full-speed port can carry.
+//
+// Build on the host:
+//   g++ -O2 -std=c++11 -Isrc tools/usb_reader.cpp src/usb_stream.cpp src/packet_schema.cpp src/crc.cpp -o usb_reader
+// Usage:
+//   usb_reader <port|capture.bin|-> [out_prefix]
+//   usb_reader --bench [capture.bin]
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "usb_stream.h"
+#include "packet_schema.h"
+#include "crc.h"
+
+#define MAX_FIELDS       32
+#define READ_SIZE        65536
+#define OUTPUT_FLUSH     65536
+#define STATS_INTERVAL_S 5.0
+
+// The device's stream task (boardconfig.h) and IMU FIFO rate, for --bench
+#define DEVICE_PERIOD_MS    10
+#define DEVICE_SCHEMA_MS    1000
+#define DEVICE_GPS_HZ       25
+#define DEVICE_IMU_HZ       500
+#define BENCH_SECONDS       60
+// Full-speed bulk: at most 19 64-byte packets per 1 ms USB frame
+#define USB_FULL_SPEED_BYTES_PER_S (19 * 64 * 1000)
+
+struct Field {
+    std::string name;
+    char code;
+    double scale;
+    size_t offset;
+};
+
+struct Schema {
+    std::vector<Field> fields;
+    size_t size = 0;
+};
+
+static size_t codeSize(char code) {
+    switch (code) {
+        case 'B': case 'b': return 1;
+        case 'H': case 'h': return 2;
+        case 'I': case 'i': case 'f': return 4;
+        case 'Q': case 'q': case 'd': return 8;
+        default: return 0;
+    }
+}
+
+// "#SCHEMA gps v2 size=44 crc=42 fields=name:code:scale:unit,..." - records
+// without crc= (IMU samples) have no CRC16 trailer; the frame CRC covers them
+static bool parseSchema(const std::string& line, std::string& name, Schema& schema) {
+    size_t space = line.find(' ', 8);
+    size_t at = line.find(" size=");
+    size_t crc = line.find(" crc=");
+    size_t fields = line.find(" fields=");
+    if (space == std::string::npos || at == std::string::npos || fields == std::string::npos) return false;
+    name = line.substr(8, space - 8);
+    schema.size = strtoul(line.c_str() + at + 6, nullptr, 10);
+
+    std::string list = line.substr(fields + 8);
+    size_t offset = 0;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(start, end - start);
+        size_t c1 = item.find(':');
+        size_t c2 = item.find(':', c1 + 1);
+        size_t c3 = item.find(':', c2 + 1);
+        if (c1 == std::string::npos || c2 == std::string::npos || c3 == std::string::npos) return false;
+        Field f;
+        f.name = item.substr(0, c1);
+        f.code = item[c1 + 1];
+        f.scale = atof(item.substr(c2 + 1, c3 - c2 - 1).c_str());
+        f.offset = offset;
+        if (codeSize(f.code) == 0) return false;
+        offset += codeSize(f.code);
+        schema.fields.push_back(f);
+        start = end + 1;
+    }
+    if (crc != std::string::npos) {
+        if (strtoul(line.c_str() + crc + 5, nullptr, 10) != offset) return false;
+        offset += 2;
+    }
+    return !schema.fields.empty() && schema.fields.size() <= MAX_FIELDS && offset == schema.size;
+}
+
+// Same text as log_reader and the Python tools: floats to 6 significant digits, scaled
+// integers to 7 decimals without trailing zeros, the rest as integers
+static void appendField(std::string& out, const Field& field, const uint8_t* p) {
+    char text[40];
+    int64_t value;
+    switch (field.code) {
+        case 'B': value = p[0]; break;
+        case 'b': value = (int8_t)p[0]; break;
+        case 'H': value = (uint16_t)(p[0] | (p[1] << 8)); break;
+        case 'h': value = (int16_t)(p[0] | (p[1] << 8)); break;
+        case 'I': { uint32_t v; memcpy(&v, p, 4); value = v; break; }
+        case 'i': { int32_t v; memcpy(&v, p, 4); value = v; break; }
+        case 'Q': case 'q': { int64_t v; memcpy(&v, p, 8); value = v; break; }
+        case 'f': { float v; memcpy(&v, p, 4); snprintf(text, sizeof(text), "%.6g", v * field.scale); out += text; return; }
+        case 'd': { double v; memcpy(&v, p, 8); snprintf(text, sizeof(text), "%.6g", v * field.scale); out += text; return; }
+        default:  value = 0; break;
+    }
+    if (field.scale == 1.0) {
+        snprintf(text, sizeof(text), "%lld", (long long)value);
+    } else {
+        snprintf(text, sizeof(text), "%.7f", value * field.scale);
+        char* end = text + strlen(text) - 1;
+        while (end > text && *end == '0') *end-- = '\0';
+        if (*end == '.') *end = '\0';
+    }
+    out += text;
+}
+
+class UsbStreamReader {
+public:
+    // No prefix: every record to stdout. discard: format, write nothing (--bench)
+    UsbStreamReader(const char* outPrefix, bool discard) : prefix(outPrefix), discard(discard) {
+        for (int t = 0; t < 3; t++) {
+            outputs[t] = nullptr;
+            records[t] = 0;
+        }
+    }
+
+    ~UsbStreamReader() {
+        flush();
+        for (int t = 0; t < 3; t++) {
+            if (outputs[t] && outputs[t] != stdout) fclose(outputs[t]);
+        }
+    }
+
+    void feed(const uint8_t* data, size_t length) {
+        const uint8_t* end = data + length;
+        while (data < end) {
+            const uint8_t* zero = (const uint8_t*)memchr(data, 0, end - data);
+            if (!zero) {
+                pending.insert(pending.end(), data, end);
+                break;
+            }
+            if (pending.empty()) {
+                frame(data, zero - data);
+            } else {
+                // Frame split across reads
+                pending.insert(pending.end(), data, zero);
+                frame(pending.data(), pending.size());
+                pending.clear();
+            }
+            data = zero + 1;
+        }
+        if (buffers[1].size() + buffers[2].size() >= OUTPUT_FLUSH) flush();
+    }
+
+    void flush() {
+        for (int t = 1; t < 3; t++) {
+            if (buffers[t].empty()) continue;
+            if (!discard) {
+                FILE* out = output(t);
+                if (out) fwrite(buffers[t].data(), 1, buffers[t].size(), out);
+            }
+            buffers[t].clear();
+        }
+    }
+
+    void report() const {
+        fprintf(stderr, "frames %u  gps %u  imu %u  lost %u  bad %u  no-schema %u\n",
+                frames, records[USB_FRAME_GPS], records[USB_FRAME_IMU], lost, bad, unknown);
+    }
+
+    uint32_t frames = 0;
+    uint32_t bad = 0;       // text before the stream started, damaged frames
+    uint32_t lost = 0;      // from sequence gaps
+    uint32_t unknown = 0;   // records before their schema arrived
+    uint32_t records[3];
+
+private:
+    void frame(const uint8_t* encoded, size_t length) {
+        if (length == 0) return;
+        if (length > USB_FRAME_MAX_ENCODED(USB_FRAME_MAX_PAYLOAD)) {
+            bad++;
+            return;
+        }
+        uint8_t raw[USB_FRAME_MAX_ENCODED(USB_FRAME_MAX_PAYLOAD)];
+        size_t n = cobsDecode(encoded, length, raw);
+        if (n < 5 || crc16(raw, n - 2) != (uint16_t)(raw[n - 2] | (raw[n - 1] << 8))) {
+            bad++;
+            return;
+        }
+        frames++;
+        uint16_t sequence = raw[1] | (raw[2] << 8);
+        if (haveSequence && sequence != expected) lost += (uint16_t)(sequence - expected);
+        expected = sequence + 1;
+        haveSequence = true;
+
+        const uint8_t* payload = raw + 3;
+        size_t payloadLength = n - 5;
+        if (raw[0] == USB_FRAME_SCHEMA) {
+            schemaFrame(std::string((const char*)payload, payloadLength));
+        } else if (raw[0] == USB_FRAME_GPS || raw[0] == USB_FRAME_IMU) {
+            record(raw[0], payload, payloadLength);
+        }
+    }
+
+    void schemaFrame(const std::string& text) {
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) end = text.size();
+            std::string line = text.substr(start, end - start);
+            start = end + 1;
+            std::string name;
+            Schema schema;
+            if (line.compare(0, 8, "#SCHEMA ") != 0 || !parseSchema(line, name, schema)) continue;
+            int type = name == "gps" ? USB_FRAME_GPS : name == "imu" ? USB_FRAME_IMU : 0;
+            if (type == 0 || !schemas[type].fields.empty()) continue;
+            schemas[type] = schema;
+
+            std::string& out = header(type);
+            for (size_t i = 0; i < schema.fields.size(); i++) {
+                if (i) out += ',';
+                out += schema.fields[i].name;
+            }
+            out += '\n';
+        }
+    }
+
+    void record(int type, const uint8_t* payload, size_t length) {
+        const Schema& schema = schemas[type];
+        if (schema.fields.empty() || length != schema.size) {
+            unknown++;
+            return;
+        }
+        std::string& out = header(type);
+        for (size_t i = 0; i < schema.fields.size(); i++) {
+            if (i) out += ',';
+            appendField(out, schema.fields[i], payload + schema.fields[i].offset);
+        }
+        out += '\n';
+        records[type]++;
+    }
+
+    // Line start for a record type: its name on stdout, nothing in a file
+    std::string& header(int type) {
+        std::string& out = buffers[prefix ? type : 1];
+        if (!prefix) out += type == USB_FRAME_GPS ? "gps," : "imu,";
+        return out;
+    }
+
+    FILE* output(int type) {
+        if (!prefix) return stdout;
+        if (!outputs[type]) {
+            std::string path = std::string(prefix) + (type == USB_FRAME_GPS ? "_gps.csv" : "_imu.csv");
+            outputs[type] = fopen(path.c_str(), "w");
+            if (!outputs[type]) fprintf(stderr, "Cannot write %s\n", path.c_str());
+        }
+        return outputs[type];
+    }
+
+    const char* prefix;
+    bool discard;
+    std::vector<uint8_t> pending;
+    Schema schemas[3];
+    std::string buffers[3];
+    FILE* outputs[3];
+    bool haveSequence = false;
+    uint16_t expected = 0;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+static void onSignal(int) { stopRequested = 1; }
+
+// CDC ignores the baud rate; raw mode so no byte is translated
+static int openPort(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 1;    // reads return after 100 ms with nothing
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIFLUSH);
+    return fd;
+}
+
+static bool writeCommand(int fd, const char* command) {
+    return write(fd, command, strlen(command)) == (ssize_t)strlen(command);
+}
+
+static int readStream(const char* path, const char* outPrefix) {
+    struct stat st;
+    bool port = strcmp(path, "-") != 0 && stat(path, &st) == 0 && S_ISCHR(st.st_mode);
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : port ? openPort(path) : open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    if (port && !writeCommand(fd, "STREAM ON\n")) {
+        fprintf(stderr, "Cannot write to %s\n", path);
+        return 1;
+    }
+
+    UsbStreamReader reader(outPrefix, false);
+    static uint8_t buffer[READ_SIZE];
+    auto lastStats = std::chrono::steady_clock::now();
+    while (!stopRequested) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0) break;
+        // A timeout on a port reads nothing and is not the end of the stream
+        if (n == 0 && !port) break;
+        reader.feed(buffer, n);
+        if (port) {
+            // Live: keep the CSV current rather than a buffer behind
+            reader.flush();
+            fflush(stdout);
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<double>(now - lastStats).count() >= STATS_INTERVAL_S) {
+                lastStats = now;
+                reader.report();
+            }
+        }
+    }
+    if (port) writeCommand(fd, "STREAM OFF\n");
+    if (fd != STDIN_FILENO) close(fd);
+    reader.flush();
+    reader.report();
+    return 0;
+}
+
+// A minute of what the stream task sends: schema every second, GNSS
+// records at the navigation rate, IMU samples at the FIFO rate
+static void synthesizeStream(std::vector<uint8_t>& out) {
+    UsbStreamFramer framer;
+    uint8_t frame[USB_FRAME_MAX_ENCODED(USB_FRAME_MAX_PAYLOAD)];
+    char schema[USB_FRAME_MAX_PAYLOAD];
+    size_t length = writeSchemaDescriptor(gpsPacketSchema, schema, sizeof(schema) - 1);
+    length += snprintf(schema + length, sizeof(schema) - length, "\n%s", STREAM_IMU_SCHEMA);
+
+    uint32_t gpsCount = 0;
+    uint32_t imuCount = 0;
+    for (uint32_t ms = 0; ms < BENCH_SECONDS * 1000; ms += DEVICE_PERIOD_MS) {
+        size_t n;
+        if (ms % DEVICE_SCHEMA_MS == 0) {
+            n = framer.frame(USB_FRAME_SCHEMA, schema, length, frame);
+            out.insert(out.end(), frame, frame + n);
+        }
+        for (; gpsCount < (ms + DEVICE_PERIOD_MS) * DEVICE_GPS_HZ / 1000; gpsCount++) {
+            GPSPacket p;
+            memset(&p, 0, sizeof(p));
+            p.timestamp = 1709987696 + gpsCount / DEVICE_GPS_HZ;
+            p.timestamp_us = (gpsCount % DEVICE_GPS_HZ) * (1000000 / DEVICE_GPS_HZ);
+            p.latitude = 521234567 + gpsCount * 40;
+            p.longitude = 210123456 + gpsCount * 95;
+            p.altitude = 112000;
+            p.speed = 12500;
+            p.heading = 6700000;
+            p.fixType = 3;
+            p.satellites = 14;
+            p.battery_mv = 3950;
+            p.battery_pct = 81;
+            p.accel_z = 1000;
+            GPSPacketCodec::seal(p);
+            n = framer.frame(USB_FRAME_GPS, &p, sizeof(p), frame);
+            out.insert(out.end(), frame, frame + n);
+        }
+        for (; imuCount < (ms + DEVICE_PERIOD_MS) * DEVICE_IMU_HZ / 1000; imuCount++) {
+            StreamIMURecord r;
+            r.timestampMicros = (int64_t)imuCount * (1000000 / DEVICE_IMU_HZ);
+            r.gnssTimeMicros = 1709987696000000LL + r.timestampMicros;
+            for (int i = 0; i < 3; i++) {
+                r.accel[i] = (int16_t)((imuCount * 37 + i * 101) % 400 - 200);
+                r.gyro[i] = (int16_t)((imuCount * 53 + i * 71) % 300 - 150);
+            }
+            r.accel[2] += 16384;
+            r.temperature = 2850;
+            n = framer.frame(USB_FRAME_IMU, &r, sizeof(r), frame);
+            out.insert(out.end(), frame, frame + n);
+        }
+    }
+}
+
+static int bench(const char* path) {
+    std::vector<uint8_t> stream;
+    double streamSeconds = 0;
+    if (path) {
+        FILE* f = fopen(path, "rb");
+        if (!f) {
+            fprintf(stderr, "Cannot read %s\n", path);
+            return 1;
+        }
+        uint8_t buffer[READ_SIZE];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) stream.insert(stream.end(), buffer, buffer + n);
+        fclose(f);
+    } else {
+        synthesizeStream(stream);
+        streamSeconds = BENCH_SECONDS;
+    }
+    if (stream.empty()) {
+        fprintf(stderr, "Nothing to decode\n");
+        return 1;
+    }
+
+    // Decode in port-sized reads until at least a second has gone by; each
+    // pass is a fresh reader, as if the port had been opened again
+    unsigned passes = 0;
+    uint64_t frames = 0;
+    bool clean = true;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        UsbStreamReader reader(nullptr, true);
+        for (size_t at = 0; at < stream.size(); at += 4096) {
+            size_t n = stream.size() - at < 4096 ? stream.size() - at : 4096;
+            reader.feed(&stream[at], n);
+        }
+        reader.flush();
+        frames += reader.frames;
+        clean = clean && reader.bad == 0 && reader.lost == 0;
+        if (++passes == 1) reader.report();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < 1.0);
+
+    double bytesPerSecond = (double)stream.size() * passes / seconds;
+    printf("%s: %zu bytes, %llu frames, %u passes\n", path ? path : "synthetic stream",
+           stream.size(), (unsigned long long)(frames / passes), passes);
+    printf("decode + CSV   %8.2f MB/s %10.0f frames/s\n", bytesPerSecond / 1e6, frames / seconds);
+    if (streamSeconds > 0) {
+        double device = stream.size() / streamSeconds;
+        printf("device stream  %8.2f MB/s %10.0f frames/s  (%.0fx headroom)\n", device / 1e6,
+               frames / passes / streamSeconds, bytesPerSecond / device);
+    }
+    printf("USB full speed %8.2f MB/s                    (%.1fx headroom)\n",
+           USB_FULL_SPEED_BYTES_PER_S / 1e6, bytesPerSecond / USB_FULL_SPEED_BYTES_PER_S);
+    return clean ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) return bench(argc > 2 ? argv[2] : nullptr);
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <port|capture.bin|-> [out_prefix]\n"
+                        "       %s --bench [capture.bin]\n", argv[0], argv[0]);
+        return 1;
+    }
+    return readStream(argv[1], argc > 2 ? argv[2] : nullptr);
+}